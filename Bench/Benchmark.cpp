@@ -0,0 +1,214 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include "Support/basics.h"
+#include "Support/Platform.h"
+
+using namespace V3DLib;
+
+namespace bench {
+
+namespace {
+
+/**
+ * Output doubles with enough digits to be useful, in a format accepted by JSON
+ */
+std::string num(double val) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.6g", val);
+  return buf;
+}
+
+
+std::string quoted(std::string const &str) {
+  std::string ret = "\"";
+
+  for (char c : str) {
+    if (c == '"' || c == '\\') ret += '\\';
+    ret += c;
+  }
+
+  return ret + "\"";
+}
+
+
+std::string timestamp() {
+  char buf[32];
+  time_t now = time(nullptr);
+  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  return buf;
+}
+
+
+std::string run_mode() {
+#ifdef QPU_MODE
+  return "qpu";
+#else
+  return "emulator";
+#endif
+}
+
+
+/**
+ * Number of QPUs to use on the current platform.
+ *
+ * The emulator can run any number of QPUs up to 12; hardware has a platform-specific maximum.
+ */
+std::vector<int> select_qpus(std::vector<int> const &in) {
+  std::vector<int> ret;
+
+  for (int n : in) {
+#ifdef QPU_MODE
+    if (n > Platform::max_qpus()) continue;
+#endif
+    if (n < 1 || n > 12) continue;
+    ret << n;
+  }
+
+  return ret;
+}
+
+}  // anon namespace
+
+
+Stats Stats::from(std::vector<double> samples) {
+  Stats ret;
+  if (samples.empty()) return ret;
+
+  std::sort(samples.begin(), samples.end());
+  int n = (int) samples.size();
+
+  double sum = 0;
+  for (double s : samples) sum += s;
+
+  ret.mean   = sum/n;
+  ret.min    = samples.front();
+  ret.max    = samples.back();
+  ret.median = (n % 2 == 1)? samples[n/2] : (samples[n/2 - 1] + samples[n/2])/2;
+
+  double sq = 0;
+  for (double s : samples) sq += (s - ret.mean)*(s - ret.mean);
+  ret.stddev = (n > 1)? std::sqrt(sq/(n - 1)) : 0;
+
+  return ret;
+}
+
+
+double Result::throughput() const {
+  if (seconds.mean <= 0) return 0;
+  return items/seconds.mean;
+}
+
+
+std::vector<std::string> Registry::names() const {
+  std::vector<std::string> ret;
+
+  for (auto const &b : m_benchmarks) {
+    ret << b.full_name();
+  }
+
+  return ret;
+}
+
+
+std::vector<Result> Registry::run(Options const &options) const {
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<Result> ret;
+
+  for (auto const &b : m_benchmarks) {
+    if (!options.filter.empty() && b.full_name().find(options.filter) == std::string::npos) continue;
+
+    std::vector<int> qpus = b.per_qpus? select_qpus(options.num_qpus) : std::vector<int>({1});
+
+    for (int num_qpus : qpus) {
+      for (int i = 0; i < options.warmup; ++i) {
+        b.run(num_qpus);
+      }
+
+      std::vector<double> samples;
+      double items = 0;
+
+      for (int i = 0; i < options.reps; ++i) {
+        auto start = Clock::now();
+        items += b.run(num_qpus);
+        std::chrono::duration<double> diff = Clock::now() - start;
+        samples.push_back(diff.count());
+      }
+
+      Result r;
+      r.group    = b.group;
+      r.name     = b.name;
+      r.unit     = b.unit;
+      r.num_qpus = num_qpus;
+      r.reps     = options.reps;
+      r.items    = (options.reps > 0)? items/options.reps : 0;
+      r.seconds  = Stats::from(samples);
+      ret << r;
+
+      if (!options.silent) {
+        printf("%-32s qpus: %2d  mean: %10.6fs  stddev: %10.6fs  %12.4g %s/s\n",
+          b.full_name().c_str(), num_qpus, r.seconds.mean, r.seconds.stddev, r.throughput(), r.unit.c_str());
+      }
+    }
+  }
+
+  return ret;
+}
+
+
+std::string to_json(std::vector<Result> const &results, Options const &options) {
+  std::string ret;
+
+  ret << "{\n"
+      << "  \"platform\": " << quoted(Platform::pi_version()) << ",\n"
+      << "  \"mode\": "     << quoted(run_mode()) << ",\n"
+      << "  \"time\": "     << quoted(timestamp()) << ",\n"
+      << "  \"warmup\": "   << options.warmup << ",\n"
+      << "  \"reps\": "     << options.reps << ",\n"
+      << "  \"results\": [";
+
+  for (int i = 0; i < (int) results.size(); ++i) {
+    auto const &r = results[i];
+
+    ret << ((i == 0)? "\n" : ",\n")
+        << "    {"
+        << "\"group\": "       << quoted(r.group)
+        << ", \"name\": "      << quoted(r.name)
+        << ", \"num_qpus\": "  << r.num_qpus
+        << ", \"reps\": "      << r.reps
+        << ", \"mean\": "      << num(r.seconds.mean)
+        << ", \"median\": "    << num(r.seconds.median)
+        << ", \"min\": "       << num(r.seconds.min)
+        << ", \"max\": "       << num(r.seconds.max)
+        << ", \"stddev\": "    << num(r.seconds.stddev)
+        << ", \"items\": "     << num(r.items)
+        << ", \"unit\": "      << quoted(r.unit)
+        << ", \"throughput\": " << num(r.throughput())
+        << "}";
+  }
+
+  ret << "\n  ]\n}\n";
+  return ret;
+}
+
+
+std::string to_csv(std::vector<Result> const &results) {
+  std::string ret;
+  ret << "group,name,num_qpus,reps,mean,median,min,max,stddev,items,unit,throughput\n";
+
+  for (auto const &r : results) {
+    ret << r.group << "," << r.name << "," << r.num_qpus << "," << r.reps << ","
+        << num(r.seconds.mean)   << "," << num(r.seconds.median) << ","
+        << num(r.seconds.min)    << "," << num(r.seconds.max)    << ","
+        << num(r.seconds.stddev) << "," << num(r.items)          << ","
+        << r.unit << "," << num(r.throughput()) << "\n";
+  }
+
+  return ret;
+}
+
+}  // namespace bench
@@ -0,0 +1,86 @@
+#ifndef _BENCH_BENCHMARK_H
+#define _BENCH_BENCHMARK_H
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Statistics over the run times of the repetitions of a benchmark, in seconds
+ */
+struct Stats {
+  double mean   = 0;
+  double median = 0;
+  double min    = 0;
+  double max    = 0;
+  double stddev = 0;
+
+  static Stats from(std::vector<double> samples);
+};
+
+
+/**
+ * A single benchmark.
+ *
+ * `run()` is called for every repetition, and returns the number of items processed in the call.
+ * The throughput is reported in items per second; `unit` is the name of the items.
+ *
+ * If `per_qpus` is set, the benchmark is run for every selected number of QPUs.
+ * Otherwise, it's run once, and the number of QPUs is passed as 1.
+ */
+struct Benchmark {
+  using Run = std::function<double(int num_qpus)>;
+
+  std::string group;
+  std::string name;
+  std::string unit;
+  bool        per_qpus = true;
+  Run         run;
+
+  std::string full_name() const { return group + "/" + name; }
+};
+
+
+struct Result {
+  std::string group;
+  std::string name;
+  std::string unit;
+  int    num_qpus = 1;
+  int    reps     = 0;
+  double items    = 0;     // Items processed per repetition, average
+  Stats  seconds;
+
+  double throughput() const;
+};
+
+
+struct Options {
+  int  warmup = 1;
+  int  reps   = 5;
+  bool silent = false;
+  std::string filter;              // Only run benchmarks with this substring in the full name
+  std::vector<int> num_qpus = {1, 8, 12};
+};
+
+
+/**
+ * Collection of benchmarks, run in order of registration.
+ */
+class Registry {
+public:
+  void add(Benchmark const &b) { m_benchmarks.push_back(b); }
+  std::vector<std::string> names() const;
+  std::vector<Result> run(Options const &options) const;
+
+private:
+  std::vector<Benchmark> m_benchmarks;
+};
+
+
+std::string to_json(std::vector<Result> const &results, Options const &options);
+std::string to_csv(std::vector<Result> const &results);
+
+}  // namespace bench
+
+#endif  // _BENCH_BENCHMARK_H
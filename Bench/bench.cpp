@@ -0,0 +1,429 @@
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark suite
+//
+// Runs a fixed set of benchmarks and outputs the results as JSON and/or CSV,
+// for tracking performance across library versions.
+//
+// Usage: bench [options]
+//
+//   -h             - Show this help text
+//   -list          - List the names of the benchmarks and exit
+//   -filter=<str>  - Only run benchmarks of which the full name contains <str>
+//   -reps=<n>      - Number of measured repetitions per benchmark (default 5)
+//   -warmup=<n>    - Number of unmeasured runs before the repetitions (default 1)
+//   -qpus=<list>   - Comma-separated numbers of QPUs to use (default 1,8,12)
+//   -json=<file>   - Write the results as JSON to <file>
+//   -csv=<file>    - Write the results as CSV to <file>
+//   -s             - Silent, don't output the results to stdout
+//
+// The problem sizes are smaller for the emulator than for the hardware, so that
+// a complete run takes a reasonable amount of time on both.
+///////////////////////////////////////////////////////////////////////////////
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include "V3DLib.h"
+#include "Source/Complex.h"
+#include "Source/Interpreter.h"
+#include "Target/Emulator.h"
+#include "Kernels/Matrix.h"
+#include "Kernels/Rot3D.h"
+#include "Kernels/Stencil.h"
+#include "Benchmark.h"
+
+using namespace V3DLib;
+using namespace bench;
+
+namespace {
+
+#ifdef QPU_MODE
+int const MatrixDim  = 192;
+int const DftDim     = 256;
+int const MandelDim  = 512;
+int const MandelIter = 512;
+int const HeatDim    = 512;
+int const Rot3DSize  = 192*1000;
+#else
+int const MatrixDim  = 48;
+int const DftDim     = 64;
+int const MandelDim  = 64;
+int const MandelIter = 128;
+int const HeatDim    = 64;
+int const Rot3DSize  = 192*10;
+#endif
+
+// Region for Mandelbrot
+float const TopLeftReal = -2.5f;
+float const TopLeftIm   =  2.0f;
+float const Range       =  4.0f;
+
+float const HeatK = 0.25f;  // Heat dissipation constant, as in the HeatMap example
+
+
+// ============================================================================
+// Kernels
+// ============================================================================
+
+/**
+ * Same as `mandelbrot_multi()` in the Mandelbrot example
+ */
+void mandelbrot_kernel(
+  Float topLeftReal, Float topLeftIm,
+  Float offsetX, Float offsetY,
+  Int numStepsWidth, Int numStepsHeight,
+  Int numIterations,
+  Int::Ptr result
+) {
+  For (Int yStep = 0, yStep < numStepsHeight - numQPUs(), yStep += numQPUs())
+    Int yIndex = yStep + me();
+    Int::Ptr dst = result + yIndex*numStepsWidth;
+
+    For (Int xStep = 0, xStep < numStepsWidth - 16, xStep += 16)
+      Int xIndex = xStep + index();
+      Complex c(topLeftReal + offsetX*toFloat(xIndex), topLeftIm - offsetY*toFloat(yIndex));
+
+      Int count = 0;
+      Complex x = c;
+      Float mag = x.mag_square();
+      FloatExpr condition = (4.0f - mag)*toFloat(numIterations - count);
+      Float checkvar = condition;
+
+      While (any(checkvar > 0.0f))
+        Where (checkvar > 0.0f)
+          x = x*x + c;
+          mag = x.mag_square();
+          count++;
+          checkvar = condition;
+        End
+      End
+
+      *dst = count;
+      dst.inc();
+    End
+  End
+}
+
+
+/**
+ * Compiled Mandelbrot kernel, shared by the benchmarks which use it
+ */
+auto &mandelbrot() {
+  static Int::Array result(MandelDim*MandelDim);
+  static auto k = compile(mandelbrot_kernel);
+  static bool loaded = false;
+
+  if (!loaded) {
+    float offset = Range/((float) MandelDim - 1);
+    k.load(TopLeftReal, TopLeftIm, offset, offset, MandelDim, MandelDim, MandelIter, &result);
+    loaded = true;
+  }
+
+  return k;
+}
+
+
+kernels::StencilMask heat_mask() {
+  float n = HeatK/8;
+
+  return kernels::StencilMask(1, {
+    n, n,          n,
+    n, 1.0f - HeatK, n,
+    n, n,          n
+  });
+}
+
+
+// ============================================================================
+// Registration of benchmarks
+// ============================================================================
+
+void add_compile_benchmarks(Registry &reg) {
+  auto add = [&reg] (std::string const &name, std::function<void()> f) {
+    Benchmark b;
+    b.group    = "compile";
+    b.name     = name;
+    b.unit     = "kernels";
+    b.per_qpus = false;
+    b.run      = [f] (int) { f(); return 1.0; };
+    reg.add(b);
+  };
+
+  add("mandelbrot", [] () {
+    auto k = compile(mandelbrot_kernel);
+  });
+
+  add("matrix_mult", [] () {
+    auto k = compile(kernels::matrix_mult_decorator(MatrixDim));
+  });
+
+  add("dft_float", [] () {
+    Float::Array input(DftDim);
+    Complex::Array2D result;
+    auto k = compile(kernels::dft_decorator(input, result));
+  });
+
+  add("rot3D", [] () {
+    auto k = compile(kernels::rot3D_2);
+  });
+
+  add("heatmap", [] () {
+    auto k = compile(kernels::stencil_decorator<Float>(heat_mask(), kernels::Boundary::ZERO));
+  });
+}
+
+
+void add_backend_benchmarks(Registry &reg) {
+  Benchmark b;
+  b.per_qpus = false;
+
+  b.group = "emulator";
+  b.name  = "mandelbrot";
+  b.unit  = "instructions";
+  b.run   = [] (int) {
+    auto &k = mandelbrot();
+    k.setNumQPUs(1);
+    uint64_t start = emulated_instruction_count();
+    k.emu();
+    return (double) (emulated_instruction_count() - start);
+  };
+  reg.add(b);
+
+  b.group = "interpreter";
+  b.name  = "mandelbrot";
+  b.unit  = "statements";
+  b.run   = [] (int) {
+    auto &k = mandelbrot();
+    k.setNumQPUs(1);
+    uint64_t start = interpreted_statement_count();
+    k.interpret();
+    return (double) (interpreted_statement_count() - start);
+  };
+  reg.add(b);
+}
+
+
+void add_throughput_benchmarks(Registry &reg) {
+  Benchmark b;
+  b.group = "throughput";
+
+  b.name = "mandelbrot";
+  b.unit = "pixels";
+  b.run  = [] (int num_qpus) {
+    auto &k = mandelbrot();
+    k.setNumQPUs(num_qpus);
+    k.call();
+    return (double) (MandelDim*MandelDim);
+  };
+  reg.add(b);
+
+  b.name = "matrix_mult";
+  b.unit = "flop";
+  b.run  = [] (int num_qpus) {
+    static Float::Array a(MatrixDim*MatrixDim);
+    static Float::Array result(MatrixDim*MatrixDim);
+    static auto k = compile(kernels::matrix_mult_decorator(MatrixDim));
+    static bool loaded = false;
+
+    if (!loaded) {
+      for (int i = 0; i < (int) a.size(); ++i) a[i] = (float) (i % 7);
+      k.load(&result, &a, &a);
+      loaded = true;
+    }
+
+    k.setNumQPUs(num_qpus);
+    k.call();
+    return 2.0*MatrixDim*MatrixDim*MatrixDim;
+  };
+  reg.add(b);
+
+  b.name = "dft_float";
+  b.unit = "elements";
+  b.run  = [] (int num_qpus) {
+    static Float::Array input(DftDim);
+    static Complex::Array2D result;
+    static auto k = compile(kernels::dft_decorator(input, result));
+    static bool loaded = false;
+
+    if (!loaded) {
+      for (int i = 0; i < DftDim; ++i) input[i] = std::sin((float) i);
+      k.load(&result, &input);
+      loaded = true;
+    }
+
+    k.setNumQPUs(num_qpus);
+    k.call();
+    return (double) DftDim;
+  };
+  reg.add(b);
+
+  b.name = "heatmap";
+  b.unit = "cells";
+  b.run  = [] (int num_qpus) {
+    static Float::Array src(HeatDim*HeatDim);
+    static Float::Array dst(HeatDim*HeatDim);
+    static auto k = compile(kernels::stencil_decorator<Float>(heat_mask(), kernels::Boundary::ZERO));
+    static bool loaded = false;
+
+    if (!loaded) {
+      src.fill(0.0f);
+      src[HeatDim*(HeatDim/2) + HeatDim/2] = 1000.0f;
+      k.load(&dst, &src, HeatDim, HeatDim);
+      loaded = true;
+    }
+
+    k.setNumQPUs(num_qpus);
+    k.call();
+    return (double) (HeatDim*HeatDim);
+  };
+  reg.add(b);
+
+  b.name = "rot3D";
+  b.unit = "points";
+  b.run  = [] (int num_qpus) {
+    static Float::Array x(Rot3DSize + 192);  // Extra space for prefetch
+    static Float::Array y(Rot3DSize + 192);
+    static auto k = compile(kernels::rot3D_2);
+    static bool loaded = false;
+
+    if (!loaded) {
+      for (int i = 0; i < Rot3DSize; ++i) {
+        x[i] = (float) i;
+        y[i] = (float) i;
+      }
+
+      k.load(Rot3DSize, std::cos(0.1f), std::sin(0.1f), &x, &y);
+      loaded = true;
+    }
+
+    k.setNumQPUs(num_qpus);
+    k.call();
+    return (double) Rot3DSize;
+  };
+  reg.add(b);
+}
+
+
+// ============================================================================
+// Command line handling
+// ============================================================================
+
+struct CmdLine {
+  Options options;
+  bool help = false;
+  bool list = false;
+  std::string json_file;
+  std::string csv_file;
+};
+
+
+bool get_value(std::string const &arg, char const *prefix, std::string &value) {
+  std::string p = prefix;
+  if (arg.compare(0, p.size(), p) != 0) return false;
+  value = arg.substr(p.size());
+  return true;
+}
+
+
+std::vector<int> parse_list(std::string const &str) {
+  std::vector<int> ret;
+  size_t pos = 0;
+
+  while (pos < str.size()) {
+    size_t next = str.find(',', pos);
+    if (next == std::string::npos) next = str.size();
+    ret.push_back(atoi(str.substr(pos, next - pos).c_str()));
+    pos = next + 1;
+  }
+
+  return ret;
+}
+
+
+bool parse(int argc, char const *argv[], CmdLine &cmd) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string val;
+
+    if (arg == "-h" || arg == "--help")           cmd.help = true;
+    else if (arg == "-list")                       cmd.list = true;
+    else if (arg == "-s")                          cmd.options.silent = true;
+    else if (get_value(arg, "-filter=", val))      cmd.options.filter = val;
+    else if (get_value(arg, "-reps=", val))        cmd.options.reps = atoi(val.c_str());
+    else if (get_value(arg, "-warmup=", val))      cmd.options.warmup = atoi(val.c_str());
+    else if (get_value(arg, "-qpus=", val))        cmd.options.num_qpus = parse_list(val);
+    else if (get_value(arg, "-json=", val))        cmd.json_file = val;
+    else if (get_value(arg, "-csv=", val))         cmd.csv_file = val;
+    else {
+      fprintf(stderr, "Unknown argument '%s', use -h for help\n", arg.c_str());
+      return false;
+    }
+  }
+
+  if (cmd.options.reps < 1 || cmd.options.warmup < 0) {
+    fprintf(stderr, "-reps must be at least 1 and -warmup can not be negative\n");
+    return false;
+  }
+
+  return true;
+}
+
+
+void usage() {
+  printf(
+    "Usage: bench [options]\n"
+    "\n"
+    "  -h             - Show this help text\n"
+    "  -list          - List the names of the benchmarks and exit\n"
+    "  -filter=<str>  - Only run benchmarks of which the full name contains <str>\n"
+    "  -reps=<n>      - Number of measured repetitions per benchmark (default 5)\n"
+    "  -warmup=<n>    - Number of unmeasured runs before the repetitions (default 1)\n"
+    "  -qpus=<list>   - Comma-separated numbers of QPUs to use (default 1,8,12)\n"
+    "  -json=<file>   - Write the results as JSON to <file>\n"
+    "  -csv=<file>    - Write the results as CSV to <file>\n"
+    "  -s             - Silent, don't output the results to stdout\n"
+  );
+}
+
+
+bool write_file(std::string const &filename, std::string const &content) {
+  std::ofstream out(filename);
+  if (!out) {
+    fprintf(stderr, "Could not open '%s' for writing\n", filename.c_str());
+    return false;
+  }
+
+  out << content;
+  return true;
+}
+
+}  // anon namespace
+
+
+int main(int argc, char const *argv[]) {
+  CmdLine cmd;
+  if (!parse(argc, argv, cmd)) return 1;
+
+  if (cmd.help) {
+    usage();
+    return 0;
+  }
+
+  Registry reg;
+  add_compile_benchmarks(reg);
+  add_backend_benchmarks(reg);
+  add_throughput_benchmarks(reg);
+
+  if (cmd.list) {
+    for (auto const &name : reg.names()) printf("%s\n", name.c_str());
+    return 0;
+  }
+
+  auto results = reg.run(cmd.options);
+
+  bool ok = true;
+  if (!cmd.json_file.empty()) ok = write_file(cmd.json_file, to_json(results, cmd.options)) && ok;
+  if (!cmd.csv_file.empty())  ok = write_file(cmd.csv_file, to_csv(results)) && ok;
+
+  return ok? 0 : 1;
+}
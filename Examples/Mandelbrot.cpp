@@ -11,7 +11,7 @@
 using namespace V3DLib;
 using std::string;
 
-std::vector<const char *> const kernels = { "multi", "single", "cpu", "all" };  // Order important! First is default, 'all' must be last
+std::vector<const char *> const kernels = { "multi", "single", "cpu", "recycle", "all" };  // Order important! First is default, 'all' must be last
 
 
 CmdParameters params = {
@@ -57,7 +57,7 @@ CmdParameters params = {
 
 
 struct MandSettings : public Settings {
-  const int ALL = 3;
+  const int ALL = 4;
 
   int    kernel;
   bool   output_pgm;
@@ -220,6 +220,74 @@ void mandelbrot_multi(
 }
 
 
+/**
+ * Multi-QPU version which refills the lanes of finished points with new points.
+ *
+ * The points are numbered as in `mandelbrot_cpu()`, and the calculation is identical.
+ * This gives the same output as `mandelbrot_cpu()` on the emulator.
+ */
+void mandelbrot_recycle(
+  Float topLeftReal, Float bottomRightIm,
+  Float offsetX, Float offsetY,
+  Int numStepsWidth, Int numItems,
+  Int numIterations,
+  Int::Ptr result
+) {
+  Float invWidth = 1.0f/toFloat(numStepsWidth);
+  Int   xStep = 0;
+  Int   yStep = 0;
+  Float realC = 0.0f;
+  Float imC   = 0.0f;
+  Float real  = 0.0f;
+  Float im    = 0.0f;
+  Float radius = 0.0f;
+  Int   count = 0;
+
+  ItemCallbacks<Int> loop;
+
+  loop.init = [&] (Int const &item) {
+    yStep = toInt((toFloat(item) + 0.5f)*invWidth);  // Correct for rounding of float calculation below
+    xStep = item - yStep*numStepsWidth;
+
+    Where (xStep < 0)
+      xStep += numStepsWidth;
+      yStep--;
+    End
+
+    Where (xStep >= numStepsWidth)
+      xStep -= numStepsWidth;
+      yStep++;
+    End
+
+    realC  = topLeftReal   + toFloat(xStep)*offsetX;
+    imC    = bottomRightIm + toFloat(yStep)*offsetY;
+    real   = realC;
+    im     = imC;
+    radius = real*real + im*im;
+    count  = 0;
+  };
+
+  loop.done = [&] () {
+    return (radius >= 4.0f || count >= numIterations);
+  };
+
+  loop.step = [&] () {
+    Float tmpReal = real*real - im*im;
+    Float tmpIm   = 2.0f*real*im;
+    real   = tmpReal + realC;
+    im     = tmpIm + imC;
+    radius = real*real + im*im;
+    count++;
+  };
+
+  loop.result = [&] () -> Int {
+    return count;
+  };
+
+  for_each_item(result, numItems, loop);
+}
+
+
 // ============================================================================
 // Local functions
 // ============================================================================
@@ -261,6 +329,25 @@ void run_qpu_kernel(KernelType &kernel) {
 }
 
 
+void run_recycle_kernel() {
+  auto k = compile(mandelbrot_recycle);
+  k.setNumQPUs(settings.num_qpus);
+
+  int size = 16*((settings.num_items() + 15)/16);  // Output is written in complete vectors
+  Int::Array result(size);
+
+  k.load(
+    settings.topLeftReal, settings.bottomRightIm,
+    settings.offsetX(), settings.offsetY(),
+    settings.numStepsWidth, settings.num_items(),
+    settings.num_iterations,
+    &result);
+
+  settings.process(k);
+  output_pgm(result);
+}
+
+
 /**
  * Run a kernel as specified by the passed kernel index
  */
@@ -279,6 +366,7 @@ void run_kernel(int kernel_index) {
         delete result;
       }
       break;
+    case 3: run_recycle_kernel(); break;
   }
 
   auto name = kernels[kernel_index];
@@ -53,6 +53,24 @@ void BaseKernel::compile_init(bool do_vc4) {
 }
 
 
+/**
+ * Check that the kernel can run on the given number of QPUs.
+ *
+ * Some library functions limit the number of QPUs for a kernel, e.g. `Tile2D`,
+ * which needs VPM space per QPU.
+ */
+void BaseKernel::check_num_qpus(int n) const {
+  if (!has_vc4()) return;
+
+  int max_qpus = vc4().compile_stats().max_qpus;
+  if (max_qpus == 0 || n <= max_qpus) return;
+
+  std::string msg;
+  msg << "Kernel can run on at most " << max_qpus << " QPUs, " << n << " requested";
+  assertq(false, msg);
+}
+
+
 bool BaseKernel::has_errors() const {
  return (has_vc4() && vc4().has_errors()) || (has_v3d() && v3d().has_errors());
 }
@@ -72,28 +90,50 @@ void BaseKernel::pretty(bool output_for_vc4, const char *filename, bool output_q
  *
  * The emulator runs vc4 code.
  */
-void BaseKernel::emu() {
+void BaseKernel::emu(QpuRange const &qpus) {
   if (vc4().has_errors()) {
     warning("Not running on emulator, there were errors during compile.");
     return;
   }
 
   assert(uniforms.size() != 0);
-  emulate(m_numQPUs, vc4().targetCode(), vc4().numVars(), uniforms, getBufferObject());
+  check_num_qpus(qpus.total);
+  emulate(qpus, vc4().targetCode(), vc4().numVars(), uniforms, getBufferObject());
 }
 
 
 /**
  * Invoke the interpreter
  */
-void BaseKernel::interpret() {
+void BaseKernel::interpret(QpuRange const &qpus) {
   if (vc4().has_errors()) {
     warning("Not running interpreter, there were errors during compile.");
     return;
   }
 
   assert(uniforms.size() != 0);
-  interpreter(m_numQPUs, vc4().sourceCode(), vc4().numVars(), uniforms, getBufferObject());
+  interpreter(qpus, vc4().sourceCode(), vc4().numVars(), uniforms, getBufferObject());
+}
+
+
+/**
+ * Run the kernel as native code on the host CPU
+ *
+ * The kernel is compiled for the CPU on the first call.
+ */
+void BaseKernel::cpu(QpuRange const &qpus) {
+  if (vc4().has_errors()) {
+    warning("Not running on CPU, there were errors during compile.");
+    return;
+  }
+
+  assert(uniforms.size() != 0);
+
+  if (!m_cpu_kernel) {
+    m_cpu_kernel.reset(new cpu::NativeKernel(vc4().sourceCode(), vc4().numVars()));
+  }
+
+  m_cpu_kernel->invoke(qpus, uniforms, getBufferObject());
 }
 
 
@@ -101,11 +141,13 @@ void BaseKernel::interpret() {
 /**
  * Invoke kernel on physical QPU hardware
  */
-void BaseKernel::qpu() {
+void BaseKernel::qpu(QpuRange const &qpus) {
+  check_num_qpus(qpus.total);
+
   if (Platform::has_vc4()) {
-    vc4().invoke(m_numQPUs, uniforms);
+    vc4().invoke(qpus, uniforms);
   } else {
-    v3d().invoke(m_numQPUs, uniforms);
+    v3d().invoke(qpus, uniforms);
   }
 }
 #endif  // QPU_MODE
@@ -144,7 +186,7 @@ std::string BaseKernel::compile_info() const {
     }
 
     if (has_v3d()) {
-      ret << "vc4:\n"
+      ret << "v3d:\n"
           << v3d().compile_info() << "\n\n";
     }
   }
@@ -153,6 +195,29 @@ std::string BaseKernel::compile_info() const {
 }
 
 
+/**
+ * Compile statistics per kernel driver, in JSON format.
+ *
+ * Intended for tracking compile times and instruction counts over library versions.
+ */
+std::string BaseKernel::compile_info_json() const {
+  std::string ret;
+  ret << "{";
+
+  if (has_vc4()) {
+    ret << "\"vc4\": " << vc4().compile_info_json();
+  }
+
+  if (has_v3d()) {
+    if (has_vc4()) ret << ", ";
+    ret << "\"v3d\": " << v3d().compile_info_json();
+  }
+
+  ret << "}";
+  return ret;
+}
+
+
 void BaseKernel::dump_compile_data(bool output_for_vc4, char const *filename) {
   if (output_for_vc4) {
     vc4().dump_compile_data(filename);
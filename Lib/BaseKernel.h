@@ -3,6 +3,7 @@
 #include <memory>
 #include "vc4/KernelDriver.h"
 #include "v3d/KernelDriver.h"
+#include "cpu/NativeKernel.h"
 
 namespace V3DLib {
 
@@ -16,6 +17,7 @@ namespace V3DLib {
  *
  *     - interpret(...)  - run on source code interpreter
  *     - emu(...)        - run on the target code emulator (`vc4` code only)
+ *     - cpu(...)        - run as native code on the host CPU, see `cpu::NativeKernel`
  *     - qpu(...)        - run on physical QPUs (only when QPU_MODE enabled))
  *     - call(...)       - depending on QPU_MODE, call `qpu()` or `emu()`
  *                      This is useful for cross-platform compatibility
@@ -67,17 +69,26 @@ public:
   void compile_init(bool do_vc4);
   void pretty(bool output_for_vc4, const char *filename = nullptr, bool output_qpu_code = true);
 
-  BaseKernel &setNumQPUs(int n) { m_numQPUs = n; return *this; }
+  BaseKernel &setNumQPUs(int n) { check_num_qpus(n); m_numQPUs = n; return *this; }
   int numQPUs() const { return m_numQPUs; }
 
-  void emu();
-  void interpret();
+  void emu()       { emu(m_numQPUs); }
+  void interpret() { interpret(m_numQPUs); }
+  void cpu()       { cpu(m_numQPUs); }
   void call();
+
+  // Run on part of the QPU id's only, see `QpuRange`
+  void emu(QpuRange const &qpus);
+  void interpret(QpuRange const &qpus);
+  void cpu(QpuRange const &qpus);
+
 #ifdef QPU_MODE
-  void qpu();
+  void qpu()       { qpu(m_numQPUs); }
+  void qpu(QpuRange const &qpus);
 #endif  // QPU_MODE
 
   std::string compile_info() const;
+  std::string compile_info_json() const;
   void dump_compile_data(bool output_for_vc4, char const *filename);
   int v3d_kernel_size() const;
   bool has_errors() const;
@@ -85,6 +96,8 @@ public:
   std::string info() const;
 
 protected:
+  void check_num_qpus(int n) const;
+
   int m_numQPUs = 1;               // Number of QPUs to run on
   IntList uniforms;                // Parameters to be passed to kernel
 
@@ -92,6 +105,7 @@ protected:
   // (There are other reasons but this is the main one)
   std::unique_ptr<vc4::KernelDriver> m_vc4_driver;
   std::unique_ptr<v3d::KernelDriver> m_v3d_driver;
+  std::unique_ptr<cpu::NativeKernel> m_cpu_kernel;  // Created on first call of `cpu()`
 };
 
 
@@ -1,4 +1,7 @@
 #include "CompileData.h"
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
 #include "Support/basics.h"
 
 namespace V3DLib {
@@ -7,10 +10,134 @@ namespace V3DLib {
 
 CompileData compile_data;
 
+namespace {
+
+double now() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * Current resident memory of the process in KB, 0 if it can not be determined.
+ *
+ * Taken from /proc/self/statm, the second field is the resident page count.
+ */
+long rss_kb() {
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == nullptr) return 0;
+
+  long size = 0;
+  long resident = 0;
+  int count = fscanf(f, "%ld %ld", &size, &resident);
+  fclose(f);
+  if (count != 2) return 0;
+
+  return resident*(sysconf(_SC_PAGESIZE)/1024);
+}
+
+
+std::string num(double val) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.6f", val);
+  return buf;
+}
+
+}  // anon namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Class PhaseTimer
+///////////////////////////////////////////////////////////////////////////////
+
+PhaseTimer::PhaseTimer(char const *name, int instrs_before) {
+  m_phase.name          = name;
+  m_phase.instrs_before = instrs_before;
+  m_phase.rss_delta_kb  = rss_kb();
+  m_start = now();
+}
+
+
+PhaseTimer::~PhaseTimer() {
+  if (!m_ended) end();
+}
+
+
+void PhaseTimer::end(int instrs_after) {
+  assert(!m_ended);
+  m_phase.seconds      = now() - m_start;
+  m_phase.instrs_after = instrs_after;
+  m_phase.rss_kb       = rss_kb();
+  m_phase.rss_delta_kb = m_phase.rss_kb - m_phase.rss_delta_kb;
+  m_ended = true;
+
+  compile_data.phases.push_back(m_phase);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Class CompileData
+///////////////////////////////////////////////////////////////////////////////
+
+double CompileData::total_seconds() const {
+  double ret = 0;
+
+  for (auto const &p : phases) {
+    ret += p.seconds;
+  }
+
+  return ret;
+}
+
+
+std::string CompileData::phases_dump() const {
+  std::string ret;
+  char buf[128];
+
+  for (auto const &p : phases) {
+    snprintf(buf, sizeof(buf), "    %-20s: %10.6fs, instrs %6d -> %6d, rss %7ldKB (%+ldKB)\n",
+      p.name.c_str(), p.seconds, p.instrs_before, p.instrs_after, p.rss_kb, p.rss_delta_kb);
+    ret << buf;
+  }
+
+  return ret;
+}
+
+
+std::string CompileData::phases_json() const {
+  std::string ret;
+
+  ret << "{\"total_seconds\": " << num(total_seconds())
+      << ", \"num_accs_introduced\": " << num_accs_introduced
+      << ", \"num_immediates_hoisted\": " << num_immediates_hoisted
+      << ", \"num_invariants_hoisted\": " << num_invariants_hoisted
+      << ", \"num_induction_vars_reduced\": " << num_induction_vars_reduced
+      << ", \"phases\": [";
+
+  for (int i = 0; i < (int) phases.size(); ++i) {
+    auto const &p = phases[i];
+
+    ret << ((i == 0)? "" : ", ")
+        << "{\"name\": \"" << p.name << "\""
+        << ", \"seconds\": "       << num(p.seconds)
+        << ", \"instrs_before\": " << p.instrs_before
+        << ", \"instrs_after\": "  << p.instrs_after
+        << ", \"rss_kb\": "        << p.rss_kb
+        << ", \"rss_delta_kb\": "  << p.rss_delta_kb
+        << "}";
+  }
+
+  ret << "]}";
+  return ret;
+}
+
+
 std::string CompileData::dump() const {
   std::string ret;
 
-  ret << title("Liveness dump")
+  ret << title("Compile phases")
+      << phases_dump()
+      << title("Liveness dump")
       << liveness_dump
       << title("Reg usage dump")
       << reg_usage_dump
@@ -43,7 +170,12 @@ void CompileData::clear() {
   target_code_before_liveness.clear();
   allocated_registers_dump.clear();
   num_accs_introduced = 0;
+  num_immediates_hoisted = 0;
+  num_invariants_hoisted = 0;
+  num_induction_vars_reduced = 0;
   num_instructions_combined = 0;
+  max_qpus = 0;
+  phases.clear();
 }
 
 }  // namespace V3DLib
@@ -6,6 +6,24 @@
 
 namespace V3DLib {
 
+/**
+ * Statistics for a single phase of the compilation.
+ *
+ * Instruction counts are -1 if not applicable to the phase.
+ * `rss_kb` is the resident memory of the process at the end of the phase,
+ * `rss_delta_kb` the change in resident memory during the phase; this can be negative.
+ * Both are 0 if the resident memory can not be determined.
+ */
+struct CompilePhase {
+  std::string name;
+  double seconds      = 0;
+  int    instrs_before = -1;
+  int    instrs_after  = -1;
+  long   rss_kb        = 0;
+  long   rss_delta_kb  = 0;
+};
+
+
 struct CompileData {
   std::string liveness_dump;
   std::string target_code_before_optimization;
@@ -14,14 +32,41 @@ struct CompileData {
   std::string allocated_registers_dump;
   std::string reg_usage_dump;
   int num_accs_introduced = 0;
+  int num_immediates_hoisted = 0;
+  int num_invariants_hoisted = 0;
+  int num_induction_vars_reduced = 0;
   int num_instructions_combined = 0;
+  int max_qpus = 0;  // Max number of QPUs the kernel can run on, 0 if not limited
+  std::vector<CompilePhase> phases;
 
+  double total_seconds() const;
+  std::string phases_dump() const;
+  std::string phases_json() const;
   std::string dump() const;
   void clear();
 };
 
 extern CompileData compile_data;
 
+
+/**
+ * Records the statistics of a compile phase into `compile_data`.
+ *
+ * Recording happens in `end()` or, if that wasn't called, in the dtor.
+ */
+class PhaseTimer {
+public:
+  PhaseTimer(char const *name, int instrs_before = -1);
+  ~PhaseTimer();
+
+  void end(int instrs_after = -1);
+
+private:
+  CompilePhase m_phase;
+  double m_start;
+  bool   m_ended = false;
+};
+
 }  // namespace V3DLib
 
 #endif  // _V3DLIB_COMMON_COMPILEDATA_H_
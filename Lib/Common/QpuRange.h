@@ -0,0 +1,52 @@
+#ifndef _V3DLIB_COMMON_QPURANGE_H_
+#define _V3DLIB_COMMON_QPURANGE_H_
+#include <cassert>
+
+namespace V3DLib {
+
+/**
+ * The QPU id's for an invocation of a kernel.
+ *
+ * Normally, a kernel runs on `count` QPUs with id's `0..count-1`, and `numQPUs()` in the kernel
+ * returns `count`.
+ *
+ * When the work of a kernel is split between executors (see `SplitKernel`), each executor runs
+ * a consecutive part of the id's of a larger, logical set of `total` QPUs.
+ * In the kernel, `me()` and `numQPUs()` then return the logical values.
+ *
+ * ------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. On termination of a `vc4` kernel, the first QPU of an invocation waits for the others
+ *    to finish and then signals the host. It is passed the number of QPUs to wait for
+ *    in a uniform, see `finish()`.
+ */
+struct QpuRange {
+  QpuRange(int in_count) : QpuRange(0, in_count, in_count) {}
+
+  QpuRange(int in_first, int in_count, int in_total) :
+    first(in_first),
+    count(in_count),
+    total(in_total)
+  {
+    assert(0 <= first && 0 < count && first + count <= total);
+  }
+
+  int id(int i) const { return first + i; }
+
+  /**
+   * Value of the termination uniform for given QPU in this invocation.
+   *
+   * @return number of QPUs to wait for, -1 if the QPU needs to signal the first QPU.
+   */
+  int finish(int i) const { return (i == 0)? count - 1 : -1; }
+
+  int first;  // Logical id of first QPU
+  int count;  // Number of QPUs running in this invocation
+  int total;  // Logical number of QPUs, value of `numQPUs()`
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_COMMON_QPURANGE_H_
@@ -8,6 +8,26 @@ BaseSharedArray::BaseSharedArray(BufferObject *heap, uint32_t element_size) :
 {}
 
 
+/**
+ * Create a view on a sub-range of the parent array.
+ *
+ * @param offset  index of first element of the view within parent
+ * @param n       number of elements in the view
+ */
+BaseSharedArray::BaseSharedArray(BaseSharedArray const &parent, uint32_t offset, uint32_t n) :
+  m_heap(parent.m_heap),
+  m_element_size(parent.m_element_size)
+{
+  assertq(parent.allocated(), "SharedArray view: parent array not allocated", true);
+  assertq(n > 0 && offset + n <= parent.size(), "SharedArray view: range outside of parent array", true);
+
+  m_usraddr      = parent.m_usraddr + offset*m_element_size;
+  m_phyaddr      = parent.m_phyaddr + offset*m_element_size;
+  m_size         = n;
+  m_is_heap_view = true;
+}
+
+
 bool BaseSharedArray::allocated() const {
   if (m_size > 0) {
     assert(m_heap != nullptr);
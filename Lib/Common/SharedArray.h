@@ -1,6 +1,8 @@
 #ifndef _V3DLIB_COMMON_SHAREDARRAY_H_
 #define _V3DLIB_COMMON_SHAREDARRAY_H_
 #include <vector>
+#include <cstring>
+#include <algorithm>
 #include "BufferObject.h"
 #include "../Support/basics.h"
 #include "../Support/Platform.h"  // has_vc4
@@ -17,15 +19,18 @@ public:
   bool allocated() const;
   uint32_t getAddress() const { return m_phyaddr; }
   uint32_t size() const { return m_size; }
+  uint32_t size_in_bytes() const { return m_size*m_element_size; }
   bool empty() const { return size() == 0; }
 
   void heap_view(BufferObject &heap);
+  bool is_view() const { return m_is_heap_view; }
 
 protected:
   uint8_t *m_usraddr = nullptr;  // Start of the heap in main memory, as seen by the CPU
 
   BaseSharedArray(BufferObject *heap, uint32_t element_size);
   BaseSharedArray(uint32_t element_size) : BaseSharedArray(nullptr, element_size) {}
+  BaseSharedArray(BaseSharedArray const &parent, uint32_t offset, uint32_t n);
 
   uint32_t phy(uint32_t i);
 
@@ -49,6 +54,20 @@ private:
  *
  * For vc4, this is a change. Previously, each SharedArray instance had its
  * own BO. Experience will tell if this new setup works
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * A view is a SharedArray which refers to a sub-range of another SharedArray.
+ *   It does not own the memory; deallocating a view does nothing to the heap.
+ *   A view can be passed as a kernel parameter like any other array.
+ *
+ *   The parent array must outlive its views.
+ *
+ * * Kernels write in blocks of 16 elements. If the size of a view passed to a kernel
+ *   is not a multiple of 16, the kernel may write past the end of the view
+ *   into the parent array.
  */
 template <typename T>
 class SharedArray : public BaseSharedArray {
@@ -60,6 +79,11 @@ public:
   SharedArray(uint32_t n, BufferObject &heap) : BaseSharedArray(&heap, sizeof(T)) { Parent::alloc(n); }
   SharedArray(BufferObject &heap) : BaseSharedArray(&heap, sizeof(T)) {}
 
+  /**
+   * Create a view on a sub-range of `parent`
+   */
+  SharedArray(SharedArray const &parent, uint32_t offset, uint32_t n) : BaseSharedArray(parent, offset, n) {}
+
   SharedArray(SharedArray &&a) = default;
   SharedArray &operator=(SharedArray &&a) = default; 
 
@@ -68,10 +92,11 @@ public:
   T const *ptr() const { return (T *) m_usraddr; }  // Return pointer to data in main memory
   T *ptr() { return (T *) m_usraddr; }
 
+  SharedArray view(uint32_t offset, uint32_t n) const { return SharedArray(*this, offset, n); }
+
   void fill(T val) {
     assertq(allocated(), "Can not fill unallocated array", true);
-    for (int i = 0; i < (int) size(); i++)
-      (*this)[i] = val;
+    std::fill_n(ptr(), size(), val);
   }
 
 
@@ -91,33 +116,32 @@ public:
 
   void copyFrom(T const *src, uint32_t in_size) {
     assert(src != nullptr);
-    assert(in_size <= size());
-
-    // TODO: consider using memcpy() instead
-    for (uint32_t offset = 0; offset < in_size; ++offset) {
-      (*this)[offset] = src[offset];
-    }
+    assert(allocated());
+    assertq(in_size <= size(), "SharedArray::copyFrom(): source larger than array", true);
+    memcpy(ptr(), src, in_size*sizeof(T));
   }
 
   void copyFrom(std::vector<T> const &src) {
     assert(!src.empty());
-    assert(src.size() <= size());
+    copyFrom(src.data(), (uint32_t) src.size());
+  }
 
-    // TODO: consider using memcpy() instead
-    for (uint32_t offset = 0; offset < src.size(); ++offset) {
-      (*this)[offset] = src[offset];
-    }
+  void copyFrom(SharedArray const &src) {
+    assert(src.allocated());
+    copyFrom(src.ptr(), src.size());
   }
 
-  void copyTo(std::vector<T> &dst) {
-    assert(!empty());
+  void copyTo(T *dst, uint32_t in_size) const {
+    assert(dst != nullptr);
+    assert(allocated());
+    assertq(in_size <= size(), "SharedArray::copyTo(): requested more elements than in array", true);
+    memcpy(dst, ptr(), in_size*sizeof(T));
+  }
 
+  void copyTo(std::vector<T> &dst) const {
+    assert(!empty());
     dst.resize(size());
-
-    // TODO: consider using memcpy() instead
-    for (uint32_t offset = 0; offset < size(); ++offset) {
-      dst[offset] = (*this)[offset];
-    }
+    copyTo(dst.data(), size());
   }
 
 
@@ -159,12 +183,7 @@ public:
 
   bool operator==(SharedArray const &rhs) const { 
     if (size() != rhs.size()) return false;
-
-    for (int i = 0; i < (int) size(); ++i) {
-      if ((*this)[i] != rhs[i]) return false;
-    }
-
-    return true;
+    return std::equal(ptr(), ptr() + size(), rhs.ptr());
   }
 
 protected:
@@ -188,6 +207,51 @@ protected:
 };
 
 
+/**
+ * Copy the `rows` x `columns` block at `src` transposed to `dst`.
+ *
+ * The copy is done in square tiles, so that the source and destination lines in use
+ * stay in the cache. The inner loop is over contiguous source elements, which the
+ * compiler can vectorize.
+ *
+ * @param dst_stride  distance between rows in `dst`
+ * @param src_stride  distance between rows in `src`
+ */
+template<typename T>
+void transpose_blocked(T *dst, int dst_stride, T const *src, int src_stride, int rows, int columns) {
+  int const TILE = 16;
+
+  for (int r0 = 0; r0 < rows; r0 += TILE) {
+    int r1 = std::min(r0 + TILE, rows);
+
+    for (int c0 = 0; c0 < columns; c0 += TILE) {
+      int c1 = std::min(c0 + TILE, columns);
+
+      for (int r = r0; r < r1; ++r) {
+        T const *src_row = src + r*src_stride;
+        T *dst_col = dst + r;
+
+        for (int c = c0; c < c1; ++c) {
+          dst_col[c*dst_stride] = src_row[c];
+        }
+      }
+    }
+  }
+}
+
+
+/**
+ * Two-dimensional array, stored row by row.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * A view on a rectangular block within another 2D array can be made with `view()`.
+ *   The rows of a view are `stride()` elements apart; this is the number of columns
+ *   of the array viewed. For kernels working on views, the stride needs to be passed
+ *   as a parameter.
+ */
 template <typename T>
 class Shared2DArray : private SharedArray<T> {
   using Parent = SharedArray<T>;
@@ -213,43 +277,87 @@ public:
 
   Shared2DArray() = default;
 
-  Shared2DArray(int rows, int columns) : Parent(rows*columns),  m_rows(rows), m_columns(columns) {
+  Shared2DArray(int rows, int columns) : Parent(rows*columns),  m_rows(rows), m_columns(columns), m_stride(columns) {
     validate();
   }
 
   Shared2DArray(int dimension) : Shared2DArray(dimension, dimension) {}  // for square array
 
+  /**
+   * Create a view on the block of `parent` starting at (`row`, `col`), with given dimensions
+   */
+  Shared2DArray(Shared2DArray const &parent, int row, int col, int rows, int columns) :
+    Parent(parent,
+      (uint32_t) (row*parent.m_stride + col),
+      (uint32_t) ((rows - 1)*parent.m_stride + columns)),
+    m_rows(rows),
+    m_columns(columns),
+    m_stride(parent.m_stride)
+  {
+    assertq(0 <= row && 0 < rows && row + rows <= parent.m_rows, "Shared2DArray view: rows out of range", true);
+    assertq(0 <= col && 0 < columns && col + columns <= parent.m_columns, "Shared2DArray view: columns out of range", true);
+  }
+
   void alloc(uint32_t rows, uint32_t columns) {
     m_rows = rows;
     m_columns = columns;
+    m_stride = columns;
     validate();
 
     Parent::alloc(rows*columns);
   }
 
-  using Parent::fill;
+  Shared2DArray view(int row, int col, int rows, int columns) const {
+    return Shared2DArray(*this, row, col, rows, columns);
+  }
+
   using Parent::getAddress;
   using Parent::allocated;
+  using Parent::is_view;
 
-  Parent const &get_parent() { return (Parent const &) *this; }  // explicit cast
+  Parent const &get_parent() const { return (Parent const &) *this; }  // explicit cast
 
   int rows()    const { return m_rows; }
   int columns() const { return m_columns; }
+  int stride()  const { return m_stride; }
+  bool is_contiguous() const { return m_stride == m_columns; }
+
+  T *row_ptr(int row) {
+    assert(0 <= row && row < m_rows);
+    return ptr() + row*m_stride;
+  }
+
+  T const *row_ptr(int row) const {
+    assert(0 <= row && row < m_rows);
+    return ptr() + row*m_stride;
+  }
+
+  void fill(T val) {
+    if (is_contiguous()) {
+      Parent::fill(val);
+      return;
+    }
+
+    for (int r = 0; r < m_rows; ++r) {
+      std::fill_n(row_ptr(r), m_columns, val);
+    }
+  }
 
   /**
-   * Copy values from square array `a` to array `b`, tranposing the array in the process
+   * Copy values from array `rhs` to this array, tranposing the array in the process.
+   *
+   * If this array is not allocated, it is allocated with the transposed dimensions of `rhs`.
+   * Either array may be a view.
    */
   void copy_transposed(Shared2DArray const &rhs) {
-    assertq(is_square() && rhs.is_square(), "copy_transposed(): can only transpose if both arrays are square");
-    assertq(m_rows == rhs.m_rows, "copy_transposed(): can only copy if arrays have same dimension");
+    if (!allocated()) {
+      alloc(rhs.m_columns, rhs.m_rows);
+    }
 
-    int dim = m_rows;
+    assertq(m_rows == rhs.m_columns && m_columns == rhs.m_rows,
+      "copy_transposed(): dimensions must be those of the transposed source");
 
-    for (int r = 0; r < dim; r++) {
-      for (int c = 0; c < dim; c++) {
-        (*this)[c][r] = rhs[r][c];
-      }
-    }
+    transpose_blocked(ptr(), m_stride, rhs.ptr(), rhs.m_stride, rhs.m_rows, rhs.m_columns);
   }
 
   bool is_square() const {
@@ -257,17 +365,23 @@ public:
   }
 
   bool operator==(Shared2DArray const &rhs) const { 
-    return ((Parent &) *this) == rhs;
+    if (m_rows != rhs.m_rows || m_columns != rhs.m_columns) return false;
+
+    for (int r = 0; r < m_rows; ++r) {
+      if (!std::equal(row_ptr(r), row_ptr(r) + m_columns, rhs.row_ptr(r))) return false;
+    }
+
+    return true;
   }
 
   Row operator[] (int row) {
     assert(0 <= row && row < m_rows);
-    return Row(this, row, m_columns);
+    return Row(this, row, m_stride);
   }
 
   Row operator[] (int row) const {  // grumbl
     assert(0 <= row && row < m_rows);
-    return Row(this, row, m_columns);
+    return Row(this, row, m_stride);
   }
 
   void make_unit_matrix() {
@@ -277,7 +391,7 @@ public:
 
     for (int r = 0; r < dim; r++) {
       for (int c = 0; c < dim; c++) {
-        Parent::access(r*dim + c) = (r == c)? 1 : 0;
+        Parent::access(r*m_stride + c) = (r == c)? 1 : 0;
       }
     }
   }
@@ -303,23 +417,42 @@ public:
   }
 
 
-  void copyTo(std::vector<T> &dst) {
+  void copyTo(std::vector<T> &dst) const {
     assert(rows() > 0);
     assert(columns() > 0);
 
     dst.resize(rows()*columns());
 
     for (int r = 0; r < rows(); ++r) {
-      for (int c = 0; c < columns(); ++c) {
-        int offset = r*columns() + c;
-        dst[offset] = (*this)[r][c];
-      }
+      memcpy(dst.data() + r*columns(), row_ptr(r), columns()*sizeof(T));
+    }
+  }
+
+  /**
+   * Copy from a source with the same dimensions, row by row.
+   *
+   * Either array may be a view.
+   */
+  void copyFrom(Shared2DArray const &src) {
+    assertq(rows() == src.rows() && columns() == src.columns(), "Shared2DArray::copyFrom(): dimensions differ", true);
+
+    for (int r = 0; r < rows(); ++r) {
+      memcpy(row_ptr(r), src.row_ptr(r), columns()*sizeof(T));
+    }
+  }
+
+  void copyFrom(std::vector<T> const &src) {
+    assertq((int) src.size() == rows()*columns(), "Shared2DArray::copyFrom(): sizes differ", true);
+
+    for (int r = 0; r < rows(); ++r) {
+      memcpy(row_ptr(r), src.data() + r*columns(), columns()*sizeof(T));
     }
   }
 
 private:
   int m_rows    = -1;  // init to illegal value
   int m_columns = -1;
+  int m_stride  = -1;  // Distance between rows, differs from m_columns for views
 
   void validate() {
     assert(m_rows > 0);
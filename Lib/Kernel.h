@@ -3,7 +3,7 @@
 #include <tuple>
 #include <algorithm>  // std::move
 #include "BaseKernel.h"
-#include "Source/Complex.h"
+#include "KernelParams.h"
 //#include "Support/assign.h"
 
 namespace V3DLib {
@@ -15,39 +15,6 @@ enum CompileFor {
 };
 
 
-// ============================================================================
-// Parameter passing
-// ============================================================================
-
-template <typename... ts> inline void nothing(ts... args) {}
-
-
-template <typename T, typename t> inline bool passParam(IntList &uniforms, t x) {
-  return T::passParam(uniforms, x);
-}
-
-
-/**
- * Grumbl still need special override for 2D shared array.
- * Sort of patched this, will sort it out another time.
- *
- * You can not possibly have any idea how long it took me to implement and use this correctly.
- * Even so, I'm probably doing it wrong.
- */
-template <>
-inline bool passParam< Float::Ptr, Float::Array2D * > (IntList &uniforms, Float::Array2D *p) {
-  return Float::Ptr::passParam(uniforms, &((BaseSharedArray const &) p->get_parent()));
-}
-
-
-template <>
-inline bool passParam< Complex::Ptr, Complex::Array2D * > (IntList &uniforms, Complex::Array2D *p) {
-  passParam< Float::Ptr, Float::Array2D * > (uniforms, &p->re());
-  passParam< Float::Ptr, Float::Array2D * > (uniforms, &p->im());
-  return true;
-}
-
-
 /**
  * API kernel definition.
  *
@@ -0,0 +1,146 @@
+#include "KernelCache.h"
+#include "Support/basics.h"
+
+namespace V3DLib {
+
+///////////////////////////////////////////////////////////////////////////////
+// Class KernelKey
+///////////////////////////////////////////////////////////////////////////////
+
+bool KernelKey::operator==(KernelKey const &rhs) const {
+  return id == rhs.id
+      && shape == rhs.shape
+      && num_qpus == rhs.num_qpus
+      && compile_for == rhs.compile_for;
+}
+
+
+std::string KernelKey::dump() const {
+  using ::operator<<;  // C++ weirdness
+
+  std::string ret;
+  ret << "'" << id << "' (";
+
+  for (int i = 0; i < (int) shape.size(); ++i) {
+    if (i != 0) ret << ", ";
+    ret << shape[i];
+  }
+
+  ret << "), num QPUs: " << num_qpus << ", compile for: ";
+
+  switch (compile_for) {
+    case VC4:  ret << "vc4";  break;
+    case V3D:  ret << "v3d";  break;
+    case BOTH: ret << "both"; break;
+  }
+
+  return ret;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Class KernelCache
+///////////////////////////////////////////////////////////////////////////////
+
+KernelCache::KernelCache(int max_size) {
+  this->max_size(max_size);
+}
+
+
+/**
+ * Set the maximum number of kernels to retain.
+ *
+ * If there are more kernels present, the least recently used are evicted.
+ */
+void KernelCache::max_size(int val) {
+  assertq(val > 0, "KernelCache: max size must be positive");
+  m_max_size = val;
+
+  while (size() > m_max_size) {
+    evict();
+  }
+}
+
+
+bool KernelCache::contains(KernelKey const &key) const {
+  for (auto const &entry : m_entries) {
+    if (entry.key == key) return true;
+  }
+
+  return false;
+}
+
+
+void KernelCache::clear() {
+  m_entries.clear();
+}
+
+
+std::string KernelCache::dump() const {
+  using ::operator<<;  // C++ weirdness
+
+  std::string ret;
+  ret << "Kernel cache, size: " << size() << "/" << m_max_size
+      << ", hits: " << m_hits << ", misses: " << m_misses << ", evictions: " << m_evictions << "\n";
+
+  for (auto const &entry : m_entries) {
+    ret << "  " << entry.key.dump() << "\n";
+  }
+
+  return ret;
+}
+
+
+/**
+ * Look up the kernel for given key.
+ *
+ * If found, the entry is moved to the front of the LRU list.
+ *
+ * @return pointer to kernel if found, nullptr otherwise
+ */
+BaseKernel *KernelCache::find(KernelKey const &key, std::type_index const &type) {
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (!(it->key == key)) continue;
+
+    if (it->type != type) {
+      using ::operator<<;  // C++ weirdness
+
+      std::string msg;
+      msg << "KernelCache: kernel for key " << key.dump() << " has different parameter types";
+      assertq(false, msg);
+      return nullptr;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it);
+    return m_entries.front().kernel.get();
+  }
+
+  return nullptr;
+}
+
+
+BaseKernel *KernelCache::add(KernelKey const &key, std::type_index const &type, std::shared_ptr<BaseKernel> k) {
+  assert(k);
+
+  while (size() >= m_max_size) {
+    evict();
+  }
+
+  m_entries.push_front({key, type, k});
+  return k.get();
+}
+
+
+/**
+ * Remove the least recently used kernel.
+ *
+ * This deletes the kernel, and thereby releases its code memory.
+ */
+void KernelCache::evict() {
+  if (m_entries.empty()) return;
+
+  m_entries.pop_back();
+  m_evictions++;
+}
+
+}  // namespace V3DLib
@@ -0,0 +1,119 @@
+#ifndef _V3DLIB_KERNELCACHE_H_
+#define _V3DLIB_KERNELCACHE_H_
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <typeindex>
+#include "Kernel.h"
+
+namespace V3DLib {
+
+/**
+ * Key for looking up a compiled kernel in a `KernelCache`.
+ *
+ * `id` identifies the kernel function, `shape` holds the values which are baked into
+ * the kernel during compilation; typically these are the dimensions of the data.
+ * Any other setting which influences the compilation (e.g. `LibSettings`) should be
+ * made part of `id` or `shape` by the caller.
+ */
+struct KernelKey {
+  std::string      id;
+  std::vector<int> shape;
+  int              num_qpus    = 1;
+  CompileFor       compile_for = BOTH;
+
+  bool operator==(KernelKey const &rhs) const;
+  std::string dump() const;
+};
+
+
+/**
+ * Registry of compiled kernels, with bounded LRU eviction.
+ *
+ * Kernels which bake dimensions into the generated code must be compiled afresh for every shape.
+ * This cache retains the most recently used kernels, so that recurring shapes are compiled only once.
+ *
+ * When the cache is full, the least recently used kernel is removed. This deletes the kernel,
+ * which releases the memory used for its code.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * A kernel returned by `get()` is owned by the cache.
+ *   The reference becomes invalid when the kernel is evicted, i.e. on a subsequent
+ *   call to `get()` with another key, or on `clear()`.
+ *
+ * * The kernel function is only called for compilation on a cache miss.
+ *   Any global settings the kernel depends on (e.g. `matrix_settings` via a decorator)
+ *   must be set before calling `get()`, also on a hit.
+ *
+ * * If many different shapes are used, consider the kernels which take the dimensions
+ *   as uniforms instead, `kernels::matrix_mult_dims()` and `kernels::dft_dims()`.
+ *   These need to be compiled only once, at the cost of some runtime.
+ */
+class KernelCache {
+public:
+  enum {
+    DEFAULT_MAX_SIZE = 8
+  };
+
+  KernelCache(int max_size = DEFAULT_MAX_SIZE);
+
+  /**
+   * Return the compiled kernel for the given key.
+   *
+   * If not present, kernel function `f` is compiled and added to the cache.
+   * The number of QPUs of the returned kernel is set to the value in the key.
+   */
+  template <typename... ts>
+  Kernel<ts...> &get(KernelKey const &key, void (*f)(ts... params)) {
+    using KernelType = Kernel<ts...>;
+    std::type_index type = typeid(KernelType);
+
+    BaseKernel *k = find(key, type);
+
+    if (k == nullptr) {
+      m_misses++;
+      std::shared_ptr<BaseKernel> ptr(new KernelType(f, key.compile_for));
+      k = add(key, type, ptr);
+    } else {
+      m_hits++;
+    }
+
+    k->setNumQPUs(key.num_qpus);
+    return *((KernelType *) k);
+  }
+
+  bool contains(KernelKey const &key) const;
+  void max_size(int val);
+  int  max_size() const { return m_max_size; }
+  int  size() const     { return (int) m_entries.size(); }
+  int  hits() const     { return m_hits; }
+  int  misses() const   { return m_misses; }
+  int  evictions() const { return m_evictions; }
+  void clear();
+  std::string dump() const;
+
+private:
+  struct Entry {
+    KernelKey                   key;
+    std::type_index             type;
+    std::shared_ptr<BaseKernel> kernel;  // shared_ptr retains the deleter for the actual kernel type
+  };
+
+  int m_max_size  = DEFAULT_MAX_SIZE;
+  int m_hits      = 0;
+  int m_misses    = 0;
+  int m_evictions = 0;
+  std::list<Entry> m_entries;            // Most recently used first
+
+  BaseKernel *find(KernelKey const &key, std::type_index const &type);
+  BaseKernel *add(KernelKey const &key, std::type_index const &type, std::shared_ptr<BaseKernel> k);
+  void evict();
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_KERNELCACHE_H_
@@ -6,9 +6,9 @@
 #include "Source/Pretty.h"
 #include "Source/Translate.h"
 #include "Source/Lang.h"       // initStmt
+#include "Source/Function.h"
 #include "Target/Satisfy.h"
 #include "SourceTranslate.h"
-#include "Support/Timer.h"
 #include "Target/instr/Mnemonics.h"
 
 namespace V3DLib {
@@ -120,16 +120,20 @@ void compile_postprocess(Instr::List &targetCode) {
   assertq(!targetCode.empty(), "compile_postprocess(): passed target code is empty");
 
   if (Platform::compiling_for_vc4()) {
+    PhaseTimer t("loadStorePass", targetCode.size());
     loadStorePass(targetCode);
+    t.end(targetCode.size());
   }
 
   //compile_data.target_code_before_regalloc = targetCode.dump();
 
   // Perform register allocation
-  getSourceTranslate().regAlloc(targetCode);  // performance hog 32/33s
+  getSourceTranslate().regAlloc(targetCode);
 
   // Satisfy target code constraints
+  PhaseTimer t("satisfy", targetCode.size());
   satisfy(targetCode);
+  t.end(targetCode.size());
 }
 
 
@@ -148,6 +152,7 @@ void KernelDriver::init_compile() {
   VarGen::reset();
   resetFreshLabelGen();
   Pointer::reset_increment();
+  BaseFunction::reset();
   compile_data.clear();
 
   // Initialize reserved general-purpose variables
@@ -155,7 +160,9 @@ void KernelDriver::init_compile() {
   qpuId    = getUniformInt();  comment("QPU id");
   qpuCount = getUniformInt();  comment("Num QPUs");
 
-  if (!Platform::compiling_for_vc4()) {
+  if (Platform::compiling_for_vc4()) {
+    Int finish = getUniformInt();  comment("Termination count");
+  } else {
     Int devnull = getUniformInt();  comment("devnull");
   }
 }
@@ -180,7 +187,10 @@ void KernelDriver::obtain_ast() {
  */
 void KernelDriver::compile(std::function<void()> create_ast) {
   try {
-    create_ast();
+    {
+      PhaseTimer t("ast");
+      create_ast();
+    }
     compile_intern();
     m_numVars = VarGen::count();
   } catch (V3DLib::Exception const &e) {
@@ -285,7 +295,7 @@ void KernelDriver::dump_compile_data(char const *filename) const {
 }
 
 
-void KernelDriver::invoke(int numQPUs, IntList &params) {
+void KernelDriver::invoke(QpuRange const &qpus, IntList &params) {
   assert(params.size() != 0);
 
   if (handle_errors()) {
@@ -293,7 +303,7 @@ void KernelDriver::invoke(int numQPUs, IntList &params) {
   }
 
    // Invoke kernel on QPUs
-  invoke_intern(numQPUs, params);
+  invoke_intern(qpus, params);
 }
 
 
@@ -302,7 +312,25 @@ std::string KernelDriver::compile_info() const {
 
   ret << "  compile num generated variables: " << numVars() << "\n"
       << "  num accs introduced            : " << numAccs() << "\n"
-      << "  num compile errors             : " << errors.size();
+      << "  num compile errors             : " << errors.size() << "\n"
+      << "  compile time                   : " << (float) m_compile_data.total_seconds() << "s\n"
+      << "  compile phases:\n"
+      << m_compile_data.phases_dump();
+
+  return ret;
+}
+
+
+/**
+ * Same info as `compile_info()`, in JSON format
+ */
+std::string KernelDriver::compile_info_json() const {
+  std::string ret;
+
+  ret << "{\"num_vars\": " << numVars()
+      << ", \"num_errors\": " << errors.size()
+      << ", \"compile\": " << m_compile_data.phases_json()
+      << "}";
 
   return ret;
 }
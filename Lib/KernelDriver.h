@@ -5,6 +5,7 @@
 #include <functional>
 #include "Common/BufferType.h"
 #include "Common/CompileData.h"
+#include "Common/QpuRange.h"
 #include "Source/StmtStack.h"
 
 namespace V3DLib {
@@ -18,7 +19,8 @@ public:
   void init_compile();
   void compile(std::function<void()> create_ast);
   virtual void encode() = 0;
-  void invoke(int numQPUs, IntList &params);
+  virtual std::vector<uint64_t> to_opcodes() = 0;
+  void invoke(QpuRange const &qpus, IntList &params);
   bool has_errors() const { return !errors.empty(); }
   std::string get_errors() const;
   int numVars() const { return m_numVars; }
@@ -27,6 +29,8 @@ public:
 
   void pretty(char const *filename = nullptr, bool output_qpu_code = true);
   std::string compile_info() const;
+  std::string compile_info_json() const;
+  CompileData const &compile_stats() const { return m_compile_data; }
   void dump_compile_data(char const *filename) const;
 
 protected:
@@ -46,7 +50,7 @@ private:
   CompileData m_compile_data;
 
   virtual void compile_intern() = 0;
-  virtual void invoke_intern(int numQPUs, IntList &params) = 0;
+  virtual void invoke_intern(QpuRange const &qpus, IntList &params) = 0;
 
   int numAccs() const { return m_compile_data.num_accs_introduced; }
 
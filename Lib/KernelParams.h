@@ -0,0 +1,112 @@
+#ifndef _V3DLIB_KERNELPARAMS_H_
+#define _V3DLIB_KERNELPARAMS_H_
+#include <string>
+#include "Source/Complex.h"
+
+namespace V3DLib {
+
+// ============================================================================
+// Parameter passing
+// ============================================================================
+
+template <typename... ts> inline void nothing(ts... args) {}
+
+
+template <typename T, typename t> inline bool passParam(IntList &uniforms, t x) {
+  return T::passParam(uniforms, x);
+}
+
+
+/**
+ * Grumbl still need special override for 2D shared array.
+ * Sort of patched this, will sort it out another time.
+ *
+ * You can not possibly have any idea how long it took me to implement and use this correctly.
+ * Even so, I'm probably doing it wrong.
+ */
+template <>
+inline bool passParam< Float::Ptr, Float::Array2D * > (IntList &uniforms, Float::Array2D *p) {
+  return Float::Ptr::passParam(uniforms, &((BaseSharedArray const &) p->get_parent()));
+}
+
+
+template <>
+inline bool passParam< Int::Ptr, Int::Array2D * > (IntList &uniforms, Int::Array2D *p) {
+  return Int::Ptr::passParam(uniforms, &((BaseSharedArray const &) p->get_parent()));
+}
+
+
+template <>
+inline bool passParam< Complex::Ptr, Complex::Array2D * > (IntList &uniforms, Complex::Array2D *p) {
+  passParam< Float::Ptr, Float::Array2D * > (uniforms, &p->re());
+  passParam< Float::Ptr, Float::Array2D * > (uniforms, &p->im());
+  return true;
+}
+
+
+/**
+ * Description of the kernel parameter types.
+ *
+ * This is used to record the parameter types of a precompiled kernel, and to check
+ * them again when the kernel is loaded, see `PrecompiledKernel`.
+ *
+ * `num_uniforms` is the number of uniform values passed for a parameter.
+ */
+template <typename T> struct ParamType;
+
+template <> struct ParamType<Int> {
+  static char const *name() { return "Int"; }
+  static int const num_uniforms = 1;
+};
+
+template <> struct ParamType<Float> {
+  static char const *name() { return "Float"; }
+  static int const num_uniforms = 1;
+};
+
+template <> struct ParamType<Int::Ptr> {
+  static char const *name() { return "Int::Ptr"; }
+  static int const num_uniforms = 1;
+};
+
+template <> struct ParamType<Float::Ptr> {
+  static char const *name() { return "Float::Ptr"; }
+  static int const num_uniforms = 1;
+};
+
+template <> struct ParamType<Complex::Ptr> {
+  static char const *name() { return "Complex::Ptr"; }
+  static int const num_uniforms = 2;  // Pointers to real and imaginary parts
+};
+
+
+/**
+ * @return parameter types as a comma-separated list, e.g. "Int::Ptr, Int"
+ */
+template <typename... ts> std::string param_signature() {
+  char const *names[] = { "", ParamType<ts>::name()... };  // Leading dummy allows for empty list
+
+  std::string ret;
+  for (int i = 1; i < (int) (sizeof(names)/sizeof(names[0])); i++) {
+    if (i > 1) ret += ", ";
+    ret += names[i];
+  }
+
+  return ret;
+}
+
+
+/**
+ * @return number of uniform values for the parameter types
+ */
+template <typename... ts> int param_uniforms() {
+  int counts[] = { 0, ParamType<ts>::num_uniforms... };
+
+  int ret = 0;
+  for (int n : counts) ret += n;
+  return ret;
+}
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_KERNELPARAMS_H_
@@ -0,0 +1,195 @@
+#include "KernelWriter.h"
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include "cpu/CodeGen.h"
+#include "Support/basics.h"
+
+namespace V3DLib {
+
+using ::operator<<;  // C++ weirdness
+
+namespace {
+
+bool is_identifier(std::string const &str) {
+  if (str.empty() || isdigit(str[0])) return false;
+
+  for (char c : str) {
+    if (!isalnum(c) && c != '_') return false;
+  }
+
+  return true;
+}
+
+
+/**
+ * Output opcodes as the initializer of a C array, 4 per line
+ */
+std::string code_array(char const *name, std::vector<uint64_t> const &code) {
+  std::string ret;
+
+  if (code.empty()) {
+    ret << "// No code present for " << name << "\n";
+    return ret;
+  }
+
+  ret << "uint64_t const " << name << "[" << (int) code.size() << "] = {";
+
+  for (int i = 0; i < (int) code.size(); i++) {
+    if (i % 4 == 0) ret << "\n ";
+
+    char buf[32];
+    sprintf(buf, " 0x%016llxull,", (unsigned long long) code[i]);
+    ret << buf;
+  }
+
+  ret << "\n};\n";
+  return ret;
+}
+
+
+void write_file(std::string const &filename, std::string const &content) {
+  std::ofstream out(filename);
+  out << content;
+  assertq(out.good(), "KernelWriter: could not write file " + filename, true);
+}
+
+}  // anon namespace
+
+
+KernelWriter::KernelWriter(
+  std::string const &name,
+  BaseKernel &k,
+  std::vector<std::string> const &params,
+  std::string const &signature,
+  int num_uniforms
+) :
+  m_name(name),
+  m_params(params),
+  m_signature(signature),
+  m_num_uniforms(num_uniforms)
+{
+  assertq(is_identifier(name), "KernelWriter: kernel name must be a valid identifier", true);
+  assertq(!k.has_errors(), "KernelWriter: kernel has compile errors", true);
+
+  if (k.has_vc4()) {
+    m_vc4_code = k.vc4().to_opcodes();
+    m_native   = cpu::generate(k.vc4().sourceCode(), k.vc4().numVars(), entry().c_str());
+  }
+
+  if (k.has_v3d()) {
+    m_v3d_code = k.v3d().to_opcodes();
+  }
+}
+
+
+/**
+ * Name of the native kernel function, must be unique over all kernels in a program
+ */
+std::string KernelWriter::entry() const {
+  return "v3dlib_precompiled_" + m_name;
+}
+
+
+std::string KernelWriter::header() const {
+  std::string guard = "_PRECOMPILED_" + m_name + "_H_";
+  for (auto &c : guard) c = (char) toupper(c);
+
+  std::string types;
+  for (int i = 0; i < (int) m_params.size(); i++) {
+    if (i > 0) types << ", ";
+    types << "V3DLib::" << m_params[i];
+  }
+
+  std::string ret;
+  ret << "// Generated by the V3DLib precompile tool, do not edit.\n"
+      << "#ifndef " << guard << "\n"
+      << "#define " << guard << "\n"
+      << "#include \"PrecompiledKernel.h\"\n"
+      << "\n"
+      << "namespace precompiled {\n"
+      << "\n"
+      << "extern V3DLib::PrecompiledData const " << m_name << "_data;\n"
+      << "\n"
+      << "using " << m_name << " = V3DLib::PrecompiledKernel<" << types << ">;\n"
+      << "\n"
+      << "}  // namespace precompiled\n"
+      << "\n"
+      << "#endif  // " << guard << "\n";
+
+  return ret;
+}
+
+
+std::string KernelWriter::source() const {
+  std::string ret;
+  ret << "// Generated by the V3DLib precompile tool, do not edit.\n"
+      << "//\n"
+      << "// Kernel    : " << m_name << "\n"
+      << "// Parameters: " << m_signature << "\n"
+      << "//\n"
+      << "// Layout of the uniforms, per QPU:\n"
+      << "//\n"
+      << "//   vc4: qpu id, num qpus, termination count, <parameters>, dummy value\n"
+      << "//   v3d: num qpus running, num qpus, devnull address, <parameters>, done address\n"
+      << "//\n"
+      << "// <parameters> consists of " << m_num_uniforms << " value(s).\n"
+      << "#include \"" << m_name << ".h\"\n"
+      << "\n";
+
+  if (!m_native.empty()) {
+    ret << "#ifdef __GNUC__\n"
+        << "#pragma GCC optimize(\"wrapv\")  // Native code relies on wrapping integer overflow\n"
+        << "#pragma GCC diagnostic ignored \"-Wunused-variable\"\n"
+        << "#pragma GCC diagnostic ignored \"-Wunused-but-set-variable\"\n"
+        << "#pragma GCC diagnostic ignored \"-Wpsabi\"  // Vector helpers are local to this file\n"
+        << "#endif\n"
+        << "\n"
+        << m_native
+        << "\n";
+  }
+
+  ret << "namespace precompiled {\n"
+      << "namespace {\n"
+      << "\n"
+      << code_array("vc4_code", m_vc4_code)
+      << "\n"
+      << code_array("v3d_code", m_v3d_code)
+      << "\n"
+      << "}  // anon namespace\n"
+      << "\n"
+      << "V3DLib::PrecompiledData const " << m_name << "_data = {\n"
+      << "  \"" << m_name << "\",\n"
+      << "  \"" << m_signature << "\",\n"
+      << "  " << m_num_uniforms << ",\n";
+
+  if (m_vc4_code.empty()) {
+    ret << "  nullptr, 0,\n";
+  } else {
+    ret << "  vc4_code, " << (int) m_vc4_code.size() << ",\n";
+  }
+
+  if (m_v3d_code.empty()) {
+    ret << "  nullptr, 0,\n";
+  } else {
+    ret << "  v3d_code, " << (int) m_v3d_code.size() << ",\n";
+  }
+
+  ret << "  " << (m_native.empty()? std::string("nullptr") : entry()) << "\n"
+      << "};\n"
+      << "\n"
+      << "}  // namespace precompiled\n";
+
+  return ret;
+}
+
+
+/**
+ * Write the header and source file for the kernel to the given directory
+ */
+void KernelWriter::write(std::string const &dir) const {
+  write_file(dir + "/" + m_name + ".h",   header());
+  write_file(dir + "/" + m_name + ".cpp", source());
+}
+
+}  // namespace V3DLib
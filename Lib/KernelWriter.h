@@ -0,0 +1,64 @@
+#ifndef _V3DLIB_KERNELWRITER_H_
+#define _V3DLIB_KERNELWRITER_H_
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Kernel.h"
+
+namespace V3DLib {
+
+/**
+ * Output a compiled kernel as C++ source code, for use with `PrecompiledKernel`.
+ *
+ * This generates a header and a source file for the kernel, containing:
+ *
+ *   - the encoded instructions for vc4 and the opcodes for v3d
+ *   - the native code for the host CPU, see `cpu::NativeKernel`
+ *   - the parameter types and the number of uniforms for the parameters
+ *
+ * The generated files depend on the headers of the library, but not on the compiler for the DSL.
+ * They are intended to be generated at build time, with the `precompile` tool.
+ *
+ * ------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. The native code relies on wrapping integer overflow, as on the QPU.
+ *    The generated source requests this from GCC with a pragma. For other compilers,
+ *    compile it with the equivalent of `-fwrapv`.
+ */
+class KernelWriter {
+public:
+  template <typename... ts>
+  KernelWriter(std::string const &name, Kernel<ts...> &k) :
+    KernelWriter(name, k, { ParamType<ts>::name()... }, param_signature<ts...>(), param_uniforms<ts...>())
+  {}
+
+  std::string const &name() const { return m_name; }
+  std::string header() const;
+  std::string source() const;
+  void write(std::string const &dir) const;
+
+private:
+  std::string              m_name;
+  std::vector<std::string> m_params;        // Names of the parameter types
+  std::string              m_signature;
+  int                      m_num_uniforms;
+  std::vector<uint64_t>    m_vc4_code;
+  std::vector<uint64_t>    m_v3d_code;
+  std::string              m_native;        // Generated native code
+
+  KernelWriter(
+    std::string const &name,
+    BaseKernel &k,
+    std::vector<std::string> const &params,
+    std::string const &signature,
+    int num_uniforms
+  );
+
+  std::string entry() const;
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_KERNELWRITER_H_
@@ -151,4 +151,35 @@ void ComplexDotVector::dft_dot_product(Int const &row, Complex &result, int num_
   rotate_sum(tmp.im(), result.im());
 }
 
+
+/**
+ * Multiply current instance with the DFT elements of column `col`, using a twiddle table.
+ *
+ * See `DotVector::dft_dot_product()` with twiddles for details.
+ */
+void ComplexDotVector::dft_dot_product(
+  Int const &row,
+  Complex &result,
+  Complex::Ptr const &twiddles,
+  int num_elements,
+  Int const &offset
+) {
+  assertq(num_elements > 0 && (num_elements & (num_elements - 1)) == 0,
+          "Twiddle table size must be a power of two", true);
+
+  Complex tmp(0, 0);               comment("ComplexDotVector::dft_dot_product() with twiddles");
+  Int phase = row*(index() + offset);
+  Int step  = row << 4;
+
+  for (int i = 0; i < (int) size(); ++i) {
+    Complex tw;
+    twiddle_lookup(tw, twiddles, phase & (num_elements - 1));
+    tmp += Complex(re[i], im[i])*tw;
+    phase += step;
+  }
+
+  rotate_sum(tmp.re(), result.re());
+  rotate_sum(tmp.im(), result.im());
+}
+
 }  // namespace kernels
@@ -22,8 +22,8 @@ namespace V3DLib {
  * NOTES
  * =====
  *
- * * A possible extension is to have the edges wraparouns for a torus topology.
- *   Will implement this when I need it.
+ * * For other data types, larger masks and edge handling (including torus wraparound),
+ *   see the generic stencil kernels in `Stencil.h`.
  *
  * * The class has been set up to use multiple lines, i.e. > 3. The idea was
  *   to make the line loading more efficient.
@@ -72,6 +72,44 @@ void DotVector::dft_dot_product(Int const &row, Complex &result, int num_element
 }
 
 
+/**
+ * Multiply current instance with the DFT elements of column `col`, using a twiddle table.
+ *
+ * Same as previous, but the DFT matrix elements are looked up in table `twiddles`
+ * instead of being calculated inline with sin/cos.
+ *
+ * The table contains the `num_elements` roots of unity, i.e. `twiddles[k] = exp(-2*pi*i*k/num_elements)`.
+ * The element for (row, col) is `twiddles[(row*col) % num_elements]`. The modulo is done with a mask,
+ * hence `num_elements` must be a power of two.
+ *
+ * The phase index is maintained incrementally, so there are no multiplications in the loop.
+ */
+void DotVector::dft_dot_product(
+  Int const &row,
+  Complex &result,
+  Complex::Ptr const &twiddles,
+  int num_elements,
+  Int const &offset
+) {
+  assertq(num_elements > 0 && (num_elements & (num_elements - 1)) == 0,
+          "Twiddle table size must be a power of two", true);
+
+  Complex tmp(0, 0);               comment("DotVector::dft_dot_product() with twiddles");
+  Int phase = row*(index() + offset);
+  Int step  = row << 4;
+
+  for (int i = 0; i < (int) size(); ++i) {
+    Complex tw;
+    twiddle_lookup(tw, twiddles, phase & (num_elements - 1));
+    tmp += Complex(elements[i]*tw.re(), elements[i]*tw.im());
+    phase += step;
+  }
+
+  rotate_sum(tmp.re(), result.re());
+  rotate_sum(tmp.im(), result.im());
+}
+
+
 /**
  * on v3d, TMU is used always for writes.
  * on vc4, DMA is used always.
@@ -133,4 +171,16 @@ void pre_write(Float::Ptr &dst, Float &src, bool add_result, Int const &j) {
   }
 }
 
+/**
+ * Load the twiddle factors for the per-lane indexes in `idx`.
+ *
+ * Uniform pointers have the lane offset already added in; this is undone here,
+ * so that each lane reads the table element it indexes.
+ */
+void twiddle_lookup(Complex &dst, Complex::Ptr const &twiddles, IntExpr idx) {
+  Complex::Ptr src = twiddles + (idx - index());
+  gather(src);
+  receive(dst);
+}
+
 }  // namespace kernels
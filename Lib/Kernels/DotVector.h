@@ -25,6 +25,8 @@ public:
   void save(Float::Ptr dst);
   void dot_product(Float::Ptr rhs, Float &result);
   void dft_dot_product(Int const &row, Complex &result, int num_elements, Int const &offset = 0);
+  void dft_dot_product(Int const &row, Complex &result, Complex::Ptr const &twiddles, int num_elements,
+                       Int const &offset = 0);
   size_t size() const { return elements.size(); }
   Float &operator[] (int index) { return elements[index]; }
   Float const &operator[] (int index) const { return elements[index]; }
@@ -35,6 +37,7 @@ private:
 
 void pre_write(Float::Ptr &dst, Float &src, bool add_result);
 void pre_write(Float::Ptr &dst, Float &src, bool add_result, Int const &j);
+void twiddle_lookup(Complex &dst, Complex::Ptr const &twiddles, IntExpr idx);
 
 }  // namespace kernels
 
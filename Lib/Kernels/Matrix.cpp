@@ -1,5 +1,6 @@
 #include "Matrix.h"
 #include <functional>
+#include <cmath>
 #include "Support/basics.h"
 #include "Source/Functions.h"
 
@@ -22,6 +23,7 @@ void matrix_settings::set(int in_rows, int in_inner, int in_columns) {
   columns       = in_columns;
   add_result    = false;       // override after this call to explicitly set
   use_multi_kernel_calls = false;
+  tile_columns  = 0;
 
   m_num_blocks  = -1;
   block_rowsize = -1;
@@ -57,18 +59,24 @@ int matrix_settings::cols_result() const { return adjust_dimension(columns, 16);
 
 
 int matrix_settings::num_blocks() const {
-  assertq(m_num_blocks == 1 || m_num_blocks == 2, "Num blocks can only be 1 or 2", true);
+  assertq(m_num_blocks >= 1, "Num blocks has not been set", true);
   return m_num_blocks;
 }
 
 
 void matrix_settings::num_blocks(int val) {
-  assert(val == 1 || val == 2);
+  assert(val >= 1);
+
+  if (inner % (16*val) != 0) {
+    std::string msg;
+    msg << "Inner dimension (" << inner << ") "
+        << "must be a multiple of 16*<number of blocks> (" << val << ") "
+        << "for block multiplication to work";
+    assertq(false, msg);
+  } 
 
-  int new_block_size = inner/val;
-  assertq(new_block_size % 16 == 0, "New block size must be a multiple of 16");
   m_num_blocks = val;
-  set_blockrowsize(new_block_size);
+  set_blockrowsize(inner/val);
 }
 
 
@@ -78,13 +86,17 @@ std::string matrix_settings::dump() const {
   msg << "settings "
       << "rows: " << rows << ", columns: " << columns
       << ", width: " << width() << ", inner: " << inner
-      << ", num blocks: " << m_num_blocks;
+      << ", num blocks: " << m_num_blocks
+      << ", tile columns: " << tile_columns;
 
   return msg;
 }
 
 
-int matrix_settings::adjust_dimension(int val, int multiple) const {
+/**
+ * Round up `val` to the nearest multiple of `multiple`
+ */
+int matrix_settings::adjust_dimension(int val, int multiple) {
   assert(val > 0);
   if (val % multiple != 0) {
     val  = multiple*(val/multiple + 1);
@@ -175,6 +187,25 @@ void matrix_mult_scalar(int N, float *dst, float *a, float *b) {
 }
 
 
+/**
+ * Fill the twiddle table for the batched DFT.
+ *
+ * The table size is the length of the signals to transform.
+ * Element k is the root of unity `exp(-2*pi*i*k/N)`.
+ *
+ * The values are calculated in double precision on the CPU.
+ */
+void dft_twiddles(Complex::Array &twiddles) {
+  int const N = (int) twiddles.size();
+  assert(N > 0);
+
+  for (int k = 0; k < N; ++k) {
+    double angle = -2*M_PI*((double) k)/((double) N);
+    twiddles[k] = complex((float) std::cos(angle), (float) std::sin(angle));
+  }
+}
+
+
 void create_block_kernel(Int const &in_offset, std::function<void (Int const &offset)> f) {
   auto &settings = get_matrix_settings();
 
@@ -189,12 +220,39 @@ void create_block_kernel(Int const &in_offset, std::function<void (Int const &of
     settings.add_result = false;
     f(0);
 
-    if (settings.num_blocks() == 2) {
+    // Remaining blocks add to the result of the previous blocks.
+    // Loop at runtime, so that the code size does not depend on the number of blocks.
+    if (settings.num_blocks() > 1) {
       settings.add_result = true;
-      Int offset = settings.width();
-      f(offset);
+
+      For (Int offset = settings.width(), offset < settings.inner, offset += settings.width())
+        f(offset);
+      End
     }
   }
 }
 
+
+/**
+ * Copy 2D array `src` to `dst`, padding the rows of `dst` with zeroes.
+ *
+ * `dst` must have the same number of rows as `src`, and at least the same number of columns.
+ */
+void copy_padded(Float::Array2D &dst, Float::Array2D const &src) {
+  assert(dst.rows() == src.rows());
+  assert(dst.columns() >= src.columns());
+
+  for (int r = 0; r < src.rows(); ++r) {
+    for (int c = 0; c < dst.columns(); ++c) {
+      dst[r][c] = (c < src.columns())? src[r][c] : 0.0f;
+    }
+  }
+}
+
+
+void copy_padded(Complex::Array2D &dst, Complex::Array2D const &src) {
+  copy_padded(dst.re(), src.re());
+  copy_padded(dst.im(), src.im());
+}
+
 }  // namespace kernels
@@ -4,6 +4,8 @@
 #include "V3DLib.h"
 #include "../Support/basics.h"
 #include "../Support/Helpers.h"
+#include "../KernelCache.h"
+#include "../LibSettings.h"
 #include "ComplexDotVector.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -21,6 +23,7 @@ struct matrix_settings {
   int columns;                                // Num columns of the result array
   bool add_result  = false;
   bool use_multi_kernel_calls = false;
+  int  tile_columns = 0;                      // If > 0, iterate over the columns of b in tiles of this size
 
   void set(int in_rows, int in_inner, int in_columns);
 
@@ -33,17 +36,21 @@ struct matrix_settings {
 
   std::string dump() const;
 
+  static int adjust_dimension(int val, int multiple);
+
 private:
   int m_num_blocks  = -1;
   int block_rowsize = -1;                         // Row size for the (block array) multiplication
 
-  int adjust_dimension(int val, int multiple) const;
   void set_blockrowsize(int in_block_rowsize);
 };
 
 
 matrix_settings &get_matrix_settings();
 
+void copy_padded(Float::Array2D &dst, Float::Array2D const &src);
+void copy_padded(Complex::Array2D &dst, Complex::Array2D const &src);
+
 
 /**
  * Pre: settings initialized
@@ -95,6 +102,10 @@ void init_result_array(Array2D &result) {
  * - unroll the internal loop (tried it but does not help, discarded)
  * - Use all QPU's
  * - All QPU's iterate over b together -> increase cache hits (when iterating over rows)
+ * - Optionally, iterate over the columns of b in tiles (`settings.tile_columns`), so that
+ *   the part of b in use fits in the cache. The downside is that the rows of a are loaded once per tile.
+ *   Tiling is only done when iterating over rows; when iterating over columns,
+ *   every QPU already handles a separate range of columns.
  */
 template<
  typename DstPtr,
@@ -109,6 +120,7 @@ void blockmatrix_loop(
 ) {
   auto &settings = get_matrix_settings();
   assert(settings.inner > 0 && (settings.inner % 16 == 0));
+  assertq(settings.tile_columns % 16 == 0, "Column tile size must be a multiple of 16", true);
 
   //
   // Initialize loops
@@ -116,11 +128,12 @@ void blockmatrix_loop(
   // This determines if multi-QPU iteration should go over a-rows or b-columns,
   // and adjusts loop parameters accordingly.
   //
+  bool iterate_rows = (settings.rows >= settings.columns);
   Int a_init = 0; 
   Int a_inc = 1;
   Int b_init = 0; 
   Int b_count = settings.columns;
-  if (settings.rows >= settings.columns) {
+  if (iterate_rows) {
     //debug("blockmatrix_loop iterating over rows");
     a_init = me();
     a_inc  = numQPUs();
@@ -149,28 +162,39 @@ void blockmatrix_loop(
 
   T result = 0;  // Explicit init required, for T == Complex '0' is interpreted as phase
 
-  For (Int a_index = a_init, a_index < settings.rows, a_index += a_inc)
-    vec.load(a + a_index*settings.inner);
+  auto loop = [&] (Int const &b_start, Int const &b_end) {
+    For (Int a_index = a_init, a_index < settings.rows, a_index += a_inc)
+      vec.load(a + a_index*settings.inner);
 
-    Int bit_count = 0;
-    DstPtr dst_local = dst + a_index*settings.cols_result() + b_init;
+      Int bit_count = 0;
+      DstPtr dst_local = dst + a_index*settings.cols_result() + b_start;
 
-    For (Int b_index = b_init,  b_index < b_count, b_index += 1)
-      T tmp = 0;
-      core(vec, b_index, tmp);
-      result.set_at(bit_count, tmp);
+      For (Int b_index = b_start,  b_index < b_end, b_index += 1)
+        T tmp = 0;
+        core(vec, b_index, tmp);
+        result.set_at(bit_count, tmp);
 
-      bit_count = (bit_count + 1) & 0xf;
+        bit_count = (bit_count + 1) & 0xf;
 
-      If (bit_count == 0)
-        pre_write(dst_local, result, settings.add_result);
+        If (bit_count == 0)
+          pre_write(dst_local, result, settings.add_result);
+        End
+      End
+
+      If (bit_count != 0)
+        pre_write(dst_local, result, settings.add_result, bit_count);
       End
     End
+  };
 
-    If (bit_count != 0)
-      pre_write(dst_local, result, settings.add_result, bit_count);
+  if (iterate_rows && settings.tile_columns > 0 && settings.tile_columns < settings.columns) {
+    For (Int tile = 0, tile < settings.columns, tile += settings.tile_columns)
+      Int tile_end = min(tile + settings.tile_columns, settings.columns);
+      loop(tile, tile_end);
     End
-  End
+  } else {
+    loop(b_init, b_count);
+  }
 }
 
 
@@ -197,6 +221,72 @@ void matrix_mult(Ptr dst, Ptr a, Ptr b) {
 }
 
 
+/**
+ * Multiply two matrixes, with the dimensions passed in as uniforms.
+ *
+ * Unlike `matrix_mult()`, no dimensions are baked into the kernel code, so a single
+ * compiled kernel can be used for all matrix dimensions; no recompiles are needed.
+ *
+ * The price is some runtime: the rows of `a` can not be retained in registers,
+ * since their size is not known on compilation. `a` and `b` are both streamed in for every
+ * element of the result.
+ *
+ * As with `matrix_mult()`, input `b` must be transposed and the inner dimension must
+ * be a multiple of 16. The number of columns of `dst` must be `columns` rounded up to
+ * a multiple of 16.
+ */
+template<
+  typename Ptr,
+  typename T = typename std::conditional<std::is_same<Ptr, Float::Ptr>::value, Float, Complex>::type
+>
+void matrix_mult_dims(Ptr dst, Ptr a, Ptr b, Int rows, Int inner, Int columns) {
+  Int cols_result = (columns + 15) & ~15;
+
+  T result = 0;  // Explicit init required, for T == Complex '0' is interpreted as phase
+
+  For (Int a_index = me(), a_index < rows, a_index += numQPUs())
+    Ptr dst_local = dst + a_index*cols_result;
+    Int bit_count = 0;
+
+    For (Int b_index = 0, b_index < columns, b_index++)
+      Ptr a_local = a + a_index*inner;
+      Ptr b_local = b + b_index*inner;
+      T sum = 0;                       comment("matrix_mult_dims() dot product");
+      if constexpr (std::is_same<T, Complex>::value) {
+        sum = Complex(0, 0);           // For Complex, '0' is interpreted as phase
+      }
+
+      For (Int i = 0, i < inner, i += 16)
+        T a_val = *a_local;
+        T b_val = *b_local;
+        sum += a_val*b_val;
+        a_local.inc();
+        b_local.inc();
+      End
+
+      T tmp = 0;
+      if constexpr (std::is_same<T, Float>::value) {
+        rotate_sum(sum, tmp);
+      } else {
+        rotate_sum(sum.re(), tmp.re());
+        rotate_sum(sum.im(), tmp.im());
+      }
+      result.set_at(bit_count, tmp);
+
+      bit_count = (bit_count + 1) & 0xf;
+
+      If (bit_count == 0)
+        pre_write(dst_local, result, false);
+      End
+    End
+
+    If (bit_count != 0)
+      pre_write(dst_local, result, false, bit_count);
+    End
+  End
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // API functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -323,6 +413,59 @@ auto dft_decorator(Array &a, Complex::Array2D &result) -> decltype(*dft_kernel<P
 void create_block_kernel(Int const &in_offset, std::function<void (Int const &offset)> f);
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Cached kernels
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Get a compiled matrix multiplication kernel for the given dimensions from `cache`.
+ *
+ * The kernel is compiled only if it is not yet present in the cache.
+ * Note that the global matrix settings are always set for the dimensions.
+ */
+inline Kernel<Float::Ptr, Float::Ptr, Float::Ptr> &cached_matrix_mult(
+  KernelCache &cache,
+  int rows, int inner, int columns,
+  int numQPUs = 1,
+  CompileFor compile_for = BOTH
+) {
+  KernelKey key = {"matrix_mult", {rows, inner, columns, LibSettings::use_tmu_for_load()}, numQPUs, compile_for};
+  return cache.get(key, matrix_mult_decorator(rows, inner, columns));
+}
+
+
+/**
+ * Get a compiled DFT kernel for the dimensions of `a` from `cache`.
+ *
+ * `result` is allocated if not yet done, as with `dft_decorator()`.
+ */
+template<
+  typename Array,
+  typename Ptr = typename std::conditional<std::is_same<Array, Complex::Array2D>::value, Complex::Ptr, Float::Ptr>::type
+>
+Kernel<Complex::Ptr, Ptr> &cached_dft(
+  KernelCache &cache,
+  Array &a,
+  Complex::Array2D &result,
+  int numQPUs = 1,
+  CompileFor compile_for = BOTH
+) {
+  std::string id = std::is_same<Ptr, Float::Ptr>::value?"dft_float":"dft_complex";
+
+  auto f = dft_decorator(a, result);
+  auto &settings = get_matrix_settings();
+
+  KernelKey key = {
+    id,
+    {settings.rows, settings.inner, LibSettings::use_high_precision_sincos(), LibSettings::use_tmu_for_load()},
+    numQPUs,
+    compile_for
+  };
+
+  return cache.get(key, f);
+}
+
+
 /**
  * The v3d part of the kernel does not work on vc4, even though the target lang code
  * is practically identical. It took a while to figure it out:
@@ -345,6 +488,135 @@ void matrix_mult_block(Ptr in_dst, Ptr in_a, Ptr in_b, Int in_offset) {
   });
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+// Batched DFT
+///////////////////////////////////////////////////////////////////////////////
+
+void dft_twiddles(Complex::Array &twiddles);
+
+
+/**
+ * Batched DFT kernel.
+ *
+ * Every row of `a` is a separate signal. The rows are distributed over the QPUs
+ * by `blockmatrix_loop()`, the row elements over the lanes.
+ *
+ * The DFT matrix elements are not calculated inline but looked up in the twiddle table,
+ * which is shared by all signals.
+ */
+template<typename Ptr>
+void dft_batch_kernel_intern(Complex::Ptr dst, Ptr a, Complex::Ptr twiddles, Int const &offset) {
+  using  DotVecType = typename std::conditional<std::is_same<Ptr, Float::Ptr>::value, DotVector, ComplexDotVector>::type;
+  auto &settings = get_matrix_settings();
+
+  blockmatrix_loop<Complex::Ptr, Ptr, Complex, DotVecType>(dst, a,
+    [&settings, &twiddles, &offset] (DotVecType &dot_vector, Int &b_index, Complex &dst ) {
+      dot_vector.dft_dot_product(b_index, dst, twiddles, settings.inner, offset);
+    }
+  );
+}
+
+
+template<typename Ptr>
+void dft_batch_kernel(Complex::Ptr dst, Ptr a, Complex::Ptr twiddles) {
+  dft_batch_kernel_intern(dst, a, twiddles, 0);
+}
+
+
+template<typename Ptr>
+void dft_batch_kernel_block(Complex::Ptr in_dst, Ptr in_a, Complex::Ptr twiddles, Int in_offset) {
+  create_block_kernel(in_offset, [&] (Int const &offset) {
+     dft_batch_kernel_intern<Ptr>(in_dst, in_a + offset, twiddles, offset);
+  });
+}
+
+
+/**
+ * Decorator for the batched DFT kernel.
+ *
+ * @param a       input signals, one signal per row. The row length must be a power of two >= 16.
+ * @param result  output spectra, one per row. Allocated here if not yet done.
+ *
+ * The kernel needs a twiddle table as third parameter, see `dft_twiddles()`.
+ */
+template<
+  typename Array2D,
+  typename Ptr = typename std::conditional<std::is_same<Array2D, Complex::Array2D>::value, Complex::Ptr, Float::Ptr>::type
+>
+auto dft_batch_decorator(Array2D &a, Complex::Array2D &result) -> decltype(*dft_batch_kernel<Ptr>) {
+  assert(a.allocated());
+  int const Dim = a.columns();
+  assertq(Dim >= 16 && (Dim & (Dim - 1)) == 0, "Batched DFT: signal length must be a power of two >= 16");
+
+  matrix_mult_decorator(a.rows(), Dim, Dim);
+  init_result_array(result);
+
+  return dft_batch_kernel<Ptr>;
+}
+
+
+/**
+ * Batched DFT, with the dimensions passed in as uniforms.
+ *
+ * This is the DFT counterpart of `matrix_mult_dims()`: a single compiled kernel
+ * serves all signal lengths and counts, no recompiles are needed.
+ *
+ * The rows of `a` are streamed in for every output element instead of being kept in registers,
+ * so this is slower than `dft_batch_kernel()`.
+ *
+ * @param dst       output spectra, `rows` rows of `dim` elements
+ * @param a         input signals, `rows` rows of `dim` elements
+ * @param twiddles  twiddle table with `dim` elements, see `dft_twiddles()`
+ * @param rows      number of signals
+ * @param dim       signal length, must be a power of two >= 16
+ */
+template<
+  typename Ptr,
+  typename T = typename std::conditional<std::is_same<Ptr, Float::Ptr>::value, Float, Complex>::type
+>
+void dft_dims(Complex::Ptr dst, Ptr a, Complex::Ptr twiddles, Int rows, Int dim) {
+  Complex result(0, 0);
+
+  For (Int a_index = me(), a_index < rows, a_index += numQPUs())
+    Complex::Ptr dst_local = dst + a_index*dim;
+    Int bit_count = 0;
+
+    For (Int k = 0, k < dim, k++)
+      Ptr a_local = a + a_index*dim;
+      Int phase = k*index();
+      Int step  = k << 4;
+      Complex sum(0, 0);               comment("dft_dims() dot product");
+
+      For (Int i = 0, i < dim, i += 16)
+        T a_val = *a_local;
+        Complex tw;
+        twiddle_lookup(tw, twiddles, phase & (dim - 1));
+
+        if constexpr (std::is_same<T, Float>::value) {
+          sum += Complex(a_val*tw.re(), a_val*tw.im());
+        } else {
+          sum += a_val*tw;
+        }
+
+        a_local.inc();
+        phase += step;
+      End
+
+      Complex tmp(0, 0);
+      rotate_sum(sum.re(), tmp.re());
+      rotate_sum(sum.im(), tmp.im());
+      result.set_at(bit_count, tmp);
+
+      bit_count = (bit_count + 1) & 0xf;
+
+      If (bit_count == 0)
+        pre_write(dst_local, result, false);
+      End
+    End
+  End
+}
+
 }  // namespace kernels
 
 
@@ -364,18 +636,21 @@ enum CallType {
 /**
  * Base class for  block matrix support
  *
- * Currently, the matrices are each split into  at most 2 blocks.
+ * The matrices are split into any number of blocks along the inner dimension.
+ * The block size must be a multiple of 16; class `Matrix` pads the inner dimension
+ * with zeroes to ensure this.
+ *
+ * Blocking is needed for big matrices, because a row of a block must fit in the register file
+ * (see `DotVector`). The results of the blocks are accumulated on the GPU side.
  *
- * This serves as a proof of concept; in due time it, is possible
- * to split them into any number of block matrices, thereby allowing
- * arbitrary dimensions for the matrices (multiples of 16, always).
+ * `Type` is the element type of the result, which may differ from the input (e.g. DFT of float signals).
  */
 template<
   typename Array,
   typename Ptr,
   typename BlockKernelType,
   typename ResultArray = Array,
-  typename Type = typename std::conditional<std::is_same<Array, Float::Array2D>::value, float, complex>::type
+  typename Type = typename std::conditional<std::is_same<ResultArray, Float::Array2D>::value, float, complex>::type
 >
 class BlockMatrix {
 public:
@@ -414,25 +689,27 @@ public:
   int  numQPUs() const { return m_num_qpus; }
 
 
+  /**
+   * Set the number of blocks to split the inner dimension into.
+   *
+   * The inner dimension must be a multiple of 16*<number of blocks>.
+   * This is checked on compilation.
+   */
   BlockMatrix &num_blocks(int val) {
     assert(DEFAULT_NUM_BLOCKS == val || 0 < val);
-    if (val > 0) {
-      assertq(val == 1 || val == 2, "Number of block matrices can only be 1 or 2" );
-      auto &settings = kernels::get_matrix_settings();
-
-      if (settings.inner/val % 16 != 0) {
-        using ::operator<<;  // C++ weirdness
-
-        std::string msg;
-        msg << "Inner dimension (" << settings.inner << ") "
-            << "must be a multiple of 16*<number of blocks> (" << val << ") "
-            << "for block multiplication to work";
-        assertq(false, msg);
-      } 
-    }
-
     m_num_blocks = val;
+    return *this;
+  }
+
 
+  /**
+   * Iterate over the columns of the second matrix in tiles of the given size.
+   *
+   * @param val  tile size, must be a multiple of 16. Zero means no tiling.
+   */
+  BlockMatrix &tile_columns(int val) {
+    assertq(val >= 0 && val % 16 == 0, "Column tile size must be a multiple of 16");
+    m_tile_columns = val;
     return *this;
   }
 
@@ -441,13 +718,12 @@ public:
    * This multiplies the input matrices using block matrix calculation,
    * with the following block matrices:
    * 
-   *                        | B1 |
-   *    AxB = | A1 | A2 | x | -- | = | A1xB1 + B1xB2 ]
-   *                        | B2 |
+   *                                  | B1 |
+   *                                  | B2 |
+   *    AxB = | A1 | A2 | ... | An | x | .. | = | A1xB1 + A2xB2 + ... + AnxBn ]
+   *                                  | Bn |
    *
-   * ...where the split dimension is halved for A1/A2 and B1/B2.
-   * 
-   * Further splitting is possible, but this serves our purposes for now.
+   * ...where the split dimension is divided by n for Ai and Bi.
    */
   void call(CallType call_type = CALL) {
     init_block(call_type);
@@ -455,7 +731,7 @@ public:
     assert(m_k.get() != nullptr);
 
     Type zero;
-    if constexpr (std::is_same<Array, Float::Array2D>::value) {
+    if constexpr (std::is_same<Type, float>::value) {
       zero = 0.0f;
     }
     m_result.fill(zero);  // Apparently necessary; 1-ones mult -> final element is + 1 for some reason
@@ -473,11 +749,10 @@ public:
       k_first_call(call_type);
       //debug(m_result.dump());
 
-      if (num_blocks() == 2) {
-        //debug("Calling second block");
-        auto &settings = kernels::get_matrix_settings();
-        int offset = settings.width();
-        load(m_k, offset);
+      auto &settings = kernels::get_matrix_settings();
+      for (int block = 1; block < num_blocks(); ++block) {
+        //debug("Calling next block");
+        load(m_k, block*settings.width());
         k_call(call_type);
       }
     } else {
@@ -494,6 +769,7 @@ public:
     std::string ret;
 
     ret << "Num blocks       : " << m_num_blocks  << "\n"
+        << "Tile columns     : " << m_tile_columns << "\n"
         << "Num QPUs         : " << m_num_qpus    << "\n"
         << "Kernel calls     : " << (use_multi_kernel_calls(CALL)?"multi":"single") << "\n"
         << "Force multi-calls: " << (m_force_multi_kernels_calls?"true":"false") << "\n";
@@ -517,6 +793,7 @@ public:
 protected:
   int m_num_qpus = 1;
   bool m_force_multi_kernels_calls = false;
+  int m_tile_columns = 0;
 
   virtual void init_block(CallType call_type) = 0;
   virtual void load(BlockKernelPtr &k, int offset) = 0;
@@ -542,6 +819,7 @@ protected:
     if (m_k.get() != nullptr) {
       // Kernel already compiled. Don't recompile if nothing changed
       if (settings.num_blocks() == num_blocks()
+       && settings.tile_columns == m_tile_columns
        && settings.use_multi_kernel_calls == use_multi_kernel_calls(call_type)) {
         //debug("Unchanged block");
         return;
@@ -550,6 +828,7 @@ protected:
     }
 
     settings.num_blocks(num_blocks());
+    settings.tile_columns = m_tile_columns;
     settings.use_multi_kernel_calls = use_multi_kernel_calls(call_type);
     kernels::init_result_array(m_result);
 
@@ -578,16 +857,13 @@ protected:
   }
 
 
-private:
-  int m_num_blocks = DEFAULT_NUM_BLOCKS;
-  ResultArray m_result;
-
-  std::unique_ptr<BlockKernelType> m_k_first;
-  std::unique_ptr<BlockKernelType> m_k;
-
-
   /**
    * Determine number of blocks to use
+   *
+   * By default, the minimum number of blocks is used for which the block size
+   * does not exceed the max size for full mult.
+   * If possible, a slightly higher number of blocks is selected which divides
+   * the inner dimension evenly, so that no padding is required.
    */
   int num_blocks() const {
     assert(MAX_FULL_BLOCKS_VC4 == MAX_FULL_BLOCKS_V3D);  // Handle this when it happens
@@ -595,13 +871,28 @@ private:
     if (m_num_blocks == DEFAULT_NUM_BLOCKS) {
       auto &settings = kernels::get_matrix_settings();
       assert(settings.inner > 0);
-      return (settings.inner <= MAX_FULL_BLOCKS_VC4)? 1: 2;
+
+      int min_blocks = (settings.inner + MAX_FULL_BLOCKS_VC4 - 1)/MAX_FULL_BLOCKS_VC4;
+
+      for (int n = min_blocks; n <= 2*min_blocks; ++n) {
+        if (settings.inner % (16*n) == 0) return n;
+      }
+
+      return min_blocks;
     }
 
     return m_num_blocks;
   }
 
 
+private:
+  int m_num_blocks = DEFAULT_NUM_BLOCKS;
+  ResultArray m_result;
+
+  std::unique_ptr<BlockKernelType> m_k_first;
+  std::unique_ptr<BlockKernelType> m_k;
+
+
   void k_first_call(CallType call_type) {
     assert(m_k_first);
 
@@ -627,6 +918,18 @@ private:
 
 /**
  * Do block matrix multiplication
+ *
+ * The inner dimension does not need to be a multiple of 16.
+ * If required, the input matrices are copied to internal arrays,
+ * with the inner dimension padded with zeroes to a multiple of 16*<number of blocks>.
+ *
+ * The row and column counts of the result are not padded; any value is fine.
+ * The result array does have its columns rounded up to a multiple of 16, the extra columns are scratch.
+ * Note that the input arrays themselves must still be allocatable, i.e. rows*columns
+ * must be a multiple of 16 (see `Shared2DArray`).
+ *
+ * The padded copies are made on every call, so that changes in the input matrices are picked up.
+ * The arrays for them are only reallocated when the dimensions or the number of blocks change.
  */
 template<
   typename Array2D,
@@ -637,23 +940,55 @@ template<
 class Matrix : public Parent {
 public:
   Matrix(Array2D &a, Array2D &b) : m_a(a), m_b(b) {
+    assertq(m_a.columns() == m_b.columns(), "Matrix: a and b (transposed) must have the same number of columns");
+
     auto &settings = kernels::get_matrix_settings();
-    settings.set(m_a.rows(), m_a.columns(), m_b.rows());
+    settings.set(m_a.rows(), kernels::matrix_settings::adjust_dimension(m_a.columns(), 16), m_b.rows());
   }
 
   void load(std::unique_ptr<BlockKernelType> &k, int offset) override {
-    k->load(&Parent::result(), &m_a, &m_b, offset);
+    k->load(&Parent::result(), &a(), &b(), offset);
   } 
 
   void init_block(CallType call_type) override {
     auto &settings = kernels::get_matrix_settings();
     settings.use_multi_kernel_calls = Parent::use_multi_kernel_calls(call_type); 
+    pad_inputs();
     Parent::init_block_kernels(kernels::matrix_mult_block<Ptr>, call_type);
   }
 
 private:
   Array2D &m_a;
   Array2D &m_b;
+  std::unique_ptr<Array2D> m_a_padded;
+  std::unique_ptr<Array2D> m_b_padded;
+  bool m_use_padded = false;
+
+  Array2D &a() { return m_use_padded?*m_a_padded:m_a; }
+  Array2D &b() { return m_use_padded?*m_b_padded:m_b; }
+
+
+  /**
+   * Set the inner dimension for the current number of blocks,
+   * and create zero-padded copies of the input matrices if needed.
+   */
+  void pad_inputs() {
+    auto &settings = kernels::get_matrix_settings();
+    int inner = kernels::matrix_settings::adjust_dimension(m_a.columns(), 16*Parent::num_blocks());
+    settings.inner = inner;
+
+    m_use_padded = (inner != m_a.columns());
+    if (!m_use_padded) return;
+
+    if (!m_a_padded || m_a_padded->columns() != inner
+     || m_a_padded->rows() != m_a.rows() || m_b_padded->rows() != m_b.rows()) {
+      m_a_padded.reset(new Array2D(m_a.rows(), inner));
+      m_b_padded.reset(new Array2D(m_b.rows(), inner));
+    }
+
+    kernels::copy_padded(*m_a_padded, m_a);
+    kernels::copy_padded(*m_b_padded, m_b);
+  }
 };
 
 
@@ -689,6 +1024,53 @@ private:
   Array &m_a;
 };
 
+
+/**
+ * Batched DFT with block matrix support
+ *
+ * Transforms a batch of signals in a single kernel invocation.
+ * The input is a 2D array with one signal per row; the output is a complex 2D array
+ * with the spectrum of each signal in the corresponding row.
+ *
+ * The twiddle table is calculated once on the CPU and shared by all signals and QPUs.
+ * This avoids the inline sin/cos of `DFT`, and has better precision on vc4.
+ *
+ * The signal length must be a power of two >= 16.
+ */
+template<
+  typename Array2D,
+  typename Ptr = typename std::conditional<std::is_same<Array2D, Float::Array2D>::value, Float::Ptr, Complex::Ptr>::type,
+  typename BlockKernelType = V3DLib::Kernel<Complex::Ptr, Ptr, Complex::Ptr, Int>,
+  typename Parent = BlockMatrix<Array2D, Ptr, BlockKernelType, Complex::Array2D>
+>
+class DFTBatch : public Parent {
+public:
+  DFTBatch(Array2D &a) : m_a(a), m_twiddles(a.columns()) {
+    int const Dim = m_a.columns();
+    assertq(Dim >= 16 && (Dim & (Dim - 1)) == 0, "DFTBatch: signal length must be a power of two >= 16");
+
+    auto &settings = kernels::get_matrix_settings();
+    settings.set(m_a.rows(), Dim, Dim);
+    kernels::dft_twiddles(m_twiddles);
+  }
+
+  int num_signals() const { return m_a.rows(); }
+
+  void load(std::unique_ptr<BlockKernelType> &k, int offset) override {
+    k->load(&Parent::result(), &m_a, &m_twiddles, offset);
+  } 
+
+  void init_block(CallType call_type) override {
+    auto &settings = kernels::get_matrix_settings();
+    settings.use_multi_kernel_calls = Parent::use_multi_kernel_calls(call_type); 
+    Parent::init_block_kernels(kernels::dft_batch_kernel_block<Ptr>, call_type);
+  }
+
+private:
+  Array2D &m_a;
+  Complex::Array m_twiddles;
+};
+
 }  // namespace V3DLib
 
 #endif  // _V3DLIB_KERNELS_MATRIX_H_
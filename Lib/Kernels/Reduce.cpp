@@ -0,0 +1,385 @@
+#include "Reduce.h"
+#include "Source/Lang.h"
+#include "Source/gather.h"
+#include "Source/Functions.h"
+#include "Support/basics.h"
+#include "KernelCache.h"
+
+namespace kernels {
+
+namespace {
+
+/**
+ * Reduce the part of the array handled by the current QPU to a vector.
+ *
+ * The QPUs take turns in reading vectors from the array. The next vector is
+ * prefetched while the current one is processed.
+ *
+ * Elements past the end of the array are read as the last element, so that
+ * reads always stay within the array. For min/max/argmax these duplicates
+ * do not influence the result; for sum, they are set to zero.
+ *
+ * @param idx  ARGMAX only, index of the value per vector element
+ */
+template<typename T>
+void reduce_lanes(ReduceOp op, T &value, Int &idx, typename T::Ptr const &src, Int const &size) {
+  Int last = size - 1;
+  Int first = min(index(), last);
+
+  if (op == ReduceOp::SUM) {
+    value = 0;
+  } else {
+    gather(src + (first - index()));  comment("reduce_lanes init");
+    receive(value);
+  }
+
+  if (op == ReduceOp::ARGMAX) {
+    idx = first;
+  }
+
+  Int offset = 16*me();
+  Int next = min(offset + index(), last);
+  gather(src + (next - index()));
+
+  While (offset < size)
+    Int n = offset + index();
+    Int cur = next;
+    T val;
+    receive(val);
+
+    offset += 16*numQPUs();
+    next = min(offset + index(), last);
+    gather(src + (next - index()));
+
+    switch (op) {
+      case ReduceOp::SUM:
+        Where (n >= size)
+          val = 0;
+        End
+        value += val;
+        break;
+
+      case ReduceOp::MIN:
+        value = min(value, val);
+        break;
+
+      case ReduceOp::MAX:
+        value = max(value, val);
+        break;
+
+      case ReduceOp::ARGMAX:
+        // Strictly greater, so that the lowest index is retained for equal values
+        Where (val > value)
+          value = val;
+          idx = cur;
+        End
+        break;
+    }
+  End
+
+  T dummy;
+  receive(dummy);  comment("Discard the last prefetch");
+}
+
+
+/**
+ * Reduce the vector elements, using a rotate tree.
+ *
+ * Afterwards, all vector elements contain the result.
+ */
+template<typename T>
+void reduce_vector(ReduceOp op, T &value, Int &idx) {
+  T tmp = value;
+
+  switch (op) {
+    case ReduceOp::SUM: rotate_sum(tmp, value); break;
+    case ReduceOp::MIN: rotate_min(tmp, value); break;
+    case ReduceOp::MAX: rotate_max(tmp, value); break;
+
+    case ReduceOp::ARGMAX:
+      for (int n = 1; n <= 8; n *= 2) {
+        T   rot_value = rotate(value, n);
+        Int rot_idx   = rotate(idx, n);
+
+        Where (rot_value > value || (rot_value == value && rot_idx < idx))
+          value = rot_value;
+          idx   = rot_idx;
+        End
+      }
+      break;
+  }
+}
+
+
+/**
+ * Combine the partial results of all QPUs on QPU 0.
+ *
+ * Every other QPU writes its partial result to its own slot of 16 values, and then sets its flag.
+ * QPU 0 waits till all flags are set, reads in the partial results and reduces these.
+ * Finally, the flags are reset.
+ *
+ * This is similar to `sync_qpus()`, but all writes are complete vectors to separate
+ * locations. This is required for vc4, where a store writes all 16 vector elements
+ * to consecutive locations.
+ *
+ * QPU 0 uses its own partial result directly; on vc4, a store is only guaranteed to be
+ * complete when the next store is done.
+ */
+template<typename T>
+void combine_qpus(
+  ReduceOp op,
+  T &value,
+  Int &idx,
+  typename T::Ptr const &partials,
+  Int::Ptr const *partial_indices,
+  Int::Ptr const &flags
+) {
+  assert(op != ReduceOp::ARGMAX || partial_indices != nullptr);
+
+  If (numQPUs() != 1)  // Don't bother combining if only one qpu
+    Int::Ptr flag = flags + 16*me();
+    header("Start combine QPU partial results");
+
+    If (me() != 0)
+      typename T::Ptr dst = partials + 16*me();
+      *dst = value;
+
+      if (op == ReduceOp::ARGMAX) {
+        Int::Ptr dst_idx = *partial_indices + 16*me();
+        *dst_idx = idx;
+      }
+
+      *flag = 1;
+    Else
+      // Vector element i reads the values of QPU i
+      Int qpu = min(index(), numQPUs() - 1);
+      Int offset = 16*qpu - index();
+
+      Int done = 0;  comment("QPU 0: Wait till all flags are set");
+      While (any(done == 0))
+        gather(flags + offset);
+        receive(done);
+
+        Where (index() == 0)
+          done = 1;
+        End
+      End
+
+      T own_value = value;
+      gather(partials + offset);
+      receive(value);
+
+      Where (index() == 0)
+        value = own_value;
+      End
+
+      if (op == ReduceOp::ARGMAX) {
+        Int own_idx = idx;
+        gather(*partial_indices + offset);
+        receive(idx);
+
+        Where (index() == 0)
+          idx = own_idx;
+        End
+      }
+
+      if (op == ReduceOp::SUM) {
+        Where (index() >= numQPUs())
+          value = 0;
+        End
+      }
+
+      reduce_vector(op, value, idx);
+
+      For (Int q = 1, q < numQPUs(), q++)
+        flag = flags + 16*q;  comment("QPU 0: Reset flags");
+        *flag = 0;
+      End
+    End
+  End
+}
+
+
+template<typename T>
+void reduce(
+  ReduceOp op,
+  T &result,
+  Int &idx,
+  typename T::Ptr const &src,
+  Int const &size,
+  typename T::Ptr const &partials,
+  Int::Ptr const *partial_indices,
+  Int::Ptr const &flags
+) {
+  reduce_lanes(op, result, idx, src, size);
+  reduce_vector(op, result, idx);
+  combine_qpus(op, result, idx, partials, partial_indices, flags);
+}
+
+
+KernelCache &reduce_cache() {
+  static KernelCache cache(16);
+  return cache;
+}
+
+
+template<typename T, ReduceOp op, typename Type>
+Type reduce_call(char const *id, SharedArray<Type> &src, int numQPUs) {
+  assertq(src.size() > 0, "reduce: array can not be empty");
+
+  SharedArray<Type> result(16);
+  SharedArray<Type> partials(16*numQPUs);
+  Int::Array flags(16*numQPUs);
+  flags.fill(0);
+
+  auto &k = reduce_cache().get({id, {}, numQPUs}, reduce_kernel<T, op>);
+  k.load(&result, &src, (int) src.size(), &partials, &flags).call();
+  return result[0];
+}
+
+
+template<typename T, typename Type>
+int argmax_call(char const *id, SharedArray<Type> &src, int numQPUs) {
+  assertq(src.size() > 0, "reduce_argmax: array can not be empty");
+
+  Int::Array result(16);
+  SharedArray<Type> partials(16*numQPUs);
+  Int::Array partial_indices(16*numQPUs);
+  Int::Array flags(16*numQPUs);
+  flags.fill(0);
+
+  auto &k = reduce_cache().get({id, {}, numQPUs}, argmax_kernel<T>);
+  k.load(&result, &src, (int) src.size(), &partials, &partial_indices, &flags).call();
+  return result[0];
+}
+
+}  // anon namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernel code
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+void reduce_sum(T &result, typename T::Ptr const &src, Int const &size,
+                typename T::Ptr const &partials, Int::Ptr const &flags) {
+  Int dummy;
+  reduce(ReduceOp::SUM, result, dummy, src, size, partials, nullptr, flags);
+}
+
+
+template<typename T>
+void reduce_min(T &result, typename T::Ptr const &src, Int const &size,
+                typename T::Ptr const &partials, Int::Ptr const &flags) {
+  Int dummy;
+  reduce(ReduceOp::MIN, result, dummy, src, size, partials, nullptr, flags);
+}
+
+
+template<typename T>
+void reduce_max(T &result, typename T::Ptr const &src, Int const &size,
+                typename T::Ptr const &partials, Int::Ptr const &flags) {
+  Int dummy;
+  reduce(ReduceOp::MAX, result, dummy, src, size, partials, nullptr, flags);
+}
+
+
+template<typename T>
+void reduce_argmax(Int &result, typename T::Ptr const &src, Int const &size,
+                   typename T::Ptr const &partials, Int::Ptr const &partial_indices, Int::Ptr const &flags) {
+  T value;
+  reduce(ReduceOp::ARGMAX, value, result, src, size, partials, &partial_indices, flags);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernels
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T, ReduceOp op>
+void reduce_kernel(typename T::Ptr result, typename T::Ptr src, Int size, typename T::Ptr partials, Int::Ptr flags) {
+  static_assert(op != ReduceOp::ARGMAX, "Use argmax_kernel() for ARGMAX");
+
+  T value;
+
+  switch (op) {
+    case ReduceOp::SUM: reduce_sum(value, src, size, partials, flags); break;
+    case ReduceOp::MIN: reduce_min(value, src, size, partials, flags); break;
+    case ReduceOp::MAX: reduce_max(value, src, size, partials, flags); break;
+    default: break;
+  }
+
+  If (me() == 0)
+    *result = value;
+  End
+}
+
+
+template<typename T>
+void argmax_kernel(Int::Ptr result, typename T::Ptr src, Int size,
+                   typename T::Ptr partials, Int::Ptr partial_indices, Int::Ptr flags) {
+  Int idx;
+  reduce_argmax<T>(idx, src, size, partials, partial_indices, flags);
+
+  If (me() == 0)
+    *result = idx;
+  End
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Host-side calls
+///////////////////////////////////////////////////////////////////////////////
+
+int reduce_sum(Int::Array &src, int numQPUs) {
+  return reduce_call<Int, ReduceOp::SUM>("reduce_sum_int", src, numQPUs);
+}
+
+float reduce_sum(Float::Array &src, int numQPUs) {
+  return reduce_call<Float, ReduceOp::SUM>("reduce_sum_float", src, numQPUs);
+}
+
+int reduce_min(Int::Array &src, int numQPUs) {
+  return reduce_call<Int, ReduceOp::MIN>("reduce_min_int", src, numQPUs);
+}
+
+float reduce_min(Float::Array &src, int numQPUs) {
+  return reduce_call<Float, ReduceOp::MIN>("reduce_min_float", src, numQPUs);
+}
+
+int reduce_max(Int::Array &src, int numQPUs) {
+  return reduce_call<Int, ReduceOp::MAX>("reduce_max_int", src, numQPUs);
+}
+
+float reduce_max(Float::Array &src, int numQPUs) {
+  return reduce_call<Float, ReduceOp::MAX>("reduce_max_float", src, numQPUs);
+}
+
+int reduce_argmax(Int::Array &src, int numQPUs) {
+  return argmax_call<Int>("reduce_argmax_int", src, numQPUs);
+}
+
+int reduce_argmax(Float::Array &src, int numQPUs) {
+  return argmax_call<Float>("reduce_argmax_float", src, numQPUs);
+}
+
+
+template void reduce_sum<Int>(Int &, Int::Ptr const &, Int const &, Int::Ptr const &, Int::Ptr const &);
+template void reduce_sum<Float>(Float &, Float::Ptr const &, Int const &, Float::Ptr const &, Int::Ptr const &);
+template void reduce_min<Int>(Int &, Int::Ptr const &, Int const &, Int::Ptr const &, Int::Ptr const &);
+template void reduce_min<Float>(Float &, Float::Ptr const &, Int const &, Float::Ptr const &, Int::Ptr const &);
+template void reduce_max<Int>(Int &, Int::Ptr const &, Int const &, Int::Ptr const &, Int::Ptr const &);
+template void reduce_max<Float>(Float &, Float::Ptr const &, Int const &, Float::Ptr const &, Int::Ptr const &);
+template void reduce_argmax<Int>(Int &, Int::Ptr const &, Int const &, Int::Ptr const &, Int::Ptr const &, Int::Ptr const &);
+template void reduce_argmax<Float>(Int &, Float::Ptr const &, Int const &, Float::Ptr const &, Int::Ptr const &, Int::Ptr const &);
+
+template void reduce_kernel<Int, ReduceOp::SUM>(Int::Ptr, Int::Ptr, Int, Int::Ptr, Int::Ptr);
+template void reduce_kernel<Int, ReduceOp::MIN>(Int::Ptr, Int::Ptr, Int, Int::Ptr, Int::Ptr);
+template void reduce_kernel<Int, ReduceOp::MAX>(Int::Ptr, Int::Ptr, Int, Int::Ptr, Int::Ptr);
+template void reduce_kernel<Float, ReduceOp::SUM>(Float::Ptr, Float::Ptr, Int, Float::Ptr, Int::Ptr);
+template void reduce_kernel<Float, ReduceOp::MIN>(Float::Ptr, Float::Ptr, Int, Float::Ptr, Int::Ptr);
+template void reduce_kernel<Float, ReduceOp::MAX>(Float::Ptr, Float::Ptr, Int, Float::Ptr, Int::Ptr);
+template void argmax_kernel<Int>(Int::Ptr, Int::Ptr, Int, Int::Ptr, Int::Ptr, Int::Ptr);
+template void argmax_kernel<Float>(Int::Ptr, Float::Ptr, Int, Float::Ptr, Int::Ptr, Int::Ptr);
+
+}  // namespace kernels
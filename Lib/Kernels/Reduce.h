@@ -0,0 +1,92 @@
+#ifndef _V3DLIB_KERNELS_REDUCE_H_
+#define _V3DLIB_KERNELS_REDUCE_H_
+#include "../Source/Int.h"
+#include "../Source/Float.h"
+#include "../Common/SharedArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Reductions over arrays
+////////////////////////////////////////////////////////////////////////////////
+
+namespace kernels {
+
+using namespace V3DLib;
+
+/**
+ * Reduction operations.
+ *
+ * For ARGMAX, the index of the first occurence of the maximum value is returned.
+ */
+enum class ReduceOp {
+  SUM,
+  MIN,
+  MAX,
+  ARGMAX
+};
+
+
+//
+// Kernel code.
+//
+// These can be used in kernels which run on multiple QPUs. Every QPU reduces a part of the array;
+// the partial results are combined by QPU 0. The final result is only present on QPU 0;
+// the other QPUs retain their partial result.
+//
+// The caller supplies the buffers for the cross-QPU combine:
+//
+// - `partials`, `partial_indices`: 16 values per QPU
+// - `flags`: 16 values per QPU, must be zero on the first call. They are reset for the next kernel call.
+//
+// Only one reduction per kernel call is supported, because the QPUs other than QPU 0 do not
+// wait for the combine to complete.
+//
+// `T` is either `Int` or `Float`.
+//
+
+template<typename T>
+void reduce_sum(T &result, typename T::Ptr const &src, Int const &size,
+                typename T::Ptr const &partials, Int::Ptr const &flags);
+
+template<typename T>
+void reduce_min(T &result, typename T::Ptr const &src, Int const &size,
+                typename T::Ptr const &partials, Int::Ptr const &flags);
+
+template<typename T>
+void reduce_max(T &result, typename T::Ptr const &src, Int const &size,
+                typename T::Ptr const &partials, Int::Ptr const &flags);
+
+template<typename T>
+void reduce_argmax(Int &result, typename T::Ptr const &src, Int const &size,
+                   typename T::Ptr const &partials, Int::Ptr const &partial_indices, Int::Ptr const &flags);
+
+
+//
+// Kernels, the result is written to the first 16 elements of `result`.
+//
+
+template<typename T, ReduceOp op>
+void reduce_kernel(typename T::Ptr result, typename T::Ptr src, Int size, typename T::Ptr partials, Int::Ptr flags);
+
+template<typename T>
+void argmax_kernel(Int::Ptr result, typename T::Ptr src, Int size,
+                   typename T::Ptr partials, Int::Ptr partial_indices, Int::Ptr flags);
+
+
+//
+// Host-side calls.
+//
+// These compile the kernel on first use and retain it for subsequent calls.
+//
+
+int   reduce_sum(Int::Array &src, int numQPUs = 1);
+float reduce_sum(Float::Array &src, int numQPUs = 1);
+int   reduce_min(Int::Array &src, int numQPUs = 1);
+float reduce_min(Float::Array &src, int numQPUs = 1);
+int   reduce_max(Int::Array &src, int numQPUs = 1);
+float reduce_max(Float::Array &src, int numQPUs = 1);
+int   reduce_argmax(Int::Array &src, int numQPUs = 1);
+int   reduce_argmax(Float::Array &src, int numQPUs = 1);
+
+}  // namespace kernels
+
+#endif  // _V3DLIB_KERNELS_REDUCE_H_
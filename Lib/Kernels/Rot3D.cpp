@@ -141,7 +141,7 @@ void rot3D_3(Float cosTheta, Float sinTheta, Float::Ptr x, Float::Ptr y) {
  * Using decorator to avoid `N/numQPUs()` in source language code.
  * TODO retest to see effect of that division, optimize it if a problem. 
  */
-FuncType *rot3D_3_decorator(int dimension, int in_numQPUs) {
+Rot3D_3_FuncType *rot3D_3_decorator(int dimension, int in_numQPUs) {
   assert(dimension > 0);
   assertq(dimension % 16 == 0, "dimension must be a multiple of 16");
   // TODO perhaps assert in_numQPUs as well
@@ -13,9 +13,9 @@ void rot3D_2(Int n, Float cosTheta, Float sinTheta, Float::Ptr x, Float::Ptr y);
 
 void rot3D_3(Float cosTheta, Float sinTheta, Float::Ptr x, Float::Ptr y);
 
-using FuncType = decltype(rot3D_3);
+using Rot3D_3_FuncType = decltype(rot3D_3);
 
-FuncType *rot3D_3_decorator(int dimension, int in_numQPUs = 1);
+Rot3D_3_FuncType *rot3D_3_decorator(int dimension, int in_numQPUs = 1);
 
 }  // namespace kernels
 
@@ -0,0 +1,67 @@
+#include "Scan.h"
+#include "Source/Functions.h"
+#include "Support/basics.h"
+#include "KernelCache.h"
+
+namespace kernels {
+
+namespace {
+
+KernelCache &scan_cache() {
+  static KernelCache cache;
+  return cache;
+}
+
+
+template<typename T, bool inclusive, typename Type>
+void scan_call(char const *id, SharedArray<Type> &dst, SharedArray<Type> &src, int numQPUs) {
+  assertq(src.size() > 0, "scan: array can not be empty");
+  assertq(dst.size() >= 16*((src.size() + 15)/16), "scan: dst must have room for src size rounded up to 16");
+
+  SharedArray<Type> block_sums(16*numQPUs);
+  Int::Array flags(16*numQPUs);
+  flags.fill(0);
+
+  auto &k = scan_cache().get({id, {}, numQPUs}, scan_kernel<T, inclusive>);
+  k.load(&dst, &src, (int) src.size(), &block_sums, &flags).call();
+}
+
+}  // anon namespace
+
+
+template<typename T, bool inclusive>
+void scan_kernel(typename T::Ptr dst, typename T::Ptr src, Int size, typename T::Ptr block_sums, Int::Ptr flags) {
+  if (inclusive) {
+    V3DLib::inclusive_scan(dst, src, size, block_sums, flags);
+  } else {
+    V3DLib::exclusive_scan(dst, src, size, block_sums, flags);
+  }
+}
+
+
+void inclusive_scan(Int::Array &dst, Int::Array &src, int numQPUs) {
+  scan_call<Int, true>("inclusive_scan_int", dst, src, numQPUs);
+}
+
+
+void inclusive_scan(Float::Array &dst, Float::Array &src, int numQPUs) {
+  scan_call<Float, true>("inclusive_scan_float", dst, src, numQPUs);
+}
+
+
+void exclusive_scan(Int::Array &dst, Int::Array &src, int numQPUs) {
+  scan_call<Int, false>("exclusive_scan_int", dst, src, numQPUs);
+}
+
+
+void exclusive_scan(Float::Array &dst, Float::Array &src, int numQPUs) {
+  scan_call<Float, false>("exclusive_scan_float", dst, src, numQPUs);
+}
+
+
+template void scan_kernel<Int, true>(Int::Ptr, Int::Ptr, Int, Int::Ptr, Int::Ptr);
+template void scan_kernel<Int, false>(Int::Ptr, Int::Ptr, Int, Int::Ptr, Int::Ptr);
+template void scan_kernel<Float, true>(Float::Ptr, Float::Ptr, Int, Float::Ptr, Int::Ptr);
+template void scan_kernel<Float, false>(Float::Ptr, Float::Ptr, Int, Float::Ptr, Int::Ptr);
+
+}  // namespace kernels
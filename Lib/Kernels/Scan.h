@@ -0,0 +1,41 @@
+#ifndef _V3DLIB_KERNELS_SCAN_H_
+#define _V3DLIB_KERNELS_SCAN_H_
+#include "../Source/Int.h"
+#include "../Source/Float.h"
+#include "../Common/SharedArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Prefix sums over arrays
+//
+// The kernel code is in `Source/Functions.h`, see `inclusive_scan()` and `exclusive_scan()`.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace kernels {
+
+using namespace V3DLib;
+
+/**
+ * Kernel for an inclusive or exclusive scan.
+ *
+ * `T` is either `Int` or `Float`.
+ * `flags` must be zero before every call.
+ */
+template<typename T, bool inclusive>
+void scan_kernel(typename T::Ptr dst, typename T::Ptr src, Int size, typename T::Ptr block_sums, Int::Ptr flags);
+
+
+//
+// Host-side calls.
+//
+// These compile the kernel on first use and retain it for subsequent calls.
+// `dst` must have room for the size of `src`, rounded up to a multiple of 16.
+//
+
+void inclusive_scan(Int::Array &dst, Int::Array &src, int numQPUs = 1);
+void inclusive_scan(Float::Array &dst, Float::Array &src, int numQPUs = 1);
+void exclusive_scan(Int::Array &dst, Int::Array &src, int numQPUs = 1);
+void exclusive_scan(Float::Array &dst, Float::Array &src, int numQPUs = 1);
+
+}  // namespace kernels
+
+#endif  // _V3DLIB_KERNELS_SCAN_H_
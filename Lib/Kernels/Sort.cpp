@@ -0,0 +1,419 @@
+#include "Sort.h"
+#include <vector>
+#include "Source/Lang.h"
+#include "Source/gather.h"
+#include "Support/basics.h"
+#include "KernelCache.h"
+
+namespace kernels {
+
+namespace {
+
+/**
+ * Registers for a number of vectors from the array, keys with optional values.
+ *
+ * The compare/exchange operations of the bitonic network are performed on these registers.
+ *
+ * The sort direction is passed as an Int, which is zero for ascending, non-zero for descending.
+ * This can differ per vector element.
+ */
+template<typename T>
+class Block {
+  using Ptr = typename T::Ptr;
+
+public:
+  Block(int size, bool has_values) : m_has_values(has_values), m_keys(size), m_index(size) {
+    if (m_has_values) m_values.resize(size);
+  }
+
+  int size() const { return (int) m_keys.size(); }
+
+  /**
+   * Set the index of vector `i` in the array
+   */
+  void set_index(int i, IntExpr val) { m_index[i] = val; }
+
+
+  /**
+   * Load the vectors. The next vector is prefetched while receiving the current one.
+   */
+  void load(Ptr const &keys, Int::Ptr const &values) {
+    load(m_keys, keys);
+    if (m_has_values) load(m_values, values);
+  }
+
+
+  void store(Ptr const &keys, Int::Ptr const &values) {
+    for (int i = 0; i < size(); ++i) {
+      *(keys + 16*m_index[i]) = m_keys[i];
+    }
+
+    if (m_has_values) {
+      for (int i = 0; i < size(); ++i) {
+        *(values + 16*m_index[i]) = m_values[i];
+      }
+    }
+  }
+
+
+  /**
+   * Compare/exchange the elements of vectors `a` and `b`.
+   *
+   * Afterwards, `a` contains the smaller values for ascending, the larger values for descending.
+   */
+  void compare_vectors(int a, int b, Int const &desc) {
+    T &ka = m_keys[a];
+    T &kb = m_keys[b];
+
+    if (!m_has_values) {
+      T lo = min(ka, kb);
+      T hi = max(ka, kb);
+
+      Where (desc == 0)
+        ka = lo;
+        kb = hi;
+      Else
+        ka = hi;
+        kb = lo;
+      End
+      return;
+    }
+
+    T   tmp_key   = ka;
+    Int tmp_value = m_values[a];
+
+    Where ((kb < ka) != (desc != 0))
+      ka = kb;
+      kb = tmp_key;
+      m_values[a] = m_values[b];
+      m_values[b] = tmp_value;
+    End
+  }
+
+
+  /**
+   * Compare/exchange the elements of vector `i` which are `j` elements apart, j < 16.
+   */
+  void compare_lanes(int i, int j, Int const &desc) {
+    assert(0 < j && j < 16);
+    T &key = m_keys[i];
+
+    Int upper = index() & j;  // Non-zero for the element with the higher index of a pair
+
+    T partner = rotate(key, 16 - j);
+    T tmp     = rotate(key, j);
+    Where (upper != 0)
+      partner = tmp;
+    End
+
+    // The lower element of a pair keeps the minimum for ascending
+    Int keep_max = 0;
+    Where ((upper != 0) != (desc != 0))
+      keep_max = 1;
+    End
+
+    if (!m_has_values) {
+      T lo = min(key, partner);
+      T hi = max(key, partner);
+
+      key = lo;
+      Where (keep_max != 0)
+        key = hi;
+      End
+      return;
+    }
+
+    Int &value = m_values[i];
+
+    // Strict comparisons, so that both elements of a pair agree on the exchange
+    Int take = 0;
+    Where (keep_max == 0 && partner < key)
+      take = 1;
+    End
+    Where (keep_max != 0 && partner > key)
+      take = 1;
+    End
+
+    Int partner_value = rotate(value, 16 - j);
+    Int tmp_value     = rotate(value, j);
+    Where (upper != 0)
+      partner_value = tmp_value;
+    End
+
+    Where (take != 0)
+      key   = partner;
+      value = partner_value;
+    End
+  }
+
+
+  /**
+   * Perform a level of the bitonic network for elements `j` apart.
+   *
+   * The vectors of the block are assumed to be consecutive in the array.
+   * For `j >= 16`, the sort direction must be the same for all vector elements.
+   */
+  void level(int j, Int const &desc) {
+    if (j >= 16) {
+      int stride = j/16;
+      assert(stride < size());
+
+      for (int a = 0; a < size(); ++a) {
+        if (a & stride) continue;
+        compare_vectors(a, a + stride, desc);
+      }
+    } else {
+      for (int i = 0; i < size(); ++i) {
+        compare_lanes(i, j, desc);
+      }
+    }
+  }
+
+private:
+  bool m_has_values;
+  std::vector<T>   m_keys;
+  std::vector<Int> m_values;
+  std::vector<Int> m_index;    // Index of the vectors in the array
+
+
+  template<typename Type>
+  void load(std::vector<Type> &dst, typename Type::Ptr const &src) {
+    gather(src + 16*m_index[0]);
+
+    for (int i = 0; i < size(); ++i) {
+      if (i + 1 < size()) gather(src + 16*m_index[i + 1]);
+      receive(dst[i]);
+    }
+  }
+};
+
+}  // anon namespace
+
+
+sort_settings &get_sort_settings() {
+  static sort_settings settings;
+  return settings;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernels
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Sort blocks of `block_vecs` vectors in registers.
+ *
+ * The blocks are sorted in alternating directions, so that pairs of blocks form
+ * bitonic sequences for the subsequent merges.
+ */
+template<typename T>
+void sort_blocks_kernel(typename T::Ptr keys, Int::Ptr values, Int num_blocks) {
+  auto const &settings = get_sort_settings();
+  int const block_vecs = settings.block_vecs;
+
+  Block<T> block(block_vecs, settings.has_values);
+
+  For (Int b = me(), b < num_blocks, b += numQPUs())
+    for (int i = 0; i < block_vecs; ++i) {
+      block.set_index(i, block_vecs*b + i);
+    }
+
+    block.load(keys, values);
+
+    for (int k = 2; k <= settings.block_size(); k *= 2) {
+      for (int j = k/2; j >= 1; j /= 2) {
+        if (j >= 16) {
+          // Direction is the same for all elements of a vector
+          int stride = j/16;
+
+          for (int a = 0; a < block_vecs; ++a) {
+            if (a & stride) continue;
+            Int desc = (16*(block_vecs*b + a)) & k;
+            block.compare_vectors(a, a + stride, desc);
+          }
+        } else {
+          for (int i = 0; i < block_vecs; ++i) {
+            Int desc = (16*(block_vecs*b + i) + index()) & k;
+            block.compare_lanes(i, j, desc);
+          }
+        }
+      }
+    }
+
+    block.store(keys, values);
+  End
+}
+
+
+/**
+ * Perform `levels` consecutive merge levels for stage `k`, over elements which are
+ * further apart than a block.
+ *
+ * The elements involved are in groups of 2^levels vectors, which are `1 << shift` vectors
+ * apart. The group index bits are split around the bits at positions shift..shift + levels - 1.
+ */
+template<typename T>
+void merge_global_kernel(typename T::Ptr keys, Int::Ptr values, Int num_groups, Int k, Int shift) {
+  auto const &settings = get_sort_settings();
+  int const levels     = settings.levels;
+  int const group_size = 1 << levels;
+
+  Block<T> block(group_size, settings.has_values);
+
+  For (Int g = me(), g < num_groups, g += numQPUs())
+    Int high = g >> shift;
+    Int base = (g - (high << shift)) + (high << (shift + levels));
+
+    for (int m = 0; m < group_size; ++m) {
+      block.set_index(m, base + (m << shift));
+    }
+
+    block.load(keys, values);
+
+    Int desc = (base << 4) & k;  // Same direction for the entire group
+
+    // Vectors in the group are consecutive in register order, with stride 1 for the last level
+    for (int l = levels - 1; l >= 0; --l) {
+      block.level(16*(1 << l), desc);
+    }
+
+    block.store(keys, values);
+  End
+}
+
+
+/**
+ * Perform the merge levels for stage `k` within blocks.
+ */
+template<typename T>
+void merge_local_kernel(typename T::Ptr keys, Int::Ptr values, Int num_blocks, Int k) {
+  auto const &settings = get_sort_settings();
+  int const block_vecs = settings.block_vecs;
+
+  Block<T> block(block_vecs, settings.has_values);
+
+  For (Int b = me(), b < num_blocks, b += numQPUs())
+    for (int i = 0; i < block_vecs; ++i) {
+      block.set_index(i, block_vecs*b + i);
+    }
+
+    block.load(keys, values);
+
+    Int desc = (settings.block_size()*b) & k;  // Same direction for the entire block
+
+    for (int j = settings.block_size()/2; j >= 1; j /= 2) {
+      block.level(j, desc);
+    }
+
+    block.store(keys, values);
+  End
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Host-side calls
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+KernelCache &sort_cache() {
+  static KernelCache cache(16);
+  return cache;
+}
+
+
+int log2(int val) {
+  int ret = 0;
+  while ((1 << ret) < val) ++ret;
+  return ret;
+}
+
+
+/**
+ * Run the bitonic sort as a sequence of kernel calls.
+ *
+ * The kernel calls act as barriers between the passes over the QPUs.
+ */
+template<typename T, typename Type>
+void sort_call(char const *id, SharedArray<Type> &keys, Int::Array *values, int numQPUs) {
+  int const size = (int) keys.size();
+  assertq(size >= 16 && (size & (size - 1)) == 0, "sort: array size must be a power of two, and at least 16");
+  assertq(values == nullptr || (int) values->size() == size, "sort: keys and values must have the same size");
+
+  static Int::Array no_values(16);
+  Int::Array &vals = (values == nullptr)? no_values : *values;
+
+  auto &settings = get_sort_settings();
+  settings.has_values = (values != nullptr);
+  settings.block_vecs = std::min(8, size/16);
+
+  int const num_vecs   = size/16;
+  int const num_blocks = num_vecs/settings.block_vecs;
+  int const block_size = settings.block_size();
+  int const has_values = settings.has_values? 1 : 0;
+
+  auto run_blocks = [&] () {
+    auto &k = sort_cache().get({id, {0, settings.block_vecs, has_values}, numQPUs}, sort_blocks_kernel<T>);
+    k.load(&keys, &vals, num_blocks).call();
+  };
+
+  auto run_global = [&] (int k, int j, int levels) {
+    settings.levels = levels;
+    int shift = log2(j/16) - levels + 1;
+
+    auto &kernel = sort_cache().get({id, {1, levels, has_values}, numQPUs}, merge_global_kernel<T>);
+    kernel.load(&keys, &vals, num_vecs >> levels, k, shift).call();
+  };
+
+  auto run_local = [&] (int k) {
+    auto &kernel = sort_cache().get({id, {2, settings.block_vecs, has_values}, numQPUs}, merge_local_kernel<T>);
+    kernel.load(&keys, &vals, num_blocks, k).call();
+  };
+
+  run_blocks();
+
+  for (int k = 2*block_size; k <= size; k *= 2) {
+    int j = k/2;
+
+    while (j >= block_size) {
+      // Up to 3 levels per call, 8 vectors in registers
+      int levels = std::min(3, log2(j) - log2(block_size) + 1);
+      run_global(k, j, levels);
+      j >>= levels;
+    }
+
+    run_local(k);
+  }
+}
+
+}  // anon namespace
+
+
+void sort(Int::Array &keys, int numQPUs) {
+  sort_call<Int>("sort_int", keys, nullptr, numQPUs);
+}
+
+
+void sort(Float::Array &keys, int numQPUs) {
+  sort_call<Float>("sort_float", keys, nullptr, numQPUs);
+}
+
+
+void sort(Int::Array &keys, Int::Array &values, int numQPUs) {
+  sort_call<Int>("sort_int", keys, &values, numQPUs);
+}
+
+
+void sort(Float::Array &keys, Int::Array &values, int numQPUs) {
+  sort_call<Float>("sort_float", keys, &values, numQPUs);
+}
+
+
+template void sort_blocks_kernel<Int>(Int::Ptr, Int::Ptr, Int);
+template void sort_blocks_kernel<Float>(Float::Ptr, Int::Ptr, Int);
+template void merge_global_kernel<Int>(Int::Ptr, Int::Ptr, Int, Int, Int);
+template void merge_global_kernel<Float>(Float::Ptr, Int::Ptr, Int, Int, Int);
+template void merge_local_kernel<Int>(Int::Ptr, Int::Ptr, Int, Int);
+template void merge_local_kernel<Float>(Float::Ptr, Int::Ptr, Int, Int);
+
+}  // namespace kernels
@@ -0,0 +1,63 @@
+#ifndef _V3DLIB_KERNELS_SORT_H_
+#define _V3DLIB_KERNELS_SORT_H_
+#include "../Source/Int.h"
+#include "../Source/Float.h"
+#include "../Common/SharedArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Bitonic sort
+////////////////////////////////////////////////////////////////////////////////
+
+namespace kernels {
+
+using namespace V3DLib;
+
+/**
+ * Settings for the sort kernels.
+ *
+ * These are applied when the kernels are compiled.
+ */
+struct sort_settings {
+  int  block_vecs = 8;       // Number of vectors in a block which is sorted in registers
+  int  levels     = 1;       // merge_global_kernel only: number of merge levels per call
+  bool has_values = false;   // If true, sort key/value pairs
+
+  int block_size() const { return 16*block_vecs; }
+};
+
+sort_settings &get_sort_settings();
+
+
+//
+// Kernels for the separate passes of the sort.
+//
+// If there are no values, the `values` parameter is ignored.
+//
+
+template<typename T>
+void sort_blocks_kernel(typename T::Ptr keys, Int::Ptr values, Int num_blocks);
+
+template<typename T>
+void merge_global_kernel(typename T::Ptr keys, Int::Ptr values, Int num_groups, Int k, Int shift);
+
+template<typename T>
+void merge_local_kernel(typename T::Ptr keys, Int::Ptr values, Int num_blocks, Int k);
+
+
+//
+// Sort arrays in ascending order.
+//
+// The array size must be a power of two, and at least 16.
+// The kernels are compiled on first use and retained for subsequent calls.
+//
+// The sort is not stable; for equal keys, the order of the values is undefined.
+//
+
+void sort(Int::Array &keys, int numQPUs = 1);
+void sort(Float::Array &keys, int numQPUs = 1);
+void sort(Int::Array &keys, Int::Array &values, int numQPUs = 1);
+void sort(Float::Array &keys, Int::Array &values, int numQPUs = 1);
+
+}  // namespace kernels
+
+#endif  // _V3DLIB_KERNELS_SORT_H_
@@ -0,0 +1,495 @@
+#include "Stencil.h"
+#include "Source/Lang.h"
+#include "Source/gather.h"
+#include "Source/Functions.h"
+#include "Support/basics.h"
+
+namespace kernels {
+
+namespace {
+
+/**
+ * The three consecutive vectors of an input row around the output position
+ */
+template<typename T>
+struct Row {
+  T left;
+  T mid;
+  T right;
+
+  void operator=(Row<T> const &rhs) {
+    left  = rhs.left;
+    mid   = rhs.mid;
+    right = rhs.right;
+  }
+};
+
+
+/**
+ * Add `c*val` to the accumulator.
+ *
+ * Since the coefficients are known at compile time, trivial multiplications are skipped.
+ */
+void add_term(Float &acc, bool &first, Float const &val, float c) {
+  if (c == 0.0f) return;
+
+  if (first) {
+    if (c == 1.0f) {
+      acc = val;
+    } else {
+      acc = c*val;
+    }
+    first = false;
+  } else if (c == 1.0f) {
+    acc += val;
+  } else if (c == -1.0f) {
+    acc -= val;
+  } else {
+    acc += c*val;
+  }
+}
+
+
+void add_term(Int &acc, bool &first, Int const &val, float c) {
+  if (c == 0.0f) return;
+  int ic = (int) c;
+  assertq((float) ic == c, "Stencil: coefficients for Int stencils must be integral");
+
+  if (first) {
+    if (ic == 1) {
+      acc = val;
+    } else {
+      acc = ic*val;
+    }
+    first = false;
+  } else if (ic == 1) {
+    acc += val;
+  } else if (ic == -1) {
+    acc -= val;
+  } else {
+    acc += ic*val;
+  }
+}
+
+
+/**
+ * Get the values at horizontal offset `dx` of the current position.
+ *
+ * Values which fall outside the middle vector are taken from the left or right vector.
+ */
+template<typename T>
+void shifted(T &dst, Row<T> const &row, int dx) {
+  if (dx == 0) {
+    dst = row.mid;
+  } else if (dx > 0) {
+    dst = rotate(row.mid, 16 - dx);
+    T tmp = rotate(row.right, 16 - dx);
+    Where (index() >= 16 - dx)
+      dst = tmp;
+    End
+  } else {
+    dst = rotate(row.mid, -dx);
+    T tmp = rotate(row.left, -dx);
+    Where (index() < -dx)
+      dst = tmp;
+    End
+  }
+}
+
+
+/**
+ * Set all vector elements of `dst` to element `lane` of `src`
+ */
+template<typename T>
+void broadcast(T &dst, T const &src, int lane) {
+  T tmp = 0;
+  Where (index() == lane)
+    tmp = src;
+  End
+
+  rotate_sum(tmp, dst);
+}
+
+
+/**
+ * Generates the code for applying a stencil to vertical strips of 16 columns.
+ *
+ * A strip is traversed from top to bottom. The input rows covered by the mask are retained
+ * in registers; per output row, one new input row is received, while the next one is prefetched.
+ *
+ * For separable masks, only the horizontally filtered rows are retained. This reduces
+ * the work per output vector from `size*size` to `2*size` terms.
+ */
+template<typename T>
+class Generator {
+  using Ptr = typename T::Ptr;
+
+public:
+  Generator(StencilSettings<T> const &settings, Ptr const &src, Int const &height, Int const &width) :
+    m_settings(settings),
+    m_mask(settings.mask),
+    m_src(src),
+    m_height(height),
+    m_width(width)
+  {
+    int size = m_mask.size();
+
+    if (m_mask.separable()) {
+      m_filtered.resize(size);
+      if (m_settings.post) m_center.resize(size);
+    } else {
+      m_rows.resize(size);
+    }
+  }
+
+
+  void strip(Ptr const &dst, Int const &x0) {
+    int const radius = m_mask.radius();
+
+    init_offsets(x0);
+    clear_window();
+
+    Int ry = -radius;
+    fetch(ry);
+
+    While (ry < radius)
+      advance(ry);
+      ry++;
+    End
+
+    Ptr dst_ptr = dst + x0;
+
+    For (Int y = 0, y < m_height, y++)
+      ry = y + radius;
+      advance(ry);
+
+      T out;
+      compute(out);
+      if (m_settings.post) {
+        m_settings.post(out, center());
+      }
+
+      *dst_ptr = out;
+      dst_ptr += m_width;
+    End
+
+    // Discard the last prefetch
+    Row<T> dummy;
+    receive(dummy.left);
+    receive(dummy.mid);
+    receive(dummy.right);
+  }
+
+private:
+  StencilSettings<T> const &m_settings;
+  StencilMask const &m_mask;
+  Ptr const &m_src;
+  Int const &m_height;
+  Int const &m_width;
+
+  Int m_x0;
+  Int m_left_offset;
+  Int m_right_offset;
+  Int m_at_left;
+  Int m_at_right;
+
+  std::vector<Row<T>> m_rows;    // Full mask: input rows
+  std::vector<T> m_filtered;     // Separable mask: horizontally filtered rows
+  std::vector<T> m_center;       // Separable mask: input rows, only if there is a post step
+
+
+  /**
+   * Determine the column offsets of the vectors left and right of the strip.
+   *
+   * For the edge strips, these point to a valid location within the row;
+   * the values read are replaced if the boundary policy requires it.
+   */
+  void init_offsets(Int const &x0) {
+    m_x0 = x0;
+    m_left_offset  = x0 - 16;
+    m_right_offset = x0 + 16;
+    m_at_left  = 0;
+    m_at_right = 0;
+
+    If (x0 == 0)
+      m_at_left = 1;
+      if (m_settings.boundary == Boundary::TORUS) {
+        m_left_offset = m_width - 16;
+      } else {
+        m_left_offset = x0;
+      }
+    End
+
+    If (x0 + 16 == m_width)
+      m_at_right = 1;
+      if (m_settings.boundary == Boundary::TORUS) {
+        m_right_offset = 0;
+      } else {
+        m_right_offset = x0;
+      }
+    End
+  }
+
+
+  /**
+   * Initialize the window values.
+   *
+   * The values are overwritten before use; this is to prevent the liveness
+   * analysis from seeing variables used before assignment.
+   */
+  void clear_window() {
+    for (auto &row : m_rows) {
+      row.left  = 0;
+      row.mid   = 0;
+      row.right = 0;
+    }
+
+    for (auto &val : m_filtered) val = 0;
+    for (auto &val : m_center)   val = 0;
+  }
+
+
+  /**
+   * Issue the loads for the vectors of input row `ry`.
+   *
+   * The row index is adjusted to lie within the grid. For torus, the radius must be
+   * smaller than the height.
+   */
+  void fetch(IntExpr ry) {
+    Int r = ry;
+
+    if (m_settings.boundary == Boundary::TORUS) {
+      Where (r < 0)         r += m_height; End
+      Where (r >= m_height) r -= m_height; End
+    } else {
+      Where (r < 0)         r = 0;              End
+      Where (r >= m_height) r = m_height - 1;   End
+    }
+
+    Int offset = r*m_width;
+    gather(m_src + (offset + m_left_offset));
+    gather(m_src + (offset + m_x0));
+    gather(m_src + (offset + m_right_offset));
+  }
+
+
+  /**
+   * Receive the vectors of input row `ry`, and apply the boundary policy.
+   */
+  void receive_row(Row<T> &row, Int const &ry) {
+    receive(row.left);
+    receive(row.mid);
+    receive(row.right);
+
+    switch (m_settings.boundary) {
+      case Boundary::ZERO:
+        If (ry < 0 || ry >= m_height)
+          row.left  = 0;
+          row.mid   = 0;
+          row.right = 0;
+        End
+
+        If (m_at_left == 1)  row.left  = 0; End
+        If (m_at_right == 1) row.right = 0; End
+        break;
+
+      case Boundary::CLAMP:
+        If (m_at_left == 1)  broadcast(row.left,  row.mid,  0); End
+        If (m_at_right == 1) broadcast(row.right, row.mid, 15); End
+        break;
+
+      case Boundary::TORUS:
+        break;
+    }
+  }
+
+
+  /**
+   * Slide the window down by one row, with new input row `ry`
+   */
+  void advance(Int const &ry) {
+    int const last = m_mask.size() - 1;
+
+    Row<T> row;
+    receive_row(row, ry);
+    fetch(ry + 1);
+
+    if (m_mask.separable()) {
+      for (int i = 0; i < last; ++i) m_filtered[i] = m_filtered[i + 1];
+      filter_row(m_filtered[last], row);
+
+      if (m_settings.post) {
+        for (int i = 0; i < last; ++i) m_center[i] = m_center[i + 1];
+        m_center[last] = row.mid;
+      }
+    } else {
+      for (int i = 0; i < last; ++i) m_rows[i] = m_rows[i + 1];
+      m_rows[last] = row;
+    }
+  }
+
+
+  /**
+   * Apply the row vector of a separable mask
+   */
+  void filter_row(T &dst, Row<T> const &row) {
+    int const radius = m_mask.radius();
+    bool first = true;
+
+    for (int dx = -radius; dx <= radius; ++dx) {
+      if (m_mask.row(dx) == 0.0f) continue;
+      T val;
+      shifted(val, row, dx);
+      add_term(dst, first, val, m_mask.row(dx));
+    }
+
+    if (first) dst = 0;
+  }
+
+
+  void compute(T &out) {
+    int const radius = m_mask.radius();
+    bool first = true;
+
+    for (int dy = -radius; dy <= radius; ++dy) {
+      if (m_mask.separable()) {
+        add_term(out, first, m_filtered[dy + radius], m_mask.column(dy));
+        continue;
+      }
+
+      for (int dx = -radius; dx <= radius; ++dx) {
+        if (m_mask.at(dy, dx) == 0.0f) continue;
+        T val;
+        shifted(val, m_rows[dy + radius], dx);
+        add_term(out, first, val, m_mask.at(dy, dx));
+      }
+    }
+
+    if (first) out = 0;
+  }
+
+
+  T const &center() const {
+    int const radius = m_mask.radius();
+
+    if (m_mask.separable()) {
+      return m_center[radius];
+    } else {
+      return m_rows[radius].mid;
+    }
+  }
+};
+
+}  // anon namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Class StencilMask
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Create a full mask.
+ *
+ * @param coefficients  row-major values, `(2*radius + 1)^2` in total
+ */
+StencilMask::StencilMask(int radius, std::vector<float> const &coefficients) :
+  m_radius(radius),
+  m_coefficients(coefficients)
+{
+  assertq(0 <= radius && radius <= MAX_RADIUS_FULL, "StencilMask: radius of a full mask must be in range 0..6");
+  assertq((int) coefficients.size() == size()*size(), "StencilMask: expecting (2*radius + 1)^2 coefficients");
+}
+
+
+/**
+ * Create a separable mask.
+ *
+ * The coefficient at (dy, dx) is `column[dy]*row[dx]`.
+ */
+StencilMask::StencilMask(std::vector<float> const &row, std::vector<float> const &column) :
+  m_radius((int) row.size()/2),
+  m_separable(true),
+  m_row(row),
+  m_column(column)
+{
+  assertq(row.size() % 2 == 1, "StencilMask: number of coefficients must be odd");
+  assertq(row.size() == column.size(), "StencilMask: row and column must have the same size");
+  assertq(m_radius <= MAX_RADIUS_SEPARABLE, "StencilMask: radius of a separable mask must be in range 0..10");
+}
+
+
+/**
+ * @param dy  vertical offset, in range -radius..radius
+ * @param dx  horizontal offset, in range -radius..radius
+ */
+float StencilMask::at(int dy, int dx) const {
+  if (m_separable) return column(dy)*row(dx);
+
+  assert(-m_radius <= dy && dy <= m_radius);
+  assert(-m_radius <= dx && dx <= m_radius);
+  return m_coefficients[(dy + m_radius)*size() + (dx + m_radius)];
+}
+
+
+float StencilMask::row(int dx) const {
+  assert(m_separable);
+  assert(-m_radius <= dx && dx <= m_radius);
+  return m_row[dx + m_radius];
+}
+
+
+float StencilMask::column(int dy) const {
+  assert(m_separable);
+  assert(-m_radius <= dy && dy <= m_radius);
+  return m_column[dy + m_radius];
+}
+
+
+std::string StencilMask::dump() const {
+  using ::operator<<;  // C++ weirdness
+
+  std::string ret;
+  ret << "Stencil mask, radius " << m_radius << (m_separable?", separable":"") << ":\n";
+
+  for (int dy = -m_radius; dy <= m_radius; ++dy) {
+    ret << "  ";
+    for (int dx = -m_radius; dx <= m_radius; ++dx) {
+      ret << at(dy, dx) << " ";
+    }
+    ret << "\n";
+  }
+
+  return ret;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernel
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+StencilSettings<T> &stencil_settings() {
+  static StencilSettings<T> settings;
+  return settings;
+}
+
+
+/**
+ * The grid is divided into vertical strips of 16 columns, which are distributed over the QPUs.
+ */
+template<typename T>
+void stencil_kernel(typename T::Ptr dst, typename T::Ptr src, Int height, Int width) {
+  Generator<T> gen(stencil_settings<T>(), src, height, width);
+
+  For (Int x0 = 16*me(), x0 < width, x0 += 16*numQPUs())
+    gen.strip(dst, x0);
+  End
+}
+
+
+template StencilSettings<Int>   &stencil_settings<Int>();
+template StencilSettings<Float> &stencil_settings<Float>();
+template void stencil_kernel<Int>(Int::Ptr dst, Int::Ptr src, Int height, Int width);
+template void stencil_kernel<Float>(Float::Ptr dst, Float::Ptr src, Int height, Int width);
+
+}  // namespace kernels
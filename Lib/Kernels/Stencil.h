@@ -0,0 +1,112 @@
+#ifndef _V3DLIB_KERNELS_STENCIL_H_
+#define _V3DLIB_KERNELS_STENCIL_H_
+#include <functional>
+#include <string>
+#include <vector>
+#include "../Source/Int.h"
+#include "../Source/Float.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Generic 2D stencil kernels
+////////////////////////////////////////////////////////////////////////////////
+
+namespace kernels {
+
+using namespace V3DLib;
+
+/**
+ * Coefficients of a 2D stencil.
+ *
+ * The mask is square with sides `2*radius + 1`, centered on the output value.
+ * It is either full, with an explicit coefficient per position, or separable,
+ * i.e. the outer product of a column and a row vector.
+ *
+ * The mask is applied at compile time; coefficients which are zero generate no code.
+ *
+ * The input rows covered by the mask are kept in registers. This limits the radius;
+ * larger masks need more registers than are available, and would fail to compile.
+ */
+class StencilMask {
+public:
+  static int const MAX_RADIUS_FULL      = 6;
+  static int const MAX_RADIUS_SEPARABLE = 10;
+
+  StencilMask(int radius, std::vector<float> const &coefficients);
+  StencilMask(std::vector<float> const &row, std::vector<float> const &column);
+
+  int radius() const { return m_radius; }
+  int size() const { return 2*m_radius + 1; }
+  bool separable() const { return m_separable; }
+  float at(int dy, int dx) const;
+  float row(int dx) const;
+  float column(int dy) const;
+  std::string dump() const;
+
+private:
+  int  m_radius    = 0;
+  bool m_separable = false;
+  std::vector<float> m_coefficients;   // Full: size()*size() values, row-major
+  std::vector<float> m_row;            // Separable only
+  std::vector<float> m_column;         // idem
+};
+
+
+/**
+ * Handling of values outside of the grid
+ */
+enum class Boundary {
+  ZERO,    // Values outside the grid are zero
+  CLAMP,   // Use the nearest value at the edge of the grid
+  TORUS    // Wrap around at the edges
+};
+
+
+/**
+ * Settings for the stencil kernel of type T.
+ *
+ * `post` is an optional step on the result, e.g. for applying the rules of a cellular automaton.
+ * It receives the stencil sum and the input value at the output position.
+ */
+template<typename T>
+struct StencilSettings {
+  using Post = std::function<void(T &result, T const &center)>;
+
+  StencilMask mask = StencilMask(0, {1.0f});
+  Boundary    boundary = Boundary::ZERO;
+  Post        post;
+};
+
+template<typename T>
+StencilSettings<T> &stencil_settings();
+
+
+/**
+ * Apply the stencil in `stencil_settings<T>()` to a grid of `height` rows of `width` values.
+ *
+ * `T` is either `Int` or `Float`.
+ * `width` must be a multiple of 16. `src` and `dst` must not overlap.
+ */
+template<typename T>
+void stencil_kernel(typename T::Ptr dst, typename T::Ptr src, Int height, Int width);
+
+
+/**
+ * Set the stencil settings and return the kernel for compilation.
+ */
+template<typename T>
+auto stencil_decorator(
+  StencilMask const &mask,
+  Boundary boundary,
+  typename StencilSettings<T>::Post post = nullptr
+) -> decltype(&stencil_kernel<T>) {
+  auto &settings = stencil_settings<T>();
+  settings.mask     = mask;
+  settings.boundary = boundary;
+  settings.post     = post;
+
+  return stencil_kernel<T>;
+}
+
+}  // namespace kernels
+
+#endif  // _V3DLIB_KERNELS_STENCIL_H_
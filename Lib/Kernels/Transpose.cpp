@@ -0,0 +1,152 @@
+#include "Transpose.h"
+#include "Source/Lang.h"
+#include "Support/basics.h"
+#include "KernelCache.h"
+
+namespace kernels {
+
+namespace {
+
+KernelCache &transpose_cache() {
+  static KernelCache cache;
+  return cache;
+}
+
+
+template<typename T, typename Type>
+void transpose_call(char const *id, Shared2DArray<Type> &dst, Shared2DArray<Type> &src, int numQPUs) {
+  assertq(src.rows() % 16 == 0 && src.columns() % 16 == 0,
+    "transpose(): dimensions of source array must be multiples of 16");
+  assertq(src.is_contiguous(), "transpose(): source array can not be a strided view");
+
+  if (!dst.allocated()) {
+    dst.alloc(src.columns(), src.rows());
+  }
+
+  assertq(dst.rows() == src.columns() && dst.columns() == src.rows(),
+    "transpose(): dimensions of destination must be those of the transposed source");
+  assertq(dst.is_contiguous(), "transpose(): destination array can not be a strided view");
+
+  auto &k = transpose_cache().get({id, {}, numQPUs}, transpose_kernel<T>);
+  k.load(&dst, &src, src.rows(), src.columns()).call();
+}
+
+}  // anon namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernel code
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Transpose a 16x16 block held in 16 vectors, in place.
+ *
+ * Element `c` of vector `r` moves to element `r` of vector `c`.
+ * This is done in three steps, with only lane-local moves between the rotations:
+ *
+ * 1. Rotate vector `i` by `i` elements
+ * 2. For each lane `l`, take vector `i` from vector `i + l`
+ * 3. Rotate vector `j` (taken from vector `-j` of step 2) by `-j` elements
+ *
+ * All indexes are modulo 16.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * The cost is 30 rotations and 15 lane selections of 16 moves each.
+ *   The naive approach, combining a rotation and a selection per element, needs 256 of each.
+ *
+ * * vc4 has a VPM, which can transpose by writing horizontally and reading vertically.
+ *   This is not used here, so that the same code runs on v3d, the emulator and the interpreter.
+ */
+template<typename T>
+void transpose_block(std::vector<T> &block) {
+  assert(block.size() == 16);
+
+  for (int i = 1; i < 16; ++i) {
+    block[i] = rotate(block[i], i);
+  }
+
+  std::vector<T> tmp(16);
+
+  for (int i = 0; i < 16; ++i) {
+    tmp[i] = block[i];
+  }
+
+  for (int l = 1; l < 16; ++l) {
+    Where (index() == l)
+      for (int i = 0; i < 16; ++i) {
+        tmp[i] = block[(i + l) % 16];
+      }
+    End
+  }
+
+  block[0] = tmp[0];
+  for (int j = 1; j < 16; ++j) {
+    block[j] = rotate(tmp[16 - j], 16 - j);
+  }
+}
+
+
+/**
+ * The tiles are taken in row order, every QPU taking each `numQPUs()`'th tile.
+ * The tile position is updated by stepping, to avoid an integer division.
+ */
+template<typename T>
+void transpose_kernel(typename T::Ptr dst, typename T::Ptr src, Int rows, Int columns) {
+  Int tile_row = 0;
+  Int tile_col = 16*me();
+  Int step     = 16*numQPUs();
+
+  While (any(tile_col >= columns))
+    tile_col -= columns;
+    tile_row += 16;
+  End
+
+  std::vector<T> block(16);
+
+  While (any(tile_row < rows))
+    typename T::Ptr p = src + tile_row*columns + tile_col;
+    for (int i = 0; i < 16; ++i) {
+      block[i] = *p;
+      p += columns;
+    }
+
+    transpose_block(block);
+
+    typename T::Ptr q = dst + tile_col*rows + tile_row;
+    for (int j = 0; j < 16; ++j) {
+      *q = block[j];
+      q += rows;
+    }
+
+    tile_col += step;
+    While (any(tile_col >= columns))
+      tile_col -= columns;
+      tile_row += 16;
+    End
+  End
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Host-side calls
+///////////////////////////////////////////////////////////////////////////////
+
+void transpose(Int::Array2D &dst, Int::Array2D &src, int numQPUs) {
+  transpose_call<Int>("transpose_int", dst, src, numQPUs);
+}
+
+
+void transpose(Float::Array2D &dst, Float::Array2D &src, int numQPUs) {
+  transpose_call<Float>("transpose_float", dst, src, numQPUs);
+}
+
+
+template void transpose_block<Int>(std::vector<Int> &);
+template void transpose_block<Float>(std::vector<Float> &);
+template void transpose_kernel<Int>(Int::Ptr, Int::Ptr, Int, Int);
+template void transpose_kernel<Float>(Float::Ptr, Float::Ptr, Int, Int);
+
+}  // namespace kernels
@@ -0,0 +1,47 @@
+#ifndef _V3DLIB_KERNELS_TRANSPOSE_H_
+#define _V3DLIB_KERNELS_TRANSPOSE_H_
+#include <vector>
+#include "../Source/Int.h"
+#include "../Source/Float.h"
+#include "../Common/SharedArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Matrix transposition on the QPUs
+////////////////////////////////////////////////////////////////////////////////
+
+namespace kernels {
+
+using namespace V3DLib;
+
+//
+// Kernel code.
+//
+// `T` is either `Int` or `Float`.
+//
+
+template<typename T>
+void transpose_block(std::vector<T> &block);
+
+/**
+ * Transpose the `rows` x `columns` matrix `src` into `dst`.
+ *
+ * Both dimensions must be multiples of 16. The matrix is handled in tiles of 16x16,
+ * which are distributed over the QPUs.
+ */
+template<typename T>
+void transpose_kernel(typename T::Ptr dst, typename T::Ptr src, Int rows, Int columns);
+
+
+//
+// Host-side calls.
+//
+// These compile the kernel on first use and retain it for subsequent calls.
+// If `dst` is not allocated, it is allocated with the transposed dimensions of `src`.
+//
+
+void transpose(Int::Array2D &dst, Int::Array2D &src, int numQPUs = 1);
+void transpose(Float::Array2D &dst, Float::Array2D &src, int numQPUs = 1);
+
+}  // namespace kernels
+
+#endif  // _V3DLIB_KERNELS_TRANSPOSE_H_
@@ -11,6 +11,8 @@ struct SettingsInternal {
   int  qpu_timeout = -1;                  // seconds, time to wait for response from QPU
   bool use_tmu_for_load = true;           // vc4 only, ignored for v3d. If false, use DMA
   bool use_high_precision_sincos = false; // If true, add extra precision to sin/cos calculation for function version
+  int  emulator_sfu_precision = 0;        // Number of mantissa bits of SFU results in emulator, 0 for full precision
+  std::string cpu_compiler = "c++ -O2";   // Compiler command for the CPU backend
 } settings;
 
 }  // anon namespace
@@ -65,4 +67,45 @@ void LibSettings::use_tmu_for_load(bool val) { settings.use_tmu_for_load = val;
 bool LibSettings::use_high_precision_sincos()         { return settings.use_high_precision_sincos; }
 void LibSettings::use_high_precision_sincos(bool val) { settings.use_high_precision_sincos = val; }
 
+
+/**
+ * Get number of mantissa bits retained in SFU results by the emulator and interpreter.
+ *
+ * The SFU functions (recip, recipsqrt, exp, log) are exact to float precision in emulation.
+ * On the hardware, they are approximations. Setting a lower precision in emulation gives an idea
+ * of the effect of this on the result of a calculation.
+ *
+ * @return number of mantissa bits, 0 if SFU results are not truncated
+ */
+int LibSettings::emulator_sfu_precision() { return settings.emulator_sfu_precision; }
+
+
+/**
+ * Set number of mantissa bits of SFU results in emulation.
+ *
+ * @param val  number of mantissa bits in range 1..23, 0 for full float precision
+ */
+void LibSettings::emulator_sfu_precision(int val) {
+  assert(0 <= val && val <= 23);
+  settings.emulator_sfu_precision = val;
+}
+
+
+/**
+ * Get the compiler command used to compile kernels for the CPU backend
+ */
+std::string const &LibSettings::cpu_compiler() { return settings.cpu_compiler; }
+
+
+/**
+ * Set the compiler command for the CPU backend.
+ *
+ * This is the compiler with optimization flags, e.g. "g++ -O3 -march=native".
+ * The flags needed for building a shared library are added by the backend.
+ */
+void LibSettings::cpu_compiler(std::string const &val) {
+  assert(!val.empty());
+  settings.cpu_compiler = val;
+}
+
 }  // namespace V3DLib
@@ -1,5 +1,6 @@
 #ifndef _V3DLIB_LIBSETTINGS_H_
 #define _V3DLIB_LIBSETTINGS_H_
+#include <string>
 
 namespace V3DLib {
 
@@ -19,6 +20,12 @@ public:
 
   static bool use_high_precision_sincos();
   static void use_high_precision_sincos(bool val);
+
+  static int  emulator_sfu_precision();
+  static void emulator_sfu_precision(int val);
+
+  static std::string const &cpu_compiler();
+  static void cpu_compiler(std::string const &val);
 };
 
 }  // namespace V3DLib
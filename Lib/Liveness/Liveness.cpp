@@ -11,6 +11,7 @@
 #include "Optimizations.h"
 #include "Support/Timer.h"
 #include "UseDef.h"
+#include "Source/Var.h"
 
 namespace V3DLib {
 namespace {
@@ -87,40 +88,6 @@ void allocate_registers(Instr &instr, RegUsage const &alloc) {
 }
 
 
-/**
- * Removes all SKIP instructions from the list
- *
- * Creating a new list is MUCH faster than inline removal using Instr::remove().
- * i.e.  Remove 1857 SKIPs from kernel final size 140828
- *        - remove() -> 28.557023s
- *        - new list -> 0.170661s
- */
-Instr::List  remove_replaced_instructions(Instr::List &instrs) {
-  Instr::List ret;
-
-  int cur   = 0;
-  int count = 0;
-
-  while (cur < instrs.size()) {
-    if (instrs[cur].tag == InstrTag::SKIP) {
-      count++;
-    } else {
-      ret << instrs[cur];
-    }
-    cur++;
-  }
-
-/*
-  if (count > 0) {
-    std::string msg;
-    msg << "remove_replaced_instructions() removed " << count << " SKIPs";
-    debug(msg);
-  }
-*/
-
-  return ret;
-}
-
 }  // anon namespace
 
 
@@ -185,7 +152,8 @@ void Liveness::compute_liveness(Instr::List &instrs) {
             AssignCond assign_cond = instr.assign_cond();
             for (int j = item.first_usage(); j <= item.last_usage(); j++) {
               assertq((assign_cond == instrs[j].assign_cond())            // expected usage
-                   || (instrs[j].is_always() && !instrs[j].is_branch()),  // Interim basic usage allowed (happens)
+                   || (instrs[j].is_always() && !instrs[j].is_branch())   // Interim basic usage allowed (happens)
+                   || (instrs[j].call_mark() == Instr::CALL_SITE),        // Function call within where-block
                 "Expected variable to be in condition assign block only", true
               );
             }
@@ -237,6 +205,7 @@ void Liveness::clear() {
   m_cfg.clear();
   m_set.clear();
   m_reg_usage.reset();
+  m_dirty.clear();
 }
 
 
@@ -245,6 +214,8 @@ void Liveness::compute(Instr::List &instrs) {
 
   m_cfg.build(instrs);
   m_reg_usage.set_used(instrs);
+  find_calls(instrs);
+  build_preds();
 
   //Timer t3("compute liveness", false);
   compute_liveness(instrs); // performance hog 23/28s
@@ -252,11 +223,130 @@ void Liveness::compute(Instr::List &instrs) {
   assert(instrs.size() == size());
 
   m_reg_usage.set_live(*this);
+  RegIdSet return_vars = mark_call_vars(instrs);
 
   compile_data.reg_usage_dump = m_reg_usage.dump(true);
   compile_data.liveness_dump = dump();
 
-  m_reg_usage.check();
+  m_reg_usage.check(return_vars);
+}
+
+
+/**
+ * Detect the out-of-line function calls and the variables used in the function bodies.
+ *
+ * A function body ranges from its entry label up to the last return branch.
+ */
+void Liveness::find_calls(Instr::List const &instrs) {
+  m_call_sites.clear();
+  m_function_vars.clear();
+
+  std::map<Label, InstrId> labels;
+  std::map<Label, int> functions;  // Key is entry label, value index in m_function_vars
+
+  for (int i = 0; i < (int) instrs.size(); i++) {
+    auto const &instr = instrs[i];
+    if (!instr.is_label()) continue;
+
+    labels[instr.label()] = i;
+
+    if (instr.call_mark() == Instr::CALL_ENTRY) {
+      functions[instr.call_entry()] = (int) m_function_vars.size();
+      m_function_vars.push_back(RegIdSet());
+    }
+  }
+
+  if (functions.empty()) return;  // No calls, nothing to do
+
+  for (int i = 0; i < (int) instrs.size(); i++) {
+    auto const &instr = instrs[i];
+
+    if (instr.call_mark() == Instr::CALL_SITE) {
+      assert(labels.find(instr.call_entry()) != labels.end());
+      assert(labels.find(instr.call_return()) != labels.end());
+      m_call_sites[i] = { labels[instr.call_entry()], labels[instr.call_return()], functions[instr.call_entry()] };
+    }
+  }
+
+  // Collect variables per function body
+  for (auto const &f : functions) {
+    int first = labels[f.first];
+    int last  = first;
+
+    for (int i = first; i < (int) instrs.size(); i++) {
+      auto const &instr = instrs[i];
+      if (instr.call_mark() == Instr::CALL_RETURN && instr.call_entry() == f.first) {
+        last = i;
+      }
+    }
+
+    auto &vars = m_function_vars[f.second];
+
+    for (int i = first; i <= last; i++) {
+      UseDef useDef(instrs[i]);
+      if (useDef.def.tag != NONE) vars.insert(useDef.def.regId);
+      vars.add(useDef.use);
+    }
+  }
+}
+
+
+/**
+ * Determine the predecessors of each instruction, for use in `update()`.
+ *
+ * The CFG edges of the call sites are left out, these are handled separately
+ * in the same way as `computeLiveOut()` does.
+ */
+void Liveness::build_preds() {
+  m_preds.assign(m_cfg.size(), std::vector<InstrId>());
+  m_callers.clear();
+
+  for (int i = 0; i < (int) m_cfg.size(); i++) {
+    auto it = m_call_sites.find(i);
+
+    if (it != m_call_sites.end()) {
+      m_callers[it->second.entry].push_back(i);
+      m_callers[it->second.ret].push_back(i);
+      continue;
+    }
+
+    for (auto succ : m_cfg[i]) {
+      m_preds[succ].push_back(i);
+    }
+  }
+}
+
+
+/**
+ * Mark the variables which are live at a function call, entry or return.
+ *
+ * These must stay in the register file, because the linear usage ranges used
+ * by the accumulator optimizations do not apply to them.
+ *
+ * @return the variables assigned in a function body which are live after a call
+ */
+RegIdSet Liveness::mark_call_vars(Instr::List const &instrs) {
+  RegIdSet ret;
+  if (m_call_sites.empty()) return ret;
+
+  for (int i = 0; i < (int) instrs.size(); i++) {
+    if (!instrs[i].is_call_mark()) continue;
+
+    for (auto var : get(i)) {
+      m_reg_usage[var].set_crosses_call();
+    }
+  }
+
+  for (auto const &it : m_call_sites) {
+    auto const &site = it.second;
+    auto const &vars = m_function_vars[site.function];
+
+    for (auto var : get(site.ret)) {
+      if (vars.member(var)) ret.insert(var);
+    }
+  }
+
+  return ret;
 }
 
 
@@ -269,12 +359,304 @@ void Liveness::compute(Instr::List &instrs) {
 void Liveness::computeLiveOut(InstrId i, RegIdSet &liveOut) {
   liveOut.clear();
 
+  if (!m_call_sites.empty()) {
+    auto it = m_call_sites.find(i);
+
+    if (it != m_call_sites.end()) {
+      auto const &site = it->second;
+      auto const &vars = m_function_vars[site.function];
+
+      for (auto var : get(site.entry)) {
+        if (vars.member(var)) liveOut.insert(var);
+      }
+
+      for (auto var : get(site.ret)) {
+        if (!vars.member(var)) liveOut.insert(var);
+      }
+
+      return;
+    }
+  }
+
   for (auto const &val : m_cfg[i]) {
     liveOut.add(get(val));
   }
 }
 
 
+/**
+ * Mark all variables in the given instruction as changed.
+ *
+ * Call this *before* changing the instruction, so that the previous variables are included,
+ * and again afterwards if variables were added to it.
+ */
+void Liveness::invalidate(Instr const &instr) {
+  if (!instr.has_registers()) return;
+
+  UseDef useDef(instr);
+  if (useDef.def.tag != NONE) m_dirty.insert(useDef.def.regId);
+  m_dirty.add(useDef.use);
+}
+
+
+/**
+ * Create a new variable, for use in instructions added by an optimization.
+ *
+ * The variable is marked as changed, so that `update()` or `insert()` picks it up.
+ */
+Reg Liveness::add_var() {
+  Var var = VarGen::fresh();
+  RegId id = m_reg_usage.add();
+  assertq(var.id() == id, "Liveness::add_var(): number of variables differs from the variable generator", true);
+
+  m_dirty.insert(id);
+  return Reg(REG_A, id);
+}
+
+
+/**
+ * Recompute the liveness of the variables passed to `invalidate()`.
+ *
+ * The instructions may have changed since the liveness was computed, but the number of instructions
+ * and the control flow must be the same. Removed instructions should be replaced with SKIP.
+ *
+ * The result is the same as for a full `compute()`, but the work done is proportional to
+ * the usage of the changed variables, not to the number of all variables times the number
+ * of iterations to reach the fixed point.
+ */
+void Liveness::update(Instr::List &instrs) {
+  if (m_dirty.empty()) return;
+  assertq(instrs.size() == size(), "Liveness::update(): number of instructions changed", true);
+
+  // Remove the previous liveness of the changed variables
+  for (auto var : m_dirty) {
+    auto const &item = m_reg_usage[var];
+
+    if (item.first_live() != -1) {
+      for (int i = item.first_live(); i <= item.last_live(); i++) {
+        m_set[i].remove(var);
+      }
+    }
+
+    m_reg_usage.reset(var);
+  }
+
+  // Redo the usage of the changed variables and collect the instructions where they are live-in.
+  // A conditional assignment after the first assignment counts as a use, see `compute_liveness()`.
+  std::map<RegId, std::vector<InstrId>> uses;
+  RegIdSet assigned;
+
+  for (int i = 0; i < instrs.size(); i++) {
+    auto const &instr = instrs[i];
+    if (!instr.has_registers()) continue;
+
+    UseDef useDef(instr);
+
+    for (auto var : useDef.use) {
+      if (!m_dirty.member(var)) continue;
+
+      m_reg_usage[var].add_src(i);
+      uses[var].push_back(i);
+    }
+
+    if (useDef.def.tag == NONE) continue;
+    RegId def = useDef.def.regId;
+    if (!m_dirty.member(def)) continue;
+
+    if (instr.isCondAssign() && assigned.member(def) && !useDef.use.member(def)) {
+      uses[def].push_back(i);
+    }
+
+    m_reg_usage[def].add_dst(i, instr.isCondAssign());
+    assigned.insert(def);
+  }
+
+  find_calls(instrs);  // The variables used in the function bodies may have changed
+
+  for (auto &it : uses) {
+    update_var(instrs, it.first, it.second);
+  }
+
+  mark_call_vars(instrs);
+  m_dirty.clear();
+
+#ifdef DEBUG
+  {
+    Liveness check((int) m_reg_usage.size());
+    check.compute(instrs);
+    assertq(check.m_set == m_set, "Liveness::update(): result differs from full liveness analysis", true);
+  }
+#endif  // DEBUG
+}
+
+
+/**
+ * Propagate the liveness of a single variable backwards, starting from the instructions using it.
+ *
+ * @param work  instructions where var is live-in; used as work list
+ */
+void Liveness::update_var(Instr::List const &instrs, RegId var, std::vector<InstrId> &work) {
+  auto &item = m_reg_usage[var];
+
+  auto set_live = [this, var, &item, &work] (InstrId i, bool add_work) {
+    if (m_set[i].member(var)) return;
+
+    m_set[i].insert(var);
+    item.add_live(i);
+    if (add_work) work.push_back(i);
+  };
+
+  // All uses have var live-in, without propagation beyond the current list
+  int num_uses = (int) work.size();
+  for (int i = 0; i < num_uses; i++) {
+    set_live(work[i], false);
+  }
+
+  // Var is live-in at a predecessor, unless the predecessor assigns it
+  auto visit = [this, var, &instrs, &set_live] (InstrId p) {
+    if (m_set[p].member(var)) return;
+
+    Reg dst = instrs[p].dst_a_reg();
+    if (dst.tag != NONE && dst.regId == var) return;
+
+    set_live(p, true);
+  };
+
+  while (!work.empty()) {
+    InstrId i = work.back();
+    work.pop_back();
+
+    for (auto p : m_preds[i]) {
+      visit(p);
+    }
+
+    if (m_callers.empty()) continue;
+
+    auto it = m_callers.find(i);
+    if (it == m_callers.end()) continue;
+
+    for (auto site_index : it->second) {
+      auto const &site = m_call_sites[site_index];
+      bool in_function = m_function_vars[site.function].member(var);
+
+      if (( in_function && i == site.entry) || (!in_function && i == site.ret)) {
+        visit(site_index);
+      }
+    }
+  }
+}
+
+
+/**
+ * Remove the SKIP instructions from the list, keeping the liveness in sync.
+ *
+ * A variable live-in at a SKIP is also live-in at the next instruction,
+ * so the live sets of the remaining instructions stay the same.
+ *
+ * Creating a new list is MUCH faster than inline removal using Instr::remove().
+ * i.e.  Remove 1857 SKIPs from kernel final size 140828
+ *        - remove() -> 28.557023s
+ *        - new list -> 0.170661s
+ */
+void Liveness::remove_skips(Instr::List &instrs) {
+  assertq(m_dirty.empty(), "Liveness::remove_skips(): call update() first", true);
+  assert(instrs.size() == size());
+  if (count_skips(instrs) == 0) return;
+
+  Instr::List ret;
+  std::vector<RegIdSet> sets;
+  std::vector<InstrId> new_index(instrs.size());
+
+  for (int i = 0; i < instrs.size(); i++) {
+    new_index[i] = (int) ret.size();
+
+    if (instrs[i].tag == InstrTag::SKIP) {
+      for (auto var : m_set[i]) {
+        m_reg_usage[var].remove_live();
+      }
+    } else {
+      ret << instrs[i];
+      sets.push_back(std::move(m_set[i]));
+    }
+  }
+
+  instrs = ret;
+  m_set = std::move(sets);
+  m_reg_usage.remap(new_index);
+  rebuild_cfg(instrs);
+}
+
+
+/**
+ * Insert instructions before the given positions, keeping the liveness in sync.
+ *
+ * An inserted instruction gets the live set of the instruction it is inserted before,
+ * without the invalidated variables. Hence, all variables in the inserted instructions
+ * must be passed to `invalidate()` beforehand. Call `update()` afterwards.
+ *
+ * @param inserts  instructions to insert, key is the index of the instruction to insert before
+ */
+void Liveness::insert(Instr::List &instrs, std::map<InstrId, Instr::List> const &inserts) {
+  if (inserts.empty()) return;
+  assert(instrs.size() == size());
+
+  Instr::List ret;
+  std::vector<RegIdSet> sets;
+  std::vector<InstrId> new_index(instrs.size());
+  std::vector<InstrId> added;
+
+  for (int i = 0; i < instrs.size(); i++) {
+    auto it = inserts.find(i);
+
+    if (it != inserts.end()) {
+      RegIdSet live_in = m_set[i];
+      live_in.remove(m_dirty);
+
+      for (int j = 0; j < it->second.size(); j++) {
+        auto const &instr = it->second[j];
+
+#ifdef DEBUG
+        UseDef useDef(instr);
+        assert(useDef.def.tag == NONE || m_dirty.member(useDef.def.regId));
+        for (auto var : useDef.use) assert(m_dirty.member(var));
+#endif  // DEBUG
+
+        added.push_back(ret.size());
+        ret << instr;
+        sets.push_back(live_in);
+      }
+    }
+
+    new_index[i] = ret.size();
+    ret << instrs[i];
+    sets.push_back(std::move(m_set[i]));
+  }
+
+  instrs = ret;
+  m_set = std::move(sets);
+  m_reg_usage.remap(new_index);
+
+  for (auto i : added) {
+    for (auto var : m_set[i]) {
+      m_reg_usage[var].add_live(i);
+    }
+  }
+
+  rebuild_cfg(instrs);
+}
+
+
+/**
+ * Redo the control flow data after instructions have been added or removed
+ */
+void Liveness::rebuild_cfg(Instr::List &instrs) {
+  m_cfg.clear();
+  m_cfg.build(instrs);
+  find_calls(instrs);
+  build_preds();
+}
+
+
 void Liveness::setSize(int size) {
   m_set.resize(size);
 }
@@ -326,42 +708,92 @@ std::string Liveness::dump() {
 /**
  * Introduce optimizations where possible in the instruction list
  *
- * This is done before the actual liveness analysis.
+ * This is done before the register allocation.
  * The idea is to minimize beforehand the number of variables considered
- * in the liveness analysis.
+ * in the register allocation.
+ *
+ * The liveness is computed once, and kept up to date by the optimizations.
+ * On return, `live` contains the liveness of the optimized instructions.
+ *
+ * Hoisting out of loops makes variables live over the entire loop. The register budget
+ * for this is an estimate, so register allocation may still fail afterwards.
+ * In that case, the register allocation redoes the optimization with `do_hoist == false`.
  */
-void Liveness::optimize(Instr::List &instrs, int numVars) {
+void Liveness::optimize(Instr::List &instrs, Liveness &live, bool do_hoist) {
   assertq(count_skips(instrs) == 0, "optimize(): SKIPs detected in instruction list");
   compile_data.target_code_before_optimization = instrs.dump();
 
-  //Timer t1("live compute");
-  Liveness live(numVars);
+  PhaseTimer t1("liveness", instrs.size());
   live.compute(instrs);
   //std::cout << live.dump() << std::endl;
-  //t1.end();
+  t1.end(instrs.size());
+
+  {
+    PhaseTimer t2("hoistImmediates", instrs.size());
+
+    compile_data.num_immediates_hoisted = do_hoist?hoistImmediates(live, instrs):0;
 
-  if (combineImmediates(live, instrs)) {
-    //std::cout << "After combineImmediates:\n"; 
-    //std::cout << instrs.dump(true) << std::endl;  // Useful sometimes for debug
+    if (compile_data.num_immediates_hoisted > 0) {
+      live.update(instrs);
+    }
+
+    t2.end(instrs.size() - count_skips(instrs));
+  }
+
+  {
+    PhaseTimer t3("combineImmediates", instrs.size() - count_skips(instrs));
+
+    if (combineImmediates(live, instrs)) {
+      //std::cout << "After combineImmediates:\n"; 
+      //std::cout << instrs.dump(true) << std::endl;  // Useful sometimes for debug
+
+      live.update(instrs);  // instructions have changed, redo liveness of changed vars
+      //std::cout << live.dump() << std::endl;
+    }
 
-    //Timer t3("combine immediates compute", true);
-    live.compute(instrs);  // instructions have changed, redo liveness
-    //std::cout << live.dump() << std::endl;
+    t3.end(instrs.size() - count_skips(instrs));
+  }
+
+  {
+    PhaseTimer t4("hoistInvariants", instrs.size() - count_skips(instrs));
+
+    compile_data.num_invariants_hoisted = do_hoist?hoistInvariants(live, instrs):0;
+
+    if (compile_data.num_invariants_hoisted > 0) {
+      live.update(instrs);
+    }
+
+    t4.end(instrs.size() - count_skips(instrs));
+  }
+
+  {
+    PhaseTimer t5("reduceInductionVars", instrs.size() - count_skips(instrs));
+
+    compile_data.num_induction_vars_reduced = reduceInductionVars(live, instrs);
+
+    if (compile_data.num_induction_vars_reduced > 0) {
+      live.update(instrs);
+    }
+
+    t5.end(instrs.size() - count_skips(instrs));
   }
 
-  //Timer t3("introduceAccum");
   int prev_count_skips = count_skips(instrs);
+  PhaseTimer t6("introduceAccum", instrs.size() - prev_count_skips);
   compile_data.num_accs_introduced = introduceAccum(live, instrs);
   assertq(prev_count_skips == count_skips(instrs), "SKIP count changed after introduceAccum()");
-	//t3.end();
-
-  // Times for following (now) insignificant
 
-  instrs = remove_replaced_instructions(instrs);
+  live.update(instrs);
+  live.remove_skips(instrs);
+  t6.end(instrs.size());
   assertq(count_skips(instrs) == 0, "optimize(): SKIPs detected in instruction list after cleanup");
 
   //std::cout << count_reg_types(instrs).dump() << std::endl;
   compile_data.target_code_before_liveness = instrs.dump();
+  compile_data.reg_usage_dump = live.m_reg_usage.dump(true);
+  compile_data.liveness_dump = live.dump();
+
+  live.m_reg_usage.check(live.mark_call_vars(instrs));
 }
 
 
@@ -4,6 +4,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 #ifndef _V3DLIB_LIVENESS_LIVENESS_H_
 #define _V3DLIB_LIVENESS_LIVENESS_H_
+#include <map>
 #include <string>
 #include <vector>
 #include "CFG.h"
@@ -31,6 +32,22 @@ namespace V3DLib {
  *
  *     That is, x is live at this point if there is a path (following gotos)
  *     from this point to a statement that use x and there is no assignment to x in any statement in the path."
+ *
+ * -------------------------
+ * NOTES
+ * =====
+ *
+ * 1. Out-of-line function calls get special handling. Following the CFG, all variables live
+ *    after any call site would be live at the function entry, and hence before all call sites.
+ *    Instead, the live-out set of a call is taken as the live variables at the function entry
+ *    which are used in the function, plus the live variables at the return point which are not.
+ *
+ * 2. The optimization passes keep the liveness up to date incrementally, instead of redoing
+ *    the full analysis after each pass. A pass calls `invalidate()` for each variable it changes,
+ *    after which `update()` recomputes the liveness of the invalidated variables only.
+ *    Instructions are not removed while doing this, they are replaced with SKIP.
+ *    `remove_skips()` removes these afterwards, shifting the liveness along.
+ *    New instructions are added with `insert()`, which also keeps the liveness in sync.
  */
 class Liveness {
 public:
@@ -45,16 +62,43 @@ public:
   void computeLiveOut(InstrId i, RegIdSet &liveOut);
   std::string dump();
 
-  static void optimize(Instr::List &instrs, int numVars);
+  void invalidate(RegId var) { m_dirty.insert(var); }
+  void invalidate(Instr const &instr);
+  Reg add_var();
+  void update(Instr::List &instrs);
+  void insert(Instr::List &instrs, std::map<InstrId, Instr::List> const &inserts);
+  void remove_skips(Instr::List &instrs);
+
+  static void optimize(Instr::List &instrs, Liveness &live, bool do_hoist = true);
 
 private:
+  /**
+   * Out-of-line function call in the instruction list
+   */
+  struct CallSite {
+    InstrId entry;     // Index of entry label of called function
+    InstrId ret;       // Index of return label
+    int     function;  // Index of function in m_function_vars
+  };
+
   CFG          m_cfg;
   std::vector<RegIdSet> m_set;
   RegUsage     m_reg_usage;
 
+  std::map<InstrId, CallSite> m_call_sites;    // Key is index of call branch
+  std::vector<RegIdSet>       m_function_vars; // Variables used in the function bodies
+  std::vector<std::vector<InstrId>> m_preds;   // Predecessors in the CFG, excluding call sites
+  std::map<InstrId, std::vector<InstrId>> m_callers;  // Call sites per entry and return label
+  RegIdSet     m_dirty;                        // Variables for which liveness needs to be recomputed
+
   RegIdSet &get(int index) { return m_set[index]; }
   void clear();
   void compute_liveness(Instr::List &instrs);
+  void find_calls(Instr::List const &instrs);
+  void build_preds();
+  void rebuild_cfg(Instr::List &instrs);
+  void update_var(Instr::List const &instrs, RegId var, std::vector<InstrId> &work);
+  RegIdSet mark_call_vars(Instr::List const &instrs);
   void setSize(int size);
   bool insert(int index, RegIdSet const &set);
 };
@@ -1,8 +1,12 @@
 #include "Optimizations.h"
 #include <iostream>
+#include <map>
 #include "Liveness.h"
+#include "UseDef.h"
 #include "Support/Platform.h"
 #include "Target/Subst.h"
+#include "Target/SmallLiteral.h"
+#include "Target/instr/Mnemonics.h"
 #include "Support/Timer.h"
 #include "Support/basics.h"
 
@@ -30,12 +34,13 @@ void replace_acc(Instr::List &instrs, RegUsageItem &item, int var_id, int acc_id
 /**
  * Not as useful as I would have hoped. range_size > 1 in practice happens, but seldom.
  */
-int peephole_0(int range_size, Instr::List &instrs, RegUsage &allocated_vars) {
+int peephole_0(int range_size, Liveness &live, Instr::List &instrs) {
   if (range_size == 0) {
     warning("peephole_0(): range_size == 0 passed in. This does nothing, not bothering");
     return 0;
   }
 
+  RegUsage &allocated_vars = live.reg_usage();
   int subst_count = 0;
 
   for (int var_id = 0; var_id < (int) allocated_vars.size(); var_id++) {
@@ -43,6 +48,7 @@ int peephole_0(int range_size, Instr::List &instrs, RegUsage &allocated_vars) {
 
     if (item.reg.tag != NONE) continue;
     if (item.unused()) continue;
+    if (item.crosses_call()) continue;  // Linear usage range does not cover the function body
     if (item.use_range() != range_size) continue;
     assert(range_size != 0 || item.only_assigned());
 
@@ -60,7 +66,13 @@ int peephole_0(int range_size, Instr::List &instrs, RegUsage &allocated_vars) {
     //
     // This is a small thing, perhaps for later optimization
     //
-    int acc_id = instrs.get_free_acc(item.first_usage(), item.last_usage());
+    // The acc must also be free past the last use if the var is live there,
+    // this happens when it is used in a loop body.
+    //
+    int last = item.last_usage();
+    if (last < item.last_live()) last = item.last_live();
+
+    int acc_id = instrs.get_free_acc(item.first_usage(), last);
 
     if (acc_id == -1) {
 /*
@@ -85,6 +97,7 @@ int peephole_0(int range_size, Instr::List &instrs, RegUsage &allocated_vars) {
 */
 
     replace_acc(instrs, item, var_id, acc_id);
+    live.invalidate(var_id);
 
     subst_count++;
   }
@@ -151,14 +164,17 @@ int peephole_1(Liveness &live, Instr::List &instrs, RegUsage &allocated_vars) {
       continue;
     }
 
+    int acc_id = instrs.get_free_acc(i - 1, i);
+    if (acc_id == -1) continue;  // All accumulators in use, can happen with long expressions
+
     Reg current(REG_A, def);
-    Reg replace_with(ACC, instrs.get_free_acc(i - 1, i));
-    assert(replace_with.regId != -1);
+    Reg replace_with(ACC, acc_id);
 
     prev.rename_dest(current, replace_with);
     renameUses(instr, current, replace_with);
     instrs[i-1] = prev;
     instrs[i]   = instr;
+    live.invalidate(def);
 
     // DANGEROUS! Do not use this value downstream.   
     // Currently stored for debug display purposes only! 
@@ -193,12 +209,15 @@ int peephole_2(Liveness &live, Instr::List &instrs, RegUsage &allocated_vars) {
 
     if (!allocated_vars[def].only_assigned()) continue;
 
+    int acc_id = instrs.get_free_acc(i, i);
+    if (acc_id == -1) continue;  // All accumulators in use
+
     Reg current(REG_A, def);
-    Reg replace_with(ACC, instrs.get_free_acc(i, i));
-    assert(replace_with.regId != -1);
+    Reg replace_with(ACC, acc_id);
 
     instr.rename_dest(current, replace_with);
     instrs[i] = instr;
+    live.invalidate(def);
 
     // DANGEROUS! Do not use this value downstream (remember why, old fart?).   
     // Currently stored for debug display purposes only! 
@@ -210,10 +229,724 @@ int peephole_2(Liveness &live, Instr::List &instrs, RegUsage &allocated_vars) {
   return subst_count;
 }
 
+
+/**
+ * Loop in the instruction list, from the header label up to and including the last branch back to it
+ */
+struct Loop {
+  InstrId header;
+  InstrId end;
+
+  bool contains(InstrId i) const { return header <= i && i <= end; }
+};
+
+
+/**
+ * Find the loops which have a preheader, ordered on header.
+ *
+ * The preheader is the position just before the header label. Code placed there runs once
+ * when the loop is entered, on condition that the loop is only entered by falling through to the header.
+ * Loops with a function call are skipped, the return jumps into the loop.
+ *
+ * Loops are properly nested, so an outer loop comes before the loops it contains.
+ */
+std::vector<Loop> find_loops(Instr::List const &instrs, CFG const &cfg) {
+  std::map<InstrId, InstrId> back_branches;         // Key is header, value is last branch back to it
+  std::vector<std::pair<InstrId, InstrId>> jumps;  // All branch edges, from and to
+
+  for (int i = 0; i < (int) cfg.size(); i++) {
+    auto const &instr = instrs[i];
+    if (instr.tag != InstrTag::BRL) continue;
+
+    for (auto succ : cfg[i]) {
+      if (succ == i + 1) continue;  // Fall-through
+      jumps.push_back({i, succ});
+
+      if (succ <= i && !instr.is_call_mark()) {
+        auto it = back_branches.find(succ);
+        if (it == back_branches.end() || it->second < i) back_branches[succ] = i;
+      }
+    }
+  }
+
+  std::vector<Loop> loops;
+
+  for (auto const &it : back_branches) {
+    Loop loop = { it.first, it.second };
+    if (loop.header == 0 || !cfg[loop.header - 1].member(loop.header)) continue;
+
+    bool single_entry = true;
+    for (auto const &jump : jumps) {
+      if (!loop.contains(jump.first) && loop.contains(jump.second)) {
+        single_entry = false;
+        break;
+      }
+    }
+
+    if (single_entry) loops.push_back(loop);
+  }
+
+  return loops;
+}
+
+
+/**
+ * Find the outermost loops which have a preheader.
+ */
+std::vector<Loop> find_outer_loops(Instr::List const &instrs, CFG const &cfg) {
+  std::vector<Loop> ret;
+
+  for (auto const &loop : find_loops(instrs, cfg)) {
+    if (!ret.empty() && ret.back().contains(loop.header)) continue;
+    ret.push_back(loop);
+  }
+
+  return ret;
+}
+
+
+/**
+ * Number of variables which can be made live over the entire loop, without running out of registers
+ *
+ * This is limited by the largest number of variables live in the loop.
+ * For vc4, the register allocation distributes the variables over register files A and B,
+ * so the budget is twice the size of a register file.
+ *
+ * This is an estimate; if register allocation fails anyway, it is retried without hoisting
+ * (see `Liveness::optimize()`).
+ */
+int available_regs(Liveness &live, Loop const &loop) {
+  int const RESERVED_REGS = 8;  // Keep free, register allocation does not always find an optimal fit
+
+  int max_live = 0;
+  for (int i = loop.header; i <= loop.end; i++) {
+    if (max_live < (int) live[i].size()) max_live = (int) live[i].size();
+  }
+
+  int num_regs = Platform::size_regfile();
+  if (Platform::compiling_for_vc4()) num_regs *= 2;  // Allocation uses both register files A and B
+
+  return num_regs - RESERVED_REGS - max_live;
+}
+
+
+/**
+ * Check if the assignment in the given instruction can be done in the preheader of the loop instead.
+ *
+ * The destination must be a variable which is assigned only here and unconditionally,
+ * and which is not used in the loop before the assignment.
+ */
+bool can_move_dst(Liveness &live, Instr const &instr, Loop const &loop) {
+  if (!instr.is_always() || instr.set_cond().flags_set()) return false;
+
+  Reg dst = instr.dst_a_reg();
+  if (dst.tag == NONE) return false;
+
+  auto const &item = live.reg_usage()[dst.regId];
+  if (!item.assigned_once() || item.crosses_call()) return false;
+
+  return !live[loop.header].member(dst.regId);
+}
+
+
+/**
+ * Check if the given instruction loads an immediate which can be moved to the preheader of the loop
+ */
+bool can_hoist(Liveness &live, Instr const &instr, Loop const &loop) {
+  if (instr.tag != InstrTag::LI) return false;
+  if (!instr.LI.imm.is_int() && !instr.LI.imm.is_float()) return false;
+  if (instr.LI.imm.is_basic()) return false;  // Cheap to load, and used as is in ALU instructions
+
+  return can_move_dst(live, instr, loop);
+}
+
+/**
+ * Check if the given instruction is an ALU operation which depends only on its operands
+ */
+bool is_pure_alu(Instr const &instr) {
+  if (instr.tag != InstrTag::ALU) return false;
+
+  switch (instr.ALU.op.value()) {
+    case ALUOp::M_ROTATE:  // Has special requirements for its operand on vc4
+    case ALUOp::A_TIDX:
+    case ALUOp::A_EIDX:
+    case ALUOp::A_TMUWT:
+      return false;
+    default:
+      return true;
+  }
+}
+
+
+/**
+ * Get the value of an integer small immediate operand
+ *
+ * @return true if the operand is an integer small immediate, false otherwise
+ */
+bool small_int_value(RegOrImm const &src, int &value) {
+  if (!src.is_imm()) return false;
+  int encoded = src.imm().val;
+
+  if (Platform::compiling_for_vc4()) {
+    if (encoded < 0 || encoded >= 32) return false;  // Floats
+    value = decodeSmallLit(encoded).intVal;
+  } else {
+    if (encoded < -16 || encoded > 15) return false;  // Floats
+    value = encoded;
+  }
+
+  return true;
+}
+
+
+/**
+ * Positions of the assignments and uses of each variable in the instruction list
+ */
+struct VarPositions {
+  std::vector<std::vector<InstrId>> defs;
+  std::vector<std::vector<InstrId>> uses;
+
+  VarPositions(Instr::List const &instrs, int num_vars) : defs(num_vars), uses(num_vars) {
+    for (int i = 0; i < (int) instrs.size(); i++) {
+      auto const &instr = instrs[i];
+      if (!instr.has_registers()) continue;
+
+      UseDef useDef(instr);
+      if (useDef.def.tag != NONE) defs[useDef.def.regId].push_back(i);
+      for (auto var : useDef.use) uses[var].push_back(i);
+    }
+  }
+
+  bool assigned_in(RegId var, Loop const &loop) const {
+    for (auto i : defs[var]) {
+      if (loop.contains(i)) return true;
+    }
+
+    return false;
+  }
+};
+
+
+/**
+ * Basic induction variable `i` of a loop, assigned once in the loop with `i = i + step` or `i = i - step`
+ */
+struct BasicInductionVar {
+  InstrId  def;   // Position of the increment
+  RegOrImm step;  // Loop-invariant
+  int      sign;  // -1 for a decrement
+};
+
+
+/**
+ * Induction variable derived from a basic induction variable `i`, with value `sign*(i << shift) + b`
+ */
+struct InductionVar {
+  RegId   base;               // The basic induction variable
+  int     sign   = 1;
+  int     shift  = 0;
+  InstrId def    = -1;        // Position of the assignment
+  int     parent = -1;        // Index of the induction variable it is calculated from, -1 if it's the base
+  bool    increment = false;  // Set if the value is used other than for deriving induction variables
+};
+
+
+/**
+ * Reduce the derived induction variables of a single loop, see `reduceInductionVars()`
+ *
+ * @param l  index of the loop in `loops`
+ *
+ * @return Number of instructions removed from the loop
+ */
+int reduce_loop(
+  Liveness &live,
+  Instr::List &instrs,
+  std::vector<Loop> const &loops,
+  int l,
+  std::vector<int> &available,
+  VarPositions const &positions,
+  std::map<InstrId, Instr::List> &inserts
+) {
+  using namespace Target::instr;
+  Loop const &loop = loops[l];
+
+  auto in_nested_loop = [&loops, &loop] (InstrId i) -> bool {
+    for (auto const &inner : loops) {
+      if (inner.header != loop.header && loop.contains(inner.header) && inner.contains(i)) return true;
+    }
+
+    return false;
+  };
+
+  auto is_invariant = [&positions, &loop] (RegOrImm const &src) -> bool {
+    if (src.is_imm()) return true;
+    return src.reg().tag == REG_A && !positions.assigned_in(src.reg().regId, loop);
+  };
+
+  //
+  // Find the basic induction variables.
+  // Increments in nested loops are skipped, these happen more than once per iteration.
+  //
+  std::map<RegId, BasicInductionVar> basic;
+
+  for (int i = loop.header + 1; i < loop.end; i++) {
+    auto const &instr = instrs[i];
+    if (instr.tag != InstrTag::ALU || !instr.is_always()) continue;
+
+    auto op = instr.ALU.op.value();
+    if (op != ALUOp::A_ADD && op != ALUOp::A_SUB) continue;
+
+    Reg dst = instr.dst_a_reg();
+    if (dst.tag == NONE || in_nested_loop(i)) continue;
+
+    int num_defs = 0;
+    for (auto j : positions.defs[dst.regId]) {
+      if (loop.contains(j)) num_defs++;
+    }
+    if (num_defs != 1) continue;
+
+    auto valid_step = [&is_invariant] (RegOrImm const &src) -> bool {
+      int value;
+      if (small_int_value(src, value)) return value != 0;
+      return src.is_reg() && is_invariant(src);
+    };
+
+    auto const &a = instr.ALU.srcA;
+    auto const &b = instr.ALU.srcB;
+
+    if (a == dst && valid_step(b)) {
+      basic[dst.regId] = { i, b, (op == ALUOp::A_SUB)? -1 : 1 };
+    } else if (op == ALUOp::A_ADD && b == dst && valid_step(a)) {
+      basic[dst.regId] = { i, a, 1 };
+    }
+  }
+
+  if (basic.empty()) return 0;
+
+  //
+  // Find the induction variables derived from these
+  //
+  std::vector<InductionVar> derived;
+  std::map<RegId, int> derived_index;
+  std::map<InstrId, int> derived_at;
+
+  auto get_iv = [&basic, &derived, &derived_index] (RegOrImm const &src, InductionVar &iv) -> bool {
+    if (!src.is_reg() || src.reg().tag != REG_A) return false;
+    RegId var = src.reg().regId;
+
+    if (basic.find(var) != basic.end()) {
+      iv = InductionVar();
+      iv.base = var;
+      return true;
+    }
+
+    auto it = derived_index.find(var);
+    if (it == derived_index.end()) return false;
+
+    iv = derived[it->second];
+    iv.parent = it->second;
+    return true;
+  };
+
+  for (int j = loop.header + 1; j < loop.end; j++) {
+    auto const &instr = instrs[j];
+    if (instr.tag != InstrTag::ALU || !can_move_dst(live, instr, loop)) continue;
+
+    auto op = instr.ALU.op.value();
+    auto const &a = instr.ALU.srcA;
+    auto const &b = instr.ALU.srcB;
+    InductionVar iv;
+    bool found = false;
+    int value;
+
+    switch (op) {
+      case ALUOp::A_SHL:
+        if (get_iv(a, iv) && small_int_value(b, value) && value >= 0) {
+          iv.shift += value;
+          found = (iv.shift <= 15);  // Shift must fit in a small immediate
+        }
+        break;
+      case ALUOp::A_ADD:
+        found = (get_iv(a, iv) && is_invariant(b)) || (get_iv(b, iv) && is_invariant(a));
+        break;
+      case ALUOp::A_SUB:
+        if (get_iv(a, iv) && is_invariant(b)) {
+          found = true;
+        } else if (get_iv(b, iv) && is_invariant(a)) {
+          iv.sign = -iv.sign;
+          found = true;
+        }
+        break;
+      default:
+        break;
+    }
+
+    if (!found) continue;
+
+    // The value must only be used in the same iteration, before the next increment
+    RegId var = instr.dest().regId;
+    InstrId inc = basic[iv.base].def;
+    bool valid = true;
+
+    for (auto k : positions.uses[var]) {
+      if (!loop.contains(k) || k <= j || (j < inc && inc < k)) {
+        valid = false;
+        break;
+      }
+    }
+
+    if (!valid) continue;
+
+    iv.def = j;
+    derived_index[var] = (int) derived.size();
+    derived_at[j] = (int) derived.size();
+    derived.push_back(iv);
+  }
+
+  if (derived.empty()) return 0;
+
+  //
+  // Only the final results of the calculations need to be incremented.
+  // The induction variables derived from each other are grouped, a group is only
+  // reduced if this removes more instructions than it adds.
+  //
+  std::vector<int> group(derived.size());
+  std::map<int, int> saved;  // Key is the group, value the number of instructions removed
+
+  for (int i = 0; i < (int) derived.size(); i++) {
+    auto &iv = derived[i];
+    RegId var = instrs[iv.def].dest().regId;
+
+    for (auto k : positions.uses[var]) {
+      if (derived_at.find(k) == derived_at.end()) {
+        iv.increment = true;
+        break;
+      }
+    }
+
+    group[i] = (iv.parent == -1)? i : group[iv.parent];
+    saved[group[i]] += iv.increment? 0 : 1;
+  }
+
+  int count = 0;
+  std::map<int, Reg> imm_steps;                   // Incremented values loaded in the preheader
+  std::map<std::pair<RegId, int>, Reg> var_steps;  // Shifted increment variables, key is variable and shift
+
+  for (auto const &it : saved) {
+    if (it.second <= 0) continue;
+
+    int num_increments = 0;
+    for (int i = 0; i < (int) derived.size(); i++) {
+      if (group[i] == it.first && derived[i].increment) num_increments++;
+    }
+
+    // Incremented variables are live over the entire loop, as are the steps they are incremented with
+    bool fits = true;
+    for (int m = 0; m <= l; m++) {
+      if (loops[m].contains(loop.header) && available[m] < 2*num_increments) fits = false;
+    }
+    if (!fits) continue;
+
+    int num_new_vars = num_increments;
+
+    for (int i = 0; i < (int) derived.size(); i++) {
+      if (group[i] != it.first) continue;
+      auto const &iv = derived[i];
+
+      // Calculate the initial value in the preheader
+      Instr &instr = instrs[iv.def];
+      Reg dst = instr.dest();
+      live.invalidate(instr);
+      inserts[loop.header] << instr;
+      instr.tag = InstrTag::SKIP;
+      count++;
+
+      if (!iv.increment) continue;
+
+      // Increment right after the increment of the basic induction variable
+      auto const &inc = basic[iv.base];
+      int sign = iv.sign*inc.sign;
+      int step;
+      Instr bump;
+
+      if (small_int_value(inc.step, step)) {
+        // Calculate with wrap-around, as on the QPU
+        uint32_t delta = ((uint32_t) step) << iv.shift;
+        if (sign < 0) delta = 0u - delta;
+        int value = (int) delta;
+
+        if (0 <= value && value <= 15) {
+          bump = add(dst, dst, value);
+        } else if (-15 <= value && value < 0) {
+          bump = sub(dst, dst, -value);
+        } else {
+          auto found = imm_steps.find(value);
+          if (found == imm_steps.end()) {
+            Reg reg = live.add_var();
+            inserts[loop.header] << li(reg, value);
+            found = imm_steps.insert({value, reg}).first;
+            num_new_vars++;
+          }
+
+          bump = add(dst, dst, found->second);
+        }
+      } else {
+        Reg step_reg = inc.step.reg();
+        live.invalidate(step_reg.regId);
+
+        if (iv.shift > 0) {
+          auto key = std::make_pair(step_reg.regId, iv.shift);
+          auto found = var_steps.find(key);
+          if (found == var_steps.end()) {
+            Reg reg = live.add_var();
+            inserts[loop.header] << shl(reg, step_reg, iv.shift);
+            found = var_steps.insert({key, reg}).first;
+            num_new_vars++;
+          }
+
+          step_reg = found->second;
+        }
+
+        bump = (sign > 0)? add(dst, dst, step_reg) : sub(dst, dst, step_reg);
+      }
+
+      inserts[inc.def + 1] << bump;
+      count--;
+    }
+
+    for (int m = 0; m <= l; m++) {
+      if (loops[m].contains(loop.header)) available[m] -= num_new_vars;
+    }
+  }
+
+  return count;
+}
+
 }  // anon namespace
 
 
 /**
+ * Move the loading of large immediates out of loops.
+ *
+ * Immediates which do not fit in a small immediate need one instruction on `vc4` (`LI`)
+ * and up to about 20 instructions on `v3d`, see `encode_int_immediate()`.
+ * Inside a loop, these are redone on every iteration. This pass moves them to the
+ * preheader of the outermost loop, where they are loaded once.
+ * Loads of the same value are combined into one.
+ *
+ * Moving a load out of a loop makes the variable live over the entire loop.
+ * To avoid running out of registers, the number of moved loads per loop is limited by the
+ * largest number of variables live in the loop.
+ *
+ * The changed variables are passed to `Liveness::invalidate()`, call `Liveness::update()` afterwards.
+ *
+ * @return Number of loads removed from loops
+ */
+int hoistImmediates(Liveness &live, Instr::List &instrs) {
+  std::map<InstrId, Instr::List> inserts;
+  int count = 0;
+
+  for (auto const &loop : find_outer_loops(instrs, live.cfg())) {
+    int available = available_regs(live, loop);
+    if (available <= 0) continue;
+
+    std::vector<Instr> pool;  // Loads moved to the preheader
+
+    for (int i = loop.header + 1; i < loop.end; i++) {
+      Instr &instr = instrs[i];
+      if (!can_hoist(live, instr, loop)) continue;
+
+      Reg current = instr.dest();
+
+      int found = -1;
+      for (int j = 0; j < (int) pool.size(); j++) {
+        if (pool[j].LI.imm == instr.LI.imm) {
+          found = j;
+          break;
+        }
+      }
+
+      if (found != -1) {
+        // Same value already loaded, use that instead
+        Reg replace_with = pool[found].dest();
+        auto const &item = live.reg_usage()[current.regId];
+
+        for (int k = i + 1; k <= item.last_usage(); k++) {
+          renameUses(instrs[k], current, replace_with);
+        }
+
+        live.invalidate(replace_with.regId);
+      } else {
+        if ((int) pool.size() >= available) continue;
+        pool.push_back(instr);
+        inserts[loop.header] << instr;
+      }
+
+      live.invalidate(current.regId);
+      instr.tag = InstrTag::SKIP;
+      count++;
+    }
+  }
+
+  live.insert(instrs, inserts);
+  return count;
+}
+
+
+/**
+ * Move loop-invariant calculations out of loops.
+ *
+ * An ALU operation is loop-invariant if its operands are not assigned in the loop,
+ * or only by loop-invariant operations which have been moved already.
+ * It is moved to the preheader of the outermost loop in which it is invariant,
+ * where it is done once instead of on every iteration.
+ *
+ * Only unconditional operations are moved, which assign a variable that is assigned nowhere else.
+ * The operations have no side effects, so it does not matter if they were skipped in some iterations.
+ * As in `hoistImmediates()`, the number of moved operations per loop is limited,
+ * and identical operations are combined into one.
+ *
+ * The changed variables are passed to `Liveness::invalidate()`, call `Liveness::update()` afterwards.
+ *
+ * @return Number of operations removed from loops
+ */
+int hoistInvariants(Liveness &live, Instr::List &instrs) {
+  auto loops = find_loops(instrs, live.cfg());
+  if (loops.empty()) return 0;
+
+  std::vector<int> available;
+  for (auto const &loop : loops) available.push_back(available_regs(live, loop));
+
+  VarPositions positions(instrs, (int) live.reg_usage().size());
+  std::map<RegId, InstrId> moved;  // Variables assigned in a preheader, value is the header of the loop
+  std::map<InstrId, Instr::List> inserts;
+  int count = 0;
+
+  auto is_invariant = [&positions, &moved] (RegOrImm const &src, Loop const &loop) -> bool {
+    if (src.is_imm()) return true;
+
+    Reg reg = src.reg();
+    if (reg.tag == NONE) return true;  // Operand not used
+    if (reg.tag != REG_A) return false;
+
+    auto it = moved.find(reg.regId);
+    if (it != moved.end()) {
+      // The preheader of a nested loop is inside the loop
+      return !(loop.contains(it->second) && it->second != loop.header);
+    }
+
+    return !positions.assigned_in(reg.regId, loop);
+  };
+
+  for (int i = 0; i < (int) instrs.size(); i++) {
+    Instr &instr = instrs[i];
+    if (!is_pure_alu(instr)) continue;
+
+    // Outer loops come first, so this selects the outermost loop in which the operation is invariant
+    for (int l = 0; l < (int) loops.size(); l++) {
+      auto const &loop = loops[l];
+      if (!loop.contains(i) || !can_move_dst(live, instr, loop)) continue;
+      if (!is_invariant(instr.ALU.srcA, loop) || !is_invariant(instr.ALU.srcB, loop)) continue;
+
+      Reg current = instr.dest();
+      auto &preheader = inserts[loop.header];
+      int found = -1;
+
+      for (int j = 0; j < preheader.size(); j++) {
+        auto const &prev = preheader[j];
+
+        if (prev.ALU.op.value() == instr.ALU.op.value()
+         && prev.ALU.srcA == instr.ALU.srcA && prev.ALU.srcB == instr.ALU.srcB) {
+          found = j;
+          break;
+        }
+      }
+
+      if (found != -1) {
+        // Same operation already moved, use its result instead
+        Reg replace_with = preheader[found].dest();
+        auto const &item = live.reg_usage()[current.regId];
+
+        for (int k = i + 1; k <= item.last_usage(); k++) {
+          renameUses(instrs[k], current, replace_with);
+        }
+
+        live.invalidate(replace_with.regId);
+        live.invalidate(instr);
+        instr.tag = InstrTag::SKIP;
+        count++;
+        break;
+      }
+
+      // The variable becomes live over the loop and the loops containing it
+      bool fits = true;
+      for (int m = 0; m <= l; m++) {
+        if (loops[m].contains(loop.header) && available[m] <= 0) fits = false;
+      }
+      if (!fits) continue;
+
+      for (int m = 0; m <= l; m++) {
+        if (loops[m].contains(loop.header)) available[m]--;
+      }
+
+      live.invalidate(instr);
+      moved[current.regId] = loop.header;
+      preheader << instr;
+      instr.tag = InstrTag::SKIP;
+      count++;
+      break;
+    }
+  }
+
+  live.insert(instrs, inserts);
+  return count;
+}
+
+
+/**
+ * Replace calculations with induction variables in loops by additions.
+ *
+ * A basic induction variable `i` is assigned once in a loop, with `i = i + c` or `i = i - c`
+ * for a loop-invariant `c`. Derived from it are the variables calculated from it with a left shift
+ * by a constant, or by adding or subtracting a loop-invariant value. These have the form `(i << s) + b`.
+ * Typically, these are offsets and pointers calculated from a loop index, such as `p + (i << 2)` for `p[i]`.
+ *
+ * Such a derived variable is calculated in the preheader instead, and incremented with `c << s`
+ * right after each increment of `i`. This pays off for chains of calculations,
+ * of which only the final results need to be incremented. A chain is only changed if this
+ * removes more instructions than it adds.
+ *
+ * Multiplications are not handled. These are 24-bit on the QPUs, the results would differ
+ * for values out of that range.
+ *
+ * The changed variables are passed to `Liveness::invalidate()`, call `Liveness::update()` afterwards.
+ *
+ * @return Number of instructions removed from loops
+ */
+int reduceInductionVars(Liveness &live, Instr::List &instrs) {
+  auto loops = find_loops(instrs, live.cfg());
+  if (loops.empty()) return 0;
+
+  std::vector<int> available;
+  for (auto const &loop : loops) available.push_back(available_regs(live, loop));
+
+  VarPositions positions(instrs, (int) live.reg_usage().size());
+  std::map<InstrId, Instr::List> inserts;
+  int count = 0;
+
+  for (int l = 0; l < (int) loops.size(); l++) {
+    count += reduce_loop(live, instrs, loops, l, available, positions, inserts);
+  }
+
+  live.insert(instrs, inserts);
+  return count;
+}
+
+
+/**
+ * Replace variables loaded with an immediate by the immediate value, or by a variable loaded with same value.
+ *
+ * The changed variables are passed to `Liveness::invalidate()`, call `Liveness::update()` afterwards.
+ *
  * @return true if any replacements were made, false otherwise
  */
 bool combineImmediates(Liveness &live, Instr::List &instrs) {
@@ -264,7 +997,7 @@ bool combineImmediates(Liveness &live, Instr::List &instrs) {
     if (instr.LI.imm.is_basic()) {
       auto const &reg_usage = live.reg_usage()[instr.dest().regId];
 
-      if (reg_usage.assigned_once()) {
+      if (reg_usage.assigned_once() && !reg_usage.crosses_call()) {
         assert(reg_usage.first_usage() == reg_usage.first_dst());
         bool can_remove = true;
 
@@ -298,6 +1031,8 @@ bool combineImmediates(Liveness &live, Instr::List &instrs) {
           }
 
           // Perform the subst
+          live.invalidate(instr.dest().regId);
+
           if (instr2.ALU.srcA == instr.dest()) {
             instr2.ALU.srcA = instr.LI.imm;
           }
@@ -308,6 +1043,7 @@ bool combineImmediates(Liveness &live, Instr::List &instrs) {
         }
 
         if (can_remove) {
+          live.invalidate(instr.dest().regId);
           instr.tag = SKIP;
         }
       }
@@ -315,6 +1051,9 @@ bool combineImmediates(Liveness &live, Instr::List &instrs) {
       continue;
     }
 
+    // Conditional assignments only set part of the vector, these can not be shared
+    if (!instr.is_always()) continue;
+
    //std::cout << "  Scanning for LI: " << instr.dump() << std::endl; 
 
 /*
@@ -348,6 +1087,7 @@ bool combineImmediates(Liveness &live, Instr::List &instrs) {
 
       if (instr2.tag != InstrTag::LI) continue;
       if (instr2.LI.imm != instr.LI.imm) continue;
+      if (!instr2.is_always()) continue;
       if (!live.cfg().is_parent_block(j, live.cfg().block_at(i))) continue;
 //      std::cout << "  Could replace LI at " << j << " (block " << live.cfg().block_at(j) << "): "
 //                << instr2.mnemonic(false) << std::endl;
@@ -400,6 +1140,8 @@ bool combineImmediates(Liveness &live, Instr::List &instrs) {
         debug(msg);
 */
         instr2.tag = InstrTag::SKIP;
+        live.invalidate(current.regId);
+        live.invalidate(replace_with.regId);
       }
     }
 
@@ -419,6 +1161,8 @@ bool combineImmediates(Liveness &live, Instr::List &instrs) {
 /**
  * Optimisation passes that introduce accumulators
  *
+ * The replaced variables are passed to `Liveness::invalidate()`, call `Liveness::update()` afterwards.
+ *
  * @param allocated_vars write param; note which vars have an accumulator registered
  *
  * @return Number of substitutions performed;
@@ -450,7 +1194,7 @@ int introduceAccum(Liveness &live, Instr::List &instrs) {
   // Picks up a lot usually, but range_size > 1 seldom results in something
   //Timer t("peephole_0");
   for (int range_size = 1; range_size <= MAX_RANGE_SIZE; range_size++) {
-    int count = peephole_0(range_size, instrs, allocated_vars);
+    int count = peephole_0(range_size, live, instrs);
 
 /*
     if (count > 0 && range_size > 1) {
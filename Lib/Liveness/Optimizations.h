@@ -6,7 +6,10 @@ namespace V3DLib {
 
 class Liveness;
 
+int hoistImmediates(Liveness &live, Instr::List &instrs);
 bool combineImmediates(Liveness &live, Instr::List &instrs);
+int hoistInvariants(Liveness &live, Instr::List &instrs);
+int reduceInductionVars(Liveness &live, Instr::List &instrs);
 int introduceAccum(Liveness &live, Instr::List &instrs);
 
 }  // namespace V3DLib
@@ -18,6 +18,34 @@ void Range::add(int val) {
 }
 
 
+/**
+ * Remove a value from the count.
+ *
+ * This assumes that the first and last values stay the same.
+ */
+void Range::remove() {
+  assert(m_count > 0);
+  m_count--;
+
+  if (m_count == 0) {
+    *this = Range();
+  }
+}
+
+
+/**
+ * Adjust the range to changed positions of the values
+ *
+ * @param new_index  new position for each old position
+ */
+void Range::remap(std::vector<int> const &new_index) {
+  if (empty()) return;
+
+  m_first = new_index[m_first];
+  m_last  = new_index[m_last];
+}
+
+
 int Range::first() const {
   return m_first;
 }
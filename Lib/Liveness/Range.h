@@ -1,6 +1,7 @@
 #ifndef _V3DLIB_LIVENESS_RANGE_H_
 #define _V3DLIB_LIVENESS_RANGE_H_
 #include <string>
+#include <vector>
 
 namespace V3DLib {
 
@@ -10,6 +11,8 @@ namespace V3DLib {
 class Range {
 public:
   void add(int val);
+  void remove();
+  void remap(std::vector<int> const &new_index);
   int first() const;
   int last() const;
   int count() const;
@@ -227,6 +227,21 @@ int RegUsageItem::last_usage() const {
 }
 
 
+/**
+ * Adjust the line numbers after instructions have been removed
+ *
+ * @param new_index  new line number for each old line number
+ */
+void RegUsageItem::remap(std::vector<int> const &new_index) {
+  for (auto &n : use_dst) {
+    n = new_index[n];
+  }
+
+  src_range.remap(new_index);
+  m_live_range.remap(new_index);
+}
+
+
 bool RegUsageItem::use_overlaps(RegUsageItem const &rhs) const {
   return !((first_usage() > rhs.last_usage()) || (last_usage() < rhs.first_usage()));
 }
@@ -245,9 +260,34 @@ void RegUsage::reset() {
   assert(size() > 0);
 
   for (int i = 0; i < (int) size(); i++) {
-    auto &item = (*this)[i];
-    item = RegUsageItem();
-    item.reg.tag = NONE;
+    reset(i);
+  }
+}
+
+
+void RegUsage::reset(RegId var) {
+  auto &item = (*this)[var];
+  item = RegUsageItem();
+  item.reg.tag = NONE;
+}
+
+
+/**
+ * Add an item for a new variable
+ *
+ * @return id of the new variable
+ */
+RegId RegUsage::add() {
+  RegId ret = (RegId) size();
+  push_back(RegUsageItem());
+  reset(ret);
+  return ret;
+}
+
+
+void RegUsage::remap(std::vector<int> const &new_index) {
+  for (int i = 0; i < (int) size(); i++) {
+    (*this)[i].remap(new_index);
   }
 }
 
@@ -284,8 +324,11 @@ void RegUsage::set_live(Liveness &live) {
  * Check internal consistency of used variables
  *
  * If anything is detected here, it is a compile error.
+ *
+ * @param return_vars  return registers of out-of-line functions. These are assigned in the function body,
+ *                     which comes after the call sites, so they are expected to be live before first assignment.
  */
-void RegUsage::check() const {
+void RegUsage::check(RegIdSet const &return_vars) const {
   std::string ret;
 
   // Case 'instruction variables which are assigned but never used'
@@ -313,6 +356,7 @@ void RegUsage::check() const {
       auto const &item = (*this)[i];
       if (!item.regular_use())   continue;
       if (item.never_assigned()) continue;  // Tested in previous block
+      if (return_vars.member(i)) continue;
 
       if (item.first_live() <= item.first_dst()) {
         tmp << "  Variable " << i << " is live before first assignment" << "\n";
@@ -31,7 +31,14 @@ struct RegUsageItem {
     return !(unused() || only_assigned());
   }
 
+  void remove_live()      { m_live_range.remove(); }
+  void remap(std::vector<int> const &new_index);
+
+  void set_crosses_call() { m_crosses_call = true; }
+  bool crosses_call() const { return m_crosses_call; }
+
 private:
+  bool m_crosses_call = false;  // Var is live over an out-of-line function call, return or entry
   Range src_range;           // First and last instructions where var is used as src
   std::vector<int> use_dst;  // List of line numbers where var is set
   Range m_live_range;
@@ -48,10 +55,13 @@ struct RegUsage : private std::vector<RegUsageItem> {
   RegUsage(int numVars);
 
   void reset();
+  void reset(RegId var);
+  RegId add();
+  void remap(std::vector<int> const &new_index);
   void set_used(Instr::List &instrs);
   void set_live(Liveness &live);
   std::string dump(bool verbose = false) const;
-  void check() const;
+  void check(RegIdSet const &return_vars = RegIdSet()) const;
   std::string dump_use_ranges() const;
   void check_overlap_usage(Reg acc, RegUsageItem const &item) const;
 
@@ -0,0 +1,99 @@
+#include "PrecompiledKernel.h"
+#include "Support/basics.h"
+#include "Support/Platform.h"
+#include "v3d/BufferObject.h"
+#include "v3d/Invoke.h"
+
+namespace V3DLib {
+
+using ::operator<<;  // C++ weirdness
+
+BasePrecompiledKernel::BasePrecompiledKernel(PrecompiledData const &data) : m_data(data) {}
+BasePrecompiledKernel::~BasePrecompiledKernel() {}
+
+
+void BasePrecompiledKernel::check_signature(std::string const &signature, int num_uniforms) const {
+  if (signature != m_data.signature || num_uniforms != m_data.num_uniforms) {
+    std::string msg;
+    msg << "PrecompiledKernel '" << m_data.name << "': parameter types (" << signature << ") "
+        << "differ from the precompiled kernel (" << m_data.signature << ")";
+    assertq(false, msg);
+  }
+}
+
+
+void BasePrecompiledKernel::check_uniforms() const {
+  assertq(uniforms.size() == m_data.num_uniforms,
+    "PrecompiledKernel: number of uniforms differs from the precompiled kernel");
+}
+
+
+/**
+ * Invoke the kernel
+ *
+ * Depending on QPU_MODE, this calls `qpu()` or `cpu()`.
+ */
+void BasePrecompiledKernel::call() {
+#ifdef QPU_MODE
+  if (!Platform::use_main_memory()) {
+    qpu();
+    return;
+  }
+#endif
+
+  cpu();
+}
+
+
+/**
+ * Run the native host code of the kernel
+ */
+void BasePrecompiledKernel::cpu(QpuRange const &qpus) {
+  assertq(m_data.native != nullptr, "PrecompiledKernel: no host code present for this kernel", true);
+  assert(uniforms.size() != 0);
+
+  cpu::run(m_data.native, qpus, uniforms, getBufferObject());
+}
+
+
+#ifdef QPU_MODE
+/**
+ * Invoke kernel on physical QPU hardware
+ *
+ * The code is copied to the code memory on the first call.
+ */
+void BasePrecompiledKernel::qpu(QpuRange const &qpus) {
+  assert(uniforms.size() != 0);
+
+  if (Platform::has_vc4()) {
+    assertq(m_data.vc4_code != nullptr, "PrecompiledKernel: no vc4 code present for this kernel", true);
+
+    if (!m_vc4_code.allocated()) {
+      m_vc4_code.alloc(m_data.vc4_size);
+      m_vc4_code.copyFrom(m_data.vc4_code, m_data.vc4_size);
+    }
+
+    m_mailbox.invoke(qpus, m_vc4_code, uniforms);
+  } else {
+    assertq(m_data.v3d_code != nullptr, "PrecompiledKernel: no v3d code present for this kernel", true);
+    assertq(qpus.count == 1 || qpus.count == 8, "Num QPU's must be 1 or 8", true);
+    assertq(qpus.first == 0, "v3d: kernels can only run on the first QPU id's", true);
+
+    if (!m_v3d_code) {
+      m_v3d_bo.reset(new v3d::BufferObject);
+      m_v3d_bo->alloc((uint32_t) (sizeof(uint64_t)*m_data.v3d_size));
+      m_v3d_code.reset(new Code(*m_v3d_bo));
+      m_v3d_code->alloc(m_data.v3d_size);
+      m_v3d_code->copyFrom(m_data.v3d_code, m_data.v3d_size);
+    }
+
+    if (!m_devnull.allocated()) {
+      m_devnull.alloc(16);
+    }
+
+    v3d::invoke(qpus, m_devnull, *m_v3d_code, uniforms);
+  }
+}
+#endif  // QPU_MODE
+
+}  // namespace V3DLib
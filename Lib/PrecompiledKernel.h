@@ -0,0 +1,122 @@
+#ifndef _V3DLIB_PRECOMPILEDKERNEL_H_
+#define _V3DLIB_PRECOMPILEDKERNEL_H_
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include "KernelParams.h"
+#include "Common/BufferObject.h"
+#include "Common/QpuRange.h"
+#include "Common/SharedArray.h"
+#include "cpu/NativeKernel.h"  // KernelFunc
+#include "vc4/Invoke.h"
+
+namespace V3DLib {
+
+/**
+ * Compiled kernel, as generated by the `precompile` tool.
+ *
+ * This contains everything needed to run a kernel, so that no DSL compilation
+ * is required at runtime.
+ */
+struct PrecompiledData {
+  char const     *name;
+  char const     *signature;     // Parameter types, see `param_signature()`
+  int             num_uniforms;  // Number of uniform values for the parameters
+  uint64_t const *vc4_code;      // Encoded instructions for vc4, nullptr if not present
+  int             vc4_size;
+  uint64_t const *v3d_code;      // Opcodes for v3d, nullptr if not present
+  int             v3d_size;
+  cpu::KernelFunc native;        // Kernel compiled for the host, nullptr if not present
+};
+
+
+/**
+ * Part of `PrecompiledKernel` which does not depend on the parameter types.
+ */
+class BasePrecompiledKernel {
+public:
+  BasePrecompiledKernel(PrecompiledData const &data);
+  BasePrecompiledKernel(BasePrecompiledKernel const &k) = delete;
+  ~BasePrecompiledKernel();
+
+  BasePrecompiledKernel &setNumQPUs(int n) { m_numQPUs = n; return *this; }
+  int numQPUs() const { return m_numQPUs; }
+  PrecompiledData const &data() const { return m_data; }
+
+  void call();
+  void cpu()       { cpu(m_numQPUs); }
+  void cpu(QpuRange const &qpus);
+
+#ifdef QPU_MODE
+  void qpu()       { qpu(m_numQPUs); }
+  void qpu(QpuRange const &qpus);
+#endif  // QPU_MODE
+
+protected:
+  PrecompiledData const &m_data;
+  int     m_numQPUs = 1;
+  IntList uniforms;  // Parameters to be passed to kernel
+
+  void check_signature(std::string const &signature, int num_uniforms) const;
+  void check_uniforms() const;
+
+private:
+  // Code memories, loaded on the first call on the QPUs
+  Code          m_vc4_code;
+  MailBoxInvoke m_mailbox;
+  std::unique_ptr<BufferObject> m_v3d_bo;   // v3d code needs a separate BO, see `v3d::KernelDriver`
+  std::unique_ptr<Code>         m_v3d_code;
+  Data          m_devnull;
+};
+
+
+/**
+ * Kernel loaded from the output of the `precompile` tool.
+ *
+ * The parameter types `ts` must be the same as for the original kernel;
+ * this is checked when the kernel is created.
+ *
+ * Usage:
+ *
+ *     #include "hello.h"   // Generated by `precompile`
+ *
+ *     precompiled::hello k(precompiled::hello_data);
+ *     k.setNumQPUs(8);
+ *     k.load(&array);
+ *     k.call();
+ *
+ * ------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. `call()` runs the kernel on the QPUs in `QPU_MODE`, and otherwise the native host code
+ *    in the precompiled data. There is no emulator fallback, since that requires the compiler.
+ *
+ * 2. The generated code is only valid for the library version with which it was generated.
+ *    In particular, the layout of the uniforms may change between versions.
+ */
+template <typename... ts>
+class PrecompiledKernel : public BasePrecompiledKernel {
+public:
+  PrecompiledKernel(PrecompiledData const &data) : BasePrecompiledKernel(data) {
+    check_signature(param_signature<ts...>(), param_uniforms<ts...>());
+  }
+
+
+  /**
+   * Load uniform values.
+   *
+   * Same as `Kernel::load()`.
+   */
+  template <typename... us>
+  PrecompiledKernel &load(us... args) {
+    uniforms.clear();
+    nothing(passParam<ts, us>(uniforms, args)...);
+    check_uniforms();
+    return *this;
+  }
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_PRECOMPILEDKERNEL_H_
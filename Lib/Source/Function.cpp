@@ -0,0 +1,94 @@
+#include "Function.h"
+#include <map>
+#include "Support/basics.h"
+
+namespace V3DLib {
+
+using ::operator<<;  // C++ weirdness
+
+namespace {
+
+// Definitions of the functions called in the kernel currently being compiled
+std::map<BaseFunction const *, FunctionDef::Ptr> definitions;
+
+}  // anon namespace
+
+
+/**
+ * Clear the function definitions.
+ *
+ * Called at the start of compilation of a kernel.
+ */
+void BaseFunction::reset() {
+  definitions.clear();
+}
+
+
+/**
+ * Get the definition of this function for the current kernel.
+ *
+ * The body is generated on first call.
+ */
+FunctionDef::Ptr BaseFunction::definition(CreateBody create_body) const {
+  auto it = definitions.find(this);
+  if (it != definitions.end()) {
+    std::string msg;
+    msg << "Recursive call of function '" << m_name << "' is not supported";
+    assertq(!it->second->in_progress, msg, true);
+    return it->second;
+  }
+
+  FunctionDef::Ptr def = std::make_shared<FunctionDef>();
+  def->name        = m_name;
+  def->link        = VarGen::fresh();
+  def->in_progress = true;
+  definitions[this] = def;
+
+  def->body = tempStmt([&def, &create_body] {
+    create_body(*def);
+  });
+
+  std::string msg;
+  msg << "Body of function '" << m_name << "' must end with Return()";
+  assertq(!def->body.empty(), msg, true);
+  auto last = def->body.back();
+  assertq(last->tag == Stmt::ASSIGN && last->assign_lhs()->tag() == Expr::VAR, msg, true);
+
+  def->ret         = last->assign_lhs()->var();
+  def->in_progress = false;
+
+  return def;
+}
+
+
+/**
+ * Add a call to this function to the current statement stack.
+ *
+ * @return the return register of the function
+ */
+Var BaseFunction::call(std::vector<Expr::Ptr> const &args, CreateBody create_body) const {
+  FunctionDef::Ptr def = definition(create_body);
+  assert(args.size() == def->params.size());
+
+  def->num_calls++;
+  auto s = Stmt::create_call(def, def->num_calls - 1, args);
+  s->comment(std::string("Call ") + m_name);
+  stmtStack() << s;
+
+  return def->ret;
+}
+
+
+/**
+ * Generate the body in place, as with function snippets.
+ *
+ * @return the expression passed to `Return()` in the body
+ */
+Expr::Ptr BaseFunction::inline_call(StackCallback f) const {
+  auto stmts = tempStmt(f);
+  assert(!stmts.empty());
+  stmtStack() << stmts;
+  return stmts.back()->assign_rhs();
+}
+
+}  // namespace V3DLib
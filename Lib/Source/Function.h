@@ -0,0 +1,137 @@
+#ifndef _V3DLIB_SOURCE_FUNCTION_H_
+#define _V3DLIB_SOURCE_FUNCTION_H_
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Int.h"
+#include "Float.h"
+#include "StmtStack.h"
+
+namespace V3DLib {
+
+/**
+ * Definition of an out-of-line function within a kernel.
+ *
+ * This is created on the first call of a function during kernel compilation;
+ * the body is generated only once per kernel.
+ *
+ * The registers used for a call are fixed per function:
+ *
+ *   - `params` - argument registers, assigned by the caller before the call
+ *   - `ret`    - return register, read by the caller directly after the call
+ *   - `link`   - clobbered by every call, holds the index of the call site to return to
+ *
+ * All other variables in the body are local to the function.
+ */
+struct FunctionDef {
+  using Ptr = std::shared_ptr<FunctionDef>;
+
+  std::string      name;
+  std::vector<Var> params;
+  Var              ret  = Var(DUMMY);
+  Var              link = Var(DUMMY);
+  Stmts            body;
+  int              num_calls   = 0;
+  bool             in_progress = false;  // Set while generating the body, to detect recursion
+};
+
+
+/**
+ * Handling of function definitions, independent of the function signature.
+ */
+class BaseFunction {
+public:
+  BaseFunction(char const *name, bool do_inline) : m_name(name), m_inline(do_inline) {}
+
+  std::string const &name() const { return m_name; }
+  bool is_inline() const { return m_inline; }
+  void set_inline(bool val) { m_inline = val; }
+
+  static void reset();
+
+protected:
+  using CreateBody = std::function<void (FunctionDef &def)>;
+
+  Var call(std::vector<Expr::Ptr> const &args, CreateBody create_body) const;
+  Expr::Ptr inline_call(StackCallback f) const;
+
+private:
+  std::string m_name;
+  bool        m_inline;
+
+  FunctionDef::Ptr definition(CreateBody create_body) const;
+};
+
+
+template<typename T> struct ExprType;
+template<> struct ExprType<Int>   { using type = IntExpr; };
+template<> struct ExprType<Float> { using type = FloatExpr; };
+
+
+/**
+ * A function in the source language
+ *
+ * By default, the body is compiled once per kernel and is called from every call site.
+ * If inlining is selected, the body is pasted into the AST at every call site instead,
+ * as is done with function snippets.
+ *
+ * The body receives the parameters as variables and must end with `functions::Return()`.
+ *
+ * Example:
+ *
+ *     Function<Int, Int, Int> max_abs("max_abs", [] (Int const &a, Int const &b) {
+ *       functions::Return(max(functions::abs(a), functions::abs(b)));
+ *     });
+ *
+ *     ...
+ *     x = max_abs(y, z);
+ *
+ * -------------------------
+ * NOTES
+ * =====
+ *
+ * 1. Recursive calls are not supported.
+ *
+ * 2. Within a `Where`-block, the body is executed for all lanes; only the assignment of
+ *    the result is subject to the where-condition. Hence, a function called within a `Where`
+ *    should not have side effects (e.g. stores).
+ *
+ * 3. Inlined functions have the same restrictions as function snippets. Notably, a body which
+ *    declares variables can not be inlined within a `Where`-block.
+ */
+template<typename Ret, typename... Args>
+class Function : public BaseFunction {
+  using RetExpr = typename ExprType<Ret>::type;
+
+public:
+  using Body = std::function<void (Args const &...)>;
+
+  Function(char const *name, Body body, bool do_inline = false) : BaseFunction(name, do_inline), m_body(body) {}
+
+  RetExpr operator()(typename ExprType<Args>::type... args) const {
+    if (is_inline()) {
+      return RetExpr(inline_call([this, args...] {
+        std::tuple<Args...> params{Args(args)...};
+        std::apply(m_body, params);
+      }));
+    }
+
+    Var ret = call({args.expr()...}, [this] (FunctionDef &def) {
+      std::tuple<Args...> params;
+      std::apply([&def] (Args const &... p) { (def.params.push_back(p.expr()->var()), ...); }, params);
+      std::apply(m_body, params);
+    });
+
+    Ret result = RetExpr(mkVar(ret));  // Copy, return register is overwritten on the next call
+    return result;
+  }
+
+private:
+  Body m_body;
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_SOURCE_FUNCTION_H_
@@ -6,12 +6,16 @@
  *
  ******************************************************************************/
 #include "Functions.h"
+#include "Function.h"
 #include <iostream>
 #include <cmath>
+#include <limits>
 #include "Support/Platform.h"
 #include "StmtStack.h"
 #include "Lang.h"
+#include "gather.h"
 #include "LibSettings.h"
+#include "vc4/DMA/Operations.h"
 
 namespace V3DLib {
 namespace functions {
@@ -148,9 +152,12 @@ IntExpr topmost_bit(IntExpr in_a) {
  * There is no support for hardware integer division on the VideoCores, this is an implementation for
  * when you really need it (costly).
  *
+ * This is the reference implementation for `integer_division()`, which is considerably faster.
+ * Results of both are identical.
+ *
  * Source: https://en.wikipedia.org/wiki/Division_algorithm#Integer_division_(unsigned)_with_remainder
  */
-void integer_division(Int &Q, Int &R, IntExpr in_a, IntExpr in_b) {
+void long_integer_division(Int &Q, Int &R, IntExpr in_a, IntExpr in_b) {
   Int N = in_a;  comment("Start long integer division");
   Int D = in_b;
 
@@ -193,6 +200,234 @@ void integer_division(Int &Q, Int &R, IntExpr in_a, IntExpr in_b) {
 }
 
 
+/**
+ * Multiply two integer values, returning the lower 32 bits of the product.
+ *
+ * The integer multiply on the VideoCores is 24-bit. The operands are split into 16-bit
+ * halves, so that all partial products are within range.
+ * The upper halves of both operands are never multiplied, these contribute nothing to the lower 32 bits.
+ */
+IntExpr mul32(IntExpr in_a, IntExpr in_b) {
+  return create_function_snippet([in_a, in_b] {
+    Int a = in_a;
+    Int b = in_b;
+    Int a_lo = a & 0xffff;
+    Int b_lo = b & 0xffff;
+
+    Return(a_lo*b_lo + ((shr(a, 16)*b_lo + a_lo*shr(b, 16)) << 16));
+  });
+}
+
+
+/**
+ * Integer division, returning quotient and remainder
+ *
+ * The quotient is estimated with the float reciprocal of the divisor, and subsequently
+ * corrected with integer operations. This is bit-exact with `long_integer_division()`:
+ *
+ * - The sign of the quotient is determined by the signs of the operands
+ * - The remainder is always positive
+ * - Division by zero returns MAX_INT as quotient and zero as remainder
+ *
+ * Input values are assumed to be in the range `-MAX_INT..MAX_INT`.
+ *
+ * ---------------------------------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. The float estimate has a relative error of a couple of ulp's (24-bit mantissa). For large quotients,
+ *    the absolute error can therefore be up to about 2^10. A second estimate on the remainder
+ *    brings this down to +/-2, after which the final steps correct the result exactly.
+ *
+ * 2. The SFU reciprocal is not exact on hardware, a single Newton-Raphson step is used to refine it.
+ *
+ * 3. The first estimate is clamped to the largest float below 2^31, to prevent overflow on conversion to int.
+ */
+void integer_division(Int &Q, Int &R, IntExpr in_a, IntExpr in_b) {
+  Int N = in_a;  comment("Start integer division");
+  Int B = in_b;
+
+  Int sign = 1;
+
+  Where ((N >= 0) != (B >= 0))       // Determine sign
+    sign = -1;
+  End
+
+  N = abs(N);
+  Int D = abs(B);
+
+  Where (D == 0)
+    D = 1;                           // Prevent NaN's, zero divisor handled at the end
+  End
+
+  Float fD  = toFloat(D);
+  Float rcp = recip(fD);
+  rcp = rcp*(2.0f - fD*rcp);         // Newton-Raphson step
+
+  Q = toInt(min(toFloat(N)*rcp, 2147483520.0f));
+  R = N - mul32(Q, D);
+  Q += toInt(toFloat(R)*rcp);
+  R = N - mul32(Q, D);
+
+  for (int i = 0; i < 2; i++) {
+    Where (R < 0)
+      Q -= 1;
+      R += D;
+    End
+  }
+
+  for (int i = 0; i < 2; i++) {
+    Where (R >= D)
+      Q += 1;
+      R -= D;
+    End
+  }
+
+  Where (B == 0)
+    Q = MAX_INT;                     // Indicates infinity
+    R = 0;
+  End
+
+  Where (sign == -1)
+    Q = two_complement(Q);
+  End
+
+  comment("End integer division");
+}
+
+
+namespace {
+
+Function<Int, Int, Int> &quotient_function() {
+  static Function<Int, Int, Int> f("quotient", [] (Int const &a, Int const &b) {
+    Int Q, R;
+    integer_division(Q, R, a, b);
+    Return(Q);
+  });
+
+  return f;
+}
+
+
+Function<Int, Int, Int> &remainder_function() {
+  static Function<Int, Int, Int> f("remainder", [] (Int const &a, Int const &b) {
+    Int Q, R;
+    integer_division(Q, R, a, b);
+    Return(R);
+  });
+
+  return f;
+}
+
+}  // anon namespace
+
+
+/**
+ * Return quotient of integer division.
+ *
+ * Unless inlining is selected with `inline_division()`, the division is
+ * compiled once per kernel and called from every call site.
+ */
+IntExpr quotient(IntExpr a, IntExpr b) {
+  return quotient_function()(a, b);
+}
+
+
+/**
+ * Return remainder of integer division.
+ *
+ * Same as `quotient()`, for the remainder
+ */
+IntExpr remainder(IntExpr a, IntExpr b) {
+  return remainder_function()(a, b);
+}
+
+
+/**
+ * Select inlining of `quotient()` and `remainder()`, for kernels compiled after this call.
+ */
+void inline_division(bool val) {
+  quotient_function().set_inline(val);
+  remainder_function().set_inline(val);
+}
+
+
+/**
+ * Integer division by a compile-time constant, returning quotient and remainder
+ *
+ * Semantics are the same as for the runtime version of `integer_division()`.
+ *
+ * - For powers of two, shift and mask are used
+ * - For other divisors, the quotient is calculated by a multiply-high with a precalculated
+ *   'magic number', followed by a shift. No correction steps are required.
+ *
+ * ---------------------------------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. The magic number is calculated as in Granlund & Montgomery, 'Division by Invariant Integers
+ *    using Multiplication' (1994). Since the dividend is positive (< 2^31), 31 bits of precision
+ *    suffice and the magic number always fits in 32 bits.
+ *
+ * 2. There is no hardware multiply-high, it is composed from 16-bit partial products.
+ */
+void integer_division(Int &Q, Int &R, IntExpr in_a, int b) {
+  if (b == 0 || b == std::numeric_limits<int>::min()) {
+    integer_division(Q, R, in_a, IntExpr(b));
+    return;
+  }
+
+  Int N = in_a;  comment("Start integer division by constant");
+
+  Int sign = 1;
+
+  if (b > 0) {
+    Where (N < 0)
+      sign = -1;
+    End
+  } else {
+    Where (N >= 0)
+      sign = -1;
+    End
+  }
+
+  N = abs(N);
+  uint32_t d = (uint32_t) std::abs(b);
+
+  int shift = 0;
+  while ((1u << shift) < d) shift++;                          // shift = ceil(log2(d))
+
+  if ((1u << shift) == d) {
+    Q = N >> shift;
+    R = N & ((int) d - 1);
+  } else {
+    uint64_t m64 = ((((uint64_t) 1) << (31 + shift)) + d - 1)/d;  // ceil(2^(31 + shift)/d)
+    assert(m64 < (((uint64_t) 1) << 32));
+    uint32_t m = (uint32_t) m64;
+
+    Int m_lo = (int) (m & 0xffff);
+    Int m_hi = (int) (m >> 16);
+    Int n_lo = N & 0xffff;
+    Int n_hi = shr(N, 16);
+
+    Int lo    = n_lo*m_lo;
+    Int mid1  = n_hi*m_lo;
+    Int mid2  = n_lo*m_hi;
+    Int carry = shr(shr(lo, 16) + (mid1 & 0xffff) + (mid2 & 0xffff), 16);
+
+    Q = n_hi*m_hi + shr(mid1, 16) + shr(mid2, 16) + carry;    // Upper 32 bits of N*m
+    Q = shr(Q, shift - 1);
+    R = N - mul32(Q, (int) d);
+  }
+
+  Where (sign == -1)
+    Q = two_complement(Q);
+  End
+
+  comment("End integer division by constant");
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Trigonometric functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -427,6 +662,603 @@ void rotate_sum(Float &input, Float &result) {
 }
 
 
+/**
+ * Determine the minimum of all the vector elements of a register.
+ *
+ * All vector elements of register result will contain the same value.
+ */
+void rotate_min(Int &input, Int &result) {
+  result = input;                          comment("rotate_min");
+  result = min(result, rotate(result, 1));
+  result = min(result, rotate(result, 2));
+  result = min(result, rotate(result, 4));
+  result = min(result, rotate(result, 8));
+}
+
+
+void rotate_min(Float &input, Float &result) {
+  result = input;                          comment("rotate_min");
+  result = min(result, rotate(result, 1));
+  result = min(result, rotate(result, 2));
+  result = min(result, rotate(result, 4));
+  result = min(result, rotate(result, 8));
+}
+
+
+/**
+ * Determine the maximum of all the vector elements of a register.
+ *
+ * All vector elements of register result will contain the same value.
+ */
+void rotate_max(Int &input, Int &result) {
+  result = input;                          comment("rotate_max");
+  result = max(result, rotate(result, 1));
+  result = max(result, rotate(result, 2));
+  result = max(result, rotate(result, 4));
+  result = max(result, rotate(result, 8));
+}
+
+
+void rotate_max(Float &input, Float &result) {
+  result = input;                          comment("rotate_max");
+  result = max(result, rotate(result, 1));
+  result = max(result, rotate(result, 2));
+  result = max(result, rotate(result, 4));
+  result = max(result, rotate(result, 8));
+}
+
+
+/**
+ * Inclusive prefix sum over the vector elements of a register.
+ *
+ * Vector element i of result contains the sum of input elements 0..i inclusive.
+ * This is a log-step scan, 4 steps for 16 elements.
+ */
+void rotate_scan(Int &input, Int &result) {
+  result = input;              comment("rotate_scan");
+
+  for (int k = 1; k < 16; k *= 2) {
+    Int tmp = rotate(result, k);
+    Where (index() >= k)
+      result += tmp;
+    End
+  }
+}
+
+
+void rotate_scan(Float &input, Float &result) {
+  result = input;              comment("rotate_scan");
+
+  for (int k = 1; k < 16; k *= 2) {
+    Float tmp = rotate(result, k);
+    Where (index() >= k)
+      result += tmp;
+    End
+  }
+}
+
+
+namespace {
+
+/**
+ * Load vector `vec` of the array, with elements past `size` set to zero.
+ *
+ * Reads never go past the end of the array.
+ */
+template<typename T>
+void scan_gather(typename T::Ptr const &src, Int const &vec, Int const &size) {
+  Int n = min(16*vec + index(), size - 1);
+  gather(src + (n - index()));
+}
+
+
+template<typename T>
+void scan_receive(T &dst, Int const &vec, Int const &size) {
+  receive(dst);
+
+  Where (16*vec + index() >= size)
+    dst = 0;
+  End
+}
+
+
+/**
+ * Prefix sum over an array, over multiple QPUs.
+ *
+ * The array is divided into contiguous blocks of vectors, one per QPU.
+ * This is done in two passes:
+ *
+ * 1. Every QPU determines the sum of its block, and makes it available to the other QPUs
+ *    via `block_sums` and `flags`.
+ * 2. Every QPU waits for the sums of the preceding blocks, and uses their total as offset
+ *    for the scan of its own block.
+ *
+ * The QPUs only wait on the QPUs with a lower index, so there is no deadlock.
+ */
+template<typename T>
+void array_scan(
+  bool inclusive,
+  typename T::Ptr const &dst,
+  typename T::Ptr const &src,
+  Int const &size,
+  typename T::Ptr const &block_sums,
+  Int::Ptr const &flags
+) {
+  Int num_vecs = (size + 15) >> 4;
+  Int per_qpu;
+  Int dummy;
+  functions::integer_division(per_qpu, dummy, num_vecs + numQPUs() - 1, numQPUs());
+
+  Int start = me()*per_qpu;
+  Int end   = min(start + per_qpu, num_vecs);
+  T carry = 0;
+
+  If (numQPUs() != 1)  // Only first pass for multiple QPUs
+    //
+    // First pass: block sum
+    //
+    T sum = 0;
+    T val;
+    Int vec = start;
+    scan_gather<T>(src, vec, size);
+
+    While (vec < end)
+      scan_receive(val, vec, size);
+      vec++;
+      scan_gather<T>(src, vec, size);
+      sum += val;
+    End
+
+    receive(val);  comment("Discard the last prefetch");
+
+    T block_sum;
+    rotate_sum(sum, block_sum);
+
+    If (me() != numQPUs() - 1)  // Last block sum not needed
+      typename T::Ptr sum_ptr = block_sums + 16*me();
+      *sum_ptr = block_sum;
+      Int::Ptr flag = flags + 16*me();
+      *flag = 1;
+    End
+
+    //
+    // Wait for the preceding blocks and add their sums
+    //
+    If (me() != 0)
+      // Vector element i reads the values of QPU i
+      Int offset = 16*min(index(), numQPUs() - 1) - index();
+
+      Int done = 0;  comment("Wait till the sums of preceding blocks are available");
+      While (any(done == 0))
+        gather(flags + offset);
+        receive(done);
+
+        Where (index() >= me())
+          done = 1;
+        End
+      End
+
+      T preceding;
+      gather(block_sums + offset);
+      receive(preceding);
+
+      Where (index() >= me())
+        preceding = 0;
+      End
+
+      rotate_sum(preceding, carry);
+    End
+  End
+
+  //
+  // Second pass: scan the block
+  //
+  Int vec = start;
+  typename T::Ptr dst_ptr = dst + 16*start;
+  scan_gather<T>(src, vec, size);
+
+  While (vec < end)
+    T val;
+    scan_receive(val, vec, size);
+    vec++;
+    scan_gather<T>(src, vec, size);
+
+    T out;
+    rotate_scan(val, out);
+
+    T vec_sum;
+    rotate_sum(val, vec_sum);
+
+    if (!inclusive) {
+      out = rotate(out, 1);
+      Where (index() == 0)
+        out = 0;
+      End
+    }
+
+    *dst_ptr = out + carry;
+    dst_ptr.inc();
+    carry += vec_sum;
+  End
+
+  T dummy_val;
+  receive(dummy_val);  comment("Discard the last prefetch");
+}
+
+}  // anon namespace
+
+
+/**
+ * Inclusive prefix sum over an array of arbitrary length.
+ *
+ * Element i of dst contains the sum of the elements 0..i of src.
+ *
+ * The output is written in complete vectors; `dst` must have room for `size` rounded up
+ * to a multiple of 16.
+ *
+ * @param block_sums  16 values per QPU, for exchanging the sums of the blocks.
+ * @param flags       16 values per QPU, must be zero at the start of the kernel call.
+ */
+void inclusive_scan(Int::Ptr const &dst, Int::Ptr const &src, Int const &size,
+                    Int::Ptr const &block_sums, Int::Ptr const &flags) {
+  array_scan<Int>(true, dst, src, size, block_sums, flags);
+}
+
+
+void inclusive_scan(Float::Ptr const &dst, Float::Ptr const &src, Int const &size,
+                    Float::Ptr const &block_sums, Int::Ptr const &flags) {
+  array_scan<Float>(true, dst, src, size, block_sums, flags);
+}
+
+
+/**
+ * Exclusive prefix sum over an array of arbitrary length.
+ *
+ * Element i of dst contains the sum of the elements 0..i-1 of src; element 0 is zero.
+ * Same conditions apply as for `inclusive_scan()`.
+ */
+void exclusive_scan(Int::Ptr const &dst, Int::Ptr const &src, Int const &size,
+                    Int::Ptr const &block_sums, Int::Ptr const &flags) {
+  array_scan<Int>(false, dst, src, size, block_sums, flags);
+}
+
+
+void exclusive_scan(Float::Ptr const &dst, Float::Ptr const &src, Int const &size,
+                    Float::Ptr const &block_sums, Int::Ptr const &flags) {
+  array_scan<Float>(false, dst, src, size, block_sums, flags);
+}
+
+
+namespace {
+
+/**
+ * Implementation of the work-queue loop, see `for_each_item()`.
+ */
+template<typename T>
+void item_loop(
+  typename T::Ptr const &dst,
+  Int const &num_items,
+  ItemCallbacks<T> const &loop,
+  int window
+) {
+  assertq(window >= 1, "for_each_item(): window must be at least 1");
+  assertq(loop.init && loop.done && loop.step && loop.result, "for_each_item(): all callbacks must be set");
+
+  Int num_rows = shr(num_items + 15, 4);
+  Int stride   = 16*numQPUs();
+  Int row      = me();                 comment("Lowest row of output which has not been written yet");
+  Int item     = 16*me() + index();    comment("Current item per lane");
+  Int d        = 0;                    // Offset of the current item's row from `row`, in rows of this QPU
+  Int busy     = 0;
+
+  std::vector<T> buf(window);          // Results of the rows which are not complete yet
+  for (int w = 0; w < window; ++w) {
+    buf[w] = 0;
+  }
+
+  Where (item < num_items)
+    busy = 1;
+    loop.init(item);
+  End
+
+  While (any(busy != 0))
+    Int fin = 0;
+    Where (busy != 0 && loop.done())
+      fin = 1;
+    End
+
+    //
+    // Put the results of the finished lanes in the row buffer, and let them move on to the next item
+    //
+    T res = loop.result();
+    for (int w = 0; w < window; ++w) {
+      Where (fin != 0 && d == w)
+        buf[w] = res;
+      End
+    }
+
+    Where (fin != 0)
+      busy = 0;
+      d++;
+      item += stride;
+    End
+
+    Where (busy != 0)
+      loop.step();
+    End
+
+    //
+    // Write out the rows which all lanes have passed
+    //
+    Where (item >= num_items)
+      d = window;                      // Lane has drained, don't let it hold up the output
+    End
+
+    While (all(d > 0 && row < num_rows))
+      *(dst + 16*row) = buf[0];
+      for (int w = 0; w + 1 < window; ++w) {
+        buf[w] = buf[w + 1];
+      }
+
+      Where (item < num_items)
+        d--;
+      End
+
+      row += numQPUs();
+    End
+
+    //
+    // Refill the idle lanes, as long as they are not too far ahead of the output
+    //
+    Where (busy == 0 && d < window && item < num_items)
+      busy = 1;
+      loop.init(item);
+    End
+  End
+}
+
+}  // anon namespace
+
+
+/**
+ * Work-queue loop which refills the lanes of finished items with new items.
+ *
+ * This is intended for loops with a data-dependent number of iterations per item,
+ * such as Mandelbrot. In the usual `While (any(...)) Where (...)` construction, all lanes
+ * keep iterating until the slowest item in the vector is done. Here, a lane which has finished
+ * its item immediately takes the next one, so that the vector stays full until the items run out.
+ *
+ * Items `0..num_items-1` are distributed over the lanes; lane `i` of QPU `q` handles the items
+ * `16*(q + n*numQPUs()) + i` for n = 0, 1, .... The result of item `k` is written to `dst[k]`.
+ *
+ * Per item, the callbacks are used as follows:
+ *
+ *   - `init(item)` - set up the state for a new item
+ *   - `done()`     - return true if the item is finished
+ *   - `step()`     - do one iteration for the item
+ *   - `result()`   - return the result of the item; only used when `done()` is true
+ *
+ * All callbacks are called within a `Where` block for the lanes concerned, and `init()` may be
+ * called before `done()` returns true for the first time. The state used by the callbacks must
+ * therefore be declared and initialized *before* calling this function.
+ *
+ * The output is written in complete vectors; `dst` must have room for `num_items` rounded up
+ * to a multiple of 16.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * There is no masked store in this library; stores always write a complete vector.
+ *   Therefore, the results are collected per lane in a buffer of `window` rows, and a row is written
+ *   when all lanes have passed it. A lane which gets `window` rows ahead of the slowest lane
+ *   waits until the slowest lane finishes its item.
+ *
+ *   A larger window keeps more lanes busy, at the cost of one register per row.
+ *
+ * @param window  number of rows to buffer per QPU
+ */
+void for_each_item(Int::Ptr const &dst, Int const &num_items, ItemCallbacks<Int> const &loop, int window) {
+  item_loop<Int>(dst, num_items, loop, window);
+}
+
+
+void for_each_item(Float::Ptr const &dst, Int const &num_items, ItemCallbacks<Float> const &loop, int window) {
+  item_loop<Float>(dst, num_items, loop, window);
+}
+
+
+namespace {
+
+int const TILE_SEMAPHORE = 14;  // Semaphore 15 is used for kernel termination
+
+
+/**
+ * Get the current value of the tile counter and increment it, with the tile lock taken.
+ *
+ * vc4 version, the lock is a hardware semaphore.
+ *
+ * The counter is read and written with DMA, so that the value is always the one in main memory.
+ * A single row is read, so the DMA read pitch is not used and the setting of the caller is retained.
+ *
+ * The lock is released afterwards, except for the final call of the final QPU, which
+ * leaves the semaphore at zero for the next kernel call.
+ */
+void fetch_tile(Int &tile, Int::Ptr &counter, Int const &last) {
+  semaDec(TILE_SEMAPHORE);         comment("Start fetch tile");
+
+  dmaSetupRead(HORIZ, 1, 16*me());
+  dmaStartRead(counter);
+  dmaWaitRead();
+  vpmSetupRead(HORIZ, 1, me());
+  tile = vpmGetInt();
+
+  *counter = tile + 1;
+  dmaWaitWrite();
+
+  If (tile != last)
+    semaInc(TILE_SEMAPHORE);
+  End
+}
+
+
+/**
+ * Get the current value of the tile counter and increment it, with the tile lock taken.
+ *
+ * Version for v3d, the lock is a mutex in main memory.
+ * All vector elements read the first value of the counter.
+ */
+void fetch_tile(Int &tile, Int::Ptr &counter, Int::Ptr const &mutex) {
+  mutex_lock(mutex);               comment("Start fetch tile");
+
+  gather(counter - index());
+  receive(tile);
+  *counter = tile + 1;
+
+  mutex_unlock(mutex);
+}
+
+
+/**
+ * Store a value and wait until it is written to main memory.
+ *
+ * On v3d, every store is followed by `tmuwt` anyway. On vc4, the DMA write is only
+ * guaranteed to be complete after waiting for it.
+ */
+void store_and_wait(Int::Ptr ptr, IntExpr val) {
+  *ptr = val;
+
+  if (Platform::compiling_for_vc4()) {
+    dmaWaitWrite();
+  }
+}
+
+}  // anon namespace
+
+
+/**
+ * Take a mutex in main memory, for mutual exclusion between the QPUs.
+ *
+ * Intended for v3d, which has no hardware semaphores.
+ * Only plain loads and stores are used, so this works on vc4 and in the interpreter also.
+ *
+ * This is Lamport's bakery algorithm. Every QPU has a vector in `mutex`, all elements of which
+ * contain the same entry: `2*ticket + choosing`. The QPU with the lowest non-zero ticket gets the mutex;
+ * for equal tickets, the QPU with the lowest index.
+ *
+ * The entries of all QPUs are read in a single gather, vector element i reads the entry of QPU i.
+ * The wait ends when no other QPU is choosing a ticket or has a ticket before this one.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * As with `sync_qpus()`, this relies on stores being visible to the loads of the other QPUs.
+ *   The stores of the mutex wait until the write is complete. Stores in the critical section
+ *   are complete when the mutex is released, since a vc4 DMA store waits for the previous one.
+ *
+ * @param mutex  16 values per QPU, must be zero at the start of the kernel call.
+ */
+void mutex_lock(Int::Ptr const &mutex) {
+  Int::Ptr entry = mutex + 16*me();
+  Int offset = 16*min(index(), numQPUs() - 1) - index();  comment("Start mutex lock");
+
+  store_and_wait(entry, 1);        comment("Choosing a ticket");
+
+  Int entries;
+  gather(mutex + offset);
+  receive(entries);
+
+  Int tickets = shr(entries, 1);
+  Int ticket;
+  rotate_max(tickets, ticket);
+  ticket = ticket + 1;
+  store_and_wait(entry, 2*ticket); comment("Ticket chosen");
+
+  Int wait = 1;
+  While (any(wait != 0))
+    gather(mutex + offset);
+    receive(entries);
+
+    tickets = shr(entries, 1);
+    wait = entries & 1;
+
+    Where (tickets != 0 && (tickets < ticket || (tickets == ticket && index() < me())))
+      wait = 1;
+    End
+  End
+}
+
+
+/**
+ * Release a mutex taken with `mutex_lock()`.
+ */
+void mutex_unlock(Int::Ptr const &mutex) {
+  store_and_wait(mutex + 16*me(), 0);
+}
+
+
+/**
+ * Loop over tiles, with the tiles distributed dynamically over the QPUs.
+ *
+ * Each QPU takes the next tile from a counter in shared memory when it is ready with its previous tile.
+ * This balances the load for irregular workloads, where static distribution by `me()`
+ * would let one QPU handle the tail.
+ *
+ * `f(tile)` is called for every tile `0..num_tiles-1` exactly once, on any QPU.
+ * All lanes of `tile` have the same value.
+ *
+ * `counter` must have room for `16*(1 + numQPUs())` values. The first vector is the counter,
+ * the rest is the mutex for v3d. All values must be set to zero by the host before each kernel call.
+ * After the call, the counter contains `num_tiles + numQPUs()`.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * On vc4, the counter is protected by a hardware semaphore, which is used as a mutex.
+ *   QPU 0 releases the mutex at the start; the final access to the counter leaves the semaphore
+ *   at zero, so that it is in the initial state for the next call.
+ *   Only one loop can be active at a time.
+ *
+ * * v3d has no semaphores. There, the counter is protected by a mutex in main memory,
+ *   see `mutex_lock()`. TMU atomics are not supported by this library.
+ *
+ * * The emulator runs the QPUs in lockstep, one instruction per QPU.
+ *   The distribution of tiles is therefore deterministic there.
+ *   The interpreter does not support DMA, and can therefore not run this on vc4.
+ */
+void for_each_tile(Int::Ptr counter, IntExpr num_tiles, std::function<void(Int const &tile)> f) {
+  Int n = num_tiles;
+  Int tile = 0;
+
+  if (!Platform::compiling_for_vc4()) {
+    Int::Ptr mutex = counter + 16;
+
+    fetch_tile(tile, counter, mutex);
+
+    While (tile < n)
+      f(tile);
+      fetch_tile(tile, counter, mutex);
+    End
+    return;
+  }
+
+  Int last = n + numQPUs() - 1;    comment("Final value of counter to be fetched");
+
+  If (me() == 0)
+    semaInc(TILE_SEMAPHORE);       comment("Initial release of tile lock");
+  End
+
+  fetch_tile(tile, counter, last);
+
+  While (tile < n)
+    f(tile);
+    fetch_tile(tile, counter, last);
+  End
+}
+
+
 /**
  * Set value of src to vector element 'n' of dst
  *
@@ -2,6 +2,7 @@
 #define _V3DLIB_SOURCE_FUNCTIONS_H_
 #include "Int.h"
 #include "Float.h"
+#include "Cond.h"
 #include "StmtStack.h"  // StackCallback
 
 namespace V3DLib {
@@ -16,7 +17,13 @@ FloatExpr create_float_function_snippet(StackCallback f);
 IntExpr two_complement(IntExpr a);
 IntExpr abs(IntExpr a);
 IntExpr topmost_bit(IntExpr in_a);
+IntExpr mul32(IntExpr in_a, IntExpr in_b);
+void long_integer_division(Int &quotient, Int &remainder, IntExpr in_a, IntExpr in_b);
 void integer_division(Int &quotient, Int &remainder, IntExpr in_a, IntExpr in_b);
+void integer_division(Int &quotient, Int &remainder, IntExpr in_a, int b);
+IntExpr quotient(IntExpr a, IntExpr b);
+IntExpr remainder(IntExpr a, IntExpr b);
+void inline_division(bool val);
 
 inline IntExpr operator-(IntExpr a) { return two_complement(a); }
 
@@ -35,10 +42,42 @@ FloatExpr fabs(FloatExpr x);
 
 void rotate_sum(Int &input, Int &result);
 void rotate_sum(Float &input, Float &result);
+void rotate_min(Int &input, Int &result);
+void rotate_min(Float &input, Float &result);
+void rotate_max(Int &input, Int &result);
+void rotate_max(Float &input, Float &result);
+void rotate_scan(Int &input, Int &result);
+void rotate_scan(Float &input, Float &result);
 void set_at(Int &dst, Int n, Int const &src);
 void set_at(Float &dst, Int n, Float const &src);
 
 void sync_qpus(Int::Ptr signal);
+void mutex_lock(Int::Ptr const &mutex);
+void mutex_unlock(Int::Ptr const &mutex);
+
+void inclusive_scan(Int::Ptr const &dst, Int::Ptr const &src, Int const &size,
+                    Int::Ptr const &block_sums, Int::Ptr const &flags);
+void inclusive_scan(Float::Ptr const &dst, Float::Ptr const &src, Int const &size,
+                    Float::Ptr const &block_sums, Int::Ptr const &flags);
+void exclusive_scan(Int::Ptr const &dst, Int::Ptr const &src, Int const &size,
+                    Int::Ptr const &block_sums, Int::Ptr const &flags);
+void exclusive_scan(Float::Ptr const &dst, Float::Ptr const &src, Int const &size,
+                    Float::Ptr const &block_sums, Int::Ptr const &flags);
+
+/**
+ * Callbacks for the work items of `for_each_item()`
+ */
+template<typename T>
+struct ItemCallbacks {
+  std::function<void(Int const &item)> init;
+  std::function<BoolExpr()>            done;
+  StackCallback                        step;
+  std::function<T()>                   result;
+};
+
+void for_each_item(Int::Ptr const &dst, Int const &num_items, ItemCallbacks<Int> const &loop, int window = 4);
+void for_each_item(Float::Ptr const &dst, Int const &num_items, ItemCallbacks<Float> const &loop, int window = 4);
+void for_each_tile(Int::Ptr counter, IntExpr num_tiles, std::function<void(Int const &tile)> f);
 
 }  // namespace V3DLib
 
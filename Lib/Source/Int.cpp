@@ -164,15 +164,23 @@ IntExpr ror(IntExpr a, IntExpr b)        { return mkIntApply(a, Op(ROR,  INT32),
  *
  * Integer division is costly; should you need both quotient and remainder,
  * It is better to call integer_division() directly.
+ *
+ * Division by a literal value is much cheaper than division by a variable, and is inlined.
+ * Division by a variable is done with an out-of-line function call.
  */
 IntExpr operator/(IntExpr a, IntExpr b) {
   // b == 0 a bad idea, assert() won't work for testing
-  using functions::integer_division;
+  if (b.expr()->tag() != Expr::INT_LIT) {
+    return functions::quotient(a, b);
+  }
+
   Int quotient;
   Int remainder;
-  integer_division(quotient, remainder, a, b);
+  functions::integer_division(quotient, remainder, a, b.expr()->intLit);
   return quotient;
 }
+
+
 /**
  * Return remainder of values
  *
@@ -181,10 +189,13 @@ IntExpr operator/(IntExpr a, IntExpr b) {
  */
 IntExpr operator%(IntExpr a, IntExpr b) {
   // b == 0 a bad idea, assert() won't work for testing
-  using functions::integer_division;
+  if (b.expr()->tag() != Expr::INT_LIT) {
+    return functions::remainder(a, b);
+  }
+
   Int quotient;
   Int remainder;
-  integer_division(quotient, remainder, a, b);
+  functions::integer_division(quotient, remainder, a, b.expr()->intLit);
   return remainder;
 }
 
@@ -14,7 +14,8 @@ namespace V3DLib {
 enum ReservedVarId : VarId {
   RSV_QPU_ID   = 0,
   RSV_NUM_QPUS = 1,
-  RSV_DEVNULL  = 2
+  RSV_DEVNULL  = 2,  // v3d only
+  RSV_FINISH   = 2   // vc4 only, termination count, see `QpuRange::finish()`
 };
 
 template <typename T> struct Deref; // Forward declaration template class
@@ -29,7 +30,8 @@ template <typename T> struct Deref; // Forward declaration template class
  * both the LHS and RHS of an assignment.
  */
 struct Int : public BaseExpr {
-  using Array = V3DLib::SharedArray<int>;
+  using Array   = V3DLib::SharedArray<int>;
+  using Array2D = V3DLib::Shared2DArray<int>;
   using Ptr   = V3DLib::ptr::Ptr<Int>;
 
   Int();
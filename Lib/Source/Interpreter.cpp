@@ -2,6 +2,7 @@
 #include <algorithm>  // reverse()
 #include "Common/SharedArray.h"
 #include "Source/Stmt.h"
+#include "Source/Function.h"
 #include "Common/BufferObject.h"
 #include "Target/EmuSupport.h"
 #include "Support/basics.h"
@@ -12,12 +13,16 @@ using ::operator<<;  // C++ weirdness
 
 namespace {
 
+// Total number of statements executed in the current thread, for benchmarking.
+// Per thread, because kernels may be interpreted concurrently (see `TaskGraph`)
+thread_local uint64_t statement_count = 0;
+
 Vec const Always(1);
 
 // State of a single core.
 struct CoreState {
   int id;                        // Core id
-  int nextUniform = -2;          // Pointer to next uniform to read
+  int nextUniform = -EmuState::NUM_HEADER_UNIFORMS;  // Pointer to next uniform to read
   Seq<Vec> loadBuffer;           // Load buffer
 
   int readStride = 0;            // Read stride
@@ -54,20 +59,20 @@ private:
   Vec *m_env  = nullptr;      // Environment mapping vars to values
   int sizeEnv = -1;           // Size of the environment
 
-  static int load_show_count;
-  static int store_show_count;
+  static thread_local int load_show_count;
+  static thread_local int store_show_count;
 };
 
 
-int CoreState::load_show_count = 0;
-int CoreState::store_show_count = 0;
+thread_local int CoreState::load_show_count = 0;
+thread_local int CoreState::store_show_count = 0;
 
 
 // State of the Interpreter.
 struct InterpreterState : public EmuState {
   CoreState core[MAX_QPUS];  // State of each core
 
-  InterpreterState(int in_num_qpus, IntList const &in_uniforms) : EmuState(in_num_qpus, in_uniforms) {} 
+  InterpreterState(QpuRange const &in_qpus, IntList const &in_uniforms) : EmuState(in_qpus, in_uniforms) {}
 };
 
 
@@ -374,6 +379,27 @@ Vec vecAnd(Vec x, Vec y) {
 // ============================================================================
 
 void execWhere(InterpreterState &is, CoreState *s, Vec cond, Stmt::Ptr stmt);
+void exec(InterpreterState &is, int core_index);
+void append_stack(CoreState &s, Stmt::Array const &stmts);
+
+
+/**
+ * Execute a call of an out-of-line function.
+ *
+ * The arguments are assigned to the parameters for all lanes, and the body
+ * is put on the stack for execution.
+ */
+void execCall(InterpreterState &is, CoreState *s, Stmt const &stmt) {
+  auto f = stmt.function();
+  auto const &args = stmt.call_args();
+  assert(args.size() == f->params.size());
+
+  for (int i = 0; i < (int) args.size(); i++) {
+    execAssign(is, s, Always, mkVar(f->params[i]), args[i]);
+  }
+
+  append_stack(*s, f->body);
+}
 
 
 void execWhere(InterpreterState &is, CoreState *s, Vec cond, Stmt::Array const &stmts) {
@@ -413,8 +439,21 @@ void execWhere(InterpreterState &is, CoreState *s, Vec cond, Stmt::Ptr stmt) {
       return;
     }
 
+    // Function call
+    case Stmt::CALL: {
+      // The body is run to completion for all lanes, only the assignment of the result
+      // is subject to the where-condition
+      auto depth = s->stack.size();
+      execCall(is, s, *stmt);
+
+      while (s->stack.size() > depth) {
+        exec(is, s->id);
+      }
+      return;
+    }
+
     default:
-      assertq(false, "V3DLib: only assignments and nested 'where' statements can occur in a 'where' statement");
+      assertq(false, "V3DLib: only assignments, function calls and nested 'where' statements can occur in a 'where' statement");
       return;
   }
 }
@@ -487,6 +526,7 @@ void append_stack(CoreState &s, Stmt::Array const &stmts) {
 void exec(InterpreterState &is, int core_index) {
   CoreState *s = &is.core[core_index];
   assert(s->stack.size() > 0);
+  statement_count++;
 
   // Get next statement
   Stmt::Ptr stmt = s->stack.back();
@@ -497,6 +537,10 @@ void exec(InterpreterState &is, int core_index) {
     return;
   }
 
+  if (stmt->tag != Stmt::SEMA_INC && stmt->tag != Stmt::SEMA_DEC) {
+    is.reset_semaphore_wait();  // Not stuck as long as some QPU makes progress
+  }
+
   if (stmt->do_break_point()) {
 #ifdef DEBUG
     printf("Interpreter: hit breakpoint for stmt: %s\n", stmt->dump().c_str());
@@ -539,6 +583,10 @@ void exec(InterpreterState &is, int core_index) {
       }
       break;
 
+    case Stmt::CALL:
+      execCall(is, s, *stmt);
+      break;
+
     case Stmt::LOAD_RECEIVE:
       execLoadReceive(s, stmt->address());
       break;
@@ -568,7 +616,7 @@ void exec(InterpreterState &is, int core_index) {
  * difference is that the interpreter operates on source code and the
  * emulator on target code.
  *
- * @param numCores  Number of cores active
+ * @param qpus      Cores to run, with their logical id's
  * @param stmt      Source code
  * @param numVars   Max var id used in source
  * @param uniforms  Kernel parameters
@@ -576,13 +624,15 @@ void exec(InterpreterState &is, int core_index) {
  * @param output    Output from print statements (if NULL, stdout is used)
  */
 void interpreter(
-  int numCores,
+  QpuRange const &qpus,
   Stmts const &stmts,
   int numVars,
   IntList &uniforms,
   BufferObject &heap
 ) {
-  InterpreterState state(numCores, uniforms);
+  assert(qpus.count <= MAX_QPUS);
+  int numCores = qpus.count;
+  InterpreterState state(qpus, uniforms);
 
   // Initialise state
   for (int i = 0; i < numCores; i++) {
@@ -615,4 +665,14 @@ void interpreter(
   }
 }
 
+
+/**
+ * Get the total number of statements executed by the interpreter, over all cores and calls.
+ *
+ * Intended for benchmarking; take the difference of two calls.
+ */
+uint64_t interpreted_statement_count() {
+  return statement_count;
+}
+
 }  // namespace V3DLib
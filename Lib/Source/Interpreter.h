@@ -2,6 +2,7 @@
 #define _V3DLIB_INTERPRETER_H_
 #include <stdint.h>
 #include "../Source/Stmt.h"
+#include "../Common/QpuRange.h"
 
 namespace V3DLib {
 
@@ -11,13 +12,15 @@ template<typename T>
 class Seq;
 
 void interpreter(
-  int numCores,
+  QpuRange const &qpus,
   Stmts const &stmts,
   int numVars,
   IntList &uniforms,
   BufferObject &heap
 );
 
+uint64_t interpreted_statement_count();
+
 }  // namespace V3DLib
 
 #endif  // _V3DLIB_INTERPRETER_H_
@@ -0,0 +1,364 @@
+///////////////////////////////////////////////////////////////////////////////
+// Math functions with precision tiers
+//
+// Meaning of the tiers per function:
+//
+//  | Function       | FAST                  | NEWTON                     | FULL                            |
+//  |----------------|-----------------------|----------------------------|---------------------------------|
+//  | recip, div     | SFU recip             | one Newton-Raphson step    | two steps, residual correction  |
+//  | rsqrt, sqrt    | SFU recipsqrt         | one Newton-Raphson step    | two steps, residual correction  |
+//  | exp2, log2     | SFU exp/log           | same as FAST (1)           | range reduction + polynomial    |
+//  | pow            | exp2(y*log2(x)), with the tier passed on                                             |
+//  | atan2          | 3rd order polynomial  | 9th order polynomial       | 17th order polynomial           |
+//  | asin, acos     | atan2 and sqrt, with the tier passed on                                             |
+//  | tanh           | SFU exp               | SFU exp, series near zero  | FULL exp2, series near zero     |
+//
+// (1) There is no Newton-Raphson step for the SFU exp/log which doesn't depend on the
+//     precision of the other SFU function.
+//
+// Everything is generated inline, as with `functions::cos()`. These functions can therefore
+// not be called within a `Where`-block.
+//
+// Special values (NaN's, Inf's) are not handled.
+///////////////////////////////////////////////////////////////////////////////
+#include "Math.h"
+#include <vector>
+#include "Functions.h"  // fabs(), ffloor()
+#include "Lang.h"       // Where
+#include "Support/basics.h"
+
+namespace V3DLib {
+namespace functions {
+namespace {
+
+float const PI    = 3.14159265358979f;
+float const LN2   = 0.693147180559945f;
+float const LOG2E = 1.44269504088896f;
+float const SQRT2 = 1.41421356237310f;
+
+
+/**
+ * Evaluate a polynomial with Horner's rule
+ *
+ * @param coeffs  coefficients, highest order first
+ */
+FloatExpr horner(Float const &x, std::vector<float> const &coeffs) {
+  assert(coeffs.size() >= 2);
+
+  Float ret = coeffs[0]*x + coeffs[1];
+
+  for (int i = 2; i < (int) coeffs.size(); i++) {
+    ret = ret*x + coeffs[i];
+  }
+
+  return ret;
+}
+
+
+IntExpr bits(Float const &x) {
+  return FloatExpr(x).as_int();
+}
+
+}  // anon namespace
+
+
+char const *precision_name(Precision prec) {
+  switch (prec) {
+    case FAST:   return "fast";
+    case NEWTON: return "newton";
+    case FULL:   return "full";
+  }
+
+  assert(false);
+  return "";
+}
+
+
+/**
+ * Reciprocal
+ *
+ * Division by zero is not handled.
+ */
+FloatExpr recip(FloatExpr x_in, Precision prec) {
+  if (prec == FAST) return V3DLib::recip(x_in);
+
+  Float x = x_in;
+  Float r = V3DLib::recip(x);  comment("Start recip");
+  r = r*(2.0f - x*r);
+
+  if (prec == FULL) {
+    r = r*(2.0f - x*r);
+    r = r + r*(1.0f - x*r);
+  }
+
+  return r;
+}
+
+
+/**
+ * Float division
+ *
+ * For FULL, the quotient is corrected with the residual of the division,
+ * which makes it exact to about an ulp.
+ */
+FloatExpr div(FloatExpr a, FloatExpr b, Precision prec) {
+  if (prec == FAST) return a*V3DLib::recip(b);
+
+  Float n = a;
+  Float d = b;
+  Float r = recip(d, prec);
+  Float q = n*r;
+
+  if (prec == FULL) {
+    q = q + r*(n - d*q);
+  }
+
+  return q;
+}
+
+
+/**
+ * Reciprocal square root
+ */
+FloatExpr rsqrt(FloatExpr x_in, Precision prec) {
+  if (prec == FAST) return recipsqrt(x_in);
+
+  Float x = x_in;
+  Float y = recipsqrt(x);  comment("Start rsqrt");
+  y = y*(1.5f - 0.5f*x*y*y);
+
+  if (prec == FULL) {
+    y = y*(1.5f - 0.5f*x*y*y);
+  }
+
+  return y;
+}
+
+
+/**
+ * Square root
+ *
+ * Returns zero for negative input.
+ */
+FloatExpr sqrt(FloatExpr x_in, Precision prec) {
+  Float x = x_in;
+  Float y = rsqrt(x, prec);
+  Float s = x*y;            comment("Start sqrt");
+
+  if (prec == FULL) {
+    s = s + 0.5f*y*(x - s*s);
+  }
+
+  Where (x <= 0.0f)
+    s = 0.0f;
+  End
+
+  return s;
+}
+
+
+/**
+ * Power of two
+ *
+ * For FULL, the input is split into an integer n and a fraction f in -0.5..0.5.
+ * 2^f is calculated with a Taylor polynomial of e^(f*ln(2)), and the exponent n is added
+ * to the exponent bits of the result.
+ *
+ * Inputs below -126 return zero (no denormals).
+ */
+FloatExpr exp2(FloatExpr x_in, Precision prec) {
+  if (prec != FULL) return V3DLib::exp(x_in);
+
+  Float x_orig = x_in;
+  Float x = min(max(x_orig, -126.0f), 128.0f);  comment("Start exp2");
+  Int   n = toInt(x + 128.5f) - 128;            // Round to nearest; toInt() truncates, so keep the value positive
+  Float f = (x - toFloat(n))*LN2;
+  Float p = horner(f, {1.0f/5040, 1.0f/720, 1.0f/120, 1.0f/24, 1.0f/6, 0.5f, 1.0f, 1.0f});
+
+  Float ret;
+  ret.as_float(bits(p) + (n << 23));
+
+  Where (x_orig < -126.0f)
+    ret = 0.0f;
+  End
+
+  return ret;
+}
+
+
+/**
+ * Logarithm base 2
+ *
+ * For FULL, the input is split into an exponent e and a mantissa m in sqrt(0.5)..sqrt(2).
+ * ln(m) is calculated with the series of 2*atanh((m - 1)/(m + 1)).
+ *
+ * Input must be positive.
+ */
+FloatExpr log2(FloatExpr x_in, Precision prec) {
+  if (prec != FULL) return V3DLib::log(x_in);
+
+  Float x = x_in;
+  Int   b = bits(x);                                       comment("Start log2");
+  Int   e = (b >> 23) - 127;
+  Float m;
+  m.as_float((b & 0x007fffff) | 0x3f800000);               // Mantissa in range 1..2
+
+  Where (m > SQRT2)
+    m = 0.5f*m;
+    e = e + 1;
+  End
+
+  Float t  = div(m - 1.0f, m + 1.0f, FULL);
+  Float t2 = t*t;
+
+  // Coefficients of the series, multiplied by 2/ln(2) to get log2
+  float const C = 2*LOG2E;
+  return toFloat(e) + t*horner(t2, {C/9, C/7, C/5, C/3, C});
+}
+
+
+/**
+ * x to the power y
+ *
+ * Calculated as exp2(y*log2(x)). The relative error of log2 is multiplied by y*log2(x),
+ * so the result is less precise than the separate functions for large exponents.
+ *
+ * Returns zero for non-positive x.
+ */
+FloatExpr pow(FloatExpr x_in, FloatExpr y, Precision prec) {
+  Float x   = x_in;
+  Float ret = exp2(y*log2(x, prec), prec);
+
+  Where (x <= 0.0f)
+    ret = 0.0f;
+  End
+
+  return ret;
+}
+
+
+/**
+ * Arc tangent of y/x, using the signs of both to determine the quadrant.
+ *
+ * The ratio of the smaller and larger of |x| and |y| is taken, in range 0..1,
+ * and atan() of this is approximated with a polynomial:
+ *
+ *   - FAST   - max error 1.5e-3 rad [Rajan et al., 'Efficient approximations for the arctangent function' (2006)]
+ *   - NEWTON - max error 1e-5 rad   [Abramowitz and Stegun, 4.4.47]
+ *   - FULL   - max error 2e-8 rad   [Abramowitz and Stegun, 4.4.49]
+ *
+ * Returns zero if both x and y are zero.
+ */
+FloatExpr atan2(FloatExpr y_in, FloatExpr x_in, Precision prec) {
+  Float y  = y_in;
+  Float x  = x_in;
+  Float ax = fabs(x);
+  Float ay = fabs(y);
+  Float hi = max(ax, ay);
+  Float lo = min(ax, ay);
+  Float a  = div(lo, hi, prec);  comment("Start atan2");
+
+  Where (hi == 0.0f)
+    a = 0.0f;
+  End
+
+  Float r;
+
+  switch (prec) {
+    case FAST:
+      r = a*(PI/4 + (1.0f - a)*(0.2447f + 0.0663f*a));
+      break;
+    case NEWTON: {
+      Float a2 = a*a;
+      r = a*horner(a2, {0.0208351f, -0.0851330f, 0.1801410f, -0.3302995f, 0.9998660f});
+    }
+    break;
+    case FULL: {
+      Float a2 = a*a;
+      r = a*horner(a2, {
+        0.0028662257f, -0.0161657367f, 0.0429096138f, -0.0752896400f,
+        0.1065626393f, -0.1420889944f, 0.1999355085f, -0.3333314528f, 1.0f
+      });
+    }
+    break;
+  }
+
+  Where (ay > ax)
+    r = PI/2 - r;
+  End
+
+  Where (x < 0.0f)
+    r = PI - r;
+  End
+
+  Where (y < 0.0f)
+    r = 0.0f - r;
+  End
+
+  return r;
+}
+
+
+/**
+ * Arc sine, calculated as atan2(x, sqrt(1 - x^2))
+ *
+ * Input must be in range -1..1.
+ */
+FloatExpr asin(FloatExpr x_in, Precision prec) {
+  Float x = x_in;
+  Float c = sqrt((1.0f - x)*(1.0f + x), prec);
+  return atan2(x, c, prec);
+}
+
+
+/**
+ * Arc cosine, calculated as atan2(sqrt(1 - x^2), x)
+ *
+ * Input must be in range -1..1.
+ */
+FloatExpr acos(FloatExpr x_in, Precision prec) {
+  Float x = x_in;
+  Float s = sqrt((1.0f - x)*(1.0f + x), prec);
+  return atan2(s, x, prec);
+}
+
+
+/**
+ * Hyperbolic tangent, calculated as (1 - e)/(1 + e) with e = exp(-2|x|)
+ *
+ * For small |x|, this suffers from cancellation. Except for FAST,
+ * a Taylor series is used instead in this range.
+ */
+FloatExpr tanh(FloatExpr x_in, Precision prec) {
+  Float x  = x_in;
+  Float ax = fabs(x);
+  Float e  = exp2((-2.0f*LOG2E)*ax, prec);  comment("Start tanh");
+  Float r  = div(1.0f - e, 1.0f + e, prec);
+
+  if (prec != FAST) {
+    Float x2 = ax*ax;
+    Float s;
+    float limit;
+
+    if (prec == NEWTON) {
+      limit = 0.1f;
+      s = ax*horner(x2, {2.0f/15, -1.0f/3, 1.0f});
+    } else {
+      limit = 0.3f;
+      s = ax*horner(x2, {-1382.0f/155925, 62.0f/2835, -17.0f/315, 2.0f/15, -1.0f/3, 1.0f});
+    }
+
+    Where (ax < limit)
+      r = s;
+    End
+  }
+
+  Where (x < 0.0f)
+    r = 0.0f - r;
+  End
+
+  return r;
+}
+
+}  // namespace functions
+}  // namespace V3DLib
@@ -0,0 +1,38 @@
+#ifndef _V3DLIB_SOURCE_MATH_H_
+#define _V3DLIB_SOURCE_MATH_H_
+#include "Int.h"
+#include "Float.h"
+
+namespace V3DLib {
+namespace functions {
+
+/**
+ * Precision tiers for the math functions.
+ *
+ * A lower tier generates less code and is faster, at the cost of accuracy.
+ * What each tier means for a specific function is described in `Math.cpp`.
+ */
+enum Precision {
+  FAST,    // Use the SFU result directly, or a low-order approximation
+  NEWTON,  // Refine the SFU result with one Newton-Raphson step, or a medium-order approximation
+  FULL     // Full float accuracy, within a couple of ulp
+};
+
+char const *precision_name(Precision prec);
+
+FloatExpr recip(FloatExpr x, Precision prec);
+FloatExpr div(FloatExpr a, FloatExpr b, Precision prec = NEWTON);
+FloatExpr rsqrt(FloatExpr x, Precision prec = NEWTON);
+FloatExpr sqrt(FloatExpr x, Precision prec = NEWTON);
+FloatExpr exp2(FloatExpr x, Precision prec = NEWTON);
+FloatExpr log2(FloatExpr x, Precision prec = NEWTON);
+FloatExpr pow(FloatExpr x, FloatExpr y, Precision prec = NEWTON);
+FloatExpr atan2(FloatExpr y, FloatExpr x, Precision prec = NEWTON);
+FloatExpr asin(FloatExpr x, Precision prec = NEWTON);
+FloatExpr acos(FloatExpr x, Precision prec = NEWTON);
+FloatExpr tanh(FloatExpr x, Precision prec = NEWTON);
+
+}  // namespace functions
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_SOURCE_MATH_H_
@@ -0,0 +1,220 @@
+#include "Packed.h"
+#include <cstring>
+#include "Lang.h"
+#include "Support/debug.h"
+
+namespace V3DLib {
+
+namespace {
+
+int const HALF_EXP_OFFSET = (127 - 15);  // Difference in exponent bias between float and half
+int const HALF_MIN_NORMAL = 0x38800000;  // Bit pattern of smallest normal half as float, 2^-14
+int const HALF_INF        = 0x7c00;
+int const HALF_NAN        = 0x7e00;
+int const FLOAT_INF       = 0x7f800000;
+
+
+/**
+ * Clamp the values to given range
+ */
+IntExpr saturate(IntExpr val, int min_val, int max_val) {
+  return min(max(val, min_val), max_val);
+}
+
+}  // anon namespace
+
+
+// ============================================================================
+// Class UInt8
+// ============================================================================
+
+UInt8::UInt8(Deref<UInt8> d) : Int(IntExpr(d.expr())) {}
+
+
+UInt8 &UInt8::operator=(UInt8 const &rhs) {
+  Int::operator=(rhs);
+  return *this;
+}
+
+
+/**
+ * Get value `n` of every word, zero-extended
+ */
+IntExpr UInt8::unpack(int n) const {
+  assert(0 <= n && n < PER_WORD);
+  if (n == 0) return (*this) & 0xff;
+  if (n == PER_WORD - 1) return shr(*this, 8*n);
+  return shr(*this, 8*n) & 0xff;
+}
+
+
+/**
+ * Combine the values into words.
+ *
+ * Values outside of the range 0..255 are saturated.
+ */
+void UInt8::pack(IntExpr v0, IntExpr v1, IntExpr v2, IntExpr v3) {
+  Int::operator=(saturate(v0, 0, 255)
+              | (saturate(v1, 0, 255) << 8)
+              | (saturate(v2, 0, 255) << 16)
+              | (saturate(v3, 0, 255) << 24));
+}
+
+
+// ============================================================================
+// Class Int16
+// ============================================================================
+
+Int16::Int16(Deref<Int16> d) : Int(IntExpr(d.expr())) {}
+
+
+Int16 &Int16::operator=(Int16 const &rhs) {
+  Int::operator=(rhs);
+  return *this;
+}
+
+
+/**
+ * Get value `n` of every word, sign-extended
+ */
+IntExpr Int16::unpack(int n) const {
+  assert(0 <= n && n < PER_WORD);
+  if (n == 0) return ((*this) << 16) >> 16;
+  return (*this) >> 16;
+}
+
+
+/**
+ * Combine the values into words.
+ *
+ * Values outside of the range -32768..32767 are saturated.
+ */
+void Int16::pack(IntExpr v0, IntExpr v1) {
+  Int::operator=((saturate(v0, -32768, 32767) & 0xffff) | (saturate(v1, -32768, 32767) << 16));
+}
+
+
+// ============================================================================
+// Class Half
+// ============================================================================
+
+Half::Half(Deref<Half> d) : Int(IntExpr(d.expr())) {}
+
+
+Half &Half::operator=(Half const &rhs) {
+  Int::operator=(rhs);
+  return *this;
+}
+
+
+/**
+ * Get value `n` of every word, converted to float
+ */
+FloatExpr Half::unpack(int n) const {
+  assert(0 <= n && n < PER_WORD);
+
+  Int h;
+  if (n == 0) {
+    h = (*this) & 0xffff;
+  } else {
+    h = shr(*this, 16);
+  }
+
+  Int abs_h = h & 0x7fff;
+  Int bits  = (abs_h << 13) + (HALF_EXP_OFFSET << 23);
+
+  Where (abs_h < 0x0400)      // Zero and subnormals
+    bits = 0;
+  End
+
+  Where (abs_h >= HALF_INF)   // Infinity and NaN
+    bits = (abs_h << 13) | FLOAT_INF;
+  End
+
+  Float ret;
+  ret.as_float(bits | ((h & 0x8000) << 16));
+  return ret;
+}
+
+
+/**
+ * Convert the values to half and combine them into words.
+ */
+void Half::pack(FloatExpr v0, FloatExpr v1) {
+  auto convert = [] (FloatExpr val) -> IntExpr {
+    Int bits  = val.as_int();
+    Int abs_f = bits & 0x7fffffff;
+    Int h     = shr(abs_f + 0x1000, 13) - (HALF_EXP_OFFSET << 10);
+
+    Where (abs_f + 0x1000 < HALF_MIN_NORMAL)  // Underflow after rounding
+      h = 0;
+    End
+
+    Where (h >= HALF_INF)                     // Overflow, also infinity
+      h = HALF_INF;
+    End
+
+    Where (abs_f > FLOAT_INF)
+      h = HALF_NAN;
+    End
+
+    return h | (shr(bits, 16) & 0x8000);
+  };
+
+  Int lo = convert(v0);
+  Int hi = convert(v1);
+  Int::operator=(lo | (hi << 16));
+}
+
+
+// ============================================================================
+// Host-side conversions
+// ============================================================================
+
+/**
+ * Convert a float to a half, with the same rounding as `Half::pack()`
+ */
+uint16_t to_half(float val) {
+  uint32_t bits;
+  memcpy(&bits, &val, sizeof(bits));
+
+  uint32_t abs_f = bits & 0x7fffffff;
+  uint32_t sign  = (bits >> 16) & 0x8000;
+  uint32_t h;
+
+  if (abs_f > (uint32_t) FLOAT_INF) {
+    h = HALF_NAN;
+  } else if (abs_f + 0x1000 < (uint32_t) HALF_MIN_NORMAL) {
+    h = 0;
+  } else {
+    h = ((abs_f + 0x1000) >> 13) - (HALF_EXP_OFFSET << 10);
+    if (h >= (uint32_t) HALF_INF) h = HALF_INF;
+  }
+
+  return (uint16_t) (h | sign);
+}
+
+
+/**
+ * Convert a half to a float, with the same handling of special values as `Half::unpack()`
+ */
+float from_half(uint16_t val) {
+  uint32_t abs_h = val & 0x7fffu;
+  uint32_t bits;
+
+  if (abs_h < 0x0400) {
+    bits = 0;
+  } else if (abs_h >= (uint32_t) HALF_INF) {
+    bits = (abs_h << 13) | (uint32_t) FLOAT_INF;
+  } else {
+    bits = (abs_h << 13) + (HALF_EXP_OFFSET << 23);
+  }
+
+  bits |= ((uint32_t) (val & 0x8000)) << 16;
+
+  float ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+}  // namespace V3DLib
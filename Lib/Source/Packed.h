@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// This module defines packed vector types, with multiple narrow values
+// per 32-bit vector element.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _V3DLIB_SOURCE_PACKED_H_
+#define _V3DLIB_SOURCE_PACKED_H_
+#include <cstdint>
+#include "Int.h"
+#include "Float.h"
+
+namespace V3DLib {
+
+/**
+ * Packed vector of 8-bit unsigned values.
+ *
+ * A packed vector is a vector of 16 32-bit words, with 4 values per word.
+ * It is loaded and stored like an `Int`, so a load or store moves 64 values.
+ * This is intended for kernels which are bound by memory bandwidth, e.g. image processing.
+ *
+ * Calculations are done on the unpacked values:
+ *
+ *   - `unpack(n)` returns value `n` of every word; in terms of the array, lane `i` of the result
+ *     is value `4*i + n` relative to the start of the vector.
+ *   - `pack()` combines four vectors of values into words, in the same order.
+ *
+ * Arrays of this type must have a size which is a multiple of 64, i.e. a whole number of vectors.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * The unpacking and packing is done with regular integer operations, so this works the same
+ *   on both platforms, as well as the interpreter and emulator. The pack/unpack modes of
+ *   vc4 are not used.
+ */
+struct UInt8 : public Int {
+  using Array = V3DLib::SharedArray<uint8_t>;
+  using Ptr   = V3DLib::ptr::Ptr<UInt8>;
+
+  enum {
+    PER_WORD = 4
+  };
+
+  UInt8() = default;
+  UInt8(UInt8 const &x) : Int(x) {}
+  UInt8(Deref<UInt8> d);
+
+  UInt8 &operator=(UInt8 const &rhs);
+
+  IntExpr unpack(int n) const;
+  void pack(IntExpr v0, IntExpr v1, IntExpr v2, IntExpr v3);
+};
+
+
+/**
+ * Packed vector of 16-bit signed values, 2 values per 32-bit word.
+ *
+ * Otherwise the same as `UInt8`. Arrays of this type must have a size which is a multiple of 32.
+ */
+struct Int16 : public Int {
+  using Array = V3DLib::SharedArray<int16_t>;
+  using Ptr   = V3DLib::ptr::Ptr<Int16>;
+
+  enum {
+    PER_WORD = 2
+  };
+
+  Int16() = default;
+  Int16(Int16 const &x) : Int(x) {}
+  Int16(Deref<Int16> d);
+
+  Int16 &operator=(Int16 const &rhs);
+
+  IntExpr unpack(int n) const;
+  void pack(IntExpr v0, IntExpr v1);
+};
+
+
+/**
+ * Packed vector of 16-bit floats (IEEE 754 half precision), 2 values per 32-bit word.
+ *
+ * Otherwise the same as `UInt8`. Arrays of this type must have a size which is a multiple of 32.
+ * The array elements are the raw bit patterns; use `to_half()` and `from_half()` to convert
+ * on the host side.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * The conversions flush subnormal values to zero and round to nearest, with ties away from zero.
+ *   Values too large for a half are converted to infinity. The host conversions do exactly
+ *   the same, so results can be compared bit for bit.
+ */
+struct Half : public Int {
+  using Array = V3DLib::SharedArray<uint16_t>;
+  using Ptr   = V3DLib::ptr::Ptr<Half>;
+
+  enum {
+    PER_WORD = 2
+  };
+
+  Half() = default;
+  Half(Half const &x) : Int(x) {}
+  Half(Deref<Half> d);
+
+  Half &operator=(Half const &rhs);
+
+  FloatExpr unpack(int n) const;
+  void pack(FloatExpr v0, FloatExpr v1);
+};
+
+
+uint16_t to_half(float val);
+float from_half(uint16_t val);
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_SOURCE_PACKED_H_
@@ -1,4 +1,5 @@
 #include "Pretty.h"
+#include "Function.h"
 #include "Stmt.h"
 #include "Support/basics.h"
 #include "Support/Helpers.h"
@@ -100,6 +101,10 @@ std::string pretty(int indent, Stmt::Ptr s) {
           << "receive(" << s->address()->pretty() << ")";
       break;
 
+    case Stmt::CALL:
+      ret << indentBy(indent) << "call " << s->function()->name << "()";
+      break;
+
     case Stmt::GATHER_PREFETCH:
       ret << indentBy(indent) << "Prefetch Tag";
       break;
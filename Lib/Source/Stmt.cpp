@@ -1,5 +1,6 @@
 #include "Stmt.h"
 #include "Support/basics.h"
+#include "Function.h"
 #include "vc4/DMA/DMA.h"
 
 namespace V3DLib {
@@ -274,6 +275,7 @@ std::string Stmt::disp_intern(bool with_linebreaks, int seq_depth) const {
     case GATHER_PREFETCH:  ret << "GATHER_PREFETCH";  break;
     case FOR:              ret << "FOR";              break;
     case LOAD_RECEIVE:     ret << "LOAD_RECEIVE";     break;
+    case CALL:             ret << "CALL " << m_function->name << " #" << m_call_index; break;
 
     default: {
         std::string tmp = DMA::disp(tag);
@@ -346,6 +348,44 @@ Stmt::Ptr Stmt::create_assign(Expr::Ptr lhs, Expr::Ptr rhs) {
 }
 
 
+/**
+ * Create a call of an out-of-line function
+ *
+ * @param call_index  index of the call site within the calls of the given function;
+ *                    used to determine the return address.
+ * @param args        expressions to assign to the parameter registers of the function
+ */
+Stmt::Ptr Stmt::create_call(std::shared_ptr<FunctionDef> f, int call_index, std::vector<Expr::Ptr> const &args) {
+  assert(f.get() != nullptr);
+  assert(0 <= call_index && call_index < f->num_calls);
+
+  Ptr ret = create(CALL);
+  ret->m_function   = f;
+  ret->m_call_index = call_index;
+  ret->m_call_args  = args;
+  return ret;
+}
+
+
+std::shared_ptr<FunctionDef> Stmt::function() const {
+  assert(tag == CALL);
+  assert(m_function.get() != nullptr);
+  return m_function;
+}
+
+
+int Stmt::call_index() const {
+  assert(tag == CALL);
+  return m_call_index;
+}
+
+
+std::vector<Expr::Ptr> const &Stmt::call_args() const {
+  assert(tag == CALL);
+  return m_call_args;
+}
+
+
 CExpr::Ptr Stmt::if_cond() const {
   assert(tag == IF);
   assert(m_cond.get() != nullptr);
@@ -8,6 +8,8 @@
 
 namespace V3DLib {
 
+struct FunctionDef;  // Forward declaration
+
 // ============================================================================
 // Class Stmt
 // ============================================================================
@@ -40,6 +42,7 @@ struct Stmt : public InstructionComment {
     WHILE,
     FOR,
     LOAD_RECEIVE,
+    CALL,                // Call of out-of-line function
 
     GATHER_PREFETCH,
 
@@ -101,12 +104,17 @@ struct Stmt : public InstructionComment {
   CExpr::Ptr if_cond() const;
   CExpr::Ptr loop_cond() const;
 
+  std::shared_ptr<FunctionDef> function() const;
+  int call_index() const;
+  std::vector<Expr::Ptr> const &call_args() const;
+
   //
   // Instantiation methods
   //
   static Ptr create(Tag in_tag);
   static Ptr create(Tag in_tag, Expr::Ptr e0, Expr::Ptr e1);
   static Ptr create_assign(Expr::Ptr lhs, Expr::Ptr rhs);
+  static Ptr create_call(std::shared_ptr<FunctionDef> f, int call_index, std::vector<Expr::Ptr> const &args);
 
   Tag tag;
   DMA::Stmt dma;
@@ -125,6 +133,10 @@ private:
 
   CExpr::Ptr m_cond;
 
+  std::shared_ptr<FunctionDef> m_function;  // Called function
+  int m_call_index = -1;                    // Index of call site in called function
+  std::vector<Expr::Ptr> m_call_args;       // Arguments of call, in order of the function parameters
+
   bool m_break_point = false;
 
   static Ptr create(Tag in_tag, Ptr s0, Ptr s1);
@@ -4,6 +4,7 @@
 #include "Target/SmallLiteral.h"
 #include "Target/instr/Mnemonics.h"
 #include "Support/basics.h"
+#include "Function.h"
 
 namespace V3DLib {
 
@@ -11,6 +12,37 @@ using ::operator<<;  // C++ weirdness
 
 namespace {
 
+/**
+ * Out-of-line functions called in the code being translated,
+ * along with the labels for their entry and return points.
+ */
+struct CalledFunction {
+  FunctionDef::Ptr   def;
+  Label              entry;
+  std::vector<Label> returns;  // Index is call site
+};
+
+std::vector<CalledFunction> called_functions;
+
+
+CalledFunction const &called_function(FunctionDef::Ptr def) {
+  for (auto const &f : called_functions) {
+    if (f.def == def) return f;
+  }
+
+  CalledFunction f;
+  f.def   = def;
+  f.entry = freshLabel();
+
+  for (int i = 0; i < def->num_calls; i++) {
+    f.returns.push_back(freshLabel());
+  }
+
+  called_functions.push_back(f);
+  return called_functions.back();
+}
+
+
 // ============================================================================
 // Operands
 // ============================================================================
@@ -308,12 +340,20 @@ BranchCond condExp(Instr::List &seq, CExpr &c) {
 // ============================================================================
 
 Instr::List whereStmt(Stmt::Ptr s, Var condVar, AssignCond cond, bool saveRestore);
+void translateCall(Instr::List &seq, Stmt &s);
 
 Instr::List whereStmt(Stmt::Array const &stmts, Var condVar, AssignCond cond, bool saveRestore, bool first_true = false) {
   Instr::List ret;
 
   for (int i = 0; i < (int) stmts.size(); i++) {
     ret << whereStmt(stmts[i], condVar, cond, (i == 0 && first_true)?true:saveRestore);
+
+    if (stmts[i]->tag == Stmt::WHERE && i + 1 < (int) stmts.size()) {
+      // A nested where-statement sets the condition flags for its own body.
+      // Restore the flags for the statements following it.
+      Var dummy = VarGen::fresh();
+      ret << Target::instr::mov(dummy, condVar).setCondFlag(Flag::ZC).comment("Restore where condition");
+    }
   }
 
   return ret;
@@ -444,7 +484,19 @@ Instr::List whereStmt(Stmt::Ptr s, Var condVar, AssignCond cond, bool saveRestor
     return ret;
   }
 
-  assertq(false, "V3DLib: only assignments and nested 'where' statements can occur in a 'where' statement", true);
+  // ---------------------------------------------
+  // Case: function call
+  // ---------------------------------------------
+  if (s->tag == Stmt::CALL) {
+    // The function body is executed unconditionally and clobbers the condition flags
+    translateCall(ret, *s);
+
+    Var dummy = VarGen::fresh();
+    ret << mov(dummy, condVar).setCondFlag(Flag::ZC).comment("Restore where condition after call");
+    return ret;
+  }
+
+  assertq(false, "V3DLib: only assignments, function calls and nested 'where' statements can occur in a 'where' statement", true);
   return ret;
 }
 
@@ -507,6 +559,79 @@ void translateWhile(Instr::List &seq, Stmt &s) {
 }
 
 
+/**
+ * Translate a call of an out-of-line function.
+ *
+ * The index of the call site is put in the link register, and is used
+ * on return to jump back to the instruction following the call.
+ */
+void translateCall(Instr::List &seq, Stmt &s) {
+  using namespace Target::instr;
+
+  auto const &f = called_function(s.function());
+  int index     = s.call_index();
+  assert(0 <= index && index < (int) f.returns.size());
+
+  auto const &args = s.call_args();
+  assert(args.size() == f.def->params.size());
+
+  // Arguments are always assigned unconditionally, also within a where-block
+  for (int i = 0; i < (int) args.size(); i++) {
+    seq << varAssign(f.def->params[i], args[i]);
+  }
+
+  std::string cmt;
+  cmt << "Call " << f.def->name;
+
+  seq << li(f.def->link, index).comment(cmt)
+      << branch(f.entry).call_mark(Instr::CALL_SITE, f.entry, f.returns[index])
+      << label(f.returns[index]);
+}
+
+
+/**
+ * Translate the bodies of the called functions and add them after the passed code.
+ *
+ * Translating a body can add more called functions; these are handled in the same loop.
+ *
+ * Each body ends with a return sequence, which compares the link register with each call site
+ * and jumps back to the matching one.
+ */
+void translateFunctions(Instr::List &seq) {
+  using namespace Target::instr;
+
+  if (called_functions.empty()) return;
+
+  Label endLabel = freshLabel();
+  seq << branch(endLabel).comment("Skip function bodies");
+
+  for (int i = 0; i < (int) called_functions.size(); i++) {
+    CalledFunction f = called_functions[i];  // Copy, vector may grow during translation of body
+
+    seq << label(f.entry).call_mark(Instr::CALL_ENTRY, f.entry);
+    int first = seq.size();
+    stmts(&seq, f.def->body);
+
+    std::string hdr;
+    hdr << "Function " << f.def->name;
+    seq[first].header(hdr);
+
+    // Return to call site
+    int last = (int) f.returns.size() - 1;
+    for (int j = 0; j < last; j++) {
+      auto cmp = std::make_shared<BExpr>(mkVar(f.def->link), CmpOp(CmpOp::EQ, INT32), mkIntLit(j));
+      BranchCond cond = condExp(seq, *mkAny(cmp));
+      seq << branch(f.returns[j]).branch_cond(cond).call_mark(Instr::CALL_RETURN, f.entry);
+    }
+
+    seq << branch(f.returns[last]).call_mark(Instr::CALL_RETURN, f.entry)  // Must be the last call site
+        .comment("Return");
+  }
+
+  seq << label(endLabel);
+}
+
+
 // ============================================================================
 // Statements
 // ============================================================================
@@ -535,6 +660,9 @@ void stmt(Instr::List *seq, Stmt::Ptr s) {
         *seq << whereStmt(s, condVar, always, false);
       }
       break;
+    case Stmt::CALL:                     // Call of out-of-line function
+      translateCall(*seq, *s);
+      break;
     case Stmt::LOAD_RECEIVE:             // 'receive(e)', where e is an expr
       using Target::instr::recv;
 
@@ -686,10 +814,14 @@ Expr::Ptr putInVar(Instr::List *seq, Expr::Ptr e) {
  */
 void translate_stmt(Instr::List &seq, Stmts &s) {
   assert(seq.empty());  // TODO perhaps move this test up, or seq as return value
+  called_functions.clear();
 
   for (int i = 0; i < (int) s.size(); i++) {
     stmt(&seq, s[i]);
   }
+
+  translateFunctions(seq);
+  called_functions.clear();
 }
 
 }  // namespace V3DLib
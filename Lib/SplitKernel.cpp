@@ -0,0 +1,206 @@
+#include "SplitKernel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <thread>
+#include "Support/basics.h"
+#include "Support/Platform.h"
+#include "Target/EmuSupport.h"  // MAX_QPUS
+
+namespace V3DLib {
+
+using ::operator<<;  // C++ weirdness
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+  std::chrono::duration<double> diff = Clock::now() - start;
+  return diff.count();
+}
+
+
+/**
+ * Add a measurement to a running average.
+ *
+ * The average is used to even out the noise in the timings, while still adapting to
+ * changes in the load of the host.
+ */
+double smooth(double average, double value) {
+  if (average <= 0) return value;
+  return 0.5*(average + value);
+}
+
+
+char const *host_name(SplitKernel::Host host) {
+  switch (host) {
+    case SplitKernel::INTERPRETER: return "interpreter";
+    case SplitKernel::EMULATOR:    return "emulator";
+    case SplitKernel::CPU:         return "cpu";
+  }
+
+  return "<unknown>";
+}
+
+}  // anon namespace
+
+
+SplitKernel::SplitKernel(BaseKernel &k, Host host) : m_k(k), m_host(host) {}
+
+
+/**
+ * Set a fixed number of QPU id's for the host.
+ *
+ * This disables the tuning. With `n == 0`, the kernel runs on the QPUs only.
+ */
+SplitKernel &SplitKernel::host_qpus(int n) {
+  assertq(0 <= n && n <= max_host_qpus(), "SplitKernel: number of host QPUs out of range", true);
+  m_host_qpus = n;
+  m_tune      = false;
+  return *this;
+}
+
+
+/**
+ * Max number of QPU id's which can be run on the host.
+ *
+ * The interpreter and emulator have a fixed limit on the number of QPUs.
+ * The same limit is used for the native code, which runs a host thread per id.
+ */
+int SplitKernel::max_host_qpus() const {
+  return MAX_QPUS;
+}
+
+
+/**
+ * @return fraction of the kernel work assigned to the host
+ */
+double SplitKernel::host_fraction() const {
+  return ((double) host_qpus())/total_qpus();
+}
+
+
+/**
+ * Run the kernel, divided over the QPUs and the host.
+ *
+ * The QPU side runs on a separate thread, the host side on the calling thread.
+ * If either side throws, the exception is passed on after both sides are done.
+ */
+void SplitKernel::run() {
+  int const device = device_qpus();
+  int const host   = host_qpus();
+  int const total  = total_qpus();
+
+  if (host == 0) {
+    auto start = Clock::now();
+    run_device(QpuRange(0, device, total));
+    tune(seconds_since(start), 0);
+    return;
+  }
+
+  std::exception_ptr device_error;
+  double device_time = 0;
+
+  std::thread device_thread([this, device, total, &device_error, &device_time] {
+    auto start = Clock::now();
+
+    try {
+      run_device(QpuRange(0, device, total));
+    } catch (...) {
+      device_error = std::current_exception();
+    }
+
+    device_time = seconds_since(start);
+  });
+
+  std::exception_ptr host_error;
+  auto start = Clock::now();
+
+  try {
+    run_host(QpuRange(device, host, total));
+  } catch (...) {
+    host_error = std::current_exception();
+  }
+
+  double host_time = seconds_since(start);
+  device_thread.join();
+
+  if (device_error) std::rethrow_exception(device_error);
+  if (host_error)   std::rethrow_exception(host_error);
+
+  tune(device_time, host_time);
+}
+
+
+void SplitKernel::run_device(QpuRange const &qpus) {
+#ifdef QPU_MODE
+  if (!Platform::use_main_memory()) {
+    m_k.qpu(qpus);
+    return;
+  }
+#endif
+
+  m_k.emu(qpus);
+}
+
+
+void SplitKernel::run_host(QpuRange const &qpus) {
+  switch (m_host) {
+    case INTERPRETER: m_k.interpret(qpus); break;
+    case EMULATOR:    m_k.emu(qpus);       break;
+    case CPU:         m_k.cpu(qpus);       break;
+  }
+}
+
+
+/**
+ * Adjust the number of host id's to the measured throughput of both sides.
+ *
+ * If the host does a fraction `f` of the total work and the QPUs the rest,
+ * both sides take the same time when:
+ *
+ *     f = host_rate/(host_rate + device_rate)
+ *
+ * With `d` device id's, the number of host id's for this fraction is `f*d/(1 - f)`.
+ *
+ * This is called by `run()` with the measured timings of both sides, in seconds.
+ * A time of zero means that the side did not run.
+ */
+void SplitKernel::tune(double device_time, double host_time) {
+  m_device_time = device_time;
+  m_host_time   = host_time;
+
+  double const total = total_qpus();
+
+  if (m_device_time > 0) {
+    m_device_rate = smooth(m_device_rate, (device_qpus()/total)/m_device_time);
+  }
+
+  if (host_qpus() > 0 && m_host_time > 0) {
+    m_host_rate = smooth(m_host_rate, (host_qpus()/total)/m_host_time);
+  }
+
+  if (!m_tune) return;
+  if (m_device_rate <= 0 || m_host_rate <= 0) return;
+
+  double f = m_host_rate/(m_host_rate + m_device_rate);
+  double n = (f < 1)? f*device_qpus()/(1 - f) : max_host_qpus();
+
+  m_host_qpus = std::min(max_host_qpus(), (int) std::lround(n));
+}
+
+
+std::string SplitKernel::info() const {
+  std::string ret;
+
+  ret << "SplitKernel, host: " << host_name(m_host)
+      << ", QPU id's: " << device_qpus() << " device, " << host_qpus() << " host"
+      << ((m_tune)? " (tuned)" : " (fixed)") << "\n"
+      << "  last run: device " << (float) m_device_time << "s, host " << (float) m_host_time << "s\n";
+
+  return ret;
+}
+
+}  // namespace V3DLib
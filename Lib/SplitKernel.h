@@ -0,0 +1,81 @@
+#ifndef _V3DLIB_SPLITKERNEL_H_
+#define _V3DLIB_SPLITKERNEL_H_
+#include <string>
+#include "BaseKernel.h"
+
+namespace V3DLib {
+
+/**
+ * Run a data-parallel kernel on the QPUs and on the host at the same time.
+ *
+ * This is intended for kernels which divide their work over the QPUs with `me()` and `numQPUs()`,
+ * for example:
+ *
+ *     For (Int i = me(), i < n, i += numQPUs())
+ *       ...
+ *     End
+ *
+ * The kernel is run with a logical number of QPUs which is larger than the number of QPUs
+ * set for the kernel. The QPUs take the first id's, a host-side executor runs the remaining id's.
+ * Both write their results directly into the shared arrays, so there is nothing to merge afterwards.
+ *
+ * The number of id's for the host is tuned on every run from the measured throughput of both sides,
+ * so that they take about the same time. This can be overridden with `host_qpus(n)`.
+ *
+ * The kernel is loaded with its parameters as usual, by `Kernel::load()`, before calling `run()`.
+ *
+ * ------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. The QPUs and the host run independently. The kernel can therefore not synchronize between
+ *    QPUs, e.g. with semaphores, except at the end of the kernel (this is done by the library).
+ *
+ * 2. The work per id should be about the same for the tuning to be effective.
+ *    Interleaving the work items over the id's, as in the example above, helps with this.
+ *
+ * 3. Without `QPU_MODE`, or when main memory is used, the QPU side runs on the emulator.
+ *    This allows for developing and testing the host side on any platform.
+ */
+class SplitKernel {
+public:
+  enum Host {
+    INTERPRETER,
+    EMULATOR,
+    CPU          // Native code, see `cpu::NativeKernel`
+  };
+
+  SplitKernel(BaseKernel &k, Host host = CPU);
+
+  void run();
+  SplitKernel &host_qpus(int n);
+
+  int host_qpus() const   { return m_host_qpus; }
+  int device_qpus() const { return m_k.numQPUs(); }
+  int total_qpus() const  { return device_qpus() + host_qpus(); }
+  int max_host_qpus() const;
+  double host_fraction() const;
+  std::string info() const;
+  void tune(double device_time, double host_time);
+
+private:
+  BaseKernel &m_k;
+  Host        m_host;
+  int         m_host_qpus = 1;
+  bool        m_tune      = true;
+
+  // Measured throughputs, as fraction of the total kernel work per second; 0 if not known yet
+  double m_device_rate = 0;
+  double m_host_rate   = 0;
+
+  // Timings of the last run, in seconds
+  double m_device_time = 0;
+  double m_host_time   = 0;
+
+  void run_device(QpuRange const &qpus);
+  void run_host(QpuRange const &qpus);
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_SPLITKERNEL_H_
@@ -22,13 +22,10 @@ void RegIdSet::add(RegIdSet const &rhs) {
 
 
 void RegIdSet::remove(RegIdSet const &rhs) {
-  erase(rhs.begin(), rhs.end());  // Doesn't help much with speed
-
-/*
+  // NOTE: erase(rhs.begin(), rhs.end()) is not an option, the iterators must be from this set
   for (auto r : rhs) {
     erase(r);
   }
-*/
 }
 
 
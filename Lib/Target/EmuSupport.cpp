@@ -5,6 +5,7 @@
 #include "Support/basics.h"
 #include "Target/instr/ALUOp.h"
 #include "Source/Op.h"
+#include "LibSettings.h"
 
 namespace V3DLib {
 namespace {
@@ -155,7 +156,7 @@ Vec Vec::recip() const {
     ret[i].floatVal = (a != 0)?1/a:0;      // TODO: not sure about value safeguard
   }
 
-  return ret;
+  return ret.sfu_precision();
 }
 
 
@@ -167,7 +168,7 @@ Vec Vec::recip_sqrt() const {
     ret[i].floatVal = (a != 0)?1/a:0;      // TODO: not sure about value safeguard
   }
 
-  return ret;
+  return ret.sfu_precision();
 }
 
 
@@ -178,7 +179,7 @@ Vec Vec::exp() const {
     ret[i].floatVal = (float) ::exp2(elems[i].floatVal);
   }
 
-  return ret;
+  return ret.sfu_precision();
 }
 
 
@@ -190,6 +191,26 @@ Vec Vec::log() const {
     ret[i].floatVal = a;
   }
 
+  return ret.sfu_precision();
+}
+
+
+/**
+ * Truncate the mantissa of float values to the SFU precision set in `LibSettings`.
+ *
+ * Does nothing if no SFU precision is set.
+ */
+Vec Vec::sfu_precision() const {
+  int bits = LibSettings::emulator_sfu_precision();
+  if (bits == 0) return *this;
+
+  uint32_t const mask = ~((((uint32_t) 1) << (23 - bits)) - 1);
+  Vec ret;
+
+  for (int i = 0; i < NUM_LANES; i++) {
+    ret[i].intVal = (int) (((uint32_t) elems[i].intVal) & mask);
+  }
+
   return ret;
 }
 
@@ -259,7 +280,7 @@ bool Vec::apply(ALUOp const &op, Vec a, Vec b) {
     case ALUOp::A_BOR:   d = x|y;            break;
     case ALUOp::A_BXOR:  d = x^y;            break;
     case ALUOp::A_BNOT:  d = ~x; break;
-    case ALUOp::M_MUL24: d = (x&0xffffff)*(y&0xffffff); break; // Integer multiply (24-bit)
+    case ALUOp::M_MUL24: d = (int) (((uint32_t) (x&0xffffff))*((uint32_t) (y&0xffffff))); break; // Integer multiply (24-bit)
 
     case ALUOp::A_CLZ:    d = clz(x);         break; // Count leading zeros
 
@@ -334,8 +355,8 @@ void Vec::assign(Vec const &rhs) {
 
 Vec const EmuState::index_vec({0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15});
 
-EmuState::EmuState(int in_num_qpus, IntList const &in_uniforms, bool add_dummy) :
-  num_qpus(in_num_qpus),
+EmuState::EmuState(QpuRange const &in_qpus, IntList const &in_uniforms, bool add_dummy) :
+  qpus(in_qpus),
   uniforms(in_uniforms)
 {
   // Initialise semaphores
@@ -349,14 +370,24 @@ EmuState::EmuState(int in_num_qpus, IntList const &in_uniforms, bool add_dummy)
 }
 
 
+/**
+ * Get the next uniform value for the given QPU.
+ *
+ * The uniforms start with a header, before the kernel parameters.
+ * This is passed as in `load_uniforms()` in `vc4/Invoke.cpp`.
+ *
+ * @param id  index of the QPU in the current invocation
+ */
 Vec EmuState::get_uniform(int id, int &next_uniform) {
   Vec a;
 
   assert(next_uniform < uniforms.size());
-  if (next_uniform == -2)
-    a = id;
+  if (next_uniform == -3)
+    a = qpus.id(id);
+  else if (next_uniform == -2)
+    a = qpus.total;
   else if (next_uniform == -1)
-    a = num_qpus;
+    a = qpus.finish(id);
   else
     a = uniforms[next_uniform];
 
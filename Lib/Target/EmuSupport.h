@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <vector>
 #include "../Common/Seq.h"
+#include "../Common/QpuRange.h"
 #include "../Target/instr/Imm.h"
 
 
@@ -72,18 +73,22 @@ private:
   Word elems[NUM_LANES];
 
   void assign(Vec const &rhs);
+  Vec sfu_precision() const;
 };
 
 
 class EmuState {
 public:
-  int num_qpus;
+  QpuRange qpus;           // Logical id's of the QPUs running
   Word vpm[VPM_SIZE];      // Shared VPM memory
 
-  EmuState(int in_num_qpus, IntList const &in_uniforms, bool add_dummy = false);
+  static int const NUM_HEADER_UNIFORMS = 3;  // QPU id, num QPUs, termination count
+
+  EmuState(QpuRange const &in_qpus, IntList const &in_uniforms, bool add_dummy = false);
   Vec get_uniform(int id, int &next_uniform);
   bool sema_inc(int sema_id);
   bool sema_dec(int sema_id);
+  void reset_semaphore_wait() { semaphore_wait_count = 0; }
 
   static Vec const index_vec;
 
@@ -91,7 +96,8 @@ private:
   IntList uniforms;        // Kernel parameters
   int sema[16];            // Semaphores
 
-  // Protection against locks due to semaphore waiting
+  // Protection against locks due to semaphore waiting.
+  // Counts consecutive waits; reset when any QPU does something else
   int const MAX_SEMAPHORE_WAIT = 1024;
   int semaphore_wait_count = 0;
 };
@@ -10,6 +10,10 @@ namespace V3DLib {
 
 namespace {
 
+// Total number of instructions executed in the current thread, for benchmarking.
+// Per thread, because kernels may be emulated concurrently (see `TaskGraph`)
+thread_local uint64_t instruction_count = 0;
+
 /**
  * Very simple queue containing N elements of type T
  */
@@ -78,7 +82,7 @@ private:
 // State of a single QPU.
 struct QPUState {
   int id = 0;                          // QPU id
-  int nextUniform = -2;                // Pointer to next uniform to read
+  int nextUniform = -EmuState::NUM_HEADER_UNIFORMS;  // Pointer to next uniform to read
   Seq<Vec> loadBuffer = 8;             // Load buffer for loads via TMU, 8 is initial size
 
   int readPitch = 0;                   // Read pitch
@@ -137,7 +141,7 @@ struct State : public EmuState {
   QPUState qpu[MAX_QPUS];  // State of each QPU
   Data emuHeap;
 
-  State(int in_num_qpus, IntList const &in_uniforms) : EmuState(in_num_qpus, in_uniforms, true) {}
+  State(QpuRange const &in_qpus, IntList const &in_uniforms) : EmuState(in_qpus, in_uniforms, true) {}
 };
 
 
@@ -581,14 +585,16 @@ Vec readRegOrImm(QPUState* s, State &state, RegOrImm const &src) {
 // ============================================================================
 
 /**
- * @param numQPUs   Number of QPUs active
+ * @param qpus      QPUs to run, with their logical id's
  * @param instrs    Instruction sequence
  * @param maxReg    Max reg id used
  * @param uniforms  Kernel parameters
  * @param heap
  */
-void emulate(int numQPUs, Instr::List &instrs, int maxReg, IntList &uniforms, BufferObject &heap) {
-  State state(numQPUs, uniforms);
+void emulate(QpuRange const &qpus, Instr::List &instrs, int maxReg, IntList &uniforms, BufferObject &heap) {
+  assert(qpus.count <= MAX_QPUS);
+  int numQPUs = qpus.count;
+  State state(qpus, uniforms);
   state.emuHeap.heap_view(heap);
 
   // Initialise state
@@ -618,6 +624,11 @@ void emulate(int numQPUs, Instr::List &instrs, int maxReg, IntList &uniforms, Bu
         // Run next instruction
         //
         Instr const instr = instrs.get(s->pc++);
+        instruction_count++;
+
+        if (instr.tag != SINC && instr.tag != SDEC) {
+          state.reset_semaphore_wait();  // Not stuck as long as some QPU makes progress
+        }
 
         if (instr.break_point()) {
 #ifdef DEBUG
@@ -643,7 +654,12 @@ void emulate(int numQPUs, Instr::List &instrs, int maxReg, IntList &uniforms, Bu
               b = a; 
             } else {
               a = readRegOrImm(s, state, instr.ALU.srcA);
-              b = readRegOrImm(s, state, instr.ALU.srcB);
+
+              if (instr.ALU.srcB == instr.ALU.srcA) {
+                b = a;  // Register is read only once, relevant for registers with side effects, e.g. VPM_READ
+              } else {
+                b = readRegOrImm(s, state, instr.ALU.srcB);
+              }
             }
 
             Vec result;
@@ -698,5 +714,14 @@ void emulate(int numQPUs, Instr::List &instrs, int maxReg, IntList &uniforms, Bu
   }
 }
 
-}  // namespace V3DLib
 
+/**
+ * Get the total number of instructions executed by the emulator, over all QPUs and calls.
+ *
+ * Intended for benchmarking; take the difference of two calls.
+ */
+uint64_t emulated_instruction_count() {
+  return instruction_count;
+}
+
+}  // namespace V3DLib
@@ -1,12 +1,15 @@
 #ifndef _V3DLIB_TARGET_EMULATOR_H_
 #define _V3DLIB_TARGET_EMULATOR_H_
+#include <cstdint>
 #include "instr/Instr.h"
+#include "../Common/QpuRange.h"
 
 namespace V3DLib {
 
 class BufferObject;
 
-void emulate(int numQPUs, Instr::List &instrs, int maxReg, IntList &uniforms, BufferObject &heap);
+void emulate(QpuRange const &qpus, Instr::List &instrs, int maxReg, IntList &uniforms, BufferObject &heap);
+uint64_t emulated_instruction_count();
 
 }  // namespace V3DLib
 
@@ -258,6 +258,24 @@ BranchTarget Instr::branch_target() const { assert(tag == V3DLib::BR); return m_
 void  Instr::branch_label(Label rhs) { assert(tag == InstrTag::BRL); m_branch_label = rhs; }
 Label Instr::branch_label() const    { assert(tag == InstrTag::BRL); return m_branch_label; }
 
+
+/**
+ * Mark instruction as part of an out-of-line function call.
+ *
+ * This is used by liveness analysis, which otherwise can not distinguish
+ * the call and return branches from other branches.
+ */
+Instr &Instr::call_mark(CallMark mark, Label entry, Label ret) {
+  assert(mark != NO_CALL);
+  assert(mark == CALL_ENTRY ? is_label() : is_branch_label());
+  assert((mark == CALL_SITE) == (ret != -1));
+
+  m_call_mark   = mark;
+  m_call_entry  = entry;
+  m_call_return = ret;
+  return *this;
+}
+
 Instr &Instr::branch_cond(BranchCond rhs) {
   assert(tag == V3DLib::BR || tag == V3DLib::BRL);
   m_branch_cond = rhs;
@@ -389,6 +407,34 @@ std::string Instr::dump() const {
 }
 
 
+/**
+ * Check if the vc4 constraints may require a move of an operand to ACC0.
+ *
+ * This is the case for operands which may end up in the same register file, or for
+ * a register operand combined with a small immediate (see `insertMoves_vc4()`).
+ * These moves are inserted after register allocation, so ACC0 may not be allocated
+ * to a var which is live over such an instruction.
+ */
+bool Instr::needs_acc0_vc4() const {
+  if (tag != InstrTag::ALU) return false;
+
+  // Vars can end up in either register file, special registers are in a fixed one
+  auto in_regfile = [] (RegOrImm const &src) {
+    if (!src.is_reg()) return false;
+    Reg const &reg = src.reg();
+    if (reg.tag == REG_A || reg.tag == REG_B) return true;
+    return reg.tag == SPECIAL && reg.regfile() != NONE;
+  };
+
+  bool varA = in_regfile(ALU.srcA);
+  bool varB = in_regfile(ALU.srcB);
+
+  return (varA && varB && !(ALU.srcA == ALU.srcB))
+      || (varA && ALU.srcB.is_imm())
+      || (varB && ALU.srcA.is_imm());
+}
+
+
 /**
  * Determine the accumulators used in this instruction
  *
@@ -444,6 +490,10 @@ uint32_t Instr::get_acc_usage() const {
         ret |=  (1 << ALU.srcB.reg().regId);
       }
 
+      if (Platform::compiling_for_vc4() && needs_acc0_vc4()) {
+        ret |= 1;
+      }
+
       if (ALU.op == ALUOp::A_FSIN) {
         if (!Platform::compiling_for_vc4()) {
           // SIN using special reg always returns result in r4
@@ -466,8 +516,13 @@ uint32_t Instr::get_acc_usage() const {
   // ACC 0 and 1 are used rot v3d, add
   // dst r1 and src r0 might be explicitly set beforehand, this is fine.
   // Generation of rot-instruction checks for this
-  if (!Platform::compiling_for_vc4()) {
-    if (isRot()) {
+  //
+  // For vc4, the rotated value is moved into ACC0 when satisfying constraints (after the
+  // accumulators have been introduced), so ACC0 may not be used for a var live over a rot.
+  if (isRot()) {
+    if (Platform::compiling_for_vc4()) {
+      ret |= 1;
+    } else {
       ret |= 3;
     }
   }
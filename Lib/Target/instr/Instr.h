@@ -168,6 +168,7 @@ struct Instr : public InstructionComment {
   std::string mnemonic(bool with_comments = false, std::string const &pref = "") const;
   std::string dump() const;
   uint32_t get_acc_usage() const;
+  bool needs_acc0_vc4() const;
 
   bool operator==(Instr const &rhs) const {
     // Cheat by comparing the string representation,
@@ -199,6 +200,23 @@ struct Instr : public InstructionComment {
     return m_label;
   }
 
+  /////////////////////////////////////
+  // Out-of-line function support
+  /////////////////////////////////////
+
+  enum CallMark {
+    NO_CALL,
+    CALL_SITE,    // Branch to function entry; return label is the return point
+    CALL_ENTRY,   // Label at start of function body
+    CALL_RETURN   // Branch from end of function body back to a call site
+  };
+
+  Instr &call_mark(CallMark mark, Label entry, Label ret = -1);
+  CallMark call_mark() const { return m_call_mark; }
+  bool is_call_mark() const { return m_call_mark != NO_CALL; }
+  Label call_entry() const  { assert(is_call_mark()); return m_call_entry; }
+  Label call_return() const { assert(m_call_mark == CALL_SITE); return m_call_return; }
+
   // ==================================================
   // v3d-specific  methods
   // ==================================================
@@ -216,6 +234,11 @@ private:
   BranchTarget m_branch_target;
   Label        m_branch_label;      // Label to jump to in BRL instruction
   Label        m_label;             // Label denoting branch target
+
+  // Function call fields
+  CallMark m_call_mark   = NO_CALL;
+  Label    m_call_entry  = -1;      // Entry label of called function
+  Label    m_call_return = -1;      // Label of return point for call site
 };
 
 
@@ -127,6 +127,11 @@ Instr add(Reg dst, Reg srcA, int n) {
 }
 
 
+Instr sub(Reg dst, Reg srcA, Reg srcB) {
+  return genInstr(ALUOp::A_SUB, dst, srcA, srcB);
+}
+
+
 Instr sub(Reg dst, Reg srcA, int n) {
   assert(n >= 0 && n <= 15);
   return genInstr(ALUOp::A_SUB, dst, srcA, n);
@@ -46,6 +46,7 @@ Instr mov(Reg dst, RegOrImm const &src);
 Instr shl(Reg dst, Reg srcA, int val);
 Instr add(Reg dst, Reg srcA, Reg srcB);
 Instr add(Reg dst, Reg srcA, int n);
+Instr sub(Reg dst, Reg srcA, Reg srcB);
 Instr sub(Reg dst, Reg srcA, int n);
 Instr shr(Reg dst, Reg srcA, int n);
 Instr li(Reg dst, Imm const &src);
@@ -0,0 +1,315 @@
+#include "TaskGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "Support/basics.h"
+#include "Support/Platform.h"
+
+namespace V3DLib {
+
+using ::operator<<;  // C++ weirdness
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+  std::chrono::duration<double> diff = Clock::now() - start;
+  return diff.count();
+}
+
+
+bool any_overlap(TaskGraph::Buffers const &a, TaskGraph::Buffers const &b) {
+  for (auto const &x : a) {
+    for (auto const &y : b) {
+      if (x.overlaps(y)) return true;
+    }
+  }
+
+  return false;
+}
+
+}  // anon namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Class BufferRange
+///////////////////////////////////////////////////////////////////////////////
+
+BufferRange::BufferRange(BaseSharedArray const &a) {
+  assertq(a.allocated(), "BufferRange: shared array not allocated", true);
+  begin = a.getAddress();
+  end   = begin + a.size_in_bytes();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Class TaskGraph
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Add a kernel to the graph.
+ *
+ * @return index of the added task
+ */
+int TaskGraph::add(std::string const &name, BaseKernel &k, Buffers const &reads, Buffers const &writes) {
+  for (auto const &t : m_tasks) {
+    assertq(t.kernel != &k, "TaskGraph: a kernel instance can only be added once", true);
+  }
+
+  Task task;
+  task.name   = name;
+  task.kernel = &k;
+  task.reads  = reads;
+  task.writes = writes;
+
+  for (int i = 0; i < (int) m_tasks.size(); ++i) {
+    auto const &prev = m_tasks[i];
+
+    if (any_overlap(reads, prev.writes)
+     || any_overlap(writes, prev.writes)
+     || any_overlap(writes, prev.reads)) {
+      task.deps.push_back(i);
+    }
+  }
+
+  m_tasks.push_back(task);
+  return (int) m_tasks.size() - 1;
+}
+
+
+std::vector<int> const &TaskGraph::dependencies(int task) const {
+  assert(0 <= task && task < size());
+  return m_tasks[task].deps;
+}
+
+
+/**
+ * Run all tasks.
+ *
+ * @param max_threads  Max number of host threads to use for the emulator and interpreter.
+ *                     If zero, the number of hardware threads of the host is used.
+ */
+void TaskGraph::run(Mode mode, int max_threads) {
+  if (m_tasks.empty()) return;
+
+  for (auto &t : m_tasks) {
+    t.start = t.end = 0;
+    t.slot  = -1;
+  }
+
+  if (mode == CALL) {
+#ifdef QPU_MODE
+    if (!Platform::use_main_memory()) {
+      run_in_order(mode);
+      return;
+    }
+#endif
+    mode = EMULATE;
+  }
+
+  if (max_threads <= 0) {
+    max_threads = std::max(1, (int) std::thread::hardware_concurrency());
+  }
+
+  int num_threads = std::min(max_threads, size());
+
+  if (num_threads == 1) {
+    run_in_order(mode);
+  } else {
+    run_threaded(mode, num_threads);
+  }
+}
+
+
+void TaskGraph::run_task(Task &task, Mode mode) {
+  switch (mode) {
+    case CALL:      task.kernel->call();      break;
+    case EMULATE:   task.kernel->emu();       break;
+    case INTERPRET: task.kernel->interpret(); break;
+  }
+}
+
+
+void TaskGraph::run_in_order(Mode mode) {
+  auto start = Clock::now();
+
+  for (auto &t : m_tasks) {
+    t.slot  = 0;
+    t.start = seconds_since(start);
+    run_task(t, mode);
+    t.end   = seconds_since(start);
+  }
+}
+
+
+/**
+ * Run the tasks on a pool of host threads.
+ *
+ * A task is put in the ready queue as soon as all its dependencies are done.
+ * The threads take tasks from the queue until all tasks are done.
+ * If a task throws, no new tasks are started and the first exception is rethrown.
+ */
+void TaskGraph::run_threaded(Mode mode, int num_threads) {
+  int const n = size();
+
+  std::vector<int> waiting_for(n);
+  std::vector<std::vector<int>> dependents(n);
+
+  for (int i = 0; i < n; ++i) {
+    waiting_for[i] = (int) m_tasks[i].deps.size();
+
+    for (int d : m_tasks[i].deps) {
+      dependents[d].push_back(i);
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<int> ready;
+  int num_done = 0;
+  std::exception_ptr error;
+
+  for (int i = 0; i < n; ++i) {
+    if (waiting_for[i] == 0) ready.push_back(i);
+  }
+
+  auto start = Clock::now();
+
+  auto worker = [&] (int slot) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+      cv.wait(lock, [&] { return !ready.empty() || num_done == n || error; });
+      if (num_done == n || error) break;
+
+      int index = ready.front();
+      ready.pop_front();
+      Task &task = m_tasks[index];
+
+      lock.unlock();
+
+      task.slot  = slot;
+      task.start = seconds_since(start);
+
+      try {
+        run_task(task, mode);
+      } catch (...) {
+        lock.lock();
+        if (!error) error = std::current_exception();
+        cv.notify_all();
+        break;
+      }
+
+      task.end = seconds_since(start);
+
+      lock.lock();
+      num_done++;
+
+      for (int d : dependents[index]) {
+        if (--waiting_for[d] == 0) ready.push_back(d);
+      }
+
+      cv.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+
+/**
+ * @return max number of tasks which were running at the same time in the last run
+ */
+int TaskGraph::max_concurrency() const {
+  int ret = 0;
+
+  for (auto const &t : m_tasks) {
+    int count = 0;
+
+    for (auto const &u : m_tasks) {
+      if (u.start <= t.start && t.start < u.end) count++;
+    }
+
+    ret = std::max(ret, count);
+  }
+
+  return ret;
+}
+
+
+/**
+ * Readable overview of the tasks, with their dependencies and schedule in the last run
+ */
+std::string TaskGraph::trace() const {
+  std::string ret;
+  char buf[128];
+
+  for (int i = 0; i < size(); ++i) {
+    auto const &t = m_tasks[i];
+
+    snprintf(buf, sizeof(buf), "%3d %-24s thread %2d: %10.6fs - %10.6fs, deps: ",
+      i, t.name.c_str(), t.slot, t.start, t.end);
+    ret << buf;
+
+    if (t.deps.empty()) {
+      ret << "none";
+    } else {
+      for (int j = 0; j < (int) t.deps.size(); ++j) {
+        if (j != 0) ret << ", ";
+        ret << t.deps[j];
+      }
+    }
+
+    ret << "\n";
+  }
+
+  return ret;
+}
+
+
+/**
+ * Schedule of the last run in Chrome trace event format.
+ *
+ * This can be viewed with `chrome://tracing` or Perfetto.
+ * Times are in microseconds.
+ */
+std::string TaskGraph::trace_json() const {
+  std::string ret;
+  char buf[64];
+
+  ret << "{\"traceEvents\": [";
+
+  for (int i = 0; i < size(); ++i) {
+    auto const &t = m_tasks[i];
+
+    ret << ((i == 0)? "\n" : ",\n")
+        << "  {\"name\": \"" << t.name << "\", \"ph\": \"X\", \"pid\": 0"
+        << ", \"tid\": " << t.slot;
+
+    snprintf(buf, sizeof(buf), ", \"ts\": %.3f, \"dur\": %.3f", 1e6*t.start, 1e6*(t.end - t.start));
+    ret << buf
+        << ", \"args\": {\"task\": " << i << "}}";
+  }
+
+  ret << "\n]}\n";
+  return ret;
+}
+
+}  // namespace V3DLib
@@ -0,0 +1,99 @@
+#ifndef _V3DLIB_TASKGRAPH_H_
+#define _V3DLIB_TASKGRAPH_H_
+#include <string>
+#include <vector>
+#include "BaseKernel.h"
+#include "Common/SharedArray.h"
+
+namespace V3DLib {
+
+/**
+ * Memory range of a shared array, for tracking the dependencies between tasks.
+ *
+ * Views are handled by their own range, so tasks working on disjoint parts
+ * of the same array do not depend on each other.
+ */
+struct BufferRange {
+  BufferRange(BaseSharedArray const &a);
+
+  template<typename T>
+  BufferRange(Shared2DArray<T> const &a) : BufferRange((BaseSharedArray const &) a.get_parent()) {}
+
+  bool overlaps(BufferRange const &rhs) const { return begin < rhs.end && rhs.begin < end; }
+
+  uint32_t begin = 0;  // Physical addresses
+  uint32_t end   = 0;
+};
+
+
+/**
+ * Run a set of kernels, ordered by the shared arrays they read and write.
+ *
+ * The kernels are added as tasks, with the arrays they read and write.
+ * A task depends on earlier tasks which:
+ *
+ * - write an array it reads (read after write)
+ * - read or write an array it writes (write after read, write after write)
+ *
+ * Tasks without dependencies between them may run concurrently.
+ *
+ * The kernels are loaded with their parameters as usual, by `Kernel::load()`,
+ * before the graph is run. A kernel instance can only be used for one task.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * On hardware, the kernels are run back-to-back in order of addition, on the calling thread.
+ *   A kernel call on the QPUs blocks the calling thread until done, and all QPUs are used
+ *   per call, so there is no gain in submitting from multiple threads.
+ *
+ * * On the emulator and interpreter, independent kernels run concurrently on host threads.
+ *
+ * * The order of addition is always a valid order of execution, because tasks
+ *   can only depend on tasks added before them.
+ */
+class TaskGraph {
+public:
+  enum Mode {
+    CALL,        // Run as `BaseKernel::call()` would
+    EMULATE,
+    INTERPRET
+  };
+
+  using Buffers = std::vector<BufferRange>;
+
+  int add(std::string const &name, BaseKernel &k, Buffers const &reads, Buffers const &writes);
+  void run(Mode mode = CALL, int max_threads = 0);
+  void clear() { m_tasks.clear(); }
+
+  int size() const { return (int) m_tasks.size(); }
+  std::vector<int> const &dependencies(int task) const;
+  int max_concurrency() const;
+  std::string trace() const;
+  std::string trace_json() const;
+
+private:
+  struct Task {
+    std::string      name;
+    BaseKernel      *kernel = nullptr;
+    Buffers          reads;
+    Buffers          writes;
+    std::vector<int> deps;
+
+    // Trace of last run, times in seconds from the start of the run
+    double start = 0;
+    double end   = 0;
+    int    slot  = -1;  // Index of the thread which ran the task
+  };
+
+  std::vector<Task> m_tasks;
+
+  void run_task(Task &task, Mode mode);
+  void run_in_order(Mode mode);
+  void run_threaded(Mode mode, int num_threads);
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_TASKGRAPH_H_
@@ -6,6 +6,9 @@
 #include "Source/Lang.h"
 #include "Source/gather.h"
 #include "Source/Functions.h"
+#include "Source/Function.h"
+#include "Source/Math.h"
+#include "Source/Packed.h"
 #include "Kernel.h"
 
 #endif
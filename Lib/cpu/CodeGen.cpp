@@ -0,0 +1,612 @@
+///////////////////////////////////////////////////////////////////////////////
+// Generation of native C++ code from source statements
+//
+// The generated code follows the semantics of the source interpreter (`Source/Interpreter.cpp`),
+// with every vector operation translated to a GCC vector extension operation on 16 lanes.
+//
+// All values are stored as 32-bit integer vectors. Float operations reinterpret the bits,
+// which is what a vector cast does for vectors of the same size.
+//
+// The generated code needs to be compiled with `-fwrapv`, integer overflow wraps as on the QPU.
+///////////////////////////////////////////////////////////////////////////////
+#include "CodeGen.h"
+#include <algorithm>  // find()
+#include <cstring>    // memcpy()
+#include <vector>
+#include "Source/Function.h"
+#include "Support/basics.h"
+#include "Support/Helpers.h"  // indentBy()
+
+namespace V3DLib {
+namespace cpu {
+
+using ::operator<<;  // C++ weirdness
+
+char const *ENTRY_POINT = "v3dlib_cpu_kernel";
+
+namespace {
+
+/**
+ * Definitions preceding the generated kernel.
+ *
+ * Memory access follows the interpreter: lane i accesses address `addr[i] + 4*i`.
+ * Accesses outside of the heap are ignored; loads return zero.
+ */
+char const *PRELUDE = R"(#include <stdint.h>
+#include <math.h>
+
+typedef int32_t  vi __attribute__((vector_size(64)));
+typedef uint32_t vu __attribute__((vector_size(64)));
+typedef float    vf __attribute__((vector_size(64)));
+
+typedef void (*SemaFunc)(void *state, int id, int inc);
+
+namespace {
+
+struct Heap {
+  uint32_t *base;
+  uint32_t  phy;    // Physical address of base
+  uint32_t  words;  // Size in 32-bit words
+};
+
+inline vi bc(int32_t x) { vi r; for (int i = 0; i < 16; i++) r[i] = x; return r; }
+inline vi elem_num()    { vi r; for (int i = 0; i < 16; i++) r[i] = i; return r; }
+
+inline vi select(vi m, vi a, vi b) { return (a & m) | (b & ~m); }
+inline bool any(vi m) { for (int i = 0; i < 16; i++) if (m[i]) return true;  return false; }
+inline bool all(vi m) { for (int i = 0; i < 16; i++) if (!m[i]) return false; return true; }
+
+inline vi imin(vi a, vi b) { return select(a < b, a, b); }
+inline vi imax(vi a, vi b) { return select(a > b, a, b); }
+inline vi vfmin(vi a, vi b) { return select((vf) a < (vf) b, a, b); }
+inline vi vfmax(vi a, vi b) { return select((vf) a > (vf) b, a, b); }
+
+inline vi mul24(vi a, vi b) { return (vi) (((vu) a & 0xffffff)*((vu) b & 0xffffff)); }
+inline vi shl(vi a, vi b)   { return a << (b & 31); }
+inline vi asr(vi a, vi b)   { return a >> (b & 31); }
+inline vi shr(vi a, vi b)   { return (vi) ((vu) a >> (vu) (b & 31)); }
+inline vi ror(vi a, vi b)   { vu n = (vu) (b & 31); return (vi) (((vu) a >> n) | ((vu) a << ((32 - n) & 31))); }
+
+inline vi itof(vi a) { vf r; for (int i = 0; i < 16; i++) r[i] = (float) a[i]; return (vi) r; }
+inline vi ftoi(vi a) { vf x = (vf) a; vi r; for (int i = 0; i < 16; i++) r[i] = (int32_t) x[i]; return r; }
+
+inline vi recip(vi a) {
+  vf x = (vf) a; vf r;
+  for (int i = 0; i < 16; i++) r[i] = (x[i] != 0)? 1/x[i] : 0;
+  return (vi) r;
+}
+
+inline vi recipsqrt(vi a) {
+  vf x = (vf) a; vf r;
+  for (int i = 0; i < 16; i++) { float s = sqrtf(x[i]); r[i] = (s != 0)? 1/s : 0; }
+  return (vi) r;
+}
+
+inline vi vexp2(vi a) { vf x = (vf) a; vf r; for (int i = 0; i < 16; i++) r[i] = exp2f(x[i]); return (vi) r; }
+inline vi vlog2(vi a) { vf x = (vf) a; vf r; for (int i = 0; i < 16; i++) r[i] = log2f(x[i]); return (vi) r; }
+
+inline vi rotate(vi a, vi b) {
+  int n = b[0];
+  vi r;
+  for (int i = 0; i < 16; i++) r[(i + n) & 15] = a[i];
+  return r;
+}
+
+inline vi load(Heap const &h, vi addr) {
+  vi r;
+  for (int i = 0; i < 16; i++) {
+    uint32_t w = ((uint32_t) addr[i] + 4*i - h.phy) >> 2;
+    r[i] = (w < h.words)? (int32_t) h.base[w] : 0;
+  }
+  return r;
+}
+
+inline void store(Heap const &h, vi addr, vi val) {
+  for (int i = 0; i < 16; i++) {
+    uint32_t w = ((uint32_t) addr[i] + 4*i - h.phy) >> 2;
+    if (w < h.words) h.base[w] = (uint32_t) val[i];
+  }
+}
+
+}  // anon namespace
+
+)";
+
+
+class CodeGen {
+public:
+  CodeGen(int numVars, char const *entry) : m_numVars(numVars), m_entry(entry) {}
+
+  std::string generate(Stmts const &stmts);
+
+private:
+  int m_numVars;
+  char const *m_entry;    // Name of the generated function
+  int m_indent = 2;
+  int m_count  = 0;       // For unique names of temporaries
+  std::string m_out;
+  std::vector<FunctionDef::Ptr> m_functions;  // Called functions, callees before callers
+
+  void line(std::string const &str) { m_out << indentBy(m_indent) << str << "\n"; }
+  std::string tmp(char const *prefix) { std::string ret; ret << prefix << m_count++; return ret; }
+
+  void collect_functions(Stmts const &stmts);
+  std::string function_name(FunctionDef const &f) const;
+
+  std::string expr(Expr::Ptr e);
+  std::string apply(Expr const &e, std::string const &a, std::string const &b);
+  std::string bexpr(BExpr::Ptr e);
+  std::string cexpr(CExpr::Ptr e);
+
+  void stmts(Stmts const &stmts);
+  void stmt(Stmt::Ptr s);
+  void where_stmts(Stmts const &stmts, std::string const &cond);
+  void where_stmt(Stmt::Ptr s, std::string const &cond);
+  void call(Stmt const &s);
+  void assign_var(Var v, std::string const &val, std::string const &cond);
+};
+
+
+int32_t float_bits(float x) {
+  int32_t ret;
+  memcpy(&ret, &x, sizeof(ret));
+  return ret;
+}
+
+
+std::string var_name(Var v) {
+  std::string ret;
+  ret << "v" << v.id();
+  return ret;
+}
+
+
+/**
+ * Find the called functions, also within function bodies.
+ *
+ * The functions are stored in order of definition; a called function is
+ * defined before its caller.
+ */
+void CodeGen::collect_functions(Stmts const &stmts) {
+  for (auto const &s : stmts) {
+    if (!s) continue;
+
+    switch (s->tag) {
+      case Stmt::SEQ:
+        collect_functions(s->body());
+        break;
+
+      case Stmt::WHERE:
+      case Stmt::IF:
+        collect_functions(s->then_block());
+        collect_functions(s->else_block());
+        break;
+
+      case Stmt::WHILE:
+        collect_functions(s->body());
+        break;
+
+      case Stmt::CALL: {
+        auto f = s->function();
+        if (std::find(m_functions.begin(), m_functions.end(), f) == m_functions.end()) {
+          collect_functions(f->body);
+          m_functions.push_back(f);
+        }
+      }
+      break;
+
+      default:
+        break;
+    }
+  }
+}
+
+
+std::string CodeGen::function_name(FunctionDef const &f) const {
+  std::string ret;
+  ret << "fn_" << f.link.id();  // The link register is unique per function
+  return ret;
+}
+
+
+/**
+ * Generate the statements for evaluating an expression.
+ *
+ * Every subexpression is assigned to a temporary, so that the order of evaluation
+ * is the same as in the interpreter. This matters for uniforms.
+ *
+ * @return name of the variable holding the result
+ */
+std::string CodeGen::expr(Expr::Ptr e) {
+  std::string val;
+
+  switch (e->tag()) {
+    case Expr::INT_LIT:   val << "bc(" << e->intLit << ")";                 break;
+    case Expr::FLOAT_LIT: val << "bc(" << float_bits(e->floatLit) << ")";   break;  // Bit pattern, to be exact
+
+    case Expr::DEREF: val << "load(heap, " << expr(e->deref_ptr()) << ")"; break;
+
+    case Expr::APPLY: {
+      std::string a = expr(e->lhs());
+      std::string b = (e->rhs() != nullptr)? expr(e->rhs()) : "bc(0)";
+      val = apply(*e, a, b);
+    }
+    break;
+
+    case Expr::VAR: {
+      Var v = e->var();
+
+      switch (v.tag()) {
+        case STANDARD: return var_name(v);
+        case UNIFORM:  val = "uniform()";  break;
+        case ELEM_NUM: val = "elem_num()"; break;
+
+        default:
+          assertq(false, "cpu::generate(): variable type not supported", true);
+          break;
+      }
+    }
+    break;
+  }
+
+  std::string ret = tmp("t");
+  line("vi const " + ret + " = " + val + ";");
+  return ret;
+}
+
+
+std::string CodeGen::apply(Expr const &e, std::string const &a, std::string const &b) {
+  std::string ret;
+  Op const &op = e.apply_op();
+
+  // SFU functions, which have no ALU op
+  switch (op.op) {
+    case RECIP:     ret << "recip(" << a << ")";     return ret;
+    case RECIPSQRT: ret << "recipsqrt(" << a << ")"; return ret;
+    case EXP:       ret << "vexp2(" << a << ")";     return ret;
+    case LOG:       ret << "vlog2(" << a << ")";     return ret;
+    default: break;
+  }
+
+  switch (op.opcode()) {
+    case ALUOp::A_FADD:   ret << "(vi) ((vf) " << a << " + (vf) " << b << ")"; break;
+    case ALUOp::A_FSUB:   ret << "(vi) ((vf) " << a << " - (vf) " << b << ")"; break;
+    case ALUOp::M_FMUL:   ret << "(vi) ((vf) " << a << " * (vf) " << b << ")"; break;
+    case ALUOp::A_FMIN:   ret << "vfmin(" << a << ", " << b << ")";            break;
+    case ALUOp::A_FMAX:   ret << "vfmax(" << a << ", " << b << ")";            break;
+    case ALUOp::A_ItoF:   ret << "itof(" << a << ")";                         break;
+    case ALUOp::A_FtoI:   ret << "ftoi(" << a << ")";                         break;
+    case ALUOp::A_ADD:    ret << a << " + " << b;                             break;
+    case ALUOp::A_SUB:    ret << a << " - " << b;                             break;
+    case ALUOp::M_MUL24:  ret << "mul24(" << a << ", " << b << ")";           break;
+    case ALUOp::A_MIN:    ret << "imin(" << a << ", " << b << ")";            break;
+    case ALUOp::A_MAX:    ret << "imax(" << a << ", " << b << ")";            break;
+    case ALUOp::A_SHL:    ret << "shl(" << a << ", " << b << ")";             break;
+    case ALUOp::A_ASR:    ret << "asr(" << a << ", " << b << ")";             break;
+    case ALUOp::A_SHR:    ret << "shr(" << a << ", " << b << ")";             break;
+    case ALUOp::A_ROR:    ret << "ror(" << a << ", " << b << ")";             break;
+    case ALUOp::A_BAND:   ret << a << " & " << b;                             break;
+    case ALUOp::A_BOR:    ret << a << " | " << b;                             break;
+    case ALUOp::A_BXOR:   ret << a << " ^ " << b;                             break;
+    case ALUOp::A_BNOT:   ret << "~" << a;                                    break;
+    case ALUOp::M_ROTATE: ret << "rotate(" << a << ", " << b << ")";          break;
+
+    default: {
+      std::string msg;
+      msg << "cpu::generate(): operator not supported: " << op.dump();
+      assertq(false, msg, true);
+    }
+    break;
+  }
+
+  return ret;
+}
+
+
+/**
+ * @return name of a mask vector, with -1 for true lanes and 0 for false lanes
+ */
+std::string CodeGen::bexpr(BExpr::Ptr e) {
+  std::string val;
+
+  switch (e->tag()) {
+    case NOT: val << "~" << bexpr(e->neg()); break;
+
+    case AND:
+    case OR: {
+      std::string a = bexpr(e->lhs());
+      std::string b = bexpr(e->rhs());
+      val << a << ((e->tag() == AND)? " & " : " | ") << b;
+    }
+    break;
+
+    case CMP: {
+      std::string a = expr(e->cmp_lhs());
+      std::string b = expr(e->cmp_rhs());
+
+      if (e->cmp.type() == FLOAT) {
+        val << "(vf) " << a << " " << e->cmp.to_string() << " (vf) " << b;
+      } else {
+        // As in the interpreter: the ordering is determined by the sign of the difference
+        switch (e->cmp.op()) {
+          case CmpOp::EQ:  val << a << " == " << b;          break;
+          case CmpOp::NEQ: val << a << " != " << b;          break;
+          case CmpOp::LT:  val << "(" << a << " - " << b << ") < 0";  break;
+          case CmpOp::GE:  val << "(" << a << " - " << b << ") >= 0"; break;
+          case CmpOp::LE:  val << "(" << b << " - " << a << ") >= 0"; break;
+          case CmpOp::GT:  val << "(" << b << " - " << a << ") < 0";  break;
+        }
+      }
+    }
+    break;
+  }
+
+  std::string ret = tmp("m");
+  line("vi const " + ret + " = " + val + ";");
+  return ret;
+}
+
+
+/**
+ * @return C++ boolean expression for the condition
+ */
+std::string CodeGen::cexpr(CExpr::Ptr e) {
+  std::string ret;
+  ret << ((e->tag() == ALL)? "all(" : "any(") << bexpr(e->bexpr()) << ")";
+  return ret;
+}
+
+
+/**
+ * @param cond  name of mask vector for a conditional assignment, empty for unconditional
+ */
+void CodeGen::assign_var(Var v, std::string const &val, std::string const &cond) {
+  switch (v.tag()) {
+    case STANDARD:
+      if (cond.empty()) {
+        line(var_name(v) + " = " + val + ";");
+      } else {
+        line(var_name(v) + " = select(" + cond + ", " + val + ", " + var_name(v) + ");");
+      }
+      break;
+
+    case TMU0_ADDR:  // Load via TMU
+      assert(cond.empty());
+      line("load_buf[(load_head + load_count++) & 7] = load(heap, " + val + ");");
+      break;
+
+    default:
+      assertq(false, "cpu::generate(): assignment to variable type not supported", true);
+      break;
+  }
+}
+
+
+void CodeGen::call(Stmt const &s) {
+  auto f = s.function();
+  auto const &args = s.call_args();
+  assert(args.size() == f->params.size());
+
+  for (int i = 0; i < (int) args.size(); i++) {
+    assign_var(f->params[i], expr(args[i]), "");
+  }
+
+  line(function_name(*f) + "();");
+}
+
+
+void CodeGen::where_stmts(Stmts const &stmts, std::string const &cond) {
+  for (auto const &s : stmts) {
+    where_stmt(s, cond);
+  }
+}
+
+
+void CodeGen::where_stmt(Stmt::Ptr s, std::string const &cond) {
+  if (!s) return;
+
+  switch (s->tag) {
+    case Stmt::GATHER_PREFETCH:
+    case Stmt::SKIP:
+      break;
+
+    case Stmt::SEQ:
+      where_stmts(s->body(), cond);
+      break;
+
+    case Stmt::ASSIGN:
+      assertq(s->assign_lhs()->tag() == Expr::VAR, "V3DLib: only var assignments permitted in 'where'");
+      assign_var(s->assign_lhs()->var(), expr(s->assign_rhs()), cond);
+      break;
+
+    case Stmt::WHERE: {
+      std::string b    = bexpr(s->where_cond());
+      std::string then = tmp("m");
+      std::string els  = tmp("m");
+      line("vi const " + then + " = " + cond + " & " + b + ";");
+      line("vi const " + els  + " = " + cond + " & ~" + b + ";");
+      where_stmts(s->then_block(), then);
+      where_stmts(s->else_block(), els);
+    }
+    break;
+
+    case Stmt::CALL:
+      // The body is run for all lanes, as in the interpreter
+      call(*s);
+      break;
+
+    default:
+      assertq(false, "V3DLib: only assignments, function calls and nested 'where' statements can occur in a 'where' statement");
+      break;
+  }
+}
+
+
+void CodeGen::stmts(Stmts const &stmts) {
+  for (auto const &s : stmts) {
+    stmt(s);
+  }
+}
+
+
+void CodeGen::stmt(Stmt::Ptr s) {
+  if (!s) return;
+
+  switch (s->tag) {
+    case Stmt::GATHER_PREFETCH:
+    case Stmt::SKIP:
+      break;
+
+    case Stmt::SEQ:
+      stmts(s->body());
+      break;
+
+    case Stmt::ASSIGN: {
+      auto lhs = s->assign_lhs();
+      std::string val = expr(s->assign_rhs());
+
+      if (lhs->tag() == Expr::VAR) {
+        assign_var(lhs->var(), val, "");
+      } else {
+        assert(lhs->tag() == Expr::DEREF);
+        line("store(heap, " + expr(lhs->deref_ptr()) + ", " + val + ");");
+      }
+    }
+    break;
+
+    case Stmt::WHERE: {
+      std::string b = bexpr(s->where_cond());
+      std::string els = tmp("m");
+      line("vi const " + els + " = ~" + b + ";");
+      where_stmts(s->then_block(), b);
+      where_stmts(s->else_block(), els);
+    }
+    break;
+
+    case Stmt::IF:
+      line("{");
+      m_indent += 2;
+      line("bool const cond = " + cexpr(s->if_cond()) + ";");
+      line("if (cond) {");
+      m_indent += 2;
+      stmts(s->then_block());
+      m_indent -= 2;
+      line("} else {");
+      m_indent += 2;
+      stmts(s->else_block());
+      m_indent -= 2;
+      line("}");
+      m_indent -= 2;
+      line("}");
+      break;
+
+    case Stmt::WHILE:
+      line("for (;;) {");
+      m_indent += 2;
+      line("if (!" + cexpr(s->loop_cond()) + ") break;");
+      stmts(s->body());
+      m_indent -= 2;
+      line("}");
+      break;
+
+    case Stmt::CALL:
+      call(*s);
+      break;
+
+    case Stmt::LOAD_RECEIVE: {
+      auto e = s->address();
+      assert(e->tag() == Expr::VAR);
+      line("load_count--;");
+      assign_var(e->var(), "load_buf[load_head++ & 7]", "");
+    }
+    break;
+
+    case Stmt::SEMA_INC: line("sema(sema_state, " + std::to_string(s->dma.semaId()) + ", 1);"); break;
+    case Stmt::SEMA_DEC: line("sema(sema_state, " + std::to_string(s->dma.semaId()) + ", 0);"); break;
+
+    case Stmt::SET_READ_STRIDE:
+    case Stmt::SET_WRITE_STRIDE:
+    case Stmt::SEND_IRQ_TO_HOST:
+    case Stmt::DMA_READ_WAIT:
+    case Stmt::DMA_WRITE_WAIT:
+    case Stmt::SETUP_VPM_READ:
+    case Stmt::SETUP_VPM_WRITE:
+    case Stmt::SETUP_DMA_READ:
+    case Stmt::SETUP_DMA_WRITE:
+      // Ignored, as in the interpreter
+      break;
+
+    case Stmt::DMA_START_READ:
+    case Stmt::DMA_START_WRITE:
+      assertq(false, "V3DLib: DMA access not supported by the CPU backend", true);
+      break;
+
+    default:
+      assertq(false, "cpu::generate(): unexpected stmt-tag", true);
+      break;
+  }
+}
+
+
+std::string CodeGen::generate(Stmts const &in_stmts) {
+  collect_functions(in_stmts);
+
+  m_out << PRELUDE
+        << "extern \"C\" void " << m_entry << "(\n"
+        << "  uint32_t *heap_base, uint32_t heap_phy, uint32_t heap_words,\n"
+        << "  int32_t const *uniforms, int qpu_id, int num_qpus, int finish,\n"
+        << "  void *sema_state, SemaFunc sema\n"
+        << ") {\n";
+
+  line("Heap const heap = { heap_base, heap_phy, heap_words };");
+  line("int next_uniform = -3;  // Header: qpu id, num qpus, termination count");
+  line("vi  load_buf[8];");
+  line("int load_head  = 0;");
+  line("int load_count = 0;");
+  line("");
+  line("auto uniform = [&] () -> vi {");
+  line("  int32_t u = (next_uniform == -3)? qpu_id : (next_uniform == -2)? num_qpus");
+  line("            : (next_uniform == -1)? finish : uniforms[next_uniform];");
+  line("  next_uniform++;");
+  line("  return bc(u);");
+  line("};");
+  line("");
+
+  for (int i = 0; i <= m_numVars; i++) {
+    line("vi v" + std::to_string(i) + " = {};");
+  }
+
+  for (auto const &f : m_functions) {
+    line("");
+    line("auto " + function_name(*f) + " = [&] () {  // " + f->name);
+    m_indent += 2;
+    stmts(f->body);
+    m_indent -= 2;
+    line("};");
+  }
+
+  line("");
+  stmts(in_stmts);
+
+  line("(void) load_count;");  // Avoid warning if no loads are done
+  m_out << "}\n";
+
+  return m_out;
+}
+
+}  // anon namespace
+
+
+/**
+ * Generate C++ code for the passed source statements.
+ *
+ * The resulting code defines a function with C linkage named `entry`,
+ * which runs the kernel for a single QPU. Its signature is `KernelFunc` in `NativeKernel.h`.
+ */
+std::string generate(Stmts const &stmts, int numVars, char const *entry) {
+  CodeGen gen(numVars, entry);
+  return gen.generate(stmts);
+}
+
+}  // namespace cpu
+}  // namespace V3DLib
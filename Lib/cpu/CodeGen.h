@@ -0,0 +1,16 @@
+#ifndef _V3DLIB_CPU_CODEGEN_H_
+#define _V3DLIB_CPU_CODEGEN_H_
+#include <string>
+#include "Source/Stmt.h"
+
+namespace V3DLib {
+namespace cpu {
+
+extern char const *ENTRY_POINT;
+
+std::string generate(Stmts const &stmts, int numVars, char const *entry = ENTRY_POINT);
+
+}  // namespace cpu
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_CPU_CODEGEN_H_
@@ -0,0 +1,346 @@
+#include "NativeKernel.h"
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>    // getenv()
+#include <fstream>
+#include <functional> // hash
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>   // getpid(), getuid(), fork(), execvp()
+#include "CodeGen.h"
+#include "LibSettings.h"
+#include "Support/basics.h"
+
+namespace V3DLib {
+namespace cpu {
+
+using ::operator<<;  // C++ weirdness
+
+namespace {
+
+// Flags which the generated code depends on; added to the compiler from `LibSettings`
+char const *REQUIRED_FLAGS = "-fwrapv -fPIC -shared";
+
+// Max number of libraries with the same hash of the source in the cache directory
+int const MAX_HASH_SLOTS = 16;
+
+
+/**
+ * Semaphores shared by the QPU threads of a single kernel invocation
+ */
+struct Semaphores {
+  std::mutex mutex;
+  std::condition_variable changed;
+  int count[16] = {0};
+};
+
+
+/**
+ * Increment or decrement a semaphore, blocking until this is possible.
+ *
+ * The range of a semaphore is 0..15, as on the hardware.
+ */
+void sema(void *state, int id, int inc) {
+  assert(0 <= id && id < 16);
+  auto &s = *((Semaphores *) state);
+
+  std::unique_lock<std::mutex> lock(s.mutex);
+
+  if (inc) {
+    s.changed.wait(lock, [&s, id] { return s.count[id] < 15; });
+    s.count[id]++;
+  } else {
+    s.changed.wait(lock, [&s, id] { return s.count[id] > 0; });
+    s.count[id]--;
+  }
+
+  s.changed.notify_all();
+}
+
+
+/**
+ * Check that a file or directory is owned by the current user and not writable by others.
+ *
+ * Only such files can be trusted for loading as code.
+ */
+bool is_private(std::string const &path, bool is_dir) {
+  struct stat st;
+  if (lstat(path.c_str(), &st) != 0) return false;
+  if (is_dir? !S_ISDIR(st.st_mode) : !S_ISREG(st.st_mode)) return false;
+  if (st.st_uid != getuid()) return false;
+  return (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+
+/**
+ * Create a directory with mode 0700 if it does not exist, and check that it is private.
+ */
+bool make_private_dir(std::string const &path) {
+  mkdir(path.c_str(), S_IRWXU);  // Fails harmlessly if it exists; the check below decides
+  return is_private(path, true);
+}
+
+
+/**
+ * Get the directory for the compiled libraries.
+ *
+ * This is `$XDG_CACHE_HOME/v3dlib`, or `$HOME/.cache/v3dlib` if that is not set.
+ * The directory must be owned by the current user and not be writable by others,
+ * otherwise a fresh directory is created with `mkdtemp()` for the current process.
+ */
+std::string const &cache_dir() {
+  static std::string dir;
+  if (!dir.empty()) return dir;
+
+  std::string cache;
+  char const *xdg  = getenv("XDG_CACHE_HOME");
+  char const *home = getenv("HOME");
+
+  if (xdg != nullptr && *xdg == '/') {
+    cache = xdg;
+  } else if (home != nullptr && *home == '/') {
+    cache = std::string(home) + "/.cache";
+    mkdir(cache.c_str(), S_IRWXU);
+  }
+
+  if (!cache.empty() && make_private_dir(cache + "/v3dlib")) {
+    dir = cache + "/v3dlib";
+    return dir;
+  }
+
+  char const *tmp = getenv("TMPDIR");
+  std::string templ = (tmp != nullptr && *tmp != '\0')? tmp : "/tmp";
+  templ += "/v3dlib-cpu-XXXXXX";
+
+  std::vector<char> buf(templ.begin(), templ.end());
+  buf.push_back('\0');
+  assertq(mkdtemp(buf.data()) != nullptr, "NativeKernel: could not create directory " + templ, true);
+  dir = buf.data();
+  return dir;
+}
+
+
+std::string read_file(std::string const &filename) {
+  std::ifstream in(filename);
+  std::stringstream ret;
+  ret << in.rdbuf();
+  return ret.str();
+}
+
+
+std::vector<std::string> split_words(std::string const &str) {
+  std::vector<std::string> ret;
+  std::istringstream in(str);
+  std::string word;
+
+  while (in >> word) {
+    ret.push_back(word);
+  }
+
+  return ret;
+}
+
+
+/**
+ * Run a command without going through the shell, with stderr redirected to `err_file`.
+ *
+ * The arguments are passed as is, so paths with spaces or shell characters are no issue.
+ *
+ * @return true if the command ran and exited with status 0
+ */
+bool run_command(std::vector<std::string> const &args, std::string const &err_file) {
+  assert(!args.empty());
+
+  std::vector<char *> argv;
+  for (auto const &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  pid_t pid = fork();
+  if (pid < 0) return false;
+
+  if (pid == 0) {
+    // Child; only async-signal-safe calls from here on
+    int fd = open(err_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd >= 0) {
+      dup2(fd, 2);
+      close(fd);
+    }
+
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return false;
+  }
+
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}  // anon namespace
+
+
+NativeKernel::NativeKernel(Stmts const &stmts, int numVars) {
+  m_source = generate(stmts, numVars);
+  compile();
+}
+
+
+NativeKernel::~NativeKernel() {
+  if (m_handle != nullptr) {
+    dlclose(m_handle);
+  }
+}
+
+
+/**
+ * Compile the generated code to a shared library and load it.
+ *
+ * If a library for the same code and compiler already exists in the cache directory, it is reused,
+ * but only if it is owned by the current user and not writable by others.
+ *
+ * The file name is derived from a hash of the code. The code itself, preceded by the compiler command,
+ * is stored next to the library and compared before reuse, so that a hash collision can not
+ * load the wrong kernel. Colliding kernels get the next free slot for the hash.
+ */
+void NativeKernel::compile() {
+  static std::mutex compile_mutex;  // Protects the static cache dir
+  std::lock_guard<std::mutex> guard(compile_mutex);
+
+  std::vector<std::string> args = split_words(LibSettings::cpu_compiler());
+  for (auto const &flag : split_words(REQUIRED_FLAGS)) {
+    args.push_back(flag);
+  }
+
+  std::string command;
+  for (auto const &arg : args) {
+    command << arg << " ";
+  }
+
+  std::string source;
+  source << "// " << command << "\n" << m_source;
+
+  char hash[32];
+  snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) std::hash<std::string>()(source));
+
+  std::string base;
+  bool found = false;
+
+  for (int slot = 0; slot < MAX_HASH_SLOTS; ++slot) {
+    base.clear();
+    base << cache_dir() << "/kernel-" << hash << "-" << slot;
+    m_library = base + ".so";
+
+    struct stat st;
+    if (lstat(m_library.c_str(), &st) != 0) break;  // Free slot
+
+    if (is_private(m_library, false) && is_private(base + ".cpp", false)
+     && read_file(base + ".cpp") == source) {
+      found = true;
+      break;
+    }
+  }
+
+  if (!found) {
+    // Unique names for the intermediate files; other processes may be compiling the same kernel
+    std::string tmp;
+    tmp << base << "-" << getpid();
+    std::string src_file = tmp + ".cpp";
+    std::string lib_file = tmp + ".so";
+    std::string err_file = tmp + ".err";
+
+    {
+      std::ofstream out(src_file);
+      out << source;
+      assertq(out.good(), "NativeKernel: could not write source file " + src_file, true);
+    }
+
+    args.push_back("-o");
+    args.push_back(lib_file);
+    args.push_back(src_file);
+
+    if (!run_command(args, err_file)) {
+      std::string msg;
+      msg << "NativeKernel: compile failed: " << command << "-o " << lib_file << " " << src_file << "\n"
+          << read_file(err_file);
+      remove(src_file.c_str());
+      remove(err_file.c_str());
+      assertq(false, msg, true);
+    }
+
+    remove(err_file.c_str());
+
+    // Rename is atomic, the files are either complete or not present.
+    // The source goes first, so that a present library always has its source next to it.
+    chmod(src_file.c_str(), S_IRUSR | S_IWUSR);
+    chmod(lib_file.c_str(), S_IRWXU);
+    if (rename(src_file.c_str(), (base + ".cpp").c_str()) != 0
+     || rename(lib_file.c_str(), m_library.c_str()) != 0) {
+      remove(src_file.c_str());
+      remove(lib_file.c_str());
+      assertq(false, "NativeKernel: could not rename library to " + m_library, true);
+    }
+  }
+
+  m_handle = dlopen(m_library.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (m_handle == nullptr) {
+    std::string msg;
+    msg << "NativeKernel: could not load " << m_library << ": " << dlerror();
+    assertq(false, msg, true);
+  }
+
+  m_func = (KernelFunc) dlsym(m_handle, ENTRY_POINT);
+  assertq(m_func != nullptr, "NativeKernel: kernel entry point not found", true);
+}
+
+
+/**
+ * Run a compiled kernel, with a host thread per QPU.
+ */
+void run(KernelFunc func, QpuRange const &qpus, IntList const &uniforms, BufferObject &heap) {
+  assert(func != nullptr);
+
+  std::vector<int32_t> params;
+  for (int i = 0; i < (int) uniforms.size(); i++) {
+    params.push_back(uniforms[i]);
+  }
+
+  Semaphores semaphores;
+
+  auto run_qpu = [&] (int i) {
+    func((uint32_t *) heap.usr_address(), heap.phy_address(), heap.size()/4,
+         params.data(), qpus.id(i), qpus.total, qpus.finish(i), &semaphores, sema);
+  };
+
+  if (qpus.count == 1) {
+    run_qpu(0);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < qpus.count; i++) {
+    threads.emplace_back(run_qpu, i);
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+
+void NativeKernel::invoke(QpuRange const &qpus, IntList const &uniforms, BufferObject &heap) {
+  run(m_func, qpus, uniforms, heap);
+}
+
+}  // namespace cpu
+}  // namespace V3DLib
@@ -0,0 +1,73 @@
+#ifndef _V3DLIB_CPU_NATIVEKERNEL_H_
+#define _V3DLIB_CPU_NATIVEKERNEL_H_
+#include <stdint.h>
+#include <string>
+#include "Common/Seq.h"
+#include "Common/BufferObject.h"
+#include "Common/QpuRange.h"
+#include "Source/Stmt.h"
+
+namespace V3DLib {
+namespace cpu {
+
+/**
+ * Signature of the generated function, which runs the kernel for a single QPU.
+ */
+using KernelFunc = void (*)(
+  uint32_t *heap_base, uint32_t heap_phy, uint32_t heap_words,
+  int32_t const *uniforms, int qpu_id, int num_qpus, int finish,
+  void *sema_state, void (*sema)(void *state, int id, int inc)
+);
+
+void run(KernelFunc func, QpuRange const &qpus, IntList const &uniforms, BufferObject &heap);
+
+
+/**
+ * Kernel compiled to native code for the host CPU.
+ *
+ * The source code of the kernel is translated to C++ with 16-lane vector operations
+ * (see `CodeGen.cpp`), which is compiled to a shared library with the compiler
+ * set in `LibSettings::cpu_compiler()` and loaded at runtime.
+ *
+ * This is an alternative to the interpreter and emulator, which is orders of magnitude faster.
+ * Results are the same as for the interpreter, except for the SFU functions, which are
+ * calculated with full float precision.
+ *
+ * ------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. Each QPU runs on a separate host thread. As on the hardware, the QPUs run
+ *    concurrently and synchronize only via semaphores.
+ *
+ * 2. The compiled libraries are cached in `$XDG_CACHE_HOME/v3dlib` (default `~/.cache/v3dlib`),
+ *    under a name derived from the generated code. A kernel is therefore compiled only once,
+ *    also over program runs. The directory is created with mode 0700; cached libraries are only
+ *    loaded if they are owned by the current user and not writable by others.
+ *    The generated code is kept next to the library and compared before reuse.
+ *    The compiler is run directly, not via the shell.
+ *
+ * 3. DMA (i.e. VPM access) is not supported, as in the interpreter.
+ */
+class NativeKernel {
+public:
+  NativeKernel(Stmts const &stmts, int numVars);
+  ~NativeKernel();
+
+  void invoke(QpuRange const &qpus, IntList const &uniforms, BufferObject &heap);
+  std::string const &source() const { return m_source; }
+  std::string const &library() const { return m_library; }
+
+private:
+  std::string m_source;         // Generated C++ code
+  std::string m_library;        // Path of compiled shared library
+  void       *m_handle = nullptr;
+  KernelFunc  m_func   = nullptr;
+
+  void compile();
+};
+
+}  // namespace cpu
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_CPU_NATIVEKERNEL_H_
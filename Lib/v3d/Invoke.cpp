@@ -0,0 +1,56 @@
+#include "Invoke.h"
+#include "Driver.h"
+#include "Support/basics.h"
+
+namespace V3DLib {
+namespace v3d {
+namespace {
+
+#ifdef QPU_MODE
+
+void load_uniforms(Data &unif, QpuRange const &qpus, Data const &devnull, Data const &done, IntList const &params) {
+  int offset = 0;
+
+  // Add the common uniforms
+  unif[offset++] = qpus.count;            // num qpu's running for this job; replaced by qpu id in kernel
+  unif[offset++] = qpus.total;            // num qpu's as seen by kernel
+  unif[offset++] = devnull.getAddress();  // Memory location for values to be discarded
+
+  for (int j = 0; j < params.size(); j++) {
+    unif[offset++] = params[j];
+  }
+
+  // The last item is for the 'done' location;
+  unif[offset] = (uint32_t) done.getAddress();
+}
+
+#endif  // QPU_MODE
+
+}  // anon namespace
+
+
+/**
+ * Run the kernel on v3d hardware
+ *
+ * The QPU id's are derived from the thread index in the kernel, see `add_init()` in `v3d/SourceTranslate.cpp`.
+ */
+void invoke(QpuRange const &qpus, Data &devnull, Code &codeMem, IntList &params) {
+#ifndef QPU_MODE
+  assertq(false, "Cannot run v3d invoke(), QPU_MODE not enabled");
+#else
+  assert(!codeMem.empty());
+
+  Data unif(params.size() + 4);
+  Data done(1);
+  done[0] = 0;
+
+  load_uniforms(unif, qpus, devnull, done, params);
+
+  Driver drv;
+  drv.add_bo(getBufferObject().getHandle());
+  drv.execute(codeMem, &unif, qpus.count);
+#endif  // QPU_MODE
+}
+
+}  // namespace v3d
+}  // namespace V3DLib
@@ -0,0 +1,15 @@
+#ifndef _V3DLIB_V3D_INVOKE_H_
+#define _V3DLIB_V3D_INVOKE_H_
+#include "../Common/Seq.h"
+#include "../Common/SharedArray.h"
+#include "../Common/QpuRange.h"
+
+namespace V3DLib {
+namespace v3d {
+
+void invoke(QpuRange const &qpus, Data &devnull, Code &codeMem, IntList &params);
+
+}  // namespace v3d
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_V3D_INVOKE_H_
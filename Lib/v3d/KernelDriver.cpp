@@ -1,13 +1,12 @@
 #include "KernelDriver.h"
 #include <iostream>
 #include <memory>
-#include "Driver.h"
+#include "Invoke.h"
 #include "Source/Translate.h"
 #include "Target/SmallLiteral.h"  // decodeSmallLit()
 #include "Target/RemoveLabels.h"
 #include "instr/Snippets.h"
 #include "Support/basics.h"
-#include "Support/Timer.h"
 #include "SourceTranslate.h"
 #include "instr/Encode.h"
 #include "instr/Mnemonics.h"
@@ -1178,42 +1177,6 @@ void combine(Instructions &instructions) {
   }
 }
 
-
-void load_uniforms(Data &unif, int numQPUs, Data const &devnull, Data const &done, IntList const &params) {
-  int offset = 0;
-
-  // Add the common uniforms
-  unif[offset++] = 0;                     // qpu number (id for current qpu) - 0 is for 1 QPU
-  unif[offset++] = numQPUs;               // num qpu's running for this job
-  unif[offset++] = devnull.getAddress();  // Memory location for values to be discarded
-
-  for (int j = 0; j < params.size(); j++) {
-    unif[offset++] = params[j];
-  }
-
-  // The last item is for the 'done' location;
-  unif[offset] = (uint32_t) done.getAddress();
-}
-
-
-void invoke(int numQPUs, Data &devnull, Code &codeMem, IntList &params) {
-#ifndef QPU_MODE
-  assertq(false, "Cannot run v3d invoke(), QPU_MODE not enabled");
-#else
-  assert(!codeMem.empty());
-
-  Data unif(params.size() + 4);
-  Data done(1);
-  done[0] = 0;
-
-  load_uniforms(unif, numQPUs, devnull, done, params);
-
-  Driver drv;
-  drv.add_bo(getBufferObject().getHandle());
-  drv.execute(codeMem, &unif, numQPUs);
-#endif  // QPU_MODE
-}
-
 }  // anon namespace
 
 
@@ -1230,9 +1193,23 @@ void KernelDriver::encode() {
   assert(!qpuCodeMem.allocated());
 
   // Encode target instructions
-  _encode(m_targetCode, instructions);
-  combine(instructions);
-  removeLabels(instructions);
+  {
+    PhaseTimer t("encode", m_targetCode.size());
+    _encode(m_targetCode, instructions);
+    t.end((int) instructions.size());
+  }
+
+  {
+    PhaseTimer t("combine", (int) instructions.size());
+    combine(instructions);
+    t.end((int) instructions.size());
+  }
+
+  {
+    PhaseTimer t("removeLabels", (int) instructions.size());
+    removeLabels(instructions);
+    t.end((int) instructions.size());
+  }
 
   if (!instructions.check_consistent()) {
     std::string err;
@@ -1268,21 +1245,15 @@ std::vector<uint64_t> KernelDriver::to_opcodes() {
 
 
 void KernelDriver::compile_intern() {
-  //Timer t1("compile_intern", true);
-
   obtain_ast();
 
-  //Timer t3("translate_stmt");
-  translate_stmt(m_targetCode, m_body);  // performance hog 2 12/45s
-  //t3.end();
-
+  PhaseTimer t("translate_stmt", 0);
+  translate_stmt(m_targetCode, m_body);
   insertInitBlock(m_targetCode);
   add_init(m_targetCode);
+  t.end(m_targetCode.size());
 
-  //Timer t5("compile_postprocess");
-  compile_postprocess(m_targetCode);  // performance hog 1 31/45s
-  //t5.end();
-
+  compile_postprocess(m_targetCode);
   encode();
 }
 
@@ -1307,11 +1278,14 @@ void KernelDriver::allocate() {
 }
 
 
-void KernelDriver::invoke_intern(int numQPUs, IntList &params) {
-  if (numQPUs != 1 && numQPUs != 8) {
+void KernelDriver::invoke_intern(QpuRange const &qpus, IntList &params) {
+  if (qpus.count != 1 && qpus.count != 8) {
     error("Num QPU's must be 1 or 8", true);
   }
 
+  // The QPU id's are derived from the thread index, see `add_init()` in `v3d/SourceTranslate.cpp`
+  assertq(qpus.first == 0, "v3d: kernels can only run on the first QPU id's");
+
   assertq(!has_errors(), "v3d kernels has errors, can not invoke");
 
   allocate();
@@ -1321,7 +1295,7 @@ void KernelDriver::invoke_intern(int numQPUs, IntList &params) {
     devnull.alloc(16);
   }
 
-  v3d::invoke(numQPUs, devnull, qpuCodeMem, params);
+  v3d::invoke(qpus, devnull, qpuCodeMem, params);
 }
 
 
@@ -28,6 +28,7 @@ public:
   KernelDriver(KernelDriver &&a) = default;
 
   void encode() override;
+  std::vector<uint64_t> to_opcodes() override;
   int kernel_size() const { return (int) instructions.size(); }
 
 private:
@@ -37,10 +38,9 @@ private:
   Data          devnull;
 
   void compile_intern() override;
-  void invoke_intern(int numQPUs, IntList &params) override;
+  void invoke_intern(QpuRange const &qpus, IntList &params) override;
 
   void allocate();
-  std::vector<uint64_t> to_opcodes();
   void emit_opcodes(FILE *f) override;
 };
 
@@ -1,7 +1,6 @@
 #include "SourceTranslate.h"
 #include <iostream>
 #include "Support/basics.h"
-#include "Support/Timer.h"
 #include "Source/Translate.h"
 #include "Source/Stmt.h"
 #include "Liveness/Liveness.h"
@@ -16,44 +15,26 @@ using ::operator<<;  // C++ weirdness
 
 namespace v3d {
 
-Instr::List SourceTranslate::store_var(Var dst_addr, Var src) {
-  using namespace V3DLib::Target::instr;
-  Instr::List ret;
-
-  Reg srcData(dst_addr);
-  Reg srcAddr(src);
-
-  ret << mov(TMUD, srcAddr)
-      << mov(TMUA, srcData)
-      << tmuwt();
-
-  ret.front().comment("store_var v3d");
+namespace {
 
-  return ret;
-}
-
-
-void SourceTranslate::regAlloc(Instr::List &instrs) {
-  //Timer t1("regAlloc", true);
+/**
+ * Do the actual register allocation.
+ *
+ * @return true if successful, false if the registers ran out
+ */
+bool allocate(Instr::List &instrs, bool do_hoist) {
   int numVars = VarGen::count();
 
-  //Timer t2("regAlloc optimize");
-  Liveness::optimize(instrs, numVars);
-  //t2.end();
-
-  // Step 0 - Perform liveness analysis
-  //Timer t3("regAlloc compute");
+  // Step 0 - Perform liveness analysis, kept up to date by the optimizations
   Liveness live(numVars);
-  live.compute(instrs);
-  //t3.end();
+  Liveness::optimize(instrs, live, do_hoist);
+  numVars = VarGen::count();  // The optimizations may have added variables
+
+  PhaseTimer t("regalloc", instrs.size());
 
   // Step 2 - For each variable, determine all variables ever live at the same time
-  //Timer t4("regAlloc liveWith");
   LiveSets liveWith(numVars);
   liveWith.init(instrs, live);
-  //t4.end();
-
-  //Timer t5("regAlloc Allocate reg to var");
 
   // Step 3 - Allocate a register to each variable
   for (int i = 0; i < numVars; i++) {
@@ -64,23 +45,52 @@ void SourceTranslate::regAlloc(Instr::List &instrs) {
     live.reg_usage()[i].reg.tag = REG_A;
     RegId regId = LiveSets::choose_register(possible, false);
 
-    if (regId < 0) {
-      std::string buf = "v3d regAlloc(): register allocation failed for target instruction ";
-      buf << i << ": " << instrs[i].mnemonic();
-      error(buf, true);
-    } else {
-      live.reg_usage()[i].reg.regId = regId;
-    }
+    if (regId < 0) return false;
+    live.reg_usage()[i].reg.regId = regId;
   }
 
-  //t5.end();
-
   compile_data.allocated_registers_dump = live.reg_usage().dump(true);
 
   // Step 4 - Apply the allocation to the code
-  //Timer t6("regAlloc allocate_registers");
   allocate_registers(instrs, live.reg_usage());
-  //t6.end();
+  t.end(instrs.size());
+  return true;
+}
+
+}  // anon namespace
+
+
+Instr::List SourceTranslate::store_var(Var dst_addr, Var src) {
+  using namespace V3DLib::Target::instr;
+  Instr::List ret;
+
+  Reg srcData(dst_addr);
+  Reg srcAddr(src);
+
+  ret << mov(TMUD, srcAddr)
+      << mov(TMUA, srcData)
+      << tmuwt();
+
+  ret.front().comment("store_var v3d");
+
+  return ret;
+}
+
+
+void SourceTranslate::regAlloc(Instr::List &instrs) {
+  Instr::List orig = instrs;
+  size_t num_phases = compile_data.phases.size();
+  if (allocate(instrs, true)) return;
+
+  if (compile_data.num_immediates_hoisted > 0 || compile_data.num_invariants_hoisted > 0) {
+    // Hoisting may have made too many variables live at the same time, try again without
+    warning("v3d regAlloc(): register allocation failed, retrying without hoisting");
+    instrs = orig;
+    compile_data.phases.resize(num_phases);  // Only keep the phases of the retry
+    if (allocate(instrs, false)) return;
+  }
+
+  error("v3d regAlloc(): register allocation failed, insufficient capacity", true);
 }
 
 
@@ -110,7 +120,8 @@ void add_init(Instr::List &code) {
   //
   // Broadly:
   //
-  // If (numQPUs() == 8)  // Alternative is 1, then qpu num initalized to 0 is ok
+  // me() = 0;
+  // If (num running QPUs == 8)  // Alternative is 1, then qpu num 0 is ok
   //   me() = (thread_index() >> 2) & 0b1111;
   // End
   //
@@ -118,8 +129,11 @@ void add_init(Instr::List &code) {
   // threads. It's probably also the reason why you can select only 1 or 8 (max)
   // threads, otherwise there would be gaps in the qpu id.
   //
-  ret << mov(rf(RSV_QPU_ID), 0)           // not needed, already init'd to 0. Left here to counter future brainfarts
-      << sub(ACC0, rf(RSV_NUM_QPUS), 8).pushz()
+  // The number of running QPUs is passed in the first uniform, which is loaded in `me()`.
+  // It can differ from `numQPUs()` when the kernel work is split, see `QpuRange`.
+  //
+  ret << sub(ACC0, rf(RSV_QPU_ID), 8).pushz()
+      << mov(rf(RSV_QPU_ID), 0)
       << branch(endifLabel).allzc()       // nop()'s added downstream
       << mov(ACC0, QPU_ID)
       << shr(ACC0, ACC0, 2)
@@ -40,6 +40,8 @@ struct op_item {
 std::vector<op_item> op_items = {
   { ALUOp::A_FADD,   V3D_QPU_A_FADD },  // NOTE: ADD on mul alu is int only
   { ALUOp::A_FSUB,   V3D_QPU_A_FSUB },  //       SUB on mul alu is int only
+  { ALUOp::A_FMIN,   V3D_QPU_A_FMIN },  // NOTE: FMIN/FMAX are distinguished by operand order, handled by packing
+  { ALUOp::A_FMAX,   V3D_QPU_A_FMAX },
   { ALUOp::A_FtoI,   V3D_QPU_A_FTOIN  },
   { ALUOp::A_ItoF,   V3D_QPU_A_ITOF   },
   { ALUOp::A_ADD,    V3D_QPU_A_ADD,   V3D_QPU_M_ADD },
@@ -0,0 +1,126 @@
+#include "Tile2D.h"
+#include "Source/Lang.h"   // comment()
+#include "Support/basics.h"
+#include "Common/CompileData.h"
+
+namespace V3DLib {
+namespace {
+
+int const VPM_FIRST_ROW = 32;  // First VPM row used for tiles
+int const VPM_NUM_ROWS  = 32;  // Number of VPM rows used for tiles
+
+}  // anon namespace
+
+
+/**
+ * The number of QPUs the kernel can run on is limited to `max_qpus(rows)`.
+ * This is recorded in the compile data of the kernel and checked when the kernel is run.
+ *
+ * @param rows  number of rows in a tile, max 8 (four buffers of a single QPU must fit in the VPM)
+ * @param cols  number of values per row, max 16 (one vector per row)
+ * @param pitch distance between the starts of consecutive rows in main memory, in values
+ */
+Tile2D::Tile2D(int rows, int cols, IntExpr pitch) : m_rows(rows), m_cols(cols) {
+  assertq(1 <= rows && rows <= VPM_NUM_ROWS/4, "Tile2D: number of rows must be in range 1..8", true);
+  assertq(1 <= cols && cols <= 16, "Tile2D: number of columns must be in range 1..16", true);
+
+  int slot = 4*rows;
+
+  if (compile_data.max_qpus == 0 || compile_data.max_qpus > max_qpus(rows)) {
+    compile_data.max_qpus = max_qpus(rows);
+  }
+
+  m_read_pitch   = pitch << 2;                                      comment("Init Tile2D");
+  m_write_stride = (pitch - cols) << 2;
+
+  m_load_back    = VPM_FIRST_ROW + me()*slot;
+  m_load_front   = m_load_back + rows;
+  m_load_sum     = 2*m_load_back + rows;
+  m_store_back   = m_load_back + 2*rows;
+  m_store_sum    = 2*m_store_back + rows;
+}
+
+
+/**
+ * Max number of QPUs which can use tiles with the given number of rows
+ */
+int Tile2D::max_qpus(int rows) {
+  return VPM_NUM_ROWS/(4*rows);
+}
+
+
+/**
+ * Wait for the last started load, and make its buffer available for `read()`.
+ */
+void Tile2D::wait_load() {
+  dmaWaitRead();
+  m_load_front = m_load_back;
+  m_load_back  = m_load_sum - m_load_back;
+}
+
+
+/**
+ * Read a row of the tile last waited for.
+ *
+ * Only the first `cols` values of the vector are significant.
+ */
+void Tile2D::read(IntExpr row, Int &dst) {
+  vpmSetupRead(HORIZ, 1, m_load_front + row);
+  dst = vpmGetInt();
+}
+
+
+void Tile2D::read(IntExpr row, Float &dst) {
+  vpmSetupRead(HORIZ, 1, m_load_front + row);
+  dst = vpmGetFloat();
+}
+
+
+/**
+ * Write a row of the tile for the next `store()`.
+ *
+ * Only the first `cols` values of the vector are stored.
+ */
+void Tile2D::write(IntExpr row, IntExpr src) {
+  vpmSetupWrite(HORIZ, m_store_back + row);
+  vpmPut(src);
+}
+
+
+void Tile2D::write(IntExpr row, FloatExpr src) {
+  vpmSetupWrite(HORIZ, m_store_back + row);
+  vpmPut(src);
+}
+
+
+/**
+ * Wait for the last started store.
+ *
+ * Needs to be called before the end of the kernel.
+ */
+void Tile2D::wait_store() {
+  dmaWaitWrite();
+}
+
+
+void Tile2D::load_setup() {
+  dmaSetReadPitch(m_read_pitch);                         comment("Tile2D load");
+  dmaSetupRead(HORIZ, m_rows, m_load_back << 4, m_cols);
+}
+
+
+/**
+ * Wait for the previous store, which uses the other buffer, and set up the next one.
+ */
+void Tile2D::store_setup() {
+  dmaWaitWrite();                                        comment("Tile2D store");
+  dmaSetWriteStride(m_write_stride);
+  dmaSetupWrite(HORIZ, m_rows, m_store_back << 4, m_cols);
+}
+
+
+void Tile2D::swap_store() {
+  m_store_back = m_store_sum - m_store_back;
+}
+
+}  // namespace V3DLib
@@ -0,0 +1,100 @@
+#ifndef _V3DLIB_VC4_DMA_TILE2D_H_
+#define _V3DLIB_VC4_DMA_TILE2D_H_
+#include "Operations.h"
+
+namespace V3DLib {
+
+/**
+ * Double-buffered DMA transfers of 2D tiles between main memory and the VPM, vc4 only.
+ *
+ * A tile is `rows` consecutive rows of `cols` 32-bit values in main memory, with `pitch`
+ * values between the starts of the rows. In the VPM, every row of the tile takes
+ * one row of 16 values, so that it can be read and written as a vector.
+ *
+ * This generates the DMA and VPM setup statements which otherwise need to be
+ * written by hand (see `Examples/DMA.cpp`).
+ *
+ * Usage, to overlap the transfers of the next tile with the computation of the current one:
+ *
+ *     Tile2D tile(ROWS, 16, pitch);
+ *     tile.load(src);                      // Prefetch the first tile
+ *
+ *     For (Int i = 0, i < num_tiles, i++)
+ *       tile.wait_load();                  // Tile i is available now
+ *
+ *       src += ROWS*pitch;
+ *       If (i + 1 < num_tiles)
+ *         tile.load(src);                  // Start transfer of tile i + 1
+ *       End
+ *
+ *       Float x;
+ *       for (int r = 0; r < ROWS; r++) {
+ *         tile.read(r, x);
+ *         tile.write(r, 2*x);
+ *       }
+ *
+ *       tile.store(dst);                   // Start transfer of the result of tile i
+ *       dst += ROWS*pitch;
+ *     End
+ *
+ *     tile.wait_store();
+ *
+ * ------------------------------------------------
+ * NOTES
+ * =====
+ *
+ * 1. The upper half of the VPM, rows 32-63, is used for the tiles. The lower half is used by the
+ *    regular loads and stores, which can therefore be combined with tiles.
+ *    The exception is DMA loads of variables (`LibSettings::use_tmu_for_load(false)`); these
+ *    may not be done between `load()` and `wait_load()`.
+ *
+ * 2. Every QPU gets its own slot of 4*rows VPM rows: two buffers for loading and two for storing.
+ *    The number of QPUs is therefore limited to `max_qpus(rows)`, e.g. 2 QPUs for 4-row tiles.
+ *    Running a kernel using tiles on more QPUs fails with an error.
+ *
+ * 3. The DMA load and store setup may not change while a transfer is in progress.
+ *    Therefore, a new load is only set up after the previous one has been waited for,
+ *    and `store()` waits for the previous store before setting up the next.
+ */
+class Tile2D {
+public:
+  Tile2D(int rows, int cols, IntExpr pitch);
+
+  void load(Int::Ptr &src)   { load_setup(); dmaStartRead(src); }
+  void load(Float::Ptr &src) { load_setup(); dmaStartRead(src); }
+  void wait_load();
+
+  void read(IntExpr row, Int &dst);
+  void read(IntExpr row, Float &dst);
+  void write(IntExpr row, IntExpr src);
+  void write(IntExpr row, FloatExpr src);
+
+  void store(Int::Ptr &dst)   { store_setup(); dmaStartWrite(dst); swap_store(); }
+  void store(Float::Ptr &dst) { store_setup(); dmaStartWrite(dst); swap_store(); }
+  void wait_store();
+
+  static int max_qpus(int rows);
+
+private:
+  int m_rows;
+  int m_cols;
+
+  Int m_read_pitch;    // Distance between rows in main memory, in bytes
+  Int m_write_stride;  // Distance between end of row and start of next row in main memory, in bytes
+
+  // VPM rows of the buffers.
+  // The sums are used to switch between the two buffers: other = sum - current
+  Int m_load_front;    // Buffer of the tile last waited for
+  Int m_load_back;     // Buffer for the next load
+  Int m_load_sum;
+  Int m_store_back;    // Buffer for the next store
+  Int m_store_sum;
+
+  void load_setup();
+  void store_setup();
+  void swap_store();
+};
+
+}  // namespace V3DLib
+
+#endif  // _V3DLIB_VC4_DMA_TILE2D_H_
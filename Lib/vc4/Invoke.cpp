@@ -12,13 +12,13 @@ namespace  {
 /**
  * Number of 32-bit words needed for the parameters (uniforms)
  *
- * - First two values are always the QPU ID and num QPU's
+ * - First three values are always the QPU ID, num QPU's and termination count (see `QpuRange`)
  * - Next come the actual kernel parameters, as defined in the user code
  * - This is terminated by a dummy uniform value, see Note 1.
  */
 int num_params(IntList const &params) {
   assert(!params.empty());
-  return (2 + params.size() + 1);
+  return (3 + params.size() + 1);
 }
 
 
@@ -28,7 +28,7 @@ int num_params(IntList const &params) {
  * The number and types of parameters will not change for a given kernel.
  * The value of the parameters, however, can change, so this needs to be reset every time.
  *
- * All uniform values are the same for all QPUs, *except* the qpu id.
+ * All uniform values are the same for all QPUs, *except* the qpu id and termination count.
  *
  * ----------------------------------------------------------------------------
  * Notes
@@ -41,8 +41,9 @@ int num_params(IntList const &params) {
  *    cause and gave up. Instead, I'll just pass a final dummy uniform value,
  *    which can be mangled to the heart's content of the hardware.
  */
-void load_uniforms(Data &uniforms, IntList const &params, int numQPUs) {
-  assert(0 < numQPUs && numQPUs <= Platform::max_qpus());
+void load_uniforms(Data &uniforms, IntList const &params, QpuRange const &qpus) {
+  int numQPUs = qpus.count;
+  assert(numQPUs <= Platform::max_qpus());
 
   if (!uniforms.allocated()) {
     uniforms.alloc(num_params(params)*Platform::max_qpus());
@@ -52,8 +53,9 @@ void load_uniforms(Data &uniforms, IntList const &params, int numQPUs) {
 
   int offset = 0;
   for (int i = 0; i < numQPUs; i++) {
-    uniforms[offset++] = (uint32_t) i;              // Unique QPU ID
-    uniforms[offset++] = (uint32_t) numQPUs;        // QPU count
+    uniforms[offset++] = (uint32_t) qpus.id(i);     // Unique QPU ID
+    uniforms[offset++] = (uint32_t) qpus.total;     // QPU count
+    uniforms[offset++] = (uint32_t) qpus.finish(i); // Termination count
 
     for (int j = 0; j < params.size(); j++) {
       uniforms[offset++] = params[j];
@@ -116,14 +118,14 @@ void invoke(int numQPUs, Data const &launch_messages) {
 }  // anon namespace
 
 
-void MailBoxInvoke::invoke(int numQPUs, Code const &code, IntList const &params) {
+void MailBoxInvoke::invoke(QpuRange const &qpus, Code const &code, IntList const &params) {
   //debug("Calling MailBoxInvoke::invoke()");
   assertq(!code.empty(), "MailBoxInvoke::invoke(): no code to invoke", true );
 
-  load_uniforms(m_uniforms, params, numQPUs);
+  load_uniforms(m_uniforms, params, qpus);
   init_launch_messages(launch_messages, code, params, m_uniforms);
 
-  V3DLib::invoke(numQPUs, launch_messages);
+  V3DLib::invoke(qpus.count, launch_messages);
 }
 
 }  // namespace V3DLib
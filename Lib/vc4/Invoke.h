@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include "../Common/Seq.h"
 #include "../Common/SharedArray.h"
+#include "../Common/QpuRange.h"
 
 namespace V3DLib {
 
@@ -13,7 +14,7 @@ namespace V3DLib {
  */
 class MailBoxInvoke {
 public:
-  void invoke(int numQPUs, Code const &code, IntList const &params);
+  void invoke(QpuRange const &qpus, Code const &code, IntList const &params);
 
 private:
   Data m_uniforms;  // Memory region for QPU parameters
@@ -88,16 +88,20 @@ int KernelDriver::kernel_size() const {
  * Add the postfix code to the kernel.
  *
  * Note that this emits kernel code.
+ *
+ * The first QPU of an invocation waits for the other QPUs to finish.
+ * This is not necessarily the QPU with `me() == 0`, see `QpuRange`.
  */
 void KernelDriver::kernelFinish() {
   dmaWaitRead();                header("Kernel termination");
                                 comment("Ensure outstanding DMAs have completed");
   dmaWaitWrite();
 
-  If (me() == 0)
-    Int n = numQPUs()-1;        comment("QPU 0 wait for other QPUs to finish");
+  IntExpr n(std::make_shared<Expr>(Var(STANDARD, RSV_FINISH)));
+
+  If (n >= 0)
     For (Int i = 0, i < n, i++)
-      semaDec(15);
+      semaDec(15);              comment("First QPU waits for other QPUs to finish");
     End
     hostIRQ();                  comment("Send host IRQ");
   Else
@@ -115,7 +119,9 @@ void KernelDriver::encode() {
   if (!qpuCodeMem.empty()) return;  // Don't bother if already encoded
   if (has_errors()) return;         // Don't do this if compile errors occured
 
+  PhaseTimer t("encode", m_targetCode.size());
   CodeList code = encode_instructions(m_targetCode);
+  t.end(code.size());
 
   // Allocate memory for QPU code
   qpuCodeMem.alloc(code.size());
@@ -129,6 +135,22 @@ void KernelDriver::encode() {
 }
 
 
+/**
+ * @return the encoded instructions, as loaded into the code memory
+ */
+std::vector<uint64_t> KernelDriver::to_opcodes() {
+  encode();
+  assert(!qpuCodeMem.empty());
+
+  std::vector<uint64_t> code;
+  for (int i = 0; i < (int) qpuCodeMem.size(); i++) {
+    code.push_back(qpuCodeMem[i]);
+  }
+
+  return code;
+}
+
+
 void KernelDriver::emit_opcodes(FILE *f) {
   fprintf(f, "Opcodes for vc4\n");
   fprintf(f, "===============\n\n");
@@ -156,6 +178,7 @@ void KernelDriver::compile_intern() {
 
   obtain_ast();
 
+  PhaseTimer t("translate_stmt", 0);
   V3DLib::translate_stmt(m_targetCode, m_body);
 
   {
@@ -174,18 +197,23 @@ void KernelDriver::compile_intern() {
   }
 
   m_targetCode << Instr(END);
+  t.end(m_targetCode.size());
 
   compile_postprocess(m_targetCode);
 
   // Translate branch-to-labels to relative branches
-  removeLabels(m_targetCode);
+  {
+    PhaseTimer t("removeLabels", m_targetCode.size());
+    removeLabels(m_targetCode);
+    t.end(m_targetCode.size());
+  }
 
   encode();
 }
 
 
-void KernelDriver::invoke_intern(int numQPUs, IntList &params) {
-  MailBoxInvoke::invoke(numQPUs, qpuCodeMem, params);
+void KernelDriver::invoke_intern(QpuRange const &qpus, IntList &params) {
+  MailBoxInvoke::invoke(qpus, qpuCodeMem, params);
 }
 
 }  // namespace vc4
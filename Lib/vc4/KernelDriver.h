@@ -15,6 +15,7 @@ public:
   KernelDriver(KernelDriver &&k) = default;
 
   void encode() override;
+  std::vector<uint64_t> to_opcodes() override;
   int kernel_size() const;
 
 private:
@@ -23,7 +24,7 @@ private:
 
   void kernelFinish();
   void compile_intern() override;
-  void invoke_intern(int numQPUs, IntList &params) override;
+  void invoke_intern(QpuRange const &qpus, IntList &params) override;
 
   void emit_opcodes(FILE *f) override;
 };
@@ -2,7 +2,6 @@
 #include <stdio.h>
 #include <iostream>
 #include "Support/basics.h"
-#include "Support/Timer.h"
 #include "Target/Subst.h"
 #include "SourceTranslate.h"
 #include "Common/CompileData.h"
@@ -123,46 +122,22 @@ RegTypeCount count_reg_types(Instr::List &instrs) {
 
 namespace vc4 {
 
+namespace {
+
 /**
- * The incoming instruction list has all variables assigned as
- * registers in register file A, with the index set to the variable index.
- *
- * The list can contain predefined accumulators, SPECIAL registers and NONE.
- *
- * ============================================================================
- * NOTES
- * =====
+ * Do the actual register allocation.
  *
- * * Profile timing 20210406
- *   vc4 DFT profiling in unit test, -d=272
- *   Conclusion: liveWith.init() is the main timing hog,
- *               within it liveWith is the main culprit (but used to be much worse)
- *               
- *  - Matrix mult
- *      liveWith                :  2.272735s
- *  - Inline complex
- *      liveWith                : 15.885858s
- *  - Inline float
- *      liveWith                :  6.156424s
+ * @return true if successful, false if the registers ran out
  */
-void regAlloc(Instr::List &instrs) {
-  assert(count_reg_types(instrs).safe_for_regalloc());
-  //Timer t1("vc4 regAlloc", true);
-  //std::cout << count_reg_types(instrs).dump() << std::endl;
-
+bool allocate(Instr::List &instrs, bool do_hoist) {
   int numVars = VarGen::count();
 
-//{
-//  Timer t("vc4 regAlloc optimize", true);
-  Liveness::optimize(instrs, numVars);
-//}
-
-  // Step 0 - Perform liveness analysis
+  // Step 0 - Perform liveness analysis, kept up to date by the optimizations
   Liveness live(numVars);
-//{
-//  Timer t("vc4 regAlloc compute", true);
-  live.compute(instrs);
-//}
+  Liveness::optimize(instrs, live, do_hoist);
+  numVars = VarGen::count();  // The optimizations may have added variables
+
+  PhaseTimer t("regalloc", instrs.size());
 
 
   // Step 1 - For each variable, determine a preference for register file A or B.
@@ -173,18 +148,12 @@ void regAlloc(Instr::List &instrs) {
 
   // Step 2 - For each variable, determine all variables ever live at same time
   LiveSets liveWith(numVars);
-//{
-//  Timer t("vc4 regAlloc liveWith", true);
   liveWith.init(instrs, live);
-//}
   //debug(liveWith.dump());
 
   // Step 3 - Allocate a register to each variable
   RegTag prevChosenRegFile = REG_B;
 
-//{
-//  Timer t("vc4 regAlloc allocate_reg", true);
-
   for (int i = 0; i < numVars; i++) {
     if (live.reg_usage()[i].reg.tag != NONE) continue;
     if (live.reg_usage()[i].unused()) continue;
@@ -199,7 +168,9 @@ void regAlloc(Instr::List &instrs) {
     // Choose a register file
     RegTag chosenRegFile;
     if (chosenA < 0 && chosenB < 0) {
-      error("regAlloc(): register allocation failed, insufficient capacity", true);
+      delete [] prefA;
+      delete [] prefB;
+      return false;
     }
     else if (chosenA < 0) chosenRegFile = REG_B;
     else if (chosenB < 0) chosenRegFile = REG_A;
@@ -213,22 +184,64 @@ void regAlloc(Instr::List &instrs) {
     // Finally, allocate a register to the variable
     live.reg_usage()[i].reg = Reg(chosenRegFile, (chosenRegFile == REG_A)? chosenA : chosenB);
   }
-//}
-  
+
   compile_data.allocated_registers_dump = live.reg_usage().dump(true);
   //std::cout << count_reg_types(instrs).dump() << std::endl;
 
   // Step 4 - Apply the allocation to the code
-//{
-//  Timer t("vc4 regAlloc apply allocate_registers", true);
   allocate_registers(instrs, live.reg_usage());
-//}
+  t.end(instrs.size());
 
   //std::cout << instrs.check_acc_usage() << std::endl;
 
   // Free memory
   delete [] prefA;
   delete [] prefB;
+  return true;
+}
+
+}  // anon namespace
+
+
+/**
+ * The incoming instruction list has all variables assigned as
+ * registers in register file A, with the index set to the variable index.
+ *
+ * The list can contain predefined accumulators, SPECIAL registers and NONE.
+ *
+ * ============================================================================
+ * NOTES
+ * =====
+ *
+ * * Profile timing 20210406
+ *   vc4 DFT profiling in unit test, -d=272
+ *   Conclusion: liveWith.init() is the main timing hog,
+ *               within it liveWith is the main culprit (but used to be much worse)
+ *               
+ *  - Matrix mult
+ *      liveWith                :  2.272735s
+ *  - Inline complex
+ *      liveWith                : 15.885858s
+ *  - Inline float
+ *      liveWith                :  6.156424s
+ */
+void regAlloc(Instr::List &instrs) {
+  assert(count_reg_types(instrs).safe_for_regalloc());
+  //std::cout << count_reg_types(instrs).dump() << std::endl;
+
+  Instr::List orig = instrs;
+  size_t num_phases = compile_data.phases.size();
+  if (allocate(instrs, true)) return;
+
+  if (compile_data.num_immediates_hoisted > 0 || compile_data.num_invariants_hoisted > 0) {
+    // Hoisting may have made too many variables live at the same time, try again without
+    warning("regAlloc(): register allocation failed, retrying without hoisting");
+    instrs = orig;
+    compile_data.phases.resize(num_phases);  // Only keep the phases of the retry
+    if (allocate(instrs, false)) return;
+  }
+
+  error("regAlloc(): register allocation failed, insufficient capacity", true);
 }
 
 }  // namespace vc4; 
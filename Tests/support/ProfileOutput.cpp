@@ -1,4 +1,5 @@
 #include "ProfileOutput.h"
+#include <cstdio>
 #include "Support/basics.h"
 
 std::string ProfileOutput::out_data::str() const {
@@ -66,11 +67,34 @@ void ProfileOutput::add_compile(std::string const &label, Timer &timer, int Dim)
 }
 
 
-void ProfileOutput::add_call(std::string const &label, Timer &timer, int Dim, int num_qpus) {
+/**
+ * @param num_items  if > 0, the number of items processed per iteration.
+ *                   The throughput in items per second is then added to the output.
+ */
+void ProfileOutput::add_call(
+  std::string const &label,
+  Timer &timer,
+  int Dim,
+  int num_qpus,
+  int num_items,
+  std::string const &item_name
+) {
   std::string str;
   str << "\"" << label << "\"";
 
-  output << out_data(str, timer.end(false), Dim, num_qpus);
+  std::string timer_val = timer.end(false);
+  out_data item(str, timer_val, Dim, num_qpus);
+
+  if (num_items > 0) {
+    double seconds = std::stod(timer_val);
+    if (seconds > 0) {
+      char buf[64];
+      sprintf(buf, "%.1f", ((double) num_items*num_iterations)/seconds);
+      item.throughput << buf << " " << item_name << "/s";
+    }
+  }
+
+  output << item;
 }
 
 
@@ -86,11 +110,16 @@ std::string ProfileOutput::dump() {
     std::string str;
     str << platform << "     , " << item.str() << ", ";
 
-    if (last_label != item.label) {
+    bool show_label = (last_label != item.label);
+    if (show_label) {
       str << item.label;
       last_label = item.label; 
     }
 
+    if (!item.throughput.empty()) {
+      str << (show_label?" ":"") << item.throughput;
+    }
+
     ret << str << "\n";
   }
 
@@ -108,3 +137,29 @@ void ProfileOutput::run(int Dim, std::string const &label, std::function<void(in
     add_call(label, timer, Dim, num);
   }
 }
+
+
+/**
+ * Same as previous, but also outputs the throughput
+ *
+ * @param num_items  number of items processed in a single call of `f`
+ * @param item_name  name of the items processed, used in the output
+ */
+void ProfileOutput::run(
+  int Dim,
+  std::string const &label,
+  int num_items,
+  std::string const &item_name,
+  std::function<void(int numQPUs)> f
+) {
+  assert(num_items > 0);
+
+  for (auto num : num_qpus()) {
+    Timer timer;
+
+    for (int i = 0; i < num_iterations; i++) {
+      f(num);
+    }
+    add_call(label, timer, Dim, num, num_items, item_name);
+  }
+}
@@ -28,6 +28,7 @@ class ProfileOutput {
     int Dim;
     int num_qpus;
     std::string timer;
+    std::string throughput;  // Optional, only set for throughput runs
   };
 
 public:
@@ -41,6 +42,8 @@ public:
   void add_compile(std::string const &label, std::string const &timer_val, int Dim);
   void add_compile(std::string const &label, Timer &timer, int Dim);
   void run(int Dim, std::string const &label, std::function<void(int numQPUs)> f);
+  void run(int Dim, std::string const &label, int num_items, std::string const &item_name,
+           std::function<void(int numQPUs)> f);
   std::string dump();
 
   static std::string header();
@@ -53,7 +56,8 @@ private:
   bool m_use_max_qpus   = false;
   std::vector<out_data> output;
 
-  void add_call(std::string const &label, Timer &timer, int Dim, int num_qpus);
+  void add_call(std::string const &label, Timer &timer, int Dim, int num_qpus,
+                int num_items = 0, std::string const &item_name = "");
 };
 
 #endif  // _TEST_SUPPORT_PROFILEOUTPUT_H
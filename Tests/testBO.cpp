@@ -2,6 +2,33 @@
 #include <memory>
 #include "Common/SharedArray.h"
 #include "Target/BufferObject.h"
+#include "V3DLib.h"
+#include "support/support.h"
+
+namespace {
+
+void add_one_kernel(V3DLib::Int::Ptr dst, V3DLib::Int::Ptr src) {
+  using namespace V3DLib;
+  Int a = *src;
+  *dst = a + 1;
+}
+
+
+/**
+ * Add 1 to each element of a block in a 2D array, rows `stride` elements apart
+ */
+void add_one_2d_kernel(V3DLib::Int::Ptr dst, V3DLib::Int rows, V3DLib::Int stride) {
+  using namespace V3DLib;
+
+  For (Int r = me(), r < rows, r += numQPUs())
+    Int::Ptr p = dst + r*stride;
+    Int a = *p;
+    *p = a + 1;
+  End
+}
+
+}  // anon namespace
+
 
 
 TEST_CASE("Test Buffer Objects [bo]") {
@@ -136,3 +163,117 @@ TEST_CASE("Test Buffer Objects [bo]") {
     }
   }
 }
+
+
+TEST_CASE("Test SharedArray views and bulk copy [bo][view]") {
+  using namespace V3DLib;
+
+  SUBCASE("Views should not allocate or free heap memory") {
+    emu::BufferObject heap;
+    heap.alloc(1024*1024);
+
+    {
+      Data arr(256, heap);
+      REQUIRE(heap.num_free_ranges() == 0);
+
+      {
+        Data view = arr.view(32, 64);
+        REQUIRE(view.is_view());
+        REQUIRE(view.size() == 64);
+        REQUIRE(view.getAddress() == arr.getAddress() + 32*4);
+      }
+      REQUIRE(heap.num_free_ranges() == 0);
+      REQUIRE(!heap.empty());
+    }
+
+    REQUIRE(heap.empty());
+  }
+
+
+  SUBCASE("Bulk copy and fill should work on arrays and views") {
+    Int::Array arr(128);
+    arr.fill(7);
+
+    auto view = arr.view(16, 32);
+    view.fill(-1);
+
+    std::vector<int> expected(128, 7);
+    for (int i = 16; i < 48; ++i) expected[i] = -1;
+
+    std::vector<int> out;
+    arr.copyTo(out);
+    REQUIRE(out == expected);
+
+    std::vector<int> src(32);
+    for (int i = 0; i < 32; ++i) src[i] = i;
+    view.copyFrom(src);
+    REQUIRE(arr[15] == 7);
+    REQUIRE(arr[16] == 0);
+    REQUIRE(arr[47] == 31);
+    REQUIRE(arr[48] == 7);
+
+    Int::Array copy(32);
+    copy.copyFrom(view);
+    REQUIRE(copy == view);
+  }
+
+
+  SUBCASE("A view can be passed to a kernel") {
+    Int::Array src(64);
+    Int::Array dst(64);
+    for (int i = 0; i < 64; ++i) src[i] = i;
+    dst.fill(0);
+
+    auto k = compile(add_one_kernel);
+
+    auto src_view = src.view(32, 16);
+    auto dst_view = dst.view(16, 16);
+    k.load(&dst_view, &src_view);
+    k.interpret();
+    REQUIRE(dst[15] == 0);
+    REQUIRE(dst[16] == 33);
+    REQUIRE(dst[31] == 48);
+    REQUIRE(dst[32] == 0);
+
+    dst.fill(0);
+    k.emu();
+    REQUIRE(dst[16] == 33);
+    REQUIRE(dst[31] == 48);
+    REQUIRE(dst[32] == 0);
+  }
+
+
+  SUBCASE("A 2D view on a block should pass through a kernel") {
+    int const Rows = 8;
+    int const Cols = 64;
+    Int::Array2D arr(Rows, Cols);
+    arr.fill(0);
+
+    auto block = arr.view(2, 16, 4, 16);
+    REQUIRE(block.stride() == Cols);
+    REQUIRE(!block.is_contiguous());
+    block.fill(3);
+
+    auto k = compile(add_one_2d_kernel);
+    k.load(&block, block.rows(), block.stride());
+    k.setNumQPUs(2);
+    k.emu();
+
+    for (int r = 0; r < Rows; ++r) {
+      for (int c = 0; c < Cols; ++c) {
+        bool inside = (2 <= r && r < 6 && 16 <= c && c < 32);
+        INFO("r: " << r << ", c: " << c);
+        REQUIRE(arr[r][c] == (inside? 4 : 0));
+      }
+    }
+
+    Int::Array2D copy(4, 16);
+    copy.copyFrom(block);
+    REQUIRE(copy == block);
+
+    std::vector<int> out;
+    block.copyTo(out);
+    REQUIRE(out.size() == 64);
+    REQUIRE(out[0] == 4);
+  }
+}
@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the native CPU backend
+//
+// The results of the CPU backend are compared with the interpreter, which
+// defines the semantics of the source language.
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <V3DLib.h>
+
+using namespace V3DLib;
+
+namespace {
+
+int const N = 16*8;
+
+
+/**
+ * Uses most integer operations, and control flow with Where, If and While.
+ */
+void int_kernel(Int::Ptr result, Int::Ptr in, Int n) {
+  For (Int i = 0, i < n, i += 16)
+    Int a = *in;
+    Int b = a*7 + index() - 20;
+
+    Int x = (a << 3) ^ (b >> 2);
+    x = x | (rotate(a, 3) & 0xff0);
+    x = x + min(a, b) - max(b, -5);
+    x = x + shr(b, 28) + (a ^ 0x5a5a);
+
+    Where (b < 0)
+      x = 0 - x;
+    Else
+      Where (a > 50)
+        x = x - 1000;
+      End
+    End
+
+    If (any(a == 17))
+      x = x + 3;
+    End
+
+    Int count = 0;
+    While (any(count < (a & 7)))
+      Where (count < (a & 7))
+        x = x*3 + 1;
+      End
+      count++;
+    End
+
+    *result = x + a/(index() + 3) + a%5;  // Division uses out-of-line function calls
+    in += 16;
+    result += 16;
+  End
+}
+
+
+void float_kernel(Float::Ptr result, Float::Ptr in, Int n) {
+  For (Int i = 0, i < n, i += 16)
+    Float a = *in;
+    Float x = a*a - 2.5f*a + toFloat(index());
+    x = max(x, -10.0f) + min(a, 0.5f);
+    x = x + toFloat(toInt(a*3.0f)) + functions::cos(a) + functions::recip(a + 5.0f, functions::FULL);
+
+    Where (a > 0.0f && x < 20.0f)
+      x = x*0.5f;
+    End
+
+    *result = x;
+    in += 16;
+    result += 16;
+  End
+}
+
+
+void gather_kernel(Int::Ptr result, Int::Ptr in) {
+  Int::Ptr p = in + 15*index();
+  gather(p);
+  Int a;
+  receive(a);
+  *result = a;
+}
+
+
+void qpu_kernel(Int::Ptr result) {
+  *(result + 16*me()) = 100*me() + index() + 1000*numQPUs();
+}
+
+
+template<typename Array>
+void check_equal(Array const &a, Array const &b) {
+  REQUIRE(a.size() == b.size());
+
+  for (int i = 0; i < (int) a.size(); i++) {
+    INFO("index: " << i);
+    REQUIRE(a[i] == b[i]);
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("CPU backend should give same results as interpreter [cpu]") {
+  SUBCASE("Integer operations and control flow") {
+    Int::Array in(N);
+    for (int i = 0; i < N; i++) {
+      in[i] = (i*37) % 101;  // Non-negative, integer multiplication is 24-bit
+    }
+
+    Int::Array expected(N);
+    Int::Array result(N);
+
+    auto k = compile(int_kernel);
+    k.load(&expected, &in, N);
+    k.interpret();
+
+    k.load(&result, &in, N);
+    k.cpu();
+    check_equal(result, expected);
+  }
+
+  SUBCASE("Float operations") {
+    Float::Array in(N);
+    for (int i = 0; i < N; i++) {
+      in[i] = -3.0f + 0.05f*((float) i);
+    }
+
+    Float::Array expected(N);
+    Float::Array result(N);
+
+    auto k = compile(float_kernel);
+    k.load(&expected, &in, N);
+    k.interpret();
+
+    k.load(&result, &in, N);
+    k.cpu();
+    check_equal(result, expected);
+  }
+
+  SUBCASE("Gather and receive") {
+    Int::Array in(16*16);
+    for (int i = 0; i < (int) in.size(); i++) {
+      in[i] = i;
+    }
+
+    Int::Array expected(16);
+    Int::Array result(16);
+
+    auto k = compile(gather_kernel);
+    k.load(&expected, &in);
+    k.interpret();
+
+    k.load(&result, &in);
+    k.cpu();
+    check_equal(result, expected);
+
+    for (int i = 0; i < 16; i++) {
+      REQUIRE(result[i] == 16*i);
+    }
+  }
+
+  SUBCASE("Multiple QPUs") {
+    int const NUM_QPUS = 8;
+    Int::Array result(16*NUM_QPUS);
+    result.fill(-1);
+
+    auto k = compile(qpu_kernel);
+    k.setNumQPUs(NUM_QPUS);
+    k.load(&result);
+    k.cpu();
+
+    for (int i = 0; i < (int) result.size(); i++) {
+      REQUIRE(result[i] == 100*(i/16) + (i % 16) + 1000*NUM_QPUS);
+    }
+  }
+}
+
+
+TEST_CASE("CPU backend should only reuse a cached library for the same code [cpu]") {
+  auto k = compile(int_kernel);
+  auto &driver = k.vc4();
+
+  std::string library;
+  {
+    cpu::NativeKernel nk(driver.sourceCode(), driver.numVars());
+    library = nk.library();
+  }
+
+  {
+    cpu::NativeKernel nk(driver.sourceCode(), driver.numVars());
+    REQUIRE(nk.library() == library);
+  }
+
+  // Simulate a hash collision, by changing the code stored next to the library
+  std::string code_file = library.substr(0, library.size() - 3) + ".cpp";
+  std::string code;
+  {
+    std::ifstream in(code_file);
+    REQUIRE(in.good());
+    std::stringstream buf;
+    buf << in.rdbuf();
+    code = buf.str();
+  }
+
+  { std::ofstream out(code_file); out << "// Some other kernel\n"; }
+
+  std::string other_library;
+  {
+    cpu::NativeKernel nk(driver.sourceCode(), driver.numVars());
+    other_library = nk.library();
+  }
+
+  { std::ofstream out(code_file); out << code; }
+
+  REQUIRE(other_library != library);
+  remove(other_library.c_str());
+  remove((other_library.substr(0, other_library.size() - 3) + ".cpp").c_str());
+}
+
+
+TEST_CASE("CPU backend should be faster than interpreter [cpu]") {
+  int const SIZE = 16*1024;
+
+  Int::Array in(SIZE);
+  for (int i = 0; i < SIZE; i++) {
+    in[i] = (i*37) % 101;
+  }
+
+  Int::Array expected(SIZE);
+  Int::Array result(SIZE);
+
+  auto k = compile(int_kernel);
+  k.load(&result, &in, SIZE);
+  k.cpu();  // Compiles the kernel
+
+  auto seconds = [] (std::function<void()> f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  double cpu_time = seconds([&k] { k.cpu(); });
+
+  k.load(&expected, &in, SIZE);
+  double interpret_time = seconds([&k] { k.interpret(); });
+
+  check_equal(result, expected);
+  INFO("cpu: " << cpu_time << "s, interpreter: " << interpret_time << "s");
+  REQUIRE(10*cpu_time < interpret_time);
+}
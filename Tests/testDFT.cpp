@@ -524,3 +524,245 @@ TEST_CASE("Discrete Fourier Transform tmp [dft][dft2]") {
     }
   }
 }
+
+
+namespace {
+
+/**
+ * Scalar DFT of every row of `input`, in double precision.
+ *
+ * Used as reference for the batched DFT.
+ */
+template<typename Array2D>
+std::vector<cx> scalar_dft_rows(Array2D &input) {
+  int const Rows = input.rows();
+  int const Dim  = input.columns();
+  std::vector<cx> ret(Rows*Dim);
+
+  for (int r = 0; r < Rows; ++r) {
+    for (int k = 0; k < Dim; ++k) {
+      cx sum = 0;
+
+      for (int n = 0; n < Dim; ++n) {
+        cx val;
+        if constexpr (std::is_same<Array2D, Float::Array2D>::value) {
+          val = cx(input[r][n], 0);
+        } else {
+          complex tmp = input[r][n];
+          val = cx(tmp.re(), tmp.im());
+        }
+
+        sum += val*std::polar(1.0, -2*M_PI*((double) (k*n))/Dim);
+      }
+
+      ret[r*Dim + k] = sum;
+    }
+  }
+
+  return ret;
+}
+
+
+void check_dft_rows(Complex::Array2D &result, std::vector<cx> const &expected, float precision) {
+  int const Dim = result.columns();
+  REQUIRE(result.rows()*Dim == (int) expected.size());
+
+  for (int r = 0; r < result.rows(); ++r) {
+    for (int c = 0; c < Dim; ++c) {
+      INFO("r: " << r << ", c: " << c << ", result: " << result[r][c].dump()
+                 << ", expected: " << expected[r*Dim + c]);
+      REQUIRE(abs(expected[r*Dim + c] - result[r][c]) < precision);
+    }
+  }
+}
+
+
+void create_test_signals(Float::Array2D &signals) {
+  int const Dim = signals.columns();
+
+  for (int r = 0; r < signals.rows(); ++r) {
+    for (int c = 0; c < Dim; ++c) {
+      signals[r][c] = (1.0f + 0.1f*((float) r))*wavelet_function(c, Dim);
+    }
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Batched Discrete Fourier Transform [dft][dftbatch]") {
+  int const NumSignals = 24;  // Not a multiple of num QPUs on purpose
+  float const precision = 2e-3f;
+
+  SUBCASE("Float signals should transform same as scalar") {
+    for (int Dim = 16; Dim <= 64; Dim *= 2) {
+      INFO("Dim: " << Dim);
+      Float::Array2D signals(NumSignals, Dim);
+      create_test_signals(signals);
+      auto expected = scalar_dft_rows(signals);
+
+      DFTBatch k(signals);
+      k.setNumQPUs(8);
+      k.call();
+      REQUIRE(k.result().rows() == NumSignals);
+      check_dft_rows(k.result(), expected, precision*((float) Dim));
+    }
+  }
+
+
+  SUBCASE("Complex signals should transform same as scalar") {
+    int const Dim = 32;
+    Complex::Array2D signals(NumSignals, Dim);
+    for (int r = 0; r < NumSignals; ++r) {
+      for (int c = 0; c < Dim; ++c) {
+        signals[r][c] = complex(wavelet_function(c, Dim), 0.5f*random_float());
+      }
+    }
+    auto expected = scalar_dft_rows(signals);
+
+    DFTBatch k(signals);
+    k.setNumQPUs(4);
+    k.call();
+    check_dft_rows(k.result(), expected, precision*((float) Dim));
+  }
+
+
+  SUBCASE("Batched DFT with 2 blocks should transform same as scalar") {
+    int const Dim = 64;
+    Float::Array2D signals(NumSignals, Dim);
+    create_test_signals(signals);
+    auto expected = scalar_dft_rows(signals);
+
+    DFTBatch k(signals);
+    k.num_blocks(2);
+    k.setNumQPUs(8);
+    k.call();
+    check_dft_rows(k.result(), expected, precision*((float) Dim));
+  }
+
+
+  SUBCASE("Batched DFT should be correct for big signals") {
+    int const NumBig = 4;
+
+    // Twiddles come from the CPU, so the error stays small. vc4 hardware rounds float mults downward
+    float const big_precision = Platform::has_vc4()? precision : 1.0e-5f;
+
+    for (int Dim = 256; Dim <= 1024; Dim *= 4) {
+      INFO("Dim: " << Dim);
+      Float::Array2D signals(NumBig, Dim);
+      create_test_signals(signals);
+      auto expected = scalar_dft_rows(signals);
+
+      DFTBatch k(signals);
+      k.setNumQPUs(4);
+      k.call();
+      REQUIRE(!k.has_errors());
+      check_dft_rows(k.result(), expected, big_precision*((float) Dim));
+    }
+  }
+
+
+  SUBCASE("Decorator should give same result as class") {
+    int const Dim = 32;
+    Float::Array2D signals(NumSignals, Dim);
+    create_test_signals(signals);
+
+    DFTBatch k_class(signals);
+    k_class.setNumQPUs(8);
+    k_class.call();
+
+    Complex::Array twiddles(Dim);
+    kernels::dft_twiddles(twiddles);
+
+    Complex::Array2D result;
+    auto k = compile(kernels::dft_batch_decorator(signals, result));
+    REQUIRE(!k.has_errors());
+    k.setNumQPUs(8);
+    k.load(&result, &signals, &twiddles).call();
+
+    compare_arrays(result, k_class.result(), 1e-5f);  // Kernel code differs in offset handling only, tiny diff
+  }
+
+
+  SUBCASE("Profile batched DFT throughput") {
+    bool do_profiling = false;  // Set to true to get profiling output
+    if (!do_profiling) return;
+
+    ProfileOutput profile_output;
+    profile_output.show_compile(true);
+    std::cout << "Batched DFT" << ProfileOutput::header();
+
+    int const BatchSize = 512;
+
+    for (int Dim = 64; Dim <= 512; Dim *= 2) {
+      Float::Array2D signals(BatchSize, Dim);
+      create_test_signals(signals);
+
+      Timer timer1;
+      DFTBatch k(signals);
+      k.compile();
+      profile_output.add_compile("DFT batch float", timer1, Dim);
+      if (k.has_errors()) break;
+
+      profile_output.run(Dim, "DFT batch float", BatchSize, "signals", [&k] (int numQPUs) {
+        k.setNumQPUs(numQPUs);
+        k.call();
+      });
+    }
+
+    std::cout << profile_output.dump();
+  }
+}
+
+
+TEST_CASE("DFT with dimensions as uniforms [dft][dftbatch][kernelcache]") {
+  float const precision = 2e-3f;
+
+  SUBCASE("Float signals, same kernel for all dimensions") {
+    auto k = compile(kernels::dft_dims<Float::Ptr>);
+    REQUIRE(!k.has_errors());
+
+    auto test = [&k, precision] (int rows, int Dim, int num_qpus) {
+      INFO("rows: " << rows << ", Dim: " << Dim << ", num QPUs: " << num_qpus);
+      Float::Array2D signals(rows, Dim);
+      create_test_signals(signals);
+      auto expected = scalar_dft_rows(signals);
+
+      Complex::Array twiddles(Dim);
+      kernels::dft_twiddles(twiddles);
+
+      Complex::Array2D result(rows, Dim);
+      k.setNumQPUs(num_qpus);
+      k.load(&result, &signals, &twiddles, rows, Dim).call();
+      check_dft_rows(result, expected, precision*((float) Dim));
+    };
+
+    test( 1, 16, 1);
+    test( 5, 32, 4);
+    test(24, 64, 8);
+  }
+
+
+  SUBCASE("Complex signals") {
+    auto k = compile(kernels::dft_dims<Complex::Ptr>);
+    REQUIRE(!k.has_errors());
+
+    int const Rows = 3;
+    int const Dim  = 32;
+    Complex::Array2D signals(Rows, Dim);
+    for (int r = 0; r < Rows; ++r) {
+      for (int c = 0; c < Dim; ++c) {
+        signals[r][c] = complex(wavelet_function(c, Dim), 0.5f*random_float());
+      }
+    }
+    auto expected = scalar_dft_rows(signals);
+
+    Complex::Array twiddles(Dim);
+    kernels::dft_twiddles(twiddles);
+
+    Complex::Array2D result(Rows, Dim);
+    k.setNumQPUs(2);
+    k.load(&result, &signals, &twiddles, Rows, Dim).call();
+    check_dft_rows(result, expected, precision*((float) Dim));
+  }
+}
@@ -7,6 +7,9 @@
 #include "support/support.h"
 #include "Source/Complex.h"
 #include "Source/Functions.h"
+#include "Liveness/Liveness.h"
+#include "Target/instr/Mnemonics.h"
+#include "Target/Subst.h"
 
 using namespace V3DLib;
 using namespace std;
@@ -780,7 +783,7 @@ TEST_CASE("Initialization with index() on uniform pointers should work as expect
     k.call();
     check("dma qpu");
 
-    LibSettings::use_tmu_for_load(false);
+    LibSettings::use_tmu_for_load(true);  // Restore the default
   }
 }
 
@@ -1298,3 +1301,280 @@ TEST_CASE("Test integer division and remainder [dsl][intdiv]") {
   test(  0,   1,   0, 0);
   test( 32,   0,   MAX_INT, 0);
 }
+
+
+void int_div_long_kernel(Int::Ptr quotient, Int::Ptr remainder, Int::Ptr a, Int::Ptr b) {
+  Int in_a = *a;
+  Int in_b = *b;
+  Int q, r;
+  functions::long_integer_division(q, r, in_a, in_b);
+  *quotient  = q;
+  *remainder = r;
+}
+
+
+void int_div_fast_kernel(Int::Ptr quotient, Int::Ptr remainder, Int::Ptr a, Int::Ptr b) {
+  Int in_a = *a;
+  Int in_b = *b;
+  Int q, r;
+  functions::integer_division(q, r, in_a, in_b);
+  *quotient  = q;
+  *remainder = r;
+}
+
+
+template<int D>
+void int_div_const_kernel(Int::Ptr quotient, Int::Ptr remainder, Int::Ptr a) {
+  Int in = *a;
+  *quotient  = in / D;
+  *remainder = in % D;
+}
+
+
+TEST_CASE("Fast integer division should be bit-exact with long division [dsl][intdiv]") {
+  int const N = 16;
+  int const MAX_INT = 2147483647;
+
+  Int::Array a(N), b(N);
+  Int::Array q_long(N), r_long(N);
+  Int::Array q_fast(N), r_fast(N);
+
+  auto k_long = compile(int_div_long_kernel);
+  auto k_fast = compile(int_div_fast_kernel);
+  k_long.load(&q_long, &r_long, &a, &b);
+  k_fast.load(&q_fast, &r_fast, &a, &b);
+
+  std::vector<int> edge = {
+    0, 1, -1, 2, 3, 7, 15, 16, 17, 255, 256, 1000, -1000, 65535, 65536, 65537, (1 << 23) + 1,
+    (1 << 24) - 1, 1 << 24, 123456789, -123456789, (1 << 30) + 1, MAX_INT - 1, MAX_INT, -MAX_INT
+  };
+
+  std::vector<int> values = edge;
+  srand(42);
+  for (int i = 0; i < 64; ++i) {
+    values << (rand() - RAND_MAX/2);                  // Full range
+    values << (rand() % 2000 - 1000);                 // Small values
+    values << ((rand() % 0x10000) << (rand() % 16));  // Various magnitudes
+  }
+
+  auto check = [&] (std::vector<int> const &lhs, std::vector<int> const &rhs) {
+    for (int i = 0; i < (int) lhs.size(); i += N) {
+      for (int j = 0; j < N; ++j) {
+        a[j] = lhs[(i + j) % lhs.size()];
+        b[j] = rhs[(i + j) % rhs.size()];
+      }
+
+      k_long.emu();
+      k_fast.emu();
+
+      for (int j = 0; j < N; ++j) {
+        INFO(a[j] << "/" << b[j]);
+        REQUIRE(q_fast[j] == q_long[j]);
+        REQUIRE(r_fast[j] == r_long[j]);
+      }
+    }
+  };
+
+  // Every value against a sliding window of divisors
+  for (int shift = 0; shift < (int) edge.size(); shift += 5) {
+    std::vector<int> divisors;
+    for (int i = 0; i < (int) values.size(); ++i) {
+      divisors << values[(i + shift) % values.size()];
+    }
+
+    check(values, divisors);
+    check(values, edge);
+  }
+
+  SUBCASE("Division by constant should be bit-exact with long division") {
+    Int::Array q_const(N), r_const(N);
+
+    auto test = [&] (auto kernel, int d) {
+      auto k = compile(kernel);
+      k.load(&q_const, &r_const, &a);
+
+      for (int i = 0; i < (int) values.size(); i += N) {
+        for (int j = 0; j < N; ++j) {
+          a[j] = values[(i + j) % values.size()];
+          b[j] = d;
+        }
+
+        k_long.emu();
+        k.emu();
+
+        for (int j = 0; j < N; ++j) {
+          INFO(a[j] << "/" << d);
+          REQUIRE(q_const[j] == q_long[j]);
+          REQUIRE(r_const[j] == r_long[j]);
+        }
+      }
+    };
+
+    test(int_div_const_kernel<1>,       1);
+    test(int_div_const_kernel<-1>,     -1);
+    test(int_div_const_kernel<3>,       3);
+    test(int_div_const_kernel<7>,       7);
+    test(int_div_const_kernel<-7>,     -7);
+    test(int_div_const_kernel<16>,     16);
+    test(int_div_const_kernel<-64>,   -64);
+    test(int_div_const_kernel<1000>, 1000);
+    test(int_div_const_kernel<641>,   641);
+    test(int_div_const_kernel<65537>, 65537);
+    test(int_div_const_kernel<123456789>, 123456789);
+    test(int_div_const_kernel<MAX_INT>, MAX_INT);
+    test(int_div_const_kernel<0>,       0);
+  }
+}
+
+
+TEST_CASE("Compile phases should be recorded in the compile data [dsl][compile_info]") {
+  auto k = compile(int_div_kernel);
+
+  auto check = [] (CompileData const &data, std::vector<std::string> const &expected) {
+    std::vector<std::string> names;
+
+    for (auto const &p : data.phases) {
+      names << p.name;
+      REQUIRE(p.seconds >= 0);
+      REQUIRE(p.rss_kb > 0);
+    }
+    REQUIRE(names == expected);
+
+    // Instruction counts are passed on from phase to phase
+    for (int i = 1; i < (int) data.phases.size(); ++i) {
+      auto const &prev = data.phases[i - 1];
+      auto const &cur  = data.phases[i];
+      if (prev.instrs_after == -1 || cur.name == "encode") continue;
+      INFO("phase " << cur.name);
+      REQUIRE(cur.instrs_before == prev.instrs_after);
+    }
+
+    REQUIRE(data.total_seconds() > 0);
+  };
+
+  REQUIRE(k.has_vc4());
+  check(k.vc4().compile_stats(), {
+    "ast", "translate_stmt", "loadStorePass", "liveness", "hoistImmediates", "combineImmediates",
+    "hoistInvariants", "reduceInductionVars", "introduceAccum", "regalloc", "satisfy", "removeLabels", "encode"
+  });
+
+  REQUIRE(k.has_v3d());
+  check(k.v3d().compile_stats(), {
+    "ast", "translate_stmt", "liveness", "hoistImmediates", "combineImmediates",
+    "hoistInvariants", "reduceInductionVars", "introduceAccum", "regalloc", "satisfy", "encode", "combine", "removeLabels"
+  });
+
+  std::string info = k.compile_info();
+  REQUIRE(info.find("vc4:\n") != std::string::npos);
+  REQUIRE(info.find("v3d:\n") != std::string::npos);
+  REQUIRE(info.find("regalloc") != std::string::npos);
+
+  std::string json = k.compile_info_json();
+  REQUIRE(json.find("{\"vc4\": {") == 0);
+  REQUIRE(json.find(", \"v3d\": {") != std::string::npos);
+  REQUIRE(json.find("\"name\": \"introduceAccum\"") != std::string::npos);
+}
+
+
+TEST_CASE("Liveness should be kept up to date over optimizations [dsl][liveness]") {
+  using namespace V3DLib::Target::instr;
+
+  // Loop with an accumulating variable
+  Label loop = freshLabel();
+  Instr::List instrs;
+  instrs << li(rf(0), 1)
+         << li(rf(1), 0)
+         << li(rf(2), 1)
+         << label(loop)
+         << add(rf(1), rf(1), rf(0)).pushz()
+         << branch(loop).allzc()
+         << mov(rf(3), rf(1));
+
+  int const NUM_VARS = 4;
+
+  auto check = [] (Liveness &live, Instr::List &instrs) {
+    Liveness expected(NUM_VARS);
+    expected.compute(instrs);
+
+    REQUIRE(live.size() == expected.size());
+    for (int i = 0; i < live.size(); i++) {
+      INFO("instruction " << i);
+      REQUIRE(live[i] == expected[i]);
+    }
+
+    for (int var = 0; var < NUM_VARS; var++) {
+      INFO("var " << var);
+      REQUIRE(live.reg_usage()[var].dump() == expected.reg_usage()[var].dump());
+    }
+  };
+
+  Liveness live(NUM_VARS);
+  live.compute(instrs);
+  REQUIRE(live[4].member(0));
+
+  // Replace var 0 with var 2, which has the same value
+  live.invalidate(instrs[0]);
+  live.invalidate(instrs[4]);
+  instrs[0].tag = InstrTag::SKIP;
+  renameUses(instrs[4], rf(0), rf(2));
+  live.invalidate(instrs[4]);  // Include the new variable
+  live.update(instrs);
+
+  check(live, instrs);
+  REQUIRE(!live[4].member(0));
+  REQUIRE(live[5].member(2));  // Live over the loop
+
+  live.remove_skips(instrs);
+  REQUIRE(instrs.size() == 6);
+  check(live, instrs);
+}
+
+
+namespace {
+
+void loop_code_motion_kernel(Int::Ptr result, Int::Ptr src, Int n) {
+  For (Int i = 0, i < n, i++)
+    Int offset = (numQPUs() << 4) + 3*me();           // Loop-invariant
+    Int a = *(src + (i << 4));                         // Induction variables
+    Int b = *(src + ((n - 1 - i) << 4));
+
+    For (Int j = 0, j < 2, j++)
+      a = a + offset*(n + 1);                          // Loop-invariant in both loops
+    End
+
+    *(result + (i << 4)) = a - b;
+  End
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Loop-invariant code and induction variables should be optimized [dsl][licm]") {
+  int const N = 8;
+
+  Int::Array src(16*N);
+  for (int i = 0; i < (int) src.size(); i++) {
+    src[i] = 3*i - 7;
+  }
+
+  Int::Array expected(16*N);
+  Int::Array result(16*N);
+
+  auto k = compile(loop_code_motion_kernel);
+  REQUIRE(!k.has_errors());
+  REQUIRE(k.vc4().compile_stats().num_invariants_hoisted > 0);
+  REQUIRE(k.vc4().compile_stats().num_induction_vars_reduced > 0);
+  REQUIRE(k.v3d().compile_stats().num_invariants_hoisted > 0);
+  REQUIRE(k.v3d().compile_stats().num_induction_vars_reduced > 0);
+
+  k.load(&expected, &src, N);
+  k.interpret();
+
+  k.load(&result, &src, N);
+  k.emu();
+
+  for (int i = 0; i < (int) result.size(); i++) {
+    INFO("index: " << i);
+    REQUIRE(result[i] == expected[i]);
+  }
+}
@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the work-queue loop with lane recycling
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <vector>
+#include "V3DLib.h"
+
+using namespace V3DLib;
+
+namespace {
+
+float const TopLeftReal   = -2.5f;
+float const BottomRightIm = -2.0f;
+float const RangeReal     =  4.0f;
+float const RangeIm       =  4.0f;
+
+
+struct MandelParams {
+  int width;
+  int height;
+  int num_iterations;
+
+  int num_items() const { return width*height; }
+  float offsetX() const { return RangeReal/((float) width  - 1); }
+  float offsetY() const { return RangeIm  /((float) height - 1); }
+};
+
+
+/**
+ * Reference implementation, same calculation as `mandelbrot_cpu()` in the examples
+ */
+std::vector<int> mandelbrot_cpu(MandelParams const &p) {
+  std::vector<int> result(p.num_items());
+
+  for (int xStep = 0; xStep < p.width; xStep++) {
+    for (int yStep = 0; yStep < p.height; yStep++) {
+      float realC = TopLeftReal   + ((float) xStep)*p.offsetX();
+      float imC   = BottomRightIm + ((float) yStep)*p.offsetY();
+
+      int count = 0;
+      float real = realC;
+      float im   = imC;
+      float radius = (real*real + im*im);
+
+      while (radius < 4 && count < p.num_iterations) {
+        float tmpReal = real*real - im*im;
+        float tmpIm   = 2*real*im;
+        real = tmpReal + realC;
+        im   = tmpIm + imC;
+
+        radius = (real*real + im*im);
+        count++;
+      }
+
+      result[xStep + yStep*p.width] = count;
+    }
+  }
+
+  return result;
+}
+
+
+int Window = 4;  // Passed to `for_each_item()`
+
+
+void mandelbrot_kernel(
+  Float topLeftReal, Float bottomRightIm,
+  Float offsetX, Float offsetY,
+  Int width, Int num_items,
+  Int num_iterations,
+  Int::Ptr result
+) {
+  Float inv_width = 1.0f/toFloat(width);
+  Int   x = 0;
+  Int   y = 0;
+  Float real_c = 0.0f;
+  Float im_c   = 0.0f;
+  Float real   = 0.0f;
+  Float im     = 0.0f;
+  Float radius = 0.0f;
+  Int   count  = 0;
+
+  ItemCallbacks<Int> loop;
+
+  loop.init = [&] (Int const &item) {
+    y = toInt((toFloat(item) + 0.5f)*inv_width);
+    x = item - y*width;
+
+    Where (x < 0)
+      x += width;
+      y--;
+    End
+
+    Where (x >= width)
+      x -= width;
+      y++;
+    End
+
+    real_c = topLeftReal   + toFloat(x)*offsetX;
+    im_c   = bottomRightIm + toFloat(y)*offsetY;
+    real   = real_c;
+    im     = im_c;
+    radius = real*real + im*im;
+    count  = 0;
+  };
+
+  loop.done = [&] () {
+    return (radius >= 4.0f || count >= num_iterations);
+  };
+
+  loop.step = [&] () {
+    Float tmp_real = real*real - im*im;
+    Float tmp_im   = 2.0f*real*im;
+    real   = tmp_real + real_c;
+    im     = tmp_im + im_c;
+    radius = real*real + im*im;
+    count++;
+  };
+
+  loop.result = [&] () -> Int {
+    return count;
+  };
+
+  for_each_item(result, num_items, loop, Window);
+}
+
+
+/**
+ * Output is the square of the item index, with item i taking i % 7 iterations
+ */
+void float_kernel(Float::Ptr result, Int num_items) {
+  Int   steps = 0;
+  Float val   = 0.0f;
+  Float inc   = 0.0f;
+
+  ItemCallbacks<Float> loop;
+
+  loop.init = [&] (Int const &item) {
+    steps = item & 7;
+    inc   = toFloat(item);
+    val   = 0.0f;
+  };
+
+  loop.done   = [&] () { return (steps <= 0); };
+  loop.step   = [&] () { val = val + inc; steps--; };
+  loop.result = [&] () -> Float { return val; };
+
+  for_each_item(result, num_items, loop);
+}
+
+
+void check_mandelbrot(MandelParams const &p, int num_qpus, bool interpret = false) {
+  INFO("width: " << p.width << ", height: " << p.height << ", num QPUs: " << num_qpus << ", window: " << Window);
+
+  auto expected = mandelbrot_cpu(p);
+
+  int size = 16*((p.num_items() + 15)/16);
+  Int::Array result(size);
+  result.fill(-1);
+
+  auto k = compile(mandelbrot_kernel);
+  k.setNumQPUs(num_qpus);
+  k.load(TopLeftReal, BottomRightIm, p.offsetX(), p.offsetY(), p.width, p.num_items(), p.num_iterations, &result);
+
+  if (interpret) {
+    k.interpret();
+  } else {
+    k.emu();
+  }
+
+  for (int i = 0; i < p.num_items(); ++i) {
+    INFO("i: " << i);
+    REQUIRE(result[i] == expected[i]);
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test work-queue loop with lane recycling [foreachitem]") {
+
+  SUBCASE("Mandelbrot should be identical to the cpu version") {
+    Window = 4;
+    check_mandelbrot({64, 48, 256}, 1);
+    check_mandelbrot({64, 48, 256}, 8);
+    check_mandelbrot({20, 13, 100}, 1);  // Number of items not a multiple of 16
+    check_mandelbrot({20, 13, 100}, 3);
+
+    Window = 1;
+    check_mandelbrot({64, 48, 256}, 1);
+    check_mandelbrot({20, 13, 100}, 3);
+    Window = 8;
+    check_mandelbrot({64, 48, 256}, 8);
+    Window = 4;
+  }
+
+
+  SUBCASE("Mandelbrot should work with the interpreter") {
+    check_mandelbrot({20, 13, 64}, 1, true);
+    check_mandelbrot({20, 13, 64}, 2, true);
+  }
+
+
+  SUBCASE("Float results should be written in item order") {
+    int const num_items = 1000;
+    Float::Array result(16*((num_items + 15)/16));
+    result.fill(-1.0f);
+
+    auto k = compile(float_kernel);
+    k.setNumQPUs(4);
+    k.load(&result, num_items);
+    k.emu();
+
+    for (int i = 0; i < num_items; ++i) {
+      INFO("i: " << i);
+      REQUIRE(result[i] == (float) (i*(i & 7)));
+    }
+  }
+}
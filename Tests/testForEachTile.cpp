@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the dynamic distribution of tiles over QPUs
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <vector>
+#include "V3DLib.h"
+
+using namespace V3DLib;
+
+namespace {
+
+/**
+ * Tile cost in iterations; irregular, with a couple of expensive tiles at the start
+ */
+int tile_cost(int tile) {
+  if (tile < 2) return 400;
+  return (tile*7) & 15;
+}
+
+
+/**
+ * Per tile, a vector is written with:
+ *   - lane 0: QPU which handled the tile
+ *   - lane 1: result of the tile calculation
+ */
+void tile_kernel(Int::Ptr result, Int::Ptr counter, Int num_tiles) {
+  for_each_tile(counter, num_tiles, [&] (Int const &tile) {
+    Int cost = (tile*7) & 15;
+    Where (tile < 2)
+      cost = 400;
+    End
+
+    Int sum = 0;
+    For (Int i = 0, i < cost, i++)
+      sum += tile;
+    End
+
+    Int out = me();
+    Where (index() == 1)
+      out = sum;
+    End
+
+    *(result + 16*tile) = out;
+  });
+}
+
+
+/**
+ * Every QPU increments a shared counter a number of times, with the mutex taken.
+ * Without the mutex, increments would get lost.
+ */
+void mutex_kernel(Int::Ptr counter, Int::Ptr mutex, Int reps) {
+  For (Int i = 0, i < reps, i++)
+    mutex_lock(mutex);
+
+    Int value;
+    gather(counter - index());
+    receive(value);
+    *counter = value + 1;
+
+    mutex_unlock(mutex);
+  End
+}
+
+
+struct TileRun {
+  std::vector<int> qpu;
+  int counter;
+};
+
+
+TileRun run_tiles(int num_tiles, int num_qpus) {
+  INFO("num tiles: " << num_tiles << ", num QPUs: " << num_qpus);
+
+  Int::Array result(16*num_tiles);
+  Int::Array counter(16*(1 + num_qpus));
+  result.fill(-1);
+  counter.fill(0);
+
+  auto k = compile(tile_kernel);
+  REQUIRE(!k.has_errors());  // Also checks the v3d version, which uses a mutex in main memory
+  k.setNumQPUs(num_qpus);
+  k.load(&result, &counter, num_tiles);
+  k.emu();
+
+  TileRun ret;
+  ret.counter = counter[0];
+
+  for (int t = 0; t < num_tiles; ++t) {
+    INFO("tile: " << t);
+    int qpu = result[16*t];
+    REQUIRE(0 <= qpu);
+    REQUIRE(qpu < num_qpus);
+    REQUIRE(result[16*t + 1] == t*tile_cost(t));
+    ret.qpu.push_back(qpu);
+  }
+
+  return ret;
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test dynamic tile distribution [foreachtile]") {
+  int const NumTiles = 40;
+
+  SUBCASE("All tiles should be handled exactly once") {
+    for (int num_qpus : {1, 3, 8}) {
+      auto run = run_tiles(NumTiles, num_qpus);
+      REQUIRE(run.counter == NumTiles + num_qpus);
+    }
+  }
+
+
+  SUBCASE("Distribution should be dynamic and deterministic on the emulator") {
+    int const NumQPUs = 4;
+    auto run1 = run_tiles(NumTiles, NumQPUs);
+    auto run2 = run_tiles(NumTiles, NumQPUs);
+    REQUIRE(run1.qpu == run2.qpu);
+
+    // The QPUs with the expensive tiles should handle fewer tiles than in static distribution
+    std::vector<int> count(NumQPUs, 0);
+    for (int qpu : run1.qpu) count[qpu]++;
+    REQUIRE(count[run1.qpu[0]] < NumTiles/NumQPUs);
+    REQUIRE(count[run1.qpu[1]] < NumTiles/NumQPUs);
+  }
+}
+
+
+TEST_CASE("Test mutex in main memory [foreachtile]") {
+  int const Reps = 5;
+
+  auto k = compile(mutex_kernel);
+
+  for (int num_qpus : {1, 3, 8}) {
+    INFO("num QPUs: " << num_qpus);
+    Int::Array counter(16);
+    Int::Array mutex(16*num_qpus);
+    k.setNumQPUs(num_qpus);
+    k.load(&counter, &mutex, Reps);
+
+    counter.fill(0);
+    mutex.fill(0);
+    k.emu();
+    REQUIRE(counter[0] == num_qpus*Reps);
+
+    counter.fill(0);
+    mutex.fill(0);
+    k.interpret();
+    REQUIRE(counter[0] == num_qpus*Reps);
+  }
+}
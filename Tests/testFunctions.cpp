@@ -30,7 +30,69 @@ FloatExpr hello_float_function() {
 void hello_float_kernel(Float::Ptr result) {
  *result = hello_float_function();
 } 
- 
+
+
+Function<Int, Int, Int> combine_function("combine", [] (Int const &a, Int const &b) {
+  Int ret = 3*a + b;
+
+  Where (ret > 100)
+    ret = ret - 100;
+  End
+
+  functions::Return(ret);
+});
+
+
+Function<Float, Float> halve_function("halve", [] (Float const &a) {
+  functions::Return(0.5f*a);
+});
+
+
+int combine(int a, int b) {
+  int ret = 3*a + b;
+  if (ret > 100) ret -= 100;
+  return ret;
+}
+
+
+/**
+ * Calls functions from multiple call sites, also within a loop and within a where-block
+ */
+void call_kernel(Int::Ptr result, Float::Ptr f_result, Int::Ptr in) {
+  Int a = *in;
+  Int x = combine_function(a, 1);
+
+  For (Int i = 0, i < 3, i++)
+    x = combine_function(x, i);
+  End
+
+  Where (index() < 8)
+    x = combine_function(x, index());
+  End
+
+  Int y = combine_function(a, x);
+  *result = y;
+
+  Float f = toFloat(y);
+  f = halve_function(f);
+  *f_result = halve_function(f);
+}
+
+
+/**
+ * Multiple calls of integer division, to compare code size with inlining
+ */
+void many_calls_kernel(Int::Ptr result) {
+  Int x = 1000000 + 12345*index();
+
+  for (int i = 0; i < 4; i++) {
+    Int d = 3 + i + index();
+    x = x/d + x%d;
+  }
+
+  *result = x;
+}
+
 }  // anon namespace
 
 
@@ -63,6 +125,94 @@ TEST_CASE("Test functions [funcs]") {
 }
 
 
+TEST_CASE("Out-of-line functions should give correct results [funcs][call]") {
+  int const N = 16;
+
+  Int::Array in(N);
+  for (int i = 0; i < N; i++) {
+    in[i] = 7*i + 2;  // Non-negative, integer multiplication is 24-bit
+  }
+
+  // Expected values
+  std::vector<int>   expected(N);
+  std::vector<float> f_expected(N);
+
+  for (int i = 0; i < N; i++) {
+    int x = combine(in[i], 1);
+    for (int j = 0; j < 3; j++) x = combine(x, j);
+    if (i < 8) x = combine(x, i);
+    expected[i] = combine(in[i], x);
+    f_expected[i] = 0.25f*((float) expected[i]);
+  }
+
+  auto check = [&] (Int::Array const &result, Float::Array const &f_result) {
+    for (int i = 0; i < N; i++) {
+      INFO("index " << i);
+      REQUIRE(result[i] == expected[i]);
+      REQUIRE(f_result[i] == f_expected[i]);
+    }
+  };
+
+  Int::Array   result(N);
+  Float::Array f_result(N);
+
+  SUBCASE("Out-of-line") {
+    // Note that this can not be inlined; the body of combine_function() declares a variable,
+    // which is not allowed within a where-block.
+    auto k = compile(call_kernel);
+
+    result.fill(-1);
+    f_result.fill(-1);
+    k.load(&result, &f_result, &in);
+    k.interpret();
+    check(result, f_result);
+
+    result.fill(-1);
+    f_result.fill(-1);
+    k.load(&result, &f_result, &in);
+    k.emu();
+    check(result, f_result);
+  }
+
+  SUBCASE("Out-of-line division should generate less code than inlined") {
+    auto k1 = compile(many_calls_kernel);
+    int size_out_of_line = k1.vc4().targetCode().size();
+
+    functions::inline_division(true);
+    auto k2 = compile(many_calls_kernel);
+    int size_inline = k2.vc4().targetCode().size();
+    functions::inline_division(false);
+
+    INFO("out-of-line: " << size_out_of_line << ", inline: " << size_inline);
+    REQUIRE(size_out_of_line < size_inline);
+
+    // Expected values
+    std::vector<int> expected(N);
+    for (int i = 0; i < N; i++) {
+      int x = 1000000 + 12345*i;
+      for (int j = 0; j < 4; j++) {
+        int d = 3 + j + i;
+        x = x/d + x%d;
+      }
+      expected[i] = x;
+    }
+
+    Int::Array result1(N);
+    k1.load(&result1);
+    k1.emu();
+
+    Int::Array result2(N);
+    k2.load(&result2);
+    k2.interpret();
+
+    for (int i = 0; i < N; i++) {
+      REQUIRE(result1[i] == expected[i]);
+      REQUIRE(result2[i] == expected[i]);
+    }
+  }
+}
+
+
 template<typename T1, typename T2>
 void check_result(T1 const &result, T2 const &expected) {
   REQUIRE(expected.size() == result.size());
@@ -30,6 +30,27 @@ void immediate_kernel(Int::Ptr int_result, Float::Ptr float_result) {
   *float_result = 0.0f;
 }
 
+
+/**
+ * Large immediates in loops, these should be loaded before the loop
+ */
+void loop_immediate_kernel(Int::Ptr int_result, Float::Ptr float_result, Int n) {
+  Int   a = index();
+  Float b = toFloat(index());
+
+  For (Int i = 0, i < n, i++)
+    a = (a + 12345) & 0xffff;
+    b = b*0.5f + 3.75f;
+
+    For (Int j = 0, j < 3, j++)
+      a = a + 12345;              // Same value as in outer loop
+    End
+  End
+
+  *int_result   = a;
+  *float_result = b;
+}
+
 }  // anon namespace
 
 
@@ -56,3 +77,30 @@ TEST_CASE("Test loading of immediates [dsl][imm]") {
   REQUIRE(float_result[16*2] ==   0.225f);
   REQUIRE(float_result[16*3] ==   0.0f);
 }
+
+
+TEST_CASE("Large immediates should be loaded outside of loops [dsl][imm][hoist]") {
+  int const N = 5;
+
+  Int::Array int_expected(16);
+  Float::Array float_expected(16);
+  Int::Array int_result(16);
+  Float::Array float_result(16);
+
+  auto k = compile(loop_immediate_kernel);
+  REQUIRE(!k.has_errors());
+  REQUIRE(k.vc4().compile_stats().num_immediates_hoisted > 0);
+  REQUIRE(k.v3d().compile_stats().num_immediates_hoisted > 0);
+
+  k.load(&int_expected, &float_expected, N);
+  k.interpret();
+
+  k.load(&int_result, &float_result, N);
+  k.emu();
+
+  for (int i = 0; i < 16; i++) {
+    INFO("index: " << i);
+    REQUIRE(int_result[i]   == int_expected[i]);
+    REQUIRE(float_result[i] == float_expected[i]);
+  }
+}
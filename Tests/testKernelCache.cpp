@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the kernel cache and dimension-independent kernels
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <vector>
+#include "KernelCache.h"
+#include "Kernels/Matrix.h"
+#include "support/matrix_support.h"
+
+using namespace V3DLib;
+
+namespace {
+
+/**
+ * Fill a (rows x inner) and b (columns x inner, transposed) with random values
+ * and return the scalar matrix product.
+ */
+std::vector<float> prepare_mult(Float::Array2D &a, Float::Array2D &b) {
+  for (int r = 0; r < a.rows(); ++r) {
+    for (int c = 0; c < a.columns(); ++c) a[r][c] = random_float();
+  }
+
+  for (int r = 0; r < b.rows(); ++r) {
+    for (int c = 0; c < b.columns(); ++c) b[r][c] = random_float();
+  }
+
+  int const cols_result = 16*((b.rows() + 15)/16);
+  std::vector<float> expected(a.rows()*cols_result, 0.0f);
+
+  for (int r = 0; r < a.rows(); ++r) {
+    for (int c = 0; c < b.rows(); ++c) {
+      float sum = 0;
+      for (int i = 0; i < a.columns(); ++i) {
+        sum += a[r][i]*b[c][i];
+      }
+
+      expected[r*cols_result + c] = sum;
+    }
+  }
+
+  return expected;
+}
+
+
+void check_mult(Float::Array2D &result, std::vector<float> const &expected, int columns) {
+  REQUIRE((int) expected.size() == result.rows()*result.columns());
+
+  for (int r = 0; r < result.rows(); ++r) {
+    for (int c = 0; c < columns; ++c) {
+      INFO("r: " << r << ", c: " << c);
+      REQUIRE(abs(result[r][c] - expected[r*result.columns() + c]) < 1e-4f);
+    }
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test kernel cache [kernelcache]") {
+  // Some recurring shapes
+  struct Shape {
+    int rows;
+    int inner;
+    int columns;
+  };
+
+  std::vector<Shape> shapes = {{16, 32, 16}, {32, 16, 16}, {16, 48, 32}};
+
+
+  SUBCASE("Cached kernels should be compiled only once per shape") {
+    KernelCache cache(4);
+
+    for (int pass = 0; pass < 2; ++pass) {
+      for (auto const &s : shapes) {
+        Float::Array2D a(s.rows, s.inner);
+        Float::Array2D b(s.columns, s.inner);
+        auto expected = prepare_mult(a, b);
+        Float::Array2D result(s.rows, 16*((s.columns + 15)/16));
+
+        auto &k = kernels::cached_matrix_mult(cache, s.rows, s.inner, s.columns, 4);
+        REQUIRE(!k.has_errors());
+        REQUIRE(k.numQPUs() == 4);
+        k.load(&result, &a, &b).call();
+        check_mult(result, expected, s.columns);
+      }
+    }
+
+    REQUIRE(cache.size()      == (int) shapes.size());
+    REQUIRE(cache.misses()    == (int) shapes.size());
+    REQUIRE(cache.hits()      == (int) shapes.size());
+    REQUIRE(cache.evictions() == 0);
+  }
+
+
+  SUBCASE("Least recently used kernel should be evicted") {
+    KernelCache cache(2);
+
+    auto get = [&cache, &shapes] (int index) {
+      auto const &s = shapes[index];
+      kernels::cached_matrix_mult(cache, s.rows, s.inner, s.columns);
+    };
+
+    auto contains = [&cache, &shapes] (int index) -> bool {
+      auto const &s = shapes[index];
+      KernelKey key = {"matrix_mult", {s.rows, s.inner, s.columns, LibSettings::use_tmu_for_load()}, 1, BOTH};
+      return cache.contains(key);
+    };
+
+    get(0);
+    get(1);
+    get(0);  // 0 is now most recently used
+    get(2);  // Should evict 1
+
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.evictions() == 1);
+    REQUIRE(contains(0));
+    REQUIRE(!contains(1));
+    REQUIRE(contains(2));
+
+    // Different num QPUs is a different key
+    auto const &s = shapes[0];
+    kernels::cached_matrix_mult(cache, s.rows, s.inner, s.columns, 8);
+    REQUIRE(cache.misses() == 4);
+    REQUIRE(!contains(0));  // Was least recently used
+    REQUIRE(contains(2));
+
+    cache.max_size(1);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(!contains(2));
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+  }
+
+
+  SUBCASE("Cached DFT kernels should be compiled once per size") {
+    KernelCache cache;
+
+    for (int pass = 0; pass < 2; ++pass) {
+      for (int Dim = 16; Dim <= 32; Dim += 16) {
+        Float::Array input(Dim);
+        for (int i = 0; i < Dim; ++i) input[i] = random_float();
+        Complex::Array2D result;
+
+        auto &k = kernels::cached_dft(cache, input, result);
+        REQUIRE(!k.has_errors());
+        REQUIRE(result.columns() == Dim);
+      }
+    }
+
+    REQUIRE(cache.misses() == 2);
+    REQUIRE(cache.hits()   == 2);
+  }
+}
+
+
+TEST_CASE("Test matrix mult with dimensions as uniforms [kernelcache][matrix]") {
+  auto k = compile(kernels::matrix_mult_dims<Float::Ptr>);
+  REQUIRE(!k.has_errors());
+
+  auto test = [&k] (int rows, int inner, int columns, int num_qpus) {
+    INFO("rows: " << rows << ", inner: " << inner << ", columns: " << columns << ", num QPUs: " << num_qpus);
+    Float::Array2D a(rows, inner);
+    Float::Array2D b(columns, inner);
+    auto expected = prepare_mult(a, b);
+
+    Float::Array2D result(rows, 16*((columns + 15)/16));
+    result.fill(-1.0f);
+
+    k.setNumQPUs(num_qpus);
+    k.load(&result, &a, &b, rows, inner, columns).call();
+    check_mult(result, expected, columns);
+  };
+
+  // Same kernel for all shapes
+  test(16, 16, 16, 1);
+  test(16, 48, 16, 4);
+  test( 5, 32, 21, 8);
+  test(33, 16,  3, 12);
+}
@@ -0,0 +1,278 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the math functions with precision tiers.
+//
+// This doubles as a harness for selecting precision tiers. For every function and tier,
+// the max error in ulp and the number of instructions per call are determined on the
+// emulator, and output as a table.
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <V3DLib.h>
+#include "LibSettings.h"
+#include "Target/Emulator.h"
+
+using namespace V3DLib;
+using functions::Precision;
+
+namespace {
+
+// Assumed precision of the SFU results on the hardware, in mantissa bits.
+// The emulator truncates the SFU results to this, so that the effect of the refinement steps shows.
+int const SFU_BITS = 22;
+
+int const N = 16*64;  // Number of samples per function
+
+using MathOp    = std::function<FloatExpr (Float const &a, Float const &b)>;
+using Reference = std::function<double (double a, double b)>;
+
+MathOp math_op;  // Operation to test in math_kernel()
+
+
+void math_kernel(Float::Ptr result, Float::Ptr in_a, Float::Ptr in_b, Int n) {
+  For (Int i = 0, i < n, i += 16)
+    Float a = *in_a;
+    Float b = *in_b;
+    *result = math_op(a, b);
+
+    in_a   += 16;
+    in_b   += 16;
+    result += 16;
+  End
+}
+
+
+/**
+ * Error of a float result in ulp's of the exact result
+ */
+double ulp_error(float val, double expected) {
+  float e   = std::fabs((float) expected);
+  float ulp = std::nextafter(e, INFINITY) - e;
+  if (e < FLT_MIN) ulp = std::nextafter(FLT_MIN, INFINITY) - FLT_MIN;
+
+  return std::fabs((double) val - expected)/ulp;
+}
+
+
+/**
+ * Inputs for a function, as a function of the index of a sample
+ */
+struct Inputs {
+  std::function<float (int i)> a;
+  std::function<float (int i)> b = [] (int i) { return 0.0f; };
+};
+
+
+// Sample uniformly in range lo..hi
+std::function<float (int i)> uniform(float lo, float hi) {
+  return [lo, hi] (int i) { return lo + (hi - lo)*((float) i)/(N - 1); };
+}
+
+
+// Sample with uniform distribution of the exponent in range lo..hi, lo > 0.
+// Shuffle the samples, to get differing exponents in the vectors
+std::function<float (int i)> log_uniform(float lo, float hi) {
+  return [lo, hi] (int i) {
+    int j = (i*389) % N;
+    return (float) (lo*std::pow((double) hi/lo, ((double) j)/(N - 1)));
+  };
+}
+
+
+// Negate every other sample
+std::function<float (int i)> alternating(std::function<float (int i)> f) {
+  return [f] (int i) { return (i % 2 == 0)?f(i):-f(i); };
+}
+
+
+struct UlpResult {
+  std::string name;
+  Precision   prec;
+  double      max_ulp         = 0;
+  double      instrs_per_call = 0;
+
+  static std::string header() {
+    std::ostringstream os;
+    os << std::left << std::setw(10) << "function" << std::setw(8) << "tier"
+       << std::right << std::setw(14) << "max ulp" << std::setw(14) << "instrs/call" << "\n";
+    return os.str();
+  }
+
+  std::string dump() const {
+    std::ostringstream os;
+    os << std::left << std::setw(10) << name << std::setw(8) << functions::precision_name(prec)
+       << std::right << std::setw(14) << std::setprecision(4) << max_ulp
+       << std::setw(14) << std::fixed << std::setprecision(1) << instrs_per_call << "\n";
+    return os.str();
+  }
+};
+
+
+/**
+ * Run the passed operation on the emulator, and return the number of instructions executed.
+ */
+uint64_t run_op(MathOp op, Float::Array &result, Float::Array &a, Float::Array &b) {
+  math_op = op;
+  auto k = compile(math_kernel);
+  k.load(&result, &a, &b, N);
+
+  uint64_t before = emulated_instruction_count();
+  k.emu();
+  return emulated_instruction_count() - before;
+}
+
+
+UlpResult measure(std::string const &name, Precision prec, MathOp op, Reference ref, Inputs const &in) {
+  Float::Array a(N);
+  Float::Array b(N);
+  Float::Array result(N);
+
+  for (int i = 0; i < N; i++) {
+    a[i] = in.a(i);
+    b[i] = in.b(i);
+  }
+
+  // Baseline: the loop with the input passed through unchanged
+  uint64_t base  = run_op([] (Float const &a, Float const &b) -> FloatExpr { return a; }, result, a, b);
+  uint64_t count = run_op(op, result, a, b);
+
+  UlpResult ret;
+  ret.name            = name;
+  ret.prec            = prec;
+  ret.instrs_per_call = ((double) count - (double) base)/(N/16);
+
+  for (int i = 0; i < N; i++) {
+    double err = ulp_error(result[i], ref(a[i], b[i]));
+    INFO(name << " " << functions::precision_name(prec) << ", input: " << a[i] << ", " << b[i]
+              << ", result: " << result[i] << ", expected: " << ref(a[i], b[i]));
+    REQUIRE(!std::isnan(err));
+    if (err > ret.max_ulp) ret.max_ulp = err;
+  }
+
+  return ret;
+}
+
+
+/**
+ * Definition of a math function under test
+ */
+struct MathFunction {
+  std::string name;
+  std::function<FloatExpr (Float const &a, Float const &b, Precision prec)> op;
+  Reference   ref;
+  Inputs      in;
+  double      max_ulp_full;  // Upper bound of error for tier FULL
+};
+
+
+std::vector<MathFunction> const math_functions = {
+  { "recip",
+    [] (Float const &a, Float const &b, Precision p) { return functions::recip(a, p); },
+    [] (double a, double b) { return 1/a; },
+    { log_uniform(1e-3f, 1e3f) },
+    2
+  },
+  { "div",
+    [] (Float const &a, Float const &b, Precision p) { return functions::div(a, b, p); },
+    [] (double a, double b) { return a/b; },
+    { uniform(-100, 100), log_uniform(1e-3f, 1e3f) },
+    2
+  },
+  { "rsqrt",
+    [] (Float const &a, Float const &b, Precision p) { return functions::rsqrt(a, p); },
+    [] (double a, double b) { return 1/std::sqrt(a); },
+    { log_uniform(1e-4f, 1e4f) },
+    2
+  },
+  { "sqrt",
+    [] (Float const &a, Float const &b, Precision p) { return functions::sqrt(a, p); },
+    [] (double a, double b) { return std::sqrt(a); },
+    { log_uniform(1e-4f, 1e4f) },
+    2
+  },
+  { "exp2",
+    [] (Float const &a, Float const &b, Precision p) { return functions::exp2(a, p); },
+    [] (double a, double b) { return std::exp2(a); },
+    { uniform(-20, 20) },
+    4
+  },
+  { "log2",
+    [] (Float const &a, Float const &b, Precision p) { return functions::log2(a, p); },
+    [] (double a, double b) { return std::log2(a); },
+    { log_uniform(1e-4f, 1e4f) },
+    4
+  },
+  { "pow",
+    [] (Float const &a, Float const &b, Precision p) { return functions::pow(a, b, p); },
+    [] (double a, double b) { return std::pow(a, b); },
+    { log_uniform(0.1f, 10), uniform(-4, 4) },
+    16
+  },
+  { "atan2",
+    [] (Float const &a, Float const &b, Precision p) { return functions::atan2(a, b, p); },
+    [] (double a, double b) { return std::atan2(a, b); },
+    { uniform(-10, 10), alternating(log_uniform(0.1f, 10)) },
+    4
+  },
+  { "asin",
+    [] (Float const &a, Float const &b, Precision p) { return functions::asin(a, p); },
+    [] (double a, double b) { return std::asin(a); },
+    { uniform(-1, 1) },
+    4
+  },
+  { "acos",
+    [] (Float const &a, Float const &b, Precision p) { return functions::acos(a, p); },
+    [] (double a, double b) { return std::acos(a); },
+    { uniform(-1, 1) },
+    4
+  },
+  { "tanh",
+    [] (Float const &a, Float const &b, Precision p) { return functions::tanh(a, p); },
+    [] (double a, double b) { return std::tanh(a); },
+    { uniform(-5, 5) },
+    4
+  },
+};
+
+}  // anon namespace
+
+
+TEST_CASE("Math functions should have expected precision per tier [math]") {
+  // Reset SFU precision on exit, also on failure
+  struct SfuPrecision {
+    SfuPrecision()  { LibSettings::emulator_sfu_precision(SFU_BITS); }
+    ~SfuPrecision() { LibSettings::emulator_sfu_precision(0); }
+  } sfu_precision;
+
+  std::string report;
+  report += UlpResult::header();
+
+  for (auto const &f : math_functions) {
+    std::vector<UlpResult> results;
+
+    for (auto prec : { functions::FAST, functions::NEWTON, functions::FULL }) {
+      auto op = [&f, prec] (Float const &a, Float const &b) { return f.op(a, b, prec); };
+      results.push_back(measure(f.name, prec, op, f.ref, f.in));
+      report += results.back().dump();
+    }
+
+    INFO(report);
+    auto const &fast   = results[0];
+    auto const &newton = results[1];
+    auto const &full   = results[2];
+
+    // The precision of FAST and NEWTON depends on SFU_BITS, only FULL is checked
+    REQUIRE(full.max_ulp <= f.max_ulp_full);
+    REQUIRE(fast.instrs_per_call <= newton.instrs_per_call);
+    REQUIRE(newton.instrs_per_call <= full.instrs_per_call);
+  }
+
+  bool do_profiling = false;  // Set to true to get the precision table
+  if (!do_profiling) return;
+
+  std::cout << "\nMath functions, SFU precision " << SFU_BITS << " bits\n" << report << std::endl;
+}
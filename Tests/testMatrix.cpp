@@ -570,6 +570,7 @@ TEST_CASE("Test complex matrix algebra with varying sizes [matrix][complex]") {
     test(8);
     test(1, 2);
     test(8, 2);
+    test(8, 3);
   }
 
 
@@ -757,6 +758,70 @@ void test_simple_block(int dimension) {
     }
 }
 
+
+
+/**
+ * Multiply random rectangular matrices with class Matrix and compare with a scalar multiplication.
+ *
+ * The inner dimension need not be a multiple of 16, it is padded internally.
+ * Row and column counts can be anything, as long as the input arrays can be allocated.
+ */
+void test_rectangular_block(
+  int rows, int inner, int cols,
+  int num_blocks,
+  int tile_columns = 0,
+  int num_qpus = 8,
+  bool change_inputs = false
+) {
+  INFO("rows: " << rows << ", inner: " << inner << ", cols: " << cols
+    << ", num blocks: " << num_blocks << ", tile columns: " << tile_columns);
+
+  Float::Array2D a(rows, inner);
+  Float::Array2D b(cols, inner);  // Remember, b transposed
+
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < inner; ++c) a[r][c] = random_float();
+  }
+
+  for (int r = 0; r < cols; ++r) {
+    for (int c = 0; c < inner; ++c) b[r][c] = random_float();
+  }
+
+  Matrix m(a, b);
+  m.num_blocks(num_blocks)
+   .tile_columns(tile_columns);
+  m.setNumQPUs(num_qpus);
+  m.call();
+  REQUIRE(!m.has_errors());
+
+  if (change_inputs) {
+    // Check that changes in the inputs get picked up on the next call
+    for (int r = 0; r < rows; ++r) {
+      for (int c = 0; c < inner; ++c) a[r][c] = random_float();
+    }
+
+    m.call();
+  }
+
+  auto &result = m.result();
+  REQUIRE(result.rows() == rows);
+  REQUIRE(result.columns() >= cols);
+
+  float const precision = 1.0e-5f*((float) inner);
+
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      float expected = 0;
+      for (int i = 0; i < inner; ++i) {
+        expected += a[r][i]*b[c][i];
+      }
+
+      INFO("r: " << r << ", c: " << c << ", result: " << result[r][c] << ", expected: " << expected);
+      REQUIRE(abs(result[r][c] - expected) < precision);
+    }
+  }
+}
+
 }  // anon namespace
 
 
@@ -768,6 +833,35 @@ TEST_CASE("Test block matrix multiplication [matrix][block]") {
     // Following works but takes long! Enable if you really want to check
     //test_simple_block(832);  // Test huge matrix above block limit as well
   }
+
+  SUBCASE("Test more than 2 blocks") {
+    test_rectangular_block(32, 3*16, 32, 3);
+    test_rectangular_block(16, 4*32, 48, 4, 0, 1);
+    test_rectangular_block(48, 5*16, 32, 5);
+  }
+
+  SUBCASE("Test inner dimension not a multiple of 16") {
+    test_rectangular_block(32, 37, 32, 1);
+    test_rectangular_block(16, 37, 48, 2);
+    test_rectangular_block(48, 45, 16, 3, 0, 1);
+    test_rectangular_block(16, 37, 32, 1, 0, 8, true);
+  }
+
+  SUBCASE("Test row and column counts not a multiple of 16") {
+    test_rectangular_block(3, 48, 5, 1);
+    test_rectangular_block(5, 32, 7, 2);
+    test_rectangular_block(1, 48, 23, 3, 0, 1);
+  }
+
+  SUBCASE("Test column tiling") {
+    test_rectangular_block(64, 32, 48, 1, 16);
+    test_rectangular_block(64, 50, 48, 2, 32);  // Last tile is partial
+  }
+
+  SUBCASE("Default number of blocks should be > 2 for big inner dimension") {
+    // Inner dimension is above the register limit for a full mult
+    test_rectangular_block(16, 1700, 16, Matrix<Float::Array2D>::DEFAULT_NUM_BLOCKS);
+  }
 }
 
 
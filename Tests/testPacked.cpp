@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the packed vector types
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <algorithm>
+#include <cmath>
+#include "V3DLib.h"
+#include "Support/Helpers.h"
+
+using namespace V3DLib;
+
+namespace {
+
+int const NumVecs = 4;
+
+
+void uint8_kernel(UInt8::Ptr dst, UInt8::Ptr src, Int num_vecs) {
+  For (Int i = 0, i < num_vecs, i++)
+    UInt8 x = *(src + 16*i);
+    x.pack(x.unpack(0) + 100, x.unpack(1) - 100, 2*x.unpack(2), x.unpack(3));
+    *(dst + 16*i) = x;
+  End
+}
+
+
+void int16_kernel(Int16::Ptr dst, Int16::Ptr src, Int num_vecs) {
+  For (Int i = 0, i < num_vecs, i++)
+    Int16 x = *(src + 16*i);
+    x.pack(x.unpack(0) << 2, x.unpack(1) - 1);  // NB integer multiply is 24-bit on vc4
+    *(dst + 16*i) = x;
+  End
+}
+
+
+void half_kernel(Half::Ptr dst, Half::Ptr src, Int num_vecs) {
+  For (Int i = 0, i < num_vecs, i++)
+    Half x = *(src + 16*i);
+    x.pack(1.5f*x.unpack(0) + 0.25f, -x.unpack(1));
+    *(dst + 16*i) = x;
+  End
+}
+
+
+/**
+ * Run the kernel on both the emulator and interpreter, check output with passed function
+ */
+template<typename Kernel, typename Array, typename F>
+void run_both(Kernel &k, Array &dst, F check) {
+  dst.fill(0);
+  k.call();
+  check();
+
+  dst.fill(0);
+  k.interpret();
+  check();
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test packed types [packed]") {
+
+  SUBCASE("UInt8 should unpack and pack with saturation") {
+    int const size = 64*NumVecs;
+    UInt8::Array src(size);
+    UInt8::Array dst(size);
+
+    for (int i = 0; i < size; ++i) {
+      src[i] = (uint8_t) ((i*37) % 256);
+    }
+
+    auto check = [&] () {
+      for (int i = 0; i < size; ++i) {
+        int val = src[i];
+        int expected;
+        switch (i % 4) {
+          case 0: expected = std::min(val + 100, 255); break;
+          case 1: expected = std::max(val - 100, 0);   break;
+          case 2: expected = std::min(2*val, 255);     break;
+          default: expected = val;                     break;
+        }
+
+        INFO("i: " << i);
+        REQUIRE(dst[i] == expected);
+      }
+    };
+
+    auto k = compile(uint8_kernel);
+    k.load(&dst, &src, NumVecs);
+    run_both(k, dst, check);
+  }
+
+
+  SUBCASE("Int16 should unpack and pack with saturation") {
+    int const size = 32*NumVecs;
+    Int16::Array src(size);
+    Int16::Array dst(size);
+
+    for (int i = 0; i < size; ++i) {
+      src[i] = (int16_t) ((i*1237) % 65536 - 32768);
+    }
+
+    auto check = [&] () {
+      for (int i = 0; i < size; ++i) {
+        int val = src[i];
+        int expected;
+        if (i % 2 == 0) {
+          expected = std::max(std::min(4*val, 32767), -32768);
+        } else {
+          expected = std::max(val - 1, -32768);
+        }
+
+        INFO("i: " << i);
+        REQUIRE(dst[i] == expected);
+      }
+    };
+
+    auto k = compile(int16_kernel);
+    k.load(&dst, &src, NumVecs);
+    run_both(k, dst, check);
+  }
+
+
+  SUBCASE("Host half conversions should handle special values") {
+    REQUIRE(to_half(0.0f)     == 0x0000);
+    REQUIRE(to_half(-0.0f)    == 0x8000);
+    REQUIRE(to_half(1.0f)     == 0x3c00);
+    REQUIRE(to_half(-2.0f)    == 0xc000);
+    REQUIRE(to_half(65504.0f) == 0x7bff);  // Max half
+    REQUIRE(to_half(1e5f)     == 0x7c00);  // Overflow to infinity
+    REQUIRE(to_half(1e-8f)    == 0x0000);  // Underflow
+    REQUIRE(to_half(INFINITY) == 0x7c00);
+    REQUIRE(to_half(NAN)      == 0x7e00);
+
+    REQUIRE(from_half(0x3c00) == 1.0f);
+    REQUIRE(from_half(0xc000) == -2.0f);
+    REQUIRE(from_half(0x3555) == 0.333251953125f);
+    REQUIRE(from_half(0x0001) == 0.0f);      // Subnormal flushed
+    REQUIRE(std::isinf(from_half(0x7c00)));
+    REQUIRE(std::isnan(from_half(0x7e00)));
+
+    // Round trip of all normal halfs
+    for (int h = 0x0400; h < 0x7c00; ++h) {
+      REQUIRE(to_half(from_half((uint16_t) h)) == h);
+    }
+  }
+
+
+  SUBCASE("Half should convert the same as the host") {
+    int const size = 32*NumVecs;
+    Half::Array src(size);
+    Half::Array dst(size);
+
+    for (int i = 0; i < size; ++i) {
+      src[i] = to_half(1000*random_float());
+    }
+    src[0] = to_half(60000.0f);  // Overflows after scaling
+    src[2] = to_half(1e-4f);     // Close to underflow
+
+    auto check = [&] () {
+      for (int i = 0; i < size; ++i) {
+        float val = from_half(src[i]);
+        uint16_t expected = (i % 2 == 0)? to_half(1.5f*val + 0.25f) : to_half(-val);
+
+        INFO("i: " << i << ", val: " << val);
+        REQUIRE(dst[i] == expected);
+      }
+    };
+
+    auto k = compile(half_kernel);
+    k.load(&dst, &src, NumVecs);
+    run_both(k, dst, check);
+  }
+}
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for precompiled kernels
+//
+// The generated source is compiled here to a shared library, in the same way
+// as the CPU backend does, and its native code is run through `PrecompiledKernel`.
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <cstdio>
+#include <cstdlib>  // system()
+#include <dlfcn.h>
+#include <V3DLib.h>
+#include "LibSettings.h"
+#include "KernelWriter.h"
+#include "PrecompiledKernel.h"
+
+using namespace V3DLib;
+
+namespace {
+
+int const N = 16*32;
+
+
+void scale_kernel(Int::Ptr dst, Float::Ptr src, Float factor, Int n) {
+  For (Int i = 16*me(), i < n, i += 16*numQPUs())
+    Float a = *(src + i);
+    *(dst + i) = toInt(a*factor) + me();
+  End
+}
+
+
+bool contains(std::string const &str, std::string const &sub) {
+  return str.find(sub) != std::string::npos;
+}
+
+
+std::string hex(uint64_t code) {
+  char buf[32];
+  sprintf(buf, "0x%016llxull", (unsigned long long) code);
+  return buf;
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test precompiled kernels [precompiled]") {
+  Float::Array src(N);
+  for (int i = 0; i < N; i++) {
+    src[i] = 0.5f*((float) i);
+  }
+
+  auto k = compile(scale_kernel);
+  KernelWriter writer("scale", k);
+
+  SUBCASE("Generated source should contain the compiled kernel") {
+    REQUIRE(param_signature<Int::Ptr, Float::Ptr, Float, Int>() == "Int::Ptr, Float::Ptr, Float, Int");
+    REQUIRE(param_uniforms<Int::Ptr, Complex::Ptr, Int>() == 4);
+
+    std::string header = writer.header();
+    REQUIRE(contains(header, "extern V3DLib::PrecompiledData const scale_data;"));
+    REQUIRE(contains(header,
+      "using scale = V3DLib::PrecompiledKernel<V3DLib::Int::Ptr, V3DLib::Float::Ptr, V3DLib::Float, V3DLib::Int>;"));
+
+    std::string source = writer.source();
+    REQUIRE(contains(source, "\"Int::Ptr, Float::Ptr, Float, Int\""));
+    REQUIRE(contains(source, "extern \"C\" void v3dlib_precompiled_scale("));
+
+    auto vc4_code = k.vc4().to_opcodes();
+    auto v3d_code = k.v3d().to_opcodes();
+    REQUIRE(contains(source, "vc4_code[" + std::to_string(vc4_code.size()) + "]"));
+    REQUIRE(contains(source, "v3d_code[" + std::to_string(v3d_code.size()) + "]"));
+
+    for (auto code : vc4_code) REQUIRE(contains(source, hex(code)));
+    for (auto code : v3d_code) REQUIRE(contains(source, hex(code)));
+  }
+
+  SUBCASE("Generated source should compile and run") {
+    int const NUM_QPUS = 4;
+
+    Int::Array expected(N);
+    k.setNumQPUs(NUM_QPUS);
+    k.load(&expected, &src, 3.0f, N);
+    k.interpret();
+
+    // Compile the generated code with the library headers
+    writer.write("obj/test");
+    std::string lib = "obj/test/precompiled_scale.so";
+    std::string command;
+    command << LibSettings::cpu_compiler() << " -std=c++17 -fPIC -shared -I Lib"
+            << " -o " << lib << " obj/test/scale.cpp";
+    INFO(command);
+    REQUIRE(system(command.c_str()) == 0);
+
+    void *handle = dlopen(("./" + lib).c_str(), RTLD_NOW | RTLD_LOCAL);
+    REQUIRE(handle != nullptr);
+    auto native = (cpu::KernelFunc) dlsym(handle, "v3dlib_precompiled_scale");
+    REQUIRE(native != nullptr);
+
+    PrecompiledData data = {
+      "scale", "Int::Ptr, Float::Ptr, Float, Int", 4, nullptr, 0, nullptr, 0, native
+    };
+
+    Int::Array result(N);
+    result.fill(-1);
+
+    PrecompiledKernel<Int::Ptr, Float::Ptr, Float, Int> pk(data);
+    pk.setNumQPUs(NUM_QPUS);
+    pk.load(&result, &src, 3.0f, N);
+    pk.cpu();
+
+    for (int i = 0; i < N; i++) {
+      INFO("index: " << i);
+      REQUIRE(result[i] == expected[i]);
+    }
+
+    // Parameter types must match the precompiled kernel
+    REQUIRE_THROWS(PrecompiledKernel<Int::Ptr, Float::Ptr, Int>(data));
+
+    dlclose(handle);
+  }
+}
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the array reductions
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "V3DLib.h"
+#include "Support/Helpers.h"
+#include "Kernels/Reduce.h"
+
+using namespace V3DLib;
+using namespace kernels;
+
+namespace {
+
+std::vector<int> const Sizes   = {1, 15, 16, 17, 100, 1000};
+std::vector<int> const NumQPUs = {1, 4, 8};
+
+
+/**
+ * User kernel which scales the sum of the array
+ */
+void scaled_sum_kernel(Float::Ptr result, Float::Ptr src, Int size, Float::Ptr partials, Int::Ptr flags) {
+  Float sum;
+  reduce_sum(sum, src, size, partials, flags);
+
+  If (me() == 0)
+    *result = 0.5f*sum;
+  End
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test array reductions [reduce]") {
+
+  SUBCASE("Int reductions") {
+    for (int size : Sizes) {
+      Int::Array src(size);
+      std::vector<int> values(size);
+
+      for (int i = 0; i < size; ++i) {
+        values[i] = (int) (1000*random_float());
+        src[i] = values[i];
+      }
+
+      int expected_sum    = std::accumulate(values.begin(), values.end(), 0);
+      int expected_min    = *std::min_element(values.begin(), values.end());
+      int expected_max    = *std::max_element(values.begin(), values.end());
+      int expected_argmax = (int) (std::max_element(values.begin(), values.end()) - values.begin());
+
+      for (int num_qpus : NumQPUs) {
+        INFO("size: " << size << ", num QPUs: " << num_qpus);
+        REQUIRE(reduce_sum(src, num_qpus)    == expected_sum);
+        REQUIRE(reduce_min(src, num_qpus)    == expected_min);
+        REQUIRE(reduce_max(src, num_qpus)    == expected_max);
+        REQUIRE(reduce_argmax(src, num_qpus) == expected_argmax);
+      }
+    }
+  }
+
+
+  SUBCASE("Float reductions") {
+    for (int size : Sizes) {
+      Float::Array src(size);
+      std::vector<float> values(size);
+
+      for (int i = 0; i < size; ++i) {
+        values[i] = random_float();
+        src[i] = values[i];
+      }
+
+      float expected_sum    = std::accumulate(values.begin(), values.end(), 0.0f);
+      float expected_min    = *std::min_element(values.begin(), values.end());
+      float expected_max    = *std::max_element(values.begin(), values.end());
+      int   expected_argmax = (int) (std::max_element(values.begin(), values.end()) - values.begin());
+
+      for (int num_qpus : NumQPUs) {
+        INFO("size: " << size << ", num QPUs: " << num_qpus);
+        REQUIRE(abs(reduce_sum(src, num_qpus) - expected_sum) < 1e-5f*(float) size);
+        REQUIRE(reduce_min(src, num_qpus)    == expected_min);
+        REQUIRE(reduce_max(src, num_qpus)    == expected_max);
+        REQUIRE(reduce_argmax(src, num_qpus) == expected_argmax);
+      }
+    }
+  }
+
+
+  SUBCASE("Argmax should return the first occurence of the maximum") {
+    int const size = 100;
+    Int::Array src(size);
+    src.fill(1);
+    src[37] = 5;
+    src[21] = 5;
+    src[90] = 5;
+
+    for (int num_qpus : NumQPUs) {
+      INFO("num QPUs: " << num_qpus);
+      REQUIRE(reduce_argmax(src, num_qpus) == 21);
+    }
+  }
+
+
+  SUBCASE("Reductions should be usable in user kernels") {
+    int const size     = 123;
+    int const num_qpus = 8;
+
+    Float::Array src(size);
+    float expected = 0;
+
+    for (int i = 0; i < size; ++i) {
+      src[i] = (float) (i % 4);
+      expected += src[i];
+    }
+    expected *= 0.5f;
+
+    Float::Array result(16);
+    Float::Array partials(16*num_qpus);
+    Int::Array flags(16*num_qpus);
+    flags.fill(0);
+
+    auto k = compile(scaled_sum_kernel);
+    REQUIRE(!k.has_errors());
+    k.setNumQPUs(num_qpus);
+    k.load(&result, &src, size, &partials, &flags);
+
+    // Same flags for all calls, these should be reset by the kernel
+    for (int pass = 0; pass < 2; ++pass) {
+      result.fill(0);
+      k.call();
+      REQUIRE(abs(result[0] - expected) < 1e-5f);
+
+      result.fill(0);
+      k.interpret();
+      REQUIRE(abs(result[0] - expected) < 1e-5f);
+    }
+
+    for (int i = 0; i < (int) flags.size(); ++i) {
+      REQUIRE(flags[i] == 0);
+    }
+  }
+}
@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the prefix sums
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <iostream>
+#include <numeric>
+#include <vector>
+#include "V3DLib.h"
+#include "Support/Helpers.h"
+#include "Support/Timer.h"
+#include "Kernels/Scan.h"
+#include "support/ProfileOutput.h"
+
+using namespace V3DLib;
+using namespace kernels;
+
+namespace {
+
+std::vector<int> const Sizes   = {1, 15, 16, 17, 100, 1000};
+std::vector<int> const NumQPUs = {1, 4, 8};
+
+int padded(int size) { return 16*((size + 15)/16); }
+
+
+void rotate_scan_kernel(Int::Ptr dst, Int::Ptr src) {
+  Int input = *src;
+  Int result;
+  rotate_scan(input, result);
+  *dst = result;
+}
+
+
+template<typename Array, typename Type>
+void check_scan(Array &result, std::vector<Type> const &input, bool inclusive, Type precision) {
+  std::vector<Type> expected(input.size());
+
+  if (inclusive) {
+    std::partial_sum(input.begin(), input.end(), expected.begin());
+  } else {
+    std::partial_sum(input.begin(), input.end() - 1, expected.begin() + 1);
+    expected[0] = 0;
+  }
+
+  for (int i = 0; i < (int) input.size(); ++i) {
+    INFO("i: " << i << ", result: " << result[i] << ", expected: " << expected[i]);
+    REQUIRE(abs(result[i] - expected[i]) <= precision);
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test prefix sums [scan]") {
+
+  SUBCASE("Scan within a vector") {
+    Int::Array src(16);
+    Int::Array dst(16);
+    std::vector<int> input(16);
+
+    for (int i = 0; i < 16; ++i) {
+      input[i] = i*i - 7;
+      src[i] = input[i];
+    }
+
+    auto k = compile(rotate_scan_kernel);
+    k.load(&dst, &src).call();
+    check_scan(dst, input, true, 0);
+  }
+
+
+  SUBCASE("Int scans") {
+    for (int size : Sizes) {
+      Int::Array src(size);
+      Int::Array dst(padded(size));
+      std::vector<int> input(size);
+
+      for (int i = 0; i < size; ++i) {
+        input[i] = (int) (100*random_float());
+        src[i] = input[i];
+      }
+
+      for (int num_qpus : NumQPUs) {
+        INFO("size: " << size << ", num QPUs: " << num_qpus);
+
+        inclusive_scan(dst, src, num_qpus);
+        check_scan(dst, input, true, 0);
+
+        exclusive_scan(dst, src, num_qpus);
+        check_scan(dst, input, false, 0);
+      }
+    }
+  }
+
+
+  SUBCASE("Float scans") {
+    for (int size : Sizes) {
+      Float::Array src(size);
+      Float::Array dst(padded(size));
+      std::vector<float> input(size);
+
+      for (int i = 0; i < size; ++i) {
+        input[i] = random_float();
+        src[i] = input[i];
+      }
+
+      for (int num_qpus : NumQPUs) {
+        INFO("size: " << size << ", num QPUs: " << num_qpus);
+
+        // Order of summation differs, allow for rounding differences
+        inclusive_scan(dst, src, num_qpus);
+        check_scan(dst, input, true, 1e-6f*(float) size);
+
+        exclusive_scan(dst, src, num_qpus);
+        check_scan(dst, input, false, 1e-6f*(float) size);
+      }
+    }
+  }
+
+
+  SUBCASE("Profile scan throughput") {
+    bool do_profiling = false;  // Set to true to get profiling output
+    if (!do_profiling) return;
+
+    ProfileOutput profile_output;
+    std::cout << "Inclusive scan" << ProfileOutput::header();
+
+    for (int size = 1024; size <= 256*1024; size *= 4) {
+      Float::Array src(size);
+      Float::Array dst(size);
+      for (int i = 0; i < size; ++i) src[i] = random_float();
+
+      inclusive_scan(dst, src);  // Compile outside of profiling
+
+      profile_output.run(size, "scan float", size, "elements", [&dst, &src] (int numQPUs) {
+        inclusive_scan(dst, src, numQPUs);
+      });
+    }
+
+    std::cout << profile_output.dump();
+  }
+}
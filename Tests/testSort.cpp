@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the bitonic sort
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "V3DLib.h"
+#include "Support/Helpers.h"
+#include "Kernels/Sort.h"
+#include "support/ProfileOutput.h"
+
+using namespace V3DLib;
+using namespace kernels;
+
+namespace {
+
+std::vector<int> const Sizes   = {16, 32, 64, 256, 2048};
+std::vector<int> const NumQPUs = {1, 8};
+
+
+template<typename Array, typename Type>
+void check_sorted(Array &result, std::vector<Type> input) {
+  std::sort(input.begin(), input.end());
+
+  for (int i = 0; i < (int) input.size(); ++i) {
+    INFO("i: " << i << ", result: " << result[i] << ", expected: " << input[i]);
+    REQUIRE(result[i] == input[i]);
+  }
+}
+
+
+/**
+ * The values are the original indices of the keys; check that these moved along with the keys.
+ */
+template<typename Array, typename Type>
+void check_values(Array &keys, Int::Array &values, std::vector<Type> const &input) {
+  std::vector<bool> seen(input.size(), false);
+
+  for (int i = 0; i < (int) input.size(); ++i) {
+    int index = values[i];
+    REQUIRE(0 <= index);
+    REQUIRE(index < (int) input.size());
+    REQUIRE(!seen[index]);
+    seen[index] = true;
+
+    INFO("i: " << i << ", index: " << index);
+    REQUIRE(keys[i] == input[index]);
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test bitonic sort [sort]") {
+
+  SUBCASE("Sort Int keys") {
+    for (int size : Sizes) {
+      std::vector<int> input(size);
+      for (int i = 0; i < size; ++i) {
+        input[i] = (int) (1000*random_float()) - 500;  // Includes duplicates
+      }
+
+      for (int num_qpus : NumQPUs) {
+        INFO("size: " << size << ", num QPUs: " << num_qpus);
+        Int::Array keys(size);
+        for (int i = 0; i < size; ++i) keys[i] = input[i];
+
+        sort(keys, num_qpus);
+        check_sorted(keys, input);
+      }
+    }
+  }
+
+
+  SUBCASE("Sort Float keys") {
+    for (int size : Sizes) {
+      std::vector<float> input(size);
+      for (int i = 0; i < size; ++i) {
+        input[i] = random_float();
+      }
+
+      for (int num_qpus : NumQPUs) {
+        INFO("size: " << size << ", num QPUs: " << num_qpus);
+        Float::Array keys(size);
+        for (int i = 0; i < size; ++i) keys[i] = input[i];
+
+        sort(keys, num_qpus);
+        check_sorted(keys, input);
+      }
+    }
+  }
+
+
+  SUBCASE("Sort key/value pairs") {
+    for (int size : Sizes) {
+      std::vector<int>   int_input(size);
+      std::vector<float> float_input(size);
+      for (int i = 0; i < size; ++i) {
+        int_input[i]   = (int) (100*random_float());
+        float_input[i] = random_float();
+      }
+
+      for (int num_qpus : NumQPUs) {
+        INFO("size: " << size << ", num QPUs: " << num_qpus);
+        Int::Array   int_keys(size);
+        Float::Array float_keys(size);
+        Int::Array   values(size);
+
+        for (int i = 0; i < size; ++i) {
+          int_keys[i] = int_input[i];
+          values[i]   = i;
+        }
+
+        sort(int_keys, values, num_qpus);
+        check_sorted(int_keys, int_input);
+        check_values(int_keys, values, int_input);
+
+        for (int i = 0; i < size; ++i) {
+          float_keys[i] = float_input[i];
+          values[i]     = i;
+        }
+
+        sort(float_keys, values, num_qpus);
+        check_sorted(float_keys, float_input);
+        check_values(float_keys, values, float_input);
+      }
+    }
+  }
+
+
+  SUBCASE("Profile sort throughput") {
+    bool do_profiling = false;  // Set to true to get profiling output
+    if (!do_profiling) return;
+
+    ProfileOutput profile_output;
+    std::cout << "Bitonic sort" << ProfileOutput::header();
+
+    for (int size = 1024; size <= 64*1024; size *= 4) {
+      Float::Array keys(size);
+      for (int i = 0; i < size; ++i) keys[i] = random_float();
+
+      sort(keys);  // Compile outside of profiling
+
+      profile_output.run(size, "sort float", size, "elements", [&keys, size] (int numQPUs) {
+        for (int i = 0; i < size; ++i) keys[i] = (float) ((i*7919) % size);
+        sort(keys, numQPUs);
+      });
+    }
+
+    std::cout << profile_output.dump();
+  }
+}
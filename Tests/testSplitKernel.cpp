@@ -0,0 +1,129 @@
+#include "doctest.h"
+#include <V3DLib.h>
+#include "SplitKernel.h"
+
+using namespace V3DLib;
+
+namespace {
+
+int const N = 16*60;  // Number of elements, must be a multiple of 16
+
+/**
+ * Kernel in the usual strided style; the work is divided over the QPUs by `me()` and `numQPUs()`.
+ *
+ * Besides the result, the id of the QPU which handled each block is stored.
+ */
+void square_kernel(Int::Ptr dst, Int::Ptr ids, Int::Ptr src, Int n) {
+  For (Int i = 16*me(), i < n, i += 16*numQPUs())
+    Int a = *(src + i);
+    *(dst + i) = a*a + 1;
+    *(ids + i) = me();
+  End
+}
+
+
+void check_result(Int::Array const &dst, Int::Array const &ids, int total) {
+  for (int i = 0; i < N; i++) {
+    INFO("index: " << i);
+    REQUIRE(dst[i] == i*i + 1);
+    REQUIRE(ids[i] == (i/16) % total);
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test split of kernel work between QPUs and host [splitkernel]") {
+  Int::Array src(N);
+  for (int i = 0; i < N; i++) {
+    src[i] = i;
+  }
+
+  Int::Array dst(N);
+  Int::Array ids(N);
+
+  auto k = compile(square_kernel);
+  k.setNumQPUs(2);
+
+  SUBCASE("Fixed split, all host executors") {
+    SplitKernel::Host hosts[] = { SplitKernel::INTERPRETER, SplitKernel::EMULATOR, SplitKernel::CPU };
+
+    for (auto host : hosts) {
+      dst.fill(-1);
+      ids.fill(-1);
+
+      SplitKernel split(k, host);
+      split.host_qpus(3);
+      REQUIRE(split.total_qpus() == 5);
+
+      k.load(&dst, &ids, &src, N);
+      split.run();
+      check_result(dst, ids, 5);
+    }
+  }
+
+  SUBCASE("QPUs only") {
+    dst.fill(-1);
+    ids.fill(-1);
+
+    SplitKernel split(k);
+    split.host_qpus(0);
+
+    k.load(&dst, &ids, &src, N);
+    split.run();
+    check_result(dst, ids, 2);
+  }
+
+  SUBCASE("Tuned split should give correct results") {
+    SplitKernel split(k, SplitKernel::CPU);
+    REQUIRE(split.host_qpus() == 1);
+
+    for (int run = 0; run < 3; run++) {
+      dst.fill(-1);
+      ids.fill(-1);
+
+      int total = split.total_qpus();
+      k.load(&dst, &ids, &src, N);
+      split.run();
+      check_result(dst, ids, total);
+
+      INFO(split.info());
+      REQUIRE(0 <= split.host_qpus());
+      REQUIRE(split.host_qpus() <= split.max_host_qpus());
+    }
+  }
+
+  SUBCASE("Split should be tuned to throughput") {
+    // Timings are passed in directly, the measured ones depend on the load of the host
+    {
+      // Host does its share 10x faster: d = 2, f = 5/6, n = f*d/(1 - f) = 10
+      SplitKernel split(k, SplitKernel::CPU);
+      split.tune(1.0, 0.1);
+      INFO(split.info());
+      REQUIRE(split.host_qpus() == 10);
+      REQUIRE(split.host_fraction() > 0.5);
+    }
+
+    {
+      // Host is 10x slower, it should get nothing
+      SplitKernel split(k, SplitKernel::CPU);
+      split.tune(0.1, 1.0);
+      REQUIRE(split.host_qpus() == 0);
+    }
+
+    {
+      // Same throughput per id, split stays as is
+      SplitKernel split(k, SplitKernel::CPU);
+      split.tune(1.0, 1.0);
+      REQUIRE(split.host_qpus() == 1);
+    }
+
+    {
+      // A fixed split is not tuned
+      SplitKernel split(k, SplitKernel::CPU);
+      split.host_qpus(3);
+      split.tune(1.0, 0.1);
+      REQUIRE(split.host_qpus() == 3);
+    }
+  }
+}
@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the generic 2D stencil kernels
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <vector>
+#include "V3DLib.h"
+#include "Support/Helpers.h"
+#include "Kernels/Stencil.h"
+#include "support/support.h"
+
+using namespace V3DLib;
+using namespace kernels;
+
+namespace {
+
+/**
+ * Return the grid coordinate for given boundary policy, -1 if outside the grid
+ */
+int boundary_index(int i, int size, Boundary boundary) {
+  if (0 <= i && i < size) return i;
+
+  switch (boundary) {
+    case Boundary::ZERO:  return -1;
+    case Boundary::CLAMP: return (i < 0)? 0 : size - 1;
+    case Boundary::TORUS: return (i + size) % size;
+  }
+
+  return -1;
+}
+
+
+/**
+ * Scalar version of the stencil kernel
+ */
+template<typename T>
+std::vector<T> stencil_scalar(std::vector<T> const &src, int height, int width, StencilMask const &mask, Boundary boundary) {
+  int const radius = mask.radius();
+  std::vector<T> ret(height*width);
+
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      T sum = 0;
+
+      for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+          int r = boundary_index(y + dy, height, boundary);
+          int c = boundary_index(x + dx, width, boundary);
+          if (r == -1 || c == -1) continue;
+
+          sum += ((T) mask.at(dy, dx))*src[r*width + c];
+        }
+      }
+
+      ret[y*width + x] = sum;
+    }
+  }
+
+  return ret;
+}
+
+
+void check_stencil(
+  StencilMask const &mask,
+  Boundary boundary,
+  int height,
+  int width,
+  int num_qpus
+) {
+  INFO("height: " << height << ", width: " << width << ", num QPUs: " << num_qpus
+       << ", boundary: " << (int) boundary << "\n" << mask.dump());
+
+  Float::Array src(height*width);
+  Float::Array dst(height*width);
+  std::vector<float> input(height*width);
+
+  for (int i = 0; i < height*width; ++i) {
+    input[i] = random_float();
+    src[i] = input[i];
+  }
+  dst.fill(-1.0f);
+
+  auto k = compile(stencil_decorator<Float>(mask, boundary));
+  REQUIRE(!k.has_errors());
+  k.setNumQPUs(num_qpus);
+  k.load(&dst, &src, height, width).call();
+
+  auto expected = stencil_scalar(input, height, width, mask, boundary);
+
+  for (int i = 0; i < height*width; ++i) {
+    INFO("y: " << i/width << ", x: " << i % width);
+    REQUIRE(abs(dst[i] - expected[i]) < 1e-5f);
+  }
+}
+
+
+/**
+ * Apply the rules of Conway's game of life for a neighbour count.
+ */
+void life_rules(Int &result, Int const &center) {
+  Int count = result;
+  result = 0;
+
+  Where (count == 3 || (count == 2 && center == 1))
+    result = 1;
+  End
+}
+
+
+std::vector<int> life_scalar(std::vector<int> const &src, int height, int width) {
+  std::vector<int> ret(height*width);
+
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      int count = 0;
+
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          if (dy == 0 && dx == 0) continue;
+          count += src[((y + dy + height) % height)*width + (x + dx + width) % width];
+        }
+      }
+
+      int center = src[y*width + x];
+      ret[y*width + x] = (count == 3 || (count == 2 && center == 1))? 1 : 0;
+    }
+  }
+
+  return ret;
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test generic stencil kernels [stencil]") {
+  std::vector<Boundary> boundaries = {Boundary::ZERO, Boundary::CLAMP, Boundary::TORUS};
+
+  SUBCASE("Full 3x3 mask with all boundary policies") {
+    StencilMask mask(1, {
+      0.05f, 0.10f, 0.05f,
+      0.10f, 0.40f, 0.10f,
+      0.05f, 0.15f, 0.0f
+    });
+
+    for (auto boundary : boundaries) {
+      check_stencil(mask, boundary, 7, 16, 1);
+      check_stencil(mask, boundary, 10, 48, 1);
+      check_stencil(mask, boundary, 10, 64, 4);
+    }
+  }
+
+
+  SUBCASE("Full mask with larger radius") {
+    std::vector<float> coefficients(7*7);
+    for (auto &c : coefficients) c = random_float();
+    StencilMask mask(3, coefficients);
+
+    for (auto boundary : boundaries) {
+      check_stencil(mask, boundary, 12, 32, 2);
+    }
+  }
+
+
+  SUBCASE("Masks too large for the register file should be refused") {
+    int const full = StencilMask::MAX_RADIUS_FULL;
+    int const sep  = StencilMask::MAX_RADIUS_SEPARABLE;
+
+    REQUIRE_NOTHROW(StencilMask(full, std::vector<float>((2*full + 1)*(2*full + 1), 1.0f)));
+    REQUIRE_THROWS(StencilMask(full + 1, std::vector<float>((2*full + 3)*(2*full + 3), 1.0f)));
+    REQUIRE_NOTHROW(StencilMask(std::vector<float>(2*sep + 1, 1.0f), std::vector<float>(2*sep + 1, 1.0f)));
+    REQUIRE_THROWS(StencilMask(std::vector<float>(2*sep + 3, 1.0f), std::vector<float>(2*sep + 3, 1.0f)));
+
+    // The largest masks should compile, also with a post step
+    auto post = [] (Float &result, Float const &center) { result = result - center; };
+
+    StencilMask full_mask(full, std::vector<float>((2*full + 1)*(2*full + 1), 0.5f));
+    REQUIRE(!compile(stencil_decorator<Float>(full_mask, Boundary::TORUS, post)).has_errors());
+
+    StencilMask sep_mask(std::vector<float>(2*sep + 1, 0.5f), std::vector<float>(2*sep + 1, 0.5f));
+    REQUIRE(!compile(stencil_decorator<Float>(sep_mask, Boundary::TORUS, post)).has_errors());
+  }
+
+
+  SUBCASE("Separable mask") {
+    StencilMask mask({1/16.0f, 4/16.0f, 6/16.0f, 4/16.0f, 1/16.0f}, {0.25f, 0.5f, 0.0f, -0.5f, -0.25f});
+
+    for (auto boundary : boundaries) {
+      check_stencil(mask, boundary, 9, 32, 1);
+      check_stencil(mask, boundary, 9, 80, 4);
+    }
+  }
+
+
+  SUBCASE("Int stencil as cellular automaton") {
+    int const height = 24;
+    int const width  = 48;
+
+    StencilMask mask(1, {
+      1, 1, 1,
+      1, 0, 1,
+      1, 1, 1
+    });
+
+    auto k = compile(stencil_decorator<Int>(mask, Boundary::TORUS, life_rules));
+    REQUIRE(!k.has_errors());
+    k.setNumQPUs(4);
+
+    Int::Array a(height*width);
+    Int::Array b(height*width);
+    std::vector<int> expected(height*width);
+
+    // Random initial cells
+    for (int i = 0; i < height*width; ++i) {
+      expected[i] = (random_float() > 0.7f)? 1 : 0;
+      a[i] = expected[i];
+    }
+
+    for (int gen = 0; gen < 6; ++gen) {
+      INFO("generation: " << gen);
+      expected = life_scalar(expected, height, width);
+
+      if (gen % 2 == 0) {
+        k.load(&b, &a, height, width).call();
+      } else {
+        k.load(&a, &b, height, width).call();
+      }
+
+      Int::Array &result = (gen % 2 == 0)? b : a;
+      for (int i = 0; i < height*width; ++i) {
+        INFO("y: " << i/width << ", x: " << i % width);
+        REQUIRE(result[i] == expected[i]);
+      }
+    }
+  }
+}
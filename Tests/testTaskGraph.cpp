@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for running kernels as a task graph
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <vector>
+#include "V3DLib.h"
+#include "TaskGraph.h"
+
+using namespace V3DLib;
+
+namespace {
+
+int const Size = 256;
+
+void scale_kernel(Float::Ptr dst, Float::Ptr src, Float factor, Int size) {
+  For (Int i = 16*me(), i < size, i += 16*numQPUs())
+    Float val = src[i];
+    dst[i] = factor*val;
+  End
+}
+
+
+void add_kernel(Float::Ptr dst, Float::Ptr a, Float::Ptr b, Int size) {
+  For (Int i = 16*me(), i < size, i += 16*numQPUs())
+    Float x = a[i];
+    Float y = b[i];
+    dst[i] = x + y;
+  End
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test task graph [taskgraph]") {
+  Float::Array src1(Size), src2(Size), tmp1(Size), tmp2(Size), out(Size);
+
+  auto init = [&] () {
+    for (int i = 0; i < Size; ++i) {
+      src1[i] = (float) i;
+      src2[i] = (float) (2*i);
+    }
+    tmp1.fill(0); tmp2.fill(0); out.fill(0);
+  };
+
+  auto k1 = compile(scale_kernel);
+  auto k2 = compile(scale_kernel);
+  auto k3 = compile(add_kernel);
+  auto k4 = compile(scale_kernel);
+
+  k1.load(&tmp1, &src1, 2.0f, Size);
+  k2.load(&tmp2, &src2, 3.0f, Size);
+  k3.load(&out, &tmp1, &tmp2, Size);
+  k4.load(&src1, &src2, 0.5f, Size);  // Overwrites input of first task
+
+  TaskGraph g;
+  REQUIRE(g.add("scale1", k1, {src1}, {tmp1}) == 0);
+  REQUIRE(g.add("scale2", k2, {src2}, {tmp2}) == 1);
+  REQUIRE(g.add("add",    k3, {tmp1, tmp2}, {out}) == 2);
+  REQUIRE(g.add("reset",  k4, {src2}, {src1}) == 3);
+
+  SUBCASE("Dependencies should be derived from the buffers") {
+    REQUIRE(g.dependencies(0).empty());
+    REQUIRE(g.dependencies(1).empty());
+    REQUIRE(g.dependencies(2) == std::vector<int>({0, 1}));
+    REQUIRE(g.dependencies(3) == std::vector<int>({0}));   // write after read
+  }
+
+  SUBCASE("Disjoint views on the same array should be independent") {
+    Float::Array arr(64);
+    auto lo = arr.view(0, 32);
+    auto hi = arr.view(32, 32);
+    auto k5 = compile(scale_kernel);
+    auto k6 = compile(scale_kernel);
+    auto k7 = compile(scale_kernel);
+
+    TaskGraph g2;
+    g2.add("lo",  k5, {}, {lo});
+    g2.add("hi",  k6, {}, {hi});
+    g2.add("all", k7, {arr}, {});
+    REQUIRE(g2.dependencies(1).empty());
+    REQUIRE(g2.dependencies(2) == std::vector<int>({0, 1}));
+  }
+
+  auto check = [&] () {
+    for (int i = 0; i < Size; ++i) {
+      INFO("i: " << i);
+      REQUIRE(out[i] == 2.0f*(float) i + 3.0f*2*(float) i);
+      REQUIRE(src1[i] == (float) i);  // src2*0.5
+    }
+  };
+
+  SUBCASE("Emulator, multiple threads") {
+    for (int threads : {1, 2, 4}) {
+      init();
+      g.run(TaskGraph::EMULATE, threads);
+      check();
+
+      std::string trace = g.trace();
+      INFO(trace);
+      REQUIRE(trace.find("scale2") != std::string::npos);
+      REQUIRE(g.trace_json().find("\"name\": \"add\"") != std::string::npos);
+      REQUIRE(g.max_concurrency() <= threads);
+    }
+  }
+
+  SUBCASE("Interpreter, multiple threads") {
+    init();
+    k1.setNumQPUs(4);
+    k3.setNumQPUs(2);
+    g.run(TaskGraph::INTERPRET, 3);
+    check();
+  }
+
+  SUBCASE("Default mode") {
+    init();
+    g.run();
+    check();
+  }
+}
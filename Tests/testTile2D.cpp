@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for the double-buffered DMA tile transfers
+//
+// DMA is vc4 only, and not supported by the interpreter; only the emulator is used.
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <V3DLib.h>
+#include "vc4/DMA/Tile2D.h"
+
+using namespace V3DLib;
+
+namespace {
+
+int const ROWS  = 4;
+int const COLS  = 12;
+int const PITCH = 20;  // Values between rows in main memory; the values beyond COLS may not be touched
+
+
+/**
+ * Process `num_tiles` consecutive tiles per QPU, with value = 2*value + 1
+ *
+ * Each QPU handles its own range of tiles.
+ */
+void tile_kernel(Int::Ptr src, Int::Ptr dst, Int num_tiles) {
+  Int offset = me()*num_tiles*(ROWS*PITCH);
+  src += offset;  // DMA only uses the address in lane 0
+  dst += offset;
+
+  Tile2D tile(ROWS, COLS, PITCH);
+  tile.load(src);
+
+  For (Int i = 0, i < num_tiles, i++)
+    tile.wait_load();
+
+    src += ROWS*PITCH;
+    If (i + 1 < num_tiles)
+      tile.load(src);
+    End
+
+    Int x;
+    for (int r = 0; r < ROWS; r++) {
+      tile.read(r, x);
+      tile.write(r, 2*x + 1);
+    }
+
+    tile.store(dst);
+    dst += ROWS*PITCH;
+  End
+
+  tile.wait_store();
+}
+
+
+void check_tiles(int num_qpus, int num_tiles) {
+  int const size = num_qpus*num_tiles*ROWS*PITCH;
+
+  Int::Array src(size);
+  Int::Array dst(size);
+
+  for (int i = 0; i < size; i++) {
+    src[i] = i;
+  }
+  dst.fill(-1);
+
+  auto k = compile(tile_kernel, CompileFor::VC4);
+  k.setNumQPUs(num_qpus);
+  k.load(&src, &dst, num_tiles);
+  k.emu();
+
+  for (int i = 0; i < size; i++) {
+    INFO("num QPUs: " << num_qpus << ", index: " << i);
+    int col = i % PITCH;
+
+    if (col < COLS) {
+      REQUIRE(dst[i] == 2*i + 1);
+    } else {
+      REQUIRE(dst[i] == -1);
+    }
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Tile2D should transfer tiles with double buffering [dsl][tile2d]") {
+  REQUIRE(Tile2D::max_qpus(ROWS) == 2);
+
+  SUBCASE("Single QPU") {
+    check_tiles(1, 1);
+    check_tiles(1, 5);
+  }
+
+  SUBCASE("Multiple QPUs") {
+    check_tiles(2, 3);
+  }
+
+  SUBCASE("More QPUs than fit in the VPM should be refused") {
+    auto k = compile(tile_kernel, CompileFor::VC4);
+    REQUIRE(k.vc4().compile_stats().max_qpus == 2);
+    REQUIRE_THROWS(k.setNumQPUs(3));
+    REQUIRE_NOTHROW(k.setNumQPUs(2));
+  }
+}
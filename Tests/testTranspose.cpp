@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// Tests for matrix transposition, on host and QPU
+///////////////////////////////////////////////////////////////////////////////
+#include "doctest.h"
+#include <vector>
+#include "V3DLib.h"
+#include "Kernels/Transpose.h"
+#include "Kernels/Matrix.h"
+
+using namespace V3DLib;
+using namespace kernels;
+
+namespace {
+
+template<typename Array2D>
+void fill_sequence(Array2D &a) {
+  for (int r = 0; r < a.rows(); ++r) {
+    for (int c = 0; c < a.columns(); ++c) {
+      a[r][c] = 1000*r + c;
+    }
+  }
+}
+
+
+template<typename Array2D>
+void check_transposed(Array2D const &dst, Array2D const &src) {
+  REQUIRE(dst.rows() == src.columns());
+  REQUIRE(dst.columns() == src.rows());
+
+  for (int r = 0; r < src.rows(); ++r) {
+    for (int c = 0; c < src.columns(); ++c) {
+      INFO("r: " << r << ", c: " << c);
+      REQUIRE(dst[c][r] == src[r][c]);
+    }
+  }
+}
+
+
+/**
+ * Kernel which transposes a single 16x16 block
+ */
+void block_kernel(Int::Ptr dst, Int::Ptr src) {
+  std::vector<Int> block(16);
+
+  for (int i = 0; i < 16; ++i) {
+    block[i] = *src;
+    src += 16;
+  }
+
+  transpose_block(block);
+
+  for (int i = 0; i < 16; ++i) {
+    *dst = block[i];
+    dst += 16;
+  }
+}
+
+}  // anon namespace
+
+
+TEST_CASE("Test matrix transposition [transpose]") {
+
+  SUBCASE("Host transpose should handle any shape") {
+    std::vector<std::pair<int, int>> shapes = {{16, 16}, {1, 16}, {16, 1}, {48, 80}, {80, 48}, {37, 16}, {8, 34}};
+
+    for (auto const &shape : shapes) {
+      Int::Array2D src(shape.first, shape.second);
+      fill_sequence(src);
+
+      Int::Array2D dst;
+      dst.copy_transposed(src);
+      check_transposed(dst, src);
+    }
+  }
+
+
+  SUBCASE("Host transpose should work on views") {
+    Int::Array2D src(32, 48);
+    fill_sequence(src);
+    auto src_block = src.view(8, 16, 16, 17);
+
+    Int::Array2D dst(64, 32);
+    dst.fill(-1);
+    auto dst_block = dst.view(4, 8, 17, 16);
+    dst_block.copy_transposed(src_block);
+
+    check_transposed(dst_block, src_block);
+    REQUIRE(dst[3][8] == -1);
+    REQUIRE(dst[4][7] == -1);
+    REQUIRE(dst[4][24] == -1);
+    REQUIRE(dst[21][8] == -1);
+  }
+
+
+  SUBCASE("16x16 block should transpose on emulator and interpreter") {
+    Int::Array src(256);
+    Int::Array dst(256);
+    for (int i = 0; i < 256; ++i) src[i] = i;
+
+    auto k = compile(block_kernel);
+    k.load(&dst, &src);
+
+    dst.fill(-1);
+    k.emu();
+    for (int i = 0; i < 256; ++i) {
+      INFO("i: " << i);
+      REQUIRE(dst[i] == 16*(i % 16) + i/16);
+    }
+
+    dst.fill(-1);
+    k.interpret();
+    for (int i = 0; i < 256; ++i) {
+      INFO("i: " << i);
+      REQUIRE(dst[i] == 16*(i % 16) + i/16);
+    }
+  }
+
+
+  SUBCASE("QPU transpose should handle rectangular arrays") {
+    std::vector<std::pair<int, int>> shapes = {{16, 16}, {32, 64}, {64, 32}, {48, 16}};
+
+    for (int num_qpus : {1, 3, 8}) {
+      for (auto const &shape : shapes) {
+        INFO("QPUs: " << num_qpus << ", shape: " << shape.first << "x" << shape.second);
+        Int::Array2D src(shape.first, shape.second);
+        fill_sequence(src);
+
+        Int::Array2D dst;
+        transpose(dst, src, num_qpus);
+        check_transposed(dst, src);
+      }
+    }
+  }
+
+
+  SUBCASE("Matrix multiplication with b transposed on the QPU") {
+    int const Dim = 32;
+
+    Float::Array2D a(Dim, Dim);
+    Float::Array2D b(Dim, Dim);
+
+    for (int r = 0; r < Dim; ++r) {
+      for (int c = 0; c < Dim; ++c) {
+        a[r][c] = (float) ((r + c) % 5);
+        b[r][c] = (float) ((r*c) % 7);
+      }
+    }
+
+    Float::Array2D b_transposed;
+    transpose(b_transposed, b);
+
+    Float::Array2D b_host;
+    b_host.copy_transposed(b);
+    REQUIRE(b_transposed == b_host);
+
+    Matrix<Float::Array2D> m(a, b_transposed);
+    m.setNumQPUs(1);
+    m.call();
+
+    auto &result = m.result();
+    for (int r = 0; r < Dim; ++r) {
+      for (int c = 0; c < Dim; ++c) {
+        float expected = 0;
+        for (int i = 0; i < Dim; ++i) expected += a[r][i]*b[i][c];
+
+        INFO("r: " << r << ", c: " << c);
+        REQUIRE(result[r][c] == expected);
+      }
+    }
+  }
+}
@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// Ahead-of-time compilation of kernels
+//
+// Compiles a fixed set of kernels and writes them as C++ source files,
+// which can be run with `PrecompiledKernel` without compiling at runtime.
+// For each kernel, a header and a source file is written, named after the kernel.
+//
+// Usage: precompile [options]
+//
+//   -h            - Show this help text
+//   -list         - List the names of the kernels and exit
+//   -dir=<path>   - Output directory for the generated files (default: current directory)
+//
+// To precompile your own kernels, add them in `add_kernels()` below.
+///////////////////////////////////////////////////////////////////////////////
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "V3DLib.h"
+#include "KernelWriter.h"
+#include "Kernels/Rot3D.h"
+
+using namespace V3DLib;
+
+namespace {
+
+void hello(Int::Ptr p) {
+  *p = 1;
+}
+
+
+/**
+ * Kernels to precompile.
+ *
+ * The kernels are compiled only when they are written, so that listing is fast.
+ */
+struct Registry {
+  std::vector<std::string> names;
+  std::vector<std::function<void(std::string const &dir)>> writers;
+
+  template <typename... ts>
+  void add(char const *name, void (*f)(ts... params)) {
+    names.push_back(name);
+    writers.push_back([name, f] (std::string const &dir) {
+      auto k = compile(f);
+      KernelWriter(name, k).write(dir);
+    });
+  }
+};
+
+
+void add_kernels(Registry &reg) {
+  reg.add("hello", hello);
+  reg.add("rot3D", kernels::rot3D_1a);
+}
+
+
+struct CmdLine {
+  bool help = false;
+  bool list = false;
+  std::string dir = ".";
+};
+
+
+bool get_value(std::string const &arg, char const *prefix, std::string &value) {
+  std::string p = prefix;
+  if (arg.compare(0, p.size(), p) != 0) return false;
+  value = arg.substr(p.size());
+  return true;
+}
+
+
+bool parse(int argc, char const *argv[], CmdLine &cmd) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string val;
+
+    if (arg == "-h" || arg == "--help")           cmd.help = true;
+    else if (arg == "-list")                       cmd.list = true;
+    else if (get_value(arg, "-dir=", val))         cmd.dir = val;
+    else {
+      fprintf(stderr, "Unknown argument '%s', use -h for help\n", arg.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+void usage() {
+  printf(
+    "Usage: precompile [options]\n"
+    "\n"
+    "  -h            - Show this help text\n"
+    "  -list         - List the names of the kernels and exit\n"
+    "  -dir=<path>   - Output directory for the generated files (default: current directory)\n"
+  );
+}
+
+}  // anon namespace
+
+
+int main(int argc, char const *argv[]) {
+  CmdLine cmd;
+  if (!parse(argc, argv, cmd)) return 1;
+
+  if (cmd.help) {
+    usage();
+    return 0;
+  }
+
+  Registry reg;
+  add_kernels(reg);
+
+  if (cmd.list) {
+    for (auto const &name : reg.names) printf("%s\n", name.c_str());
+    return 0;
+  }
+
+  try {
+    for (int i = 0; i < (int) reg.names.size(); i++) {
+      reg.writers[i](cmd.dir);
+      printf("Written kernel '%s'\n", reg.names[i].c_str());
+    }
+  } catch (std::exception const &e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
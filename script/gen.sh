@@ -51,6 +51,9 @@ EXAMPLES_SUPPORT=$(find Examples/Support -name '*.cpp')
 # TODO remove final line with two spaces (need bash equivalent of 'chomp')
 EXAMPLES_EXTRA=$(echo "$EXAMPLES_SUPPORT" | sed "s/\\.cpp$/\\.o  \\\\/g" | sed "s/^/  /")
 
+BENCH_SOURCES=$(find Bench -name '*.cpp')
+BENCH_FILES=$(echo "$BENCH_SOURCES" | sed "s/\\.cpp$/\\.o  \\\\/g" | sed "s/^/  /")
+
 # Get list of executables
 # NOTE: grepping on 'main(' is not fool-proof, of course.
 EXE1=$(grep -rl "main(" Examples/ Tools/)
@@ -82,4 +85,8 @@ $EXAMPLES_EXTRA
 TESTS_FILES := \\
 $OBJ_TEST
 
+# Benchmark suite
+BENCH_FILES := \\
+$BENCH_FILES
+
 END
@@ -34,6 +34,8 @@ OBJ := \
   Source/BExpr.o  \
   Source/Int.o  \
   Source/Functions.o  \
+  Source/Function.o  \
+  Source/Math.o  \
   Source/gather.o  \
   Source/Op.o  \
   Source/Expr.o  \
@@ -41,6 +43,7 @@ OBJ := \
   Source/CExpr.o  \
   Source/Float.o  \
   Source/Complex.o  \
+  Source/Packed.o  \
   Source/Var.o  \
   Source/Stmt.o  \
   Support/debug.o  \
@@ -61,6 +64,11 @@ OBJ := \
   Kernels/Rot3D.o  \
   Kernels/ComplexDotVector.o  \
   Kernels/Matrix.o  \
+  Kernels/Stencil.o  \
+  Kernels/Reduce.o  \
+  Kernels/Transpose.o  \
+  Kernels/Scan.o  \
+  Kernels/Sort.o  \
   Liveness/Range.o  \
   Liveness/LiveSet.o  \
   Liveness/UseDef.o  \
@@ -85,6 +93,7 @@ OBJ := \
   v3d/Driver.o  \
   v3d/RegisterMapping.o  \
   v3d/KernelDriver.o  \
+  v3d/Invoke.o  \
   vc4/PerformanceCounters.o  \
   vc4/Mailbox.o  \
   vc4/BufferObject.o  \
@@ -97,9 +106,17 @@ OBJ := \
   vc4/DMA/DMA.o  \
   vc4/DMA/LoadStore.o  \
   vc4/DMA/Operations.o  \
+  vc4/DMA/Tile2D.o  \
+  cpu/CodeGen.o  \
+  cpu/NativeKernel.o  \
   vc4/vc4.o  \
   vc4/KernelDriver.o  \
   KernelDriver.o  \
+  KernelCache.o  \
+  TaskGraph.o  \
+  SplitKernel.o  \
+  PrecompiledKernel.o  \
+  KernelWriter.o  \
   v3d/instr/v3d_api.o  \
   vc4/dump_instr.o  \
 
@@ -120,6 +137,7 @@ EXAMPLES := \
   walsh  \
   mult  \
   detectPlatform  \
+  precompile  \
 
 # support files for examples
 EXAMPLES_EXTRA := \
@@ -135,6 +153,21 @@ TESTS_FILES := \
   Tests/testRot3D.o  \
   Tests/testPrefetch.o  \
   Tests/testFunctions.o  \
+  Tests/testMath.o  \
+  Tests/testKernelCache.o  \
+  Tests/testTaskGraph.o  \
+  Tests/testSplitKernel.o  \
+  Tests/testPrecompiled.o  \
+  Tests/testStencil.o  \
+  Tests/testReduce.o  \
+  Tests/testTranspose.o  \
+  Tests/testScan.o  \
+  Tests/testSort.o  \
+  Tests/testPacked.o  \
+  Tests/testForEachItem.o  \
+  Tests/testForEachTile.o  \
+  Tests/testTile2D.o  \
+  Tests/testCpu.o  \
   Tests/support/ProfileOutput.o  \
   Tests/support/disasm_kernel.o  \
   Tests/support/rotate_kernel.o  \
@@ -150,3 +183,8 @@ TESTS_FILES := \
   Tests/testCmdLine.o  \
   Tests/support/qpu_disasm.o  \
 
+# Benchmark suite
+BENCH_FILES := \
+  Bench/Benchmark.o  \
+  Bench/bench.o  \
+